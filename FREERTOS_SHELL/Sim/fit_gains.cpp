@@ -0,0 +1,335 @@
+//**************************************************************************************
+/** \file fit_gains.cpp
+ *    This file contains a PC program which works out the speed band table in
+ *    drive_control.cpp from open loop step responses of one wheel. Each log is of the
+ *    wheel started from rest at a fixed duty cycle, as "sim open --csv" writes them: a
+ *    header line naming the columns t, pwm and position, then one line per control
+ *    pass with the time (s), the duty cycle (percent) and the encoder count (ticks).
+ *    Logs taken on the robot need only be put in the same form.
+ *
+ *    Usage: fit_gains [options] LOG.csv...
+ *    Options: --rate HZ  --pwm_scale N  --wn RAD_PER_S  --zeta Z
+ *
+ *    From each log the wheel's final speed is the slope of a straight line fitted to
+ *    the last part of the run. A motor with a time constant tau ends up tau behind
+ *    where it would be had it started at that speed at once, so where the line meets
+ *    the time axis gives tau. Between each pair of logs, the duty cycles and final
+ *    speeds give the feedforward: a slope kV and, where the line meets zero speed, the
+ *    duty cycle kS it takes to get past static friction. Speeding the wheel up by a
+ *    tick/s every second takes tau kV more, which is kA. With the feedforward taking
+ *    care of the speed, the wheel from the linear signal to its position is K / (s
+ *    (tau s + 1)), K being 1 / kV; with the proportional gain on the position error
+ *    and the derivative gain on the speed, the closed loop is
+ *
+ *        tau s^2 + (1 + K kd) s + K kp = 0
+ *
+ *    so kp and kd are picked to give it the natural frequency and damping asked for.
+ *    The integral is made slow enough not to upset that, with a zero at a fifth of the
+ *    natural frequency. Each log gets a band of its own, reaching to halfway to the
+ *    next log's speed.
+ *
+ *    The table is printed as C, ready to paste into drive_control.cpp.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#define FIT_STEADY_FRACTION 0.4				// Last part of each log taken as steady
+#define FIT_STEADY_TOLERANCE 0.05			// Its two halves' speeds may differ this much
+#define FIT_LINE_MAX 256					// Longest line read from a log
+#define FIT_COLUMNS_MAX 16					// Most columns a log can have
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   What one step response says about the wheel.
+ */
+
+struct step_fit
+{
+	const char* name;						// The log it came from
+	double pwm;								// Duty cycle, percent
+	double speed;							// Final speed, ticks/s
+	double tau;								// Time constant, s
+};
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Options from the command line.
+ */
+
+struct fit_options
+{
+	double rate_hz;							// Control passes per second
+	double pwm_scale;						// As in drive_gains
+	double wn;								// Closed loop natural frequency, rad/s
+	double zeta;							// Closed loop damping ratio
+};
+
+
+//-------------------------------------------------------------------------------------
+/** This function fits a straight line to part of a log by least squares.
+ *  @param t The times
+ *  @param p The positions
+ *  @param first The first sample to use
+ *  @param last One past the last sample to use
+ *  @param slope Set to the slope (ticks/s)
+ *  @param intercept Set to the position at t = 0 (ticks)
+ */
+
+static void fit_line (const std::vector<double>& t, const std::vector<double>& p,
+					  size_t first, size_t last, double& slope, double& intercept)
+{
+	double n = (double)(last - first);
+	double st = 0.0, sp = 0.0, stt = 0.0, stp = 0.0;
+	for (size_t i = first; i < last; i++)
+	{
+		st += t[i];
+		sp += p[i];
+		stt += t[i] * t[i];
+		stp += t[i] * p[i];
+	}
+	double denominator = n * stt - st * st;
+	slope = (denominator != 0.0) ? (n * stp - st * sp) / denominator : 0.0;
+	intercept = (sp - slope * st) / n;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function reads a log and works out the wheel's final speed and time constant.
+ *  @param name The file name
+ *  @param fit Filled in from the log
+ *  @return True if the log could be used
+ */
+
+static bool fit_log (const char* name, step_fit& fit)
+{
+	FILE* file = fopen (name, "r");
+	if (file == NULL)
+	{
+		fprintf (stderr, "%s: cannot read\n", name);
+		return false;
+	}
+
+	// The header says which column is which
+	char line[FIT_LINE_MAX];
+	int col_t = -1, col_pwm = -1, col_pos = -1;
+	if (fgets (line, sizeof (line), file) != NULL)
+	{
+		int col = 0;
+		for (char* field = strtok (line, ",\r\n"); field != NULL; field = strtok (NULL, ",\r\n"))
+		{
+			if (strcmp (field, "t") == 0) col_t = col;
+			else if (strcmp (field, "pwm") == 0) col_pwm = col;
+			else if (strcmp (field, "position") == 0) col_pos = col;
+			col++;
+		}
+	}
+	if (col_t < 0 || col_pwm < 0 || col_pos < 0)
+	{
+		fprintf (stderr, "%s: needs columns t, pwm and position\n", name);
+		fclose (file);
+		return false;
+	}
+
+	std::vector<double> t, p;
+	fit.pwm = 0.0;
+	while (fgets (line, sizeof (line), file) != NULL)
+	{
+		double value[FIT_COLUMNS_MAX];
+		int col = 0;
+		for (char* field = strtok (line, ",\r\n"); field != NULL && col < FIT_COLUMNS_MAX;
+			 field = strtok (NULL, ",\r\n"))
+		{
+			value[col++] = atof (field);
+		}
+		if (col <= col_t || col <= col_pwm || col <= col_pos)
+		{
+			continue;
+		}
+		t.push_back (value[col_t]);
+		p.push_back (value[col_pos]);
+		fit.pwm = value[col_pwm];
+	}
+	fclose (file);
+
+	size_t n = t.size ();
+	size_t first = n - (size_t)(n * FIT_STEADY_FRACTION);
+	size_t middle = (first + n) / 2;
+	if (n < 10 || fit.pwm == 0.0)
+	{
+		fprintf (stderr, "%s: too short, or no duty cycle\n", name);
+		return false;
+	}
+
+	// The final speed, and that the wheel really had got there
+	double slope, intercept, slope_a, slope_b, unused;
+	fit_line (t, p, first, n, slope, intercept);
+	fit_line (t, p, first, middle, slope_a, unused);
+	fit_line (t, p, middle, n, slope_b, unused);
+	if (slope == 0.0 || (slope > 0.0) != (fit.pwm > 0.0))
+	{
+		fprintf (stderr, "%s: the wheel didn't turn the way it was driven\n", name);
+		return false;
+	}
+	if (fabs (slope_b - slope_a) > FIT_STEADY_TOLERANCE * fabs (slope))
+	{
+		fprintf (stderr, "%s: warning, speed still changing at the end; log for longer\n",
+				 name);
+	}
+
+	fit.name = name;
+	fit.pwm = fabs (fit.pwm);
+	fit.speed = fabs (slope);
+	fit.tau = -intercept / slope - t[0];
+	return true;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function rounds a value to the nearest int16_t.
+ */
+
+static long fit_round (double value)
+{
+	return lround (fmax (-32767.0, fmin (32767.0, value)));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function prints how to use the program.
+ */
+
+static int usage (void)
+{
+	printf ("Usage: fit_gains [options] LOG.csv...\n"
+			"  Each log is one wheel started from rest at a fixed duty cycle, with\n"
+			"  columns t, pwm and position, as \"sim open --csv\" writes. Give logs at\n"
+			"  two or more duty cycles to fit the static friction.\n"
+			"  --rate HZ         control passes per second (default 100)\n"
+			"  --pwm_scale N     as in drive_gains_default (default 100)\n"
+			"  --wn W            closed loop natural frequency, rad/s (default 12)\n"
+			"  --zeta Z          closed loop damping ratio (default 0.8)\n");
+	return 1;
+}
+
+
+int main (int argc, char** argv)
+{
+	fit_options opt;
+	opt.rate_hz = 100.0;
+	opt.pwm_scale = 100.0;
+	opt.wn = 12.0;
+	opt.zeta = 0.8;
+
+	std::vector<step_fit> fits;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp (argv[i], "--rate") == 0 && i + 1 < argc)
+		{
+			opt.rate_hz = atof (argv[++i]);
+		}
+		else if (strcmp (argv[i], "--pwm_scale") == 0 && i + 1 < argc)
+		{
+			opt.pwm_scale = atof (argv[++i]);
+		}
+		else if (strcmp (argv[i], "--wn") == 0 && i + 1 < argc)
+		{
+			opt.wn = atof (argv[++i]);
+		}
+		else if (strcmp (argv[i], "--zeta") == 0 && i + 1 < argc)
+		{
+			opt.zeta = atof (argv[++i]);
+		}
+		else if (argv[i][0] == '-')
+		{
+			return usage ();
+		}
+		else
+		{
+			step_fit fit;
+			if (!fit_log (argv[i], fit))
+			{
+				return 1;
+			}
+			fits.push_back (fit);
+		}
+	}
+	if (fits.empty () || opt.rate_hz <= 0.0 || opt.wn <= 0.0)
+	{
+		return usage ();
+	}
+	std::sort (fits.begin (), fits.end (),
+			   [] (const step_fit& a, const step_fit& b) { return a.speed < b.speed; });
+
+	size_t n = fits.size ();
+	printf ("// Made by Sim/fit_gains from open loop step responses at");
+	for (size_t i = 0; i < n; i++)
+	{
+		printf ("%s %.0f", (i == 0) ? "" : (i + 1 == n) ? " and" : ",", fits[i].pwm);
+	}
+	printf ("%% PWM\n#define DRIVE_BANDS %u\n", (unsigned)n);
+	printf ("\t// speed, kp_l, ki_l, kd_l, kv, ka, ks\n");
+
+	for (size_t i = 0; i < n; i++)
+	{
+		// The feedforward is the line through this log's point and the next one's; the
+		// fastest band uses the line from the one before
+		double kv = fits[i].pwm / fits[i].speed;
+		double ks = 0.0;
+		if (n > 1)
+		{
+			size_t lo = (i + 1 < n) ? i : i - 1;
+			double dv = fits[lo + 1].speed - fits[lo].speed;
+			if (dv > 0.0)
+			{
+				kv = (fits[lo + 1].pwm - fits[lo].pwm) / dv;
+				ks = fmax (0.0, fits[lo].pwm - kv * fits[lo].speed);
+			}
+		}
+
+		// Pole placement for the wheel, in percent per tick, per tick/s and per tick s
+		double gain = 1.0 / kv;
+		double tau = fmax (fits[i].tau, 1.0 / opt.rate_hz);
+		double kp = tau * opt.wn * opt.wn / gain;
+		double kd = fmax (0.0, (2.0 * opt.zeta * opt.wn * tau - 1.0) / gain);
+		double ki = kp * opt.wn / 5.0;
+
+		// In the firmware's units. The integral is added once a pass, and a gain which
+		// rounds to nothing is kept at 1 so the wheel still gets to its setpoint
+		long kp_l = fit_round (kp * opt.pwm_scale);
+		long ki_l = fit_round (ki * opt.pwm_scale / opt.rate_hz);
+		long kd_l = fit_round (kd * opt.pwm_scale);
+		if (ki_l < 1)
+		{
+			ki_l = 1;
+		}
+		long speed = (i + 1 < n) ? fit_round ((fits[i].speed + fits[i + 1].speed) / 2.0)
+								 : 32767;
+		printf ("\t{ %ld, %ld, %ld, %ld, %ld, %ld, %ld }%s\t// %s: %.0f ticks/s, tau %.3f s\n",
+				speed, kp_l, ki_l, kd_l, fit_round (kv * opt.pwm_scale * 256.0),
+				fit_round (kv * tau * opt.pwm_scale * 256.0), fit_round (ks * opt.pwm_scale), (i + 1 < n) ? "," : "",
+				fits[i].name, fits[i].speed, fits[i].tau);
+	}
+	return 0;
+}
@@ -0,0 +1,98 @@
+//**************************************************************************************
+/** \file FreeRTOSConfig.h
+ *    This file configures FreeRTOS for the PC build of the task set, which runs on the
+ *    POSIX port of FreeRTOS. The settings follow those in 
+ *    Source/lib/freertos/FreeRTOSConfig.h so that tasks see the same tick rate, 
+ *    priorities and API; only the parts which depend on the AVR are different. 
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file, copied from the AVR configuration
+ *
+ *  License:
+ *    This file is part of the FreeRTOS distribution and is covered by its license.
+ */
+//**************************************************************************************
+
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+#include <stddef.h>
+#include <avr/io.h>
+
+/** The tick is 1 ms, as on the AVR, so that delays and loop periods match. The POSIX
+ *  port makes the tick from a Linux interval timer.
+ */
+#define configTICK_RATE_HZ              ( ( portTickType ) 1000 )
+#define configUSE_PREEMPTION            1
+
+/** The CPU clock is that of the AVR, so that code which converts timer counts to time
+ *  gets the same answers. F_CPU is set in the Makefile.
+ */
+#define configCPU_CLOCK_HZ              ( F_CPU )
+
+/** This macro converts milliseconds to ticks, as in the AVR configuration.
+ */
+#define configMS_TO_TICKS(x)            ((((x) * configTICK_RATE_HZ / 1000) > 0) \
+                                        ? ((x) * configTICK_RATE_HZ / 1000) : 1)
+
+#define configUSE_TRACE_FACILITY        0
+#define configGENERATE_RUN_TIME_STATS   0
+
+/** One more priority than on the AVR, so that the plant model can run above all of
+ *  the robot's tasks. The robot's tasks keep the priorities they have in main.cpp.
+ */
+#define configMAX_PRIORITIES            ( ( unsigned portBASE_TYPE ) 5 )
+
+/** Each task runs on its own pthread stack on the PC, so this is only the size of the
+ *  dummy stack which FreeRTOS allocates and then doesn't use.
+ */
+#define configMINIMAL_STACK_SIZE        ( ( unsigned short ) 100 )
+
+/** The heap used by heap_2.c. Since the dummy stacks are allocated from here, it's
+ *  larger than the AVR's; there is no point in running out of it on a PC.
+ */
+#define configTOTAL_HEAP_SIZE           ( ( size_t ) ( 256 * 1024 ) )
+
+#define configMAX_TASK_NAME_LEN         ( 10 )
+#define configUSE_IDLE_HOOK             0
+#define configUSE_TICK_HOOK             0
+#define configUSE_16_BIT_TICKS          0
+#define configIDLE_SHOULD_YIELD         1
+#define configQUEUE_REGISTRY_SIZE       0
+#define configUSE_MUTEXES               1
+#define configUSE_CO_ROUTINES           0
+#define configMAX_CO_ROUTINE_PRIORITIES ( 2 )
+
+#define INCLUDE_vTaskPrioritySet                 1
+#define INCLUDE_uxTaskPriorityGet                1
+#define INCLUDE_vTaskDelete                      0
+#define INCLUDE_vTaskCleanUpResources            0
+#define INCLUDE_vTaskSuspend                     0
+#define INCLUDE_vTaskDelayUntil                  1
+#define INCLUDE_vTaskDelay                       1
+#define INCLUDE_pcTaskGetTaskName                1
+#define INCLUDE_uxTaskGetStackHighWaterMark      1
+#define INCLUDE_xTaskGetIdleTaskHandle           1
+
+/** The AVR port counts its timer clock with this prescaler, and the time stamp code
+ *  divides by it. The POSIX port doesn't have one.
+ */
+#ifndef portCLOCK_PRESCALER
+	#define portCLOCK_PRESCALER         1
+#endif
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+/** The AVR port leaves the top of each new task's stack here so that frt_task can
+ *  print stack dumps. The POSIX port doesn't, so rtos_main.cpp points it into a dummy
+ *  area which is safe to dump.
+ */
+extern size_t portStackTopForTask;
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,148 @@
+//**************************************************************************************
+/** \file pty_stream.cpp
+ *    This file contains a serial port for the PC build of the task set, which talks
+ *    through a Linux pseudo-terminal or through standard input and output. 
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"						// Primary header for FreeRTOS
+#include "task.h"							// For vTaskDelay()
+#include "pty_stream.h"						// Header for this file
+
+
+//-------------------------------------------------------------------------------------
+/** This constructor opens the serial port. A pseudo-terminal is opened in raw mode and
+ *  the name of its slave device, such as \c /dev/pts/3, is printed so the user knows
+ *  where to connect a terminal. 
+ *  @param use_stdio True to use standard input and output instead of a pseudo-terminal
+ */
+
+pty_stream::pty_stream (bool use_stdio)
+	: emstream ()
+{
+	next_char = -1;
+
+	if (use_stdio)
+	{
+		fd_in = STDIN_FILENO;
+		fd_out = STDOUT_FILENO;
+	}
+	else
+	{
+		fd_in = fd_out = posix_openpt (O_RDWR | O_NOCTTY);
+		if (fd_in < 0 || grantpt (fd_in) != 0 || unlockpt (fd_in) != 0)
+		{
+			perror ("Cannot open a pseudo-terminal");
+			fd_in = fd_out = -1;
+			return;
+		}
+
+		// Raw mode, so that control characters such as Ctrl-A reach task_user
+		struct termios settings;
+		if (tcgetattr (fd_in, &settings) == 0)
+		{
+			cfmakeraw (&settings);
+			tcsetattr (fd_in, TCSANOW, &settings);
+		}
+		printf ("Serial port is %s\n", ptsname (fd_in));
+		fflush (stdout);
+	}
+
+	fcntl (fd_in, F_SETFL, fcntl (fd_in, F_GETFL) | O_NONBLOCK);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method writes one character to the port. The write is retried if the tick
+ *  signal of the POSIX port happens to interrupt it.
+ *  @param chout The character to be sent out
+ *  @return True if the character was sent, false if the port isn't working
+ */
+
+bool pty_stream::putchar (char chout)
+{
+	while (fd_out >= 0)
+	{
+		ssize_t count = write (fd_out, &chout, 1);
+		if (count == 1)
+		{
+			return (true);
+		}
+		if (count < 0 && errno != EINTR && errno != EAGAIN)
+		{
+			return (false);
+		}
+	}
+	return (false);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method checks if there is a character waiting to be read. It reads ahead by
+ *  one character, which \c getchar() then returns.
+ *  @return True for character available, false for no character available
+ */
+
+bool pty_stream::check_for_char (void)
+{
+	if (next_char < 0 && fd_in >= 0)
+	{
+		unsigned char ch;
+		if (read (fd_in, &ch, 1) == 1)
+		{
+			next_char = ch;
+		}
+	}
+	return (next_char >= 0);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method gets one character from the port. If none is there yet, it waits a 
+ *  tick at a time for one to come in, letting the other tasks run meanwhile.
+ *  @return The character which was found in the port
+ */
+
+int16_t pty_stream::getchar (void)
+{
+	while (!check_for_char ())
+	{
+		vTaskDelay (1);
+	}
+	int16_t ch = next_char;
+	next_char = -1;
+	return (ch);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method sends the ASCII code to clear a display screen. 
+ */
+
+void pty_stream::clear_screen (void)
+{
+	putchar (CLRSCR_STYLE);
+}
@@ -0,0 +1,65 @@
+//**************************************************************************************
+/** \file pty_stream.h
+ *    This file contains a serial port for the PC build of the task set. It stands in
+ *    for the AVR's USART, which is what rs232 objects use on the robot. 
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _PTY_STREAM_H_
+#define _PTY_STREAM_H_
+
+#include "emstream.h"						// Pull in the base class header file
+
+
+//-------------------------------------------------------------------------------------
+/** This class is an emstream which talks through a Linux pseudo-terminal, so a
+ *  terminal program such as \c screen or \c picocom can be connected to it just as it
+ *  would be to the robot's USB serial adapter. It can also use the program's own
+ *  standard input and output, which is handier when a script runs the simulation.
+ *
+ *  Reads never block the calling thread, since under the POSIX port of FreeRTOS a
+ *  task's thread which blocks in the kernel stops the other tasks too. \c getchar()
+ *  waits for a character by delaying one tick at a time, as a task would on the AVR.
+ */
+
+class pty_stream : public emstream
+{
+	protected:
+		int fd_in;							///< File descriptor characters come from
+		int fd_out;							///< File descriptor characters go to
+		int16_t next_char;					///< Character read ahead, or -1 if none
+
+	public:
+		// The constructor opens a pseudo-terminal, or uses standard I/O
+		pty_stream (bool use_stdio = false);
+
+		bool putchar (char);				// Write one character
+		bool check_for_char (void);			// Check if a character has come in
+		int16_t getchar (void);				// Get a character; wait if none is ready
+		void clear_screen (void);			// Send the 'clear display screen' code
+
+		/// This method returns true if the port opened successfully.
+		bool is_open (void)
+		{
+			return (fd_in >= 0 && fd_out >= 0);
+		}
+};
+
+#endif // _PTY_STREAM_H_
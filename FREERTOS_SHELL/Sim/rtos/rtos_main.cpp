@@ -0,0 +1,547 @@
+//**************************************************************************************
+/** \file rtos_main.cpp
+ *    This file contains the main() code for the PC build of the robot's task set. The
+ *    same tasks which main.cpp starts on the XMEGA run here on the POSIX port of 
+ *    FreeRTOS, with a pseudo-terminal in place of the USART and the plant model in
+ *    sim_plant.cpp in place of the motors and encoders. 
+ *
+ *    Usage: rtos [--stdio] [--seconds N] [--goal X Y] [--slip PERCENT] [--no-imu]
+ *                [--vision LATENCY_MS]
+ *
+ *    With \c --seconds the program prints a report of task runs, loop timing and 
+ *    queue speed after N seconds and quits, which makes it usable in scripts. 
+ *    \c --slip makes the left encoder count that much too far, which the IMU's
+ *    heading should make up for; \c --no-imu runs without the IMU. \c --vision sends 
+ *    the true pose from a simulated vision tracker, that long after each picture.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 Plant task runs TCC1, which paces the motor control loop
+ *    \li 10-18-26 Plant task runs TCE0, which times the encoder edges
+ *    \li 10-18-26 Added the waypoint queue
+ *    \li 10-18-26 Plant task runs TCE1, which runs the odometry
+ *    \li 10-18-26 TCE1 runs free as the RTOS tick's timer; the odometry uses compare B
+ *    \li 10-18-26 Added the vision tracker
+ *    \li 10-18-26 Added the BNO080 IMU and encoder slip
+ *    \li 10-18-26 Reads the odometry's pose from its double buffered share
+ *    \li 10-18-26 Loads the parameter block, as main.cpp does
+ *    \li 10-18-26 The user interface task's stack is the size main.cpp gives it
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "FreeRTOS.h"                       // Primary header for FreeRTOS
+#include "task.h"                           // Header for FreeRTOS task functions
+#include "queue.h"                          // FreeRTOS inter-task communication queues
+
+#include "frt_task.h"                       // Header of wrapper for FreeRTOS tasks
+#include "frt_text_queue.h"                 // Wrapper for FreeRTOS character queues
+#include "frt_queue.h"                      // Header of wrapper for FreeRTOS queues
+#include "shares.h"                         // Global ('extern') queue declarations
+
+#include "task_user.h"                      // Header for user interface task
+#include "task_motor.h"                     // Header for motor task
+#include "task_Robot_State.h"               // Header for robot state task
+#include "task_diag.h"						// Header for diagnostic task
+#include "robot_params.h"					// Calibration, gains and limits
+
+#include "pty_stream.h"						// Serial port on a pseudo-terminal
+#include "sim_hw.h"							// Simulated peripherals
+#include "sim_plant.h"						// The motors, wheels and encoders
+#include "sim_imu.h"						// The BNO080 IMU
+#include "sim_vision.h"						// The vision tracker on the Pi
+
+#define SIM_PLANT_PERIOD_MS 1				// Plant integration step, one tick
+#define SIM_QUEUE_RUNS 10000				// Items through the queue when timing it
+
+static double sim_slip = 0.0;				// Extra the left encoder counts, as a fraction
+static bool sim_imu_fitted = true;			// False to run without the IMU
+
+#define SIM_VISION_PERIOD_MS 33				// Time between the tracker's pictures
+static int32_t sim_vision_latency = -1;		// Time from a picture to its pose; -1 for none
+#define SIM_STACK_AREA 8192					// Size of the dummy area for stack dumps
+
+frt_text_queue print_ser_queue (32, NULL, 10);
+frt_queue<waypoint> waypoint_queue (8, NULL, 0);	// task_user's 'p' puts, task_motor gets
+
+/// The tasks' stack dumps read from here, since their real stacks belong to pthreads
+static uint8_t dummy_stacks[SIM_STACK_AREA];
+size_t portStackTopForTask = (size_t)(dummy_stacks + SIM_STACK_AREA / 2);
+
+
+//-------------------------------------------------------------------------------------
+/** This function returns the time on the PC's monotonic clock.
+ *  @return The time in microseconds from some arbitrary start
+ */
+
+static int64_t wall_us (void)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	return ((int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000);
+}
+
+
+/// Timer clock dividers, indexed by the clock select bits in CTRLA
+static const uint16_t tc_prescales[] = { 0, 1, 2, 4, 8, 64, 256, 1024 };
+
+
+//-------------------------------------------------------------------------------------
+/** This function runs a timer on by some time, calling its overflow interrupt each
+ *  time it wraps around, as the XMEGA's timer would. The interrupt is called in a
+ *  critical section, since an ISR can't be interrupted by the RTOS tick. The control 
+ *  loop's latency measurement reads TCC1's count, which here only moves once a tick.
+ *  @param timer The timer
+ *  @param residue Clock cycles not yet counted, kept from one call to the next
+ *  @param overflow The timer's overflow interrupt
+ *  @param us How long to run the timer, in microseconds
+ */
+
+static void run_tc1 (TC1_t& timer, uint32_t& residue, void (*overflow)(void), uint32_t us)
+{
+	uint16_t prescale = tc_prescales[timer.CTRLA & 0x07];
+	if (prescale == 0)
+	{
+		return;
+	}
+	residue += us * (F_CPU / 1000000UL);
+	uint32_t count = timer.CNT + residue / prescale;
+	residue %= prescale;
+	while (count > timer.PER)
+	{
+		count -= (uint32_t)timer.PER + 1;
+		timer.CNT = 0;
+		taskENTER_CRITICAL ();
+		overflow ();
+		taskEXIT_CRITICAL ();
+	}
+	timer.CNT = (uint16_t)count;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function runs timer TCE1 on by some time, calling its compare channel B
+ *  interrupt each time the count passes CCB, if that interrupt is on. On the XMEGA the
+ *  RTOS tick runs TCE1 free at the CPU clock and uses compare channel A; here the tick
+ *  comes from the POSIX port, so channel A is left alone. 
+ *  @param us How long to run the timer, in microseconds
+ */
+
+static void run_tce1 (uint32_t us)
+{
+	static uint32_t residue = 0;			// Clock cycles not yet counted
+
+	uint16_t prescale = tc_prescales[TCE1.CTRLA & 0x07];
+	if (prescale == 0)
+	{
+		return;
+	}
+	residue += us * (F_CPU / 1000000UL);
+	uint32_t span = residue / prescale;
+	residue %= prescale;
+	while (span > 0)
+	{
+		uint32_t to_match = (uint16_t)(TCE1.CCB - TCE1.CNT);
+		if (to_match == 0)
+		{
+			to_match = 0x10000UL;			// Just matched; next time round
+		}
+		if (to_match > span || !(TCE1.INTCTRLB & TC1_CCBINTLVL_gm))
+		{
+			TCE1.CNT += (uint16_t)span;
+			break;
+		}
+		span -= to_match;
+		TCE1.CNT = TCE1.CCB;
+		taskENTER_CRITICAL ();
+		TCE1_CCB_vect ();
+		taskEXIT_CRITICAL ();
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function runs timer TCE0 on by some time, as run_tc1() does, and captures
+ *  the encoder edges which happened meanwhile. The XMEGA captures on each rising edge
+ *  of an encoder's first phase, which is once every 4 counts; here that is taken to be
+ *  whenever the count passes a multiple of 4. The plant's counts move in steps, so
+ *  the time of each edge is interpolated along the step. The capture and overflow
+ *  interrupts are called in the order the timer would raise them.
+ *  @param us How long to run the timer, in microseconds
+ */
+
+static void run_tce0 (uint32_t us)
+{
+	static uint32_t residue = 0;			// Clock cycles not yet counted
+	static uint16_t last_counts[2];			// Encoder counts at the last call
+	static int32_t positions[2];			// The same, unwrapped
+
+	uint16_t counts[2] = { TCD1.CNT, TCF0.CNT };
+	uint16_t prescale = tc_prescales[TCE0.CTRLA & 0x07];
+	if (prescale == 0)
+	{
+		last_counts[0] = counts[0];
+		last_counts[1] = counts[1];
+		return;
+	}
+	residue += us * (F_CPU / 1000000UL);
+	uint32_t span = residue / prescale;
+	residue %= prescale;
+	uint16_t start = TCE0.CNT;
+
+	// Each event is the timer count from the start of the step at which it happens,
+	// and which interrupt it raises: 0 and 1 capture on channels A and B, 2 overflows
+	const uint8_t max_events = 16;
+	uint32_t at[max_events];
+	uint8_t what[max_events];
+	uint8_t events = 0;
+	if (start + span > 0xFFFF)
+	{
+		at[events] = 0x10000UL - start;
+		what[events++] = 2;
+	}
+	for (uint8_t enc = 0; enc < 2; enc++)
+	{
+		int16_t moved = (int16_t)(counts[enc] - last_counts[enc]);
+		int32_t from = positions[enc];
+		int32_t to = from + moved;
+		int32_t step = (moved > 0) ? 4 : -4;
+		int32_t edge = (moved > 0) ? (from & ~3L) + 4 : ((from - 1) & ~3L);
+		for ( ; moved != 0 && events < max_events && (moved > 0 ? edge <= to : edge >= to);
+			  edge += step)
+		{
+			at[events] = (uint32_t)((int64_t)span * (edge - from) / moved);
+			what[events++] = enc;
+		}
+		positions[enc] = to;
+		last_counts[enc] = counts[enc];
+	}
+
+	// Sort by time; there are only a few
+	for (uint8_t i = 1; i < events; i++)
+	{
+		for (uint8_t j = i; j > 0 && at[j] < at[j - 1]; j--)
+		{
+			uint32_t a = at[j]; at[j] = at[j - 1]; at[j - 1] = a;
+			uint8_t w = what[j]; what[j] = what[j - 1]; what[j - 1] = w;
+		}
+	}
+
+	taskENTER_CRITICAL ();
+	for (uint8_t i = 0; i < events; i++)
+	{
+		TCE0.CNT = (uint16_t)(start + at[i]);
+		if (what[i] == 0)
+		{
+			TCE0.CCA = TCE0.CNT;
+			TCE0_CCA_vect ();
+		}
+		else if (what[i] == 1)
+		{
+			TCE0.CCB = TCE0.CNT;
+			TCE0_CCB_vect ();
+		}
+		else
+		{
+			TCE0_OVF_vect ();
+		}
+	}
+	TCE0.CNT = (uint16_t)(start + span);
+	taskEXIT_CRITICAL ();
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This task moves the simulated robot on by one step every tick.
+ *  @details It runs at a higher priority than any of the robot's tasks, so the plant
+ *           is up to date whenever they read the encoders, as it would be in real 
+ *           life. It also runs the timers which pace the motor control loop and
+ *           time the encoder edges, and measures how regularly the POSIX port 
+ *           delivers its ticks, which limits how well the other tasks' loop timing
+ *           can be judged.
+ */
+
+class task_plant : public frt_task
+{
+	protected:
+		sim_plant plant;					///< The robot being simulated
+
+	public:
+		int64_t gap_min;					///< Shortest wall time between runs (us)
+		int64_t gap_max;					///< Longest wall time between runs (us)
+		int64_t gap_total;					///< Sum of the times between runs (us)
+		uint32_t gaps;						///< Number of times summed
+
+		task_plant (const char* a_name, unsigned portBASE_TYPE a_priority,
+					size_t a_stack_size, emstream* p_ser_dev)
+			: frt_task (a_name, a_priority, a_stack_size, p_ser_dev)
+		{
+			gap_min = INT64_MAX;
+			gap_max = gap_total = 0;
+			gaps = 0;
+		}
+
+		/// This method returns the true pose of the robot.
+		const sim_plant& get_plant (void)
+		{
+			return (plant);
+		}
+
+		void run (void);
+};
+
+
+//-------------------------------------------------------------------------------------
+/** This method steps the plant every tick and keeps track of the wall time between
+ *  steps. 
+ */
+
+void task_plant::run (void)
+{
+	portTickType previousTicks = xTaskGetTickCount ();
+	int64_t previous_us = wall_us ();
+
+	uint32_t tcc1_residue = 0;
+
+	plant.slip_left = sim_slip;
+	sim_imu_attach (&plant, &IMU_INT_PORT, IMU_INT_PIN_bm, sim_imu_fitted);
+	sim_vision_attach (&plant, (sim_vision_latency < 0) ? 0 : SIM_VISION_PERIOD_MS,
+					   (uint16_t)sim_vision_latency);
+
+	for (;;)
+	{
+		plant.step (SIM_PLANT_PERIOD_MS / 1000.0);
+		run_tc1 (TCC1, tcc1_residue, TCC1_OVF_vect, SIM_PLANT_PERIOD_MS * 1000UL);
+		run_tce1 (SIM_PLANT_PERIOD_MS * 1000UL);
+		run_tce0 (SIM_PLANT_PERIOD_MS * 1000UL);
+		sim_imu_step (SIM_PLANT_PERIOD_MS * 1000UL);
+		sim_vision_step (SIM_PLANT_PERIOD_MS * 1000UL);
+
+		int64_t now_us = wall_us ();
+		int64_t gap = now_us - previous_us;
+		previous_us = now_us;
+		if (runs > 0)
+		{
+			gap_min = (gap < gap_min) ? gap : gap_min;
+			gap_max = (gap > gap_max) ? gap : gap_max;
+			gap_total += gap;
+			gaps++;
+		}
+		runs++;
+
+		delay_from_to_ms (previousTicks, SIM_PLANT_PERIOD_MS);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   This task lets the simulation run for a while, prints a report and ends
+ *           the program.
+ */
+
+class task_monitor : public frt_task
+{
+	protected:
+		uint32_t seconds;					///< How long to let the tasks run
+		task_plant* p_plant;				///< Task which has the plant in it
+
+		// This method times items going through a FreeRTOS queue and back
+		void time_queue (void);
+
+	public:
+		task_monitor (const char* a_name, unsigned portBASE_TYPE a_priority,
+					  size_t a_stack_size, emstream* p_ser_dev, uint32_t run_seconds,
+					  task_plant* p_plant_task)
+			: frt_task (a_name, a_priority, a_stack_size, p_ser_dev)
+		{
+			seconds = run_seconds;
+			p_plant = p_plant_task;
+		}
+
+		void run (void);
+};
+
+
+//-------------------------------------------------------------------------------------
+/** This method waits the given time, then prints the task list, the tick timing, the
+ *  true and estimated positions of the robot and the time a queue takes, and ends the
+ *  program. 
+ */
+
+void task_monitor::run (void)
+{
+	portTickType start_ticks = xTaskGetTickCount ();
+	int64_t start_us = wall_us ();
+
+	delay_ms (seconds * 1000);
+
+	portTickType ticks = xTaskGetTickCount () - start_ticks;
+	int64_t elapsed_us = wall_us () - start_us;
+	const sim_plant& plant = p_plant->get_plant ();
+
+	*p_serial << endl << PMS ("--- Simulation report ---") << endl;
+	print_task_list (p_serial);
+	*p_serial << PMS ("Ticks: ") << (uint32_t)ticks << PMS (" in ") << (uint32_t)(elapsed_us / 1000)
+			  << PMS (" ms of wall time") << endl;
+	*p_serial << PMS ("Tick interval us: min ") << (uint32_t)p_plant->gap_min
+			  << PMS (" mean ") 
+			  << (uint32_t)(p_plant->gaps ? p_plant->gap_total / p_plant->gaps : 0)
+			  << PMS (" max ") << (uint32_t)p_plant->gap_max << endl;
+	*p_serial << PMS ("True pose: ") << (int32_t)plant.x << PMS (" ") 
+			  << (int32_t)plant.y << PMS (" | Angle: ") 
+			  << (int32_t)(plant.heading * 1000.0) << PMS (" mrad") << endl;
+	odometry_pose pose = robot_pose.get ();
+	*p_serial << PMS ("Odometry:  ") << pose.x << PMS (" ") 
+			  << pose.y << PMS (" | Angle: ") 
+			  << (int32_t)(((int32_t)(int16_t)pose.heading * 6283L) >> 16)
+			  << PMS (" mrad") << endl;
+	odometry_timing odo_timing;
+	odometry_timer_stats (&odo_timing, false);
+	*p_serial << PMS ("Odometry updates: ") << odo_timing.runs << PMS (" every ")
+			  << odo_timing.period_us << PMS (" us") << endl;
+	if (sim_imu_fitted)
+	{
+		*p_serial << PMS ("IMU reports read: ") << sim_imu_reads () << PMS (" | Slip: ")
+				  << (int32_t)(sim_slip * 1000.0) << PMS (" per mil") << endl;
+	}
+	else
+	{
+		*p_serial << PMS ("IMU: not fitted | Slip: ") << (int32_t)(sim_slip * 1000.0) 
+				  << PMS (" per mil") << endl;
+	}
+	vision_link_counts vision_counts;
+	vision_link_stats (&vision_counts);
+	*p_serial << PMS ("Vision packets sent: ") << sim_vision_sent () << PMS (" | received: ")
+			  << vision_counts.packets << PMS (" | CRC errors: ") << vision_counts.crc_errors
+			  << endl;
+	wheel_speeds speeds = robot_speeds.get ();
+	*p_serial << PMS ("Wheel speeds true: ") << (int32_t)plant.v_left << PMS (" ") 
+			  << (int32_t)plant.v_right << PMS (" | Estimated: ") << speeds.left 
+			  << PMS (" ") << speeds.right << PMS (" ticks/s") << endl;
+	time_queue ();
+
+	exit (0);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method times a FreeRTOS queue by putting items in and taking them out again
+ *  from this one task, so the time is that of the queue calls and nothing else. The
+ *  tick keeps interrupting, as it would on the AVR, so the other tasks' time is in
+ *  the figure too. 
+ */
+
+void task_monitor::time_queue (void)
+{
+	frt_queue<int16_t> test_queue (16, NULL, 0);
+
+	int64_t start_us = wall_us ();
+	for (int16_t count = 0; count < SIM_QUEUE_RUNS; count++)
+	{
+		test_queue.put (count);
+		test_queue.get ();
+	}
+	int64_t elapsed_us = wall_us () - start_us;
+
+	*p_serial << PMS ("Queue put and get: ") 
+			  << (uint32_t)(elapsed_us * 1000 / SIM_QUEUE_RUNS) << PMS (" ns") << endl;
+}
+
+
+/** The main function opens the serial port, sets up the same tasks as main.cpp plus
+ *  the plant and starts the scheduler. 
+ *  @return Only returns if the scheduler can't be started
+ */
+
+int main (int argc, char** argv)
+{
+	bool use_stdio = false;
+	uint32_t seconds = 0;
+
+	for (int arg = 1; arg < argc; arg++)
+	{
+		if (strcmp (argv[arg], "--stdio") == 0)
+		{
+			use_stdio = true;
+		}
+		else if (strcmp (argv[arg], "--seconds") == 0 && arg + 1 < argc)
+		{
+			seconds = atoi (argv[++arg]);
+		}
+		else if (strcmp (argv[arg], "--goal") == 0 && arg + 2 < argc)
+		{
+			setpoint_l_1 = atoi (argv[++arg]);
+			setpoint_l_2 = atoi (argv[++arg]);
+		}
+		else if (strcmp (argv[arg], "--slip") == 0 && arg + 1 < argc)
+		{
+			sim_slip = atof (argv[++arg]) / 100.0;
+		}
+		else if (strcmp (argv[arg], "--no-imu") == 0)
+		{
+			sim_imu_fitted = false;
+		}
+		else if (strcmp (argv[arg], "--vision") == 0 && arg + 1 < argc)
+		{
+			sim_vision_latency = atoi (argv[++arg]);
+		}
+		else
+		{
+			printf ("Usage: %s [--stdio] [--seconds N] [--goal X Y] [--slip PERCENT] [--no-imu]"
+					" [--vision LATENCY_MS]\n", argv[0]);
+			return (1);
+		}
+	}
+
+	pty_stream* p_ser_dev = new pty_stream (use_stdio);
+	if (!p_ser_dev->is_open ())
+	{
+		return (1);
+	}
+	*p_ser_dev << clrscr << "FreeRTOS Xmega Testing Program (simulated)" << endl << endl;
+
+	// The simulated EEPROM starts erased, so this finds the defaults
+	if (!params_load ())
+	{
+		*p_ser_dev << "No good parameters in the EEPROM; using the defaults" << endl;
+	}
+
+	// The XMEGA's RTOS tick starts TCE1 counting at the CPU clock, and the odometry
+	// shares it
+	TCE1.CTRLA = TC_CLKSEL_DIV1_gc;
+
+	// The robot's tasks, as main.cpp makes them. The plant gets a priority above
+	// theirs, which the simulator's FreeRTOSConfig.h leaves room for
+	task_plant* p_plant = new task_plant ("Plant", task_priority (4), 200, p_ser_dev);
+
+	new task_user ("UserInt", task_priority (0), 500, p_ser_dev);
+	new task_motor ("MOTOR TASK", task_priority (1), 1000, p_ser_dev);
+	new task_Robot_State ("RobotState", task_priority (3), 1000, p_ser_dev);
+	new task_diag ("Diagnostic", task_priority (1), 200, p_ser_dev);
+
+	if (seconds > 0)
+	{
+		new task_monitor ("Monitor", task_priority (4), 400, p_ser_dev, seconds, p_plant);
+	}
+
+	vTaskStartScheduler ();
+	return (1);
+}
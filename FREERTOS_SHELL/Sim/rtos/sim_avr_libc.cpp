@@ -0,0 +1,169 @@
+//**************************************************************************************
+/** \file sim_avr_libc.cpp
+ *    This file contains PC versions of the avr-libc number conversion functions. They
+ *    behave as avr-libc's do: negative numbers get a minus sign only in base 10, and
+ *    are otherwise printed as unsigned. The float to text engine which emstream uses 
+ *    is done here with the C library's printf() code.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "sim_avr_libc.h"
+
+// These flags go in the first byte of __ftoa_engine()'s output, as in ftoa_engine.h
+#define FTOA_MINUS      1
+#define FTOA_ZERO       2
+#define FTOA_INF        4
+#define FTOA_NAN        8
+
+
+//-------------------------------------------------------------------------------------
+/** This function writes an unsigned number into a string in any base from 2 to 36.
+ *  @param value The number to be converted
+ *  @param string Where the text goes; it must be big enough
+ *  @param radix The base, from 2 to 36
+ *  @param negative True to put a minus sign in front
+ *  @return A pointer to the string
+ */
+
+static char* convert (unsigned long value, char* string, int radix, bool negative)
+{
+	char* p_char = string;
+
+	if (radix < 2 || radix > 36)
+	{
+		*string = '\0';
+		return (string);
+	}
+	if (negative)
+	{
+		*p_char++ = '-';
+	}
+
+	// Write the digits backwards, then turn them around
+	char* p_first = p_char;
+	do
+	{
+		unsigned long digit = value % radix;
+		*p_char++ = (char)((digit < 10) ? ('0' + digit) : ('a' + digit - 10));
+		value /= radix;
+	}
+	while (value);
+	*p_char-- = '\0';
+
+	while (p_first < p_char)
+	{
+		char temp = *p_first;
+		*p_first++ = *p_char;
+		*p_char-- = temp;
+	}
+	return (string);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** These functions are the avr-libc conversions, each with the same arguments: the 
+ *  number, a buffer big enough for its text, and the base.
+ */
+
+char* itoa (int value, char* string, int radix)
+{
+	if (radix == 10 && value < 0)
+	{
+		return (convert (-(unsigned long)value, string, radix, true));
+	}
+	return (convert ((unsigned int)value, string, radix, false));
+}
+
+
+char* utoa (unsigned int value, char* string, int radix)
+{
+	return (convert (value, string, radix, false));
+}
+
+
+char* ltoa (long value, char* string, int radix)
+{
+	if (radix == 10 && value < 0)
+	{
+		return (convert (-(unsigned long)value, string, radix, true));
+	}
+	return (convert ((unsigned long)value, string, radix, false));
+}
+
+
+char* ultoa (unsigned long value, char* string, int radix)
+{
+	return (convert (value, string, radix, false));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function is a PC version of avr-libc's internal float to text converter. The
+ *  first byte of the output holds FTOA_ flags; the digits of the rounded mantissa
+ *  follow with no decimal point.
+ *  @param val The number to be converted
+ *  @param buf Where the flags and digits go; it must have room for maxdgs + 2 bytes
+ *  @param prec How many digits to put after the first one
+ *  @param maxdgs The most digits to make in all
+ *  @return The power of ten by which the mantissa, as d.ddd, is to be multiplied
+ */
+
+extern "C" int __ftoa_engine (double val, char* buf, uint8_t prec, uint8_t maxdgs)
+{
+	buf[0] = signbit (val) ? FTOA_MINUS : 0;
+	if (isnan (val))
+	{
+		buf[0] |= FTOA_NAN;
+		buf[1] = '\0';
+		return (0);
+	}
+	if (isinf (val))
+	{
+		buf[0] |= FTOA_INF;
+		buf[1] = '\0';
+		return (0);
+	}
+	if (val == 0.0)
+	{
+		buf[0] |= FTOA_ZERO;
+	}
+	if (prec >= maxdgs)
+	{
+		prec = maxdgs - 1;
+	}
+
+	// The C library gives d.ddde+xx; take the point out and split off the exponent
+	char text[40];
+	snprintf (text, sizeof (text), "%.*e", prec, fabs (val));
+	char* p_out = buf + 1;
+	char* p_text = text;
+	for ( ; *p_text && *p_text != 'e'; p_text++)
+	{
+		if (*p_text != '.')
+		{
+			*p_out++ = *p_text;
+		}
+	}
+	*p_out = '\0';
+	return (*p_text ? atoi (p_text + 1) : 0);
+}
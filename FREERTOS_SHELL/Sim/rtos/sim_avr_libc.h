@@ -0,0 +1,42 @@
+//**************************************************************************************
+/** \file sim_avr_libc.h
+ *    This file declares the avr-libc number conversion functions, which the emstream
+ *    and time stamp code use but which glibc doesn't have. The Makefile includes it
+ *    ahead of every file in the FreeRTOS build.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _SIM_AVR_LIBC_H_
+#define _SIM_AVR_LIBC_H_
+
+#ifdef __cplusplus
+	extern "C" {
+#endif
+
+char* itoa (int value, char* string, int radix);
+char* utoa (unsigned int value, char* string, int radix);
+char* ltoa (long value, char* string, int radix);
+char* ultoa (unsigned long value, char* string, int radix);
+
+#ifdef __cplusplus
+	}
+#endif
+
+#endif // _SIM_AVR_LIBC_H_
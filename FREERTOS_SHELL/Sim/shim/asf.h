@@ -0,0 +1,78 @@
+//**************************************************************************************
+/** \file asf.h
+ *    This file stands in for the Atmel Software Framework header when the control code
+ *    is built on a PC. Only the PWM service used by motorDriver and the EEPROM calls
+ *    used by robot_params are provided. As in ASF, the PWM service writes the period and
+ *    compare buffers of the timer, where the plant model reads the duty cycles.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 Added pwm_set_duty_cycle_percent()
+ *    \li 10-18-26 Duty cycles go in TCC0's compare buffers, as pwm_out.h writes them
+ *    \li 10-18-26 Added the EEPROM buffer calls from ASF's nvm.h
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _SIM_ASF_H_
+#define _SIM_ASF_H_
+
+#include <stdint.h>
+#include <avr/io.h>
+
+/// PWM compare channel index, as in ASF's pwm.h
+enum pwm_channel_t
+{
+	PWM_CH_A = 1,
+	PWM_CH_B = 2,
+	PWM_CH_C = 3,
+	PWM_CH_D = 4,
+};
+
+/// Timer/counters which can make PWM, as in ASF's pwm.h
+enum pwm_tc_t
+{
+	PWM_TCC0,
+	PWM_TCC1,
+	PWM_TCD0,
+	PWM_TCD1,
+	PWM_TCE0,
+	PWM_TCE1,
+	PWM_TCF0,
+	PWM_TCF1
+};
+
+/// PWM configuration; only what the simulator needs to find the channel
+struct pwm_config
+{
+	enum pwm_tc_t tc;
+	enum pwm_channel_t channel;
+	uint16_t period;						// Timer counts per period, as ASF works out
+};
+
+void pwm_init (struct pwm_config* config, enum pwm_tc_t tc, enum pwm_channel_t channel,
+			   uint16_t freq_hz);
+void pwm_start (struct pwm_config* config, uint8_t duty_cycle_scale);
+void pwm_set_duty_cycle_percent (struct pwm_config* config, uint8_t duty_cycle_scale);
+
+/// EEPROM address, as in ASF's nvm.h
+typedef uint16_t eeprom_addr_t;
+
+void nvm_eeprom_read_buffer (eeprom_addr_t address, void* buf, uint16_t len);
+void nvm_eeprom_erase_and_write_buffer (eeprom_addr_t address, const void* buf,
+										uint16_t len);
+
+#endif // _SIM_ASF_H_
@@ -0,0 +1,230 @@
+//**************************************************************************************
+/** \file io.h
+ *    This file stands in for avr-libc's <avr/io.h> when the control code is built on a
+ *    PC. It has only the registers and constants the tasks refer to. The quadrature
+ *    decoder counts are written by the plant model; the rest are just memory, so code
+ *    which sets up peripherals compiles and runs but has no effect.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 Added what the tasks need for the FreeRTOS POSIX build
+ *    \li 10-18-26 Added the encoder timers' overflow vectors
+ *    \li 10-18-26 Added TCE0, which times the encoder edges
+ *    \li 10-18-26 Added TCC0's compare buffers, written by pwm_out.h
+ *    \li 10-18-26 Added TCE1, which runs the odometry
+ *    \li 10-18-26 TC1_t's count is where TC0_t's is, so ENC1 reads right through a TC0_t*
+ *    \li 10-18-26 The odometry runs off TCE1's compare channel B
+ *    \li 10-18-26 Added USARTF0, which receives the vision tracker's packets
+ *    \li 10-18-26 Added the interrupt controller and TCD0's overflow vector
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _SIM_AVR_IO_H_
+#define _SIM_AVR_IO_H_
+
+#include <stdint.h>
+
+/// A type 0 timer/counter
+typedef struct
+{
+	uint8_t CTRLA;
+	uint8_t CTRLB;
+	uint8_t INTCTRLA;
+	uint8_t INTCTRLB;
+	uint8_t CTRLFCLR;
+	uint8_t CTRLFSET;
+	uint8_t INTFLAGS;
+	uint16_t CNT;
+	uint16_t PER;
+	uint16_t CCA;
+	uint16_t CCB;
+	uint16_t CCC;
+	uint16_t CCD;
+	uint16_t CCABUF;
+	uint16_t CCBBUF;
+	uint16_t CCCBUF;
+	uint16_t CCDBUF;
+} TC0_t;
+
+/// A type 1 timer/counter. Its registers are where a type 0's are, as on the XMEGA,
+/// since qdec_driver.cpp reads both kinds through a TC0_t pointer
+typedef struct
+{
+	uint8_t CTRLA;
+	uint8_t CTRLB;
+	uint8_t INTCTRLA;
+	uint8_t INTCTRLB;
+	uint8_t CTRLFCLR;
+	uint8_t CTRLFSET;
+	uint8_t INTFLAGS;
+	uint16_t CNT;
+	uint16_t PER;
+	uint16_t CCA;
+	uint16_t CCB;
+} TC1_t;
+
+/// An I/O port
+typedef struct
+{
+	uint8_t DIR;
+	uint8_t DIRSET;
+	uint8_t DIRCLR;
+	uint8_t OUT;
+	uint8_t OUTSET;
+	uint8_t OUTCLR;
+	uint8_t IN;
+} PORT_t;
+
+/// A USART; the simulator's serial port is a pty, not this, but the vision tracker's
+/// packets are put through USARTF0's receiver interrupt byte by byte
+typedef struct
+{
+	uint8_t DATA;
+	uint8_t STATUS;
+	uint8_t CTRLA;
+	uint8_t CTRLB;
+	uint8_t CTRLC;
+	uint8_t BAUDCTRLA;
+	uint8_t BAUDCTRLB;
+} USART_t;
+
+/// The interrupt controller; only the level enables are used
+typedef struct
+{
+	uint8_t STATUS;
+	uint8_t INTPRI;
+	uint8_t CTRL;
+} PMIC_t;
+
+#define PMIC_LOLVLEN_bm 0x01
+#define PMIC_MEDLVLEN_bm 0x02
+#define PMIC_HILVLEN_bm 0x04
+
+#define USART_FERR_bm 0x10
+#define USART_BUFOVF_bm 0x08
+#define USART_RXEN_bm 0x10
+#define USART_BSCALE0_bp 4
+#define USART_RXCINTLVL_gm 0x30
+#define USART_RXCINTLVL_OFF_gc 0x00
+#define USART_RXCINTLVL_LO_gc 0x10
+#define USART_CMODE_ASYNCHRONOUS_gc 0x00
+#define USART_PMODE_DISABLED_gc 0x00
+#define USART_CHSIZE_8BIT_gc 0x03
+
+/// Timer clock selections
+typedef enum
+{
+	TC_CLKSEL_OFF_gc = 0x00,
+	TC_CLKSEL_DIV1_gc = 0x01,
+	TC_CLKSEL_DIV2_gc = 0x02,
+	TC_CLKSEL_DIV4_gc = 0x03,
+	TC_CLKSEL_DIV8_gc = 0x04,
+	TC_CLKSEL_DIV64_gc = 0x05,
+	TC_CLKSEL_DIV256_gc = 0x06,
+	TC_CLKSEL_DIV1024_gc = 0x07
+} TC_CLKSEL_t;
+
+/// Timer waveform generation modes
+typedef enum
+{
+	TC_WGMODE_NORMAL_gc = 0x00,
+	TC_WGMODE_SS_gc = 0x03
+} TC_WGMODE_t;
+
+#define TC0_CCAEN_bm 0x10
+#define TC0_CCBEN_bm 0x20
+#define TC0_CCCEN_bm 0x40
+#define TC0_CCDEN_bm 0x80
+#define TC0_LUPD_bm 0x02
+#define TC0_OVFIF_bm 0x01
+#define TC1_CCBEN_bm 0x20
+#define TC1_CCBIF_bm 0x20
+#define TC1_CCBINTLVL_gm 0x0C
+
+/// Timer overflow interrupt levels
+typedef enum
+{
+	TC_OVFINTLVL_OFF_gc = 0x00,
+	TC_OVFINTLVL_LO_gc = 0x01,
+	TC_OVFINTLVL_MED_gc = 0x02,
+	TC_OVFINTLVL_HI_gc = 0x03
+} TC_OVFINTLVL_t;
+
+/// Timer compare channel B interrupt levels
+typedef enum
+{
+	TC_CCBINTLVL_OFF_gc = 0x00,
+	TC_CCBINTLVL_LO_gc = 0x04,
+	TC_CCBINTLVL_MED_gc = 0x08,
+	TC_CCBINTLVL_HI_gc = 0x0C
+} TC_CCBINTLVL_t;
+
+/// Timer event channel selections used by the quadrature decoders
+typedef enum
+{
+	TC_EVSEL_OFF_gc = 0x00,
+	TC_EVSEL_CH0_gc = 0x08,
+	TC_EVSEL_CH2_gc = 0x0A
+} TC_EVSEL_t;
+
+/// Event system multiplexer inputs used by the quadrature decoders
+typedef enum
+{
+	EVSYS_CHMUX_PORTD_PIN4_gc = 0x6C,
+	EVSYS_CHMUX_PORTE_PIN4_gc = 0x74
+} EVSYS_CHMUX_t;
+
+/// Quadrature decoder index recognition modes
+typedef enum
+{
+	EVSYS_QDIRM_00_gc = 0x00
+} EVSYS_QDIRM_t;
+
+/// Interrupt vectors are ordinary functions, called by the simulated hardware
+#define TCC1_OVF_vect sim_TCC1_OVF_vect
+#define TCD0_OVF_vect sim_TCD0_OVF_vect		// Never called; TCD0 doesn't count
+#define TCD1_OVF_vect sim_TCD1_OVF_vect		// Never called; see QDEC_Ext_Read() in sim_hw.cpp
+#define TCF0_OVF_vect sim_TCF0_OVF_vect
+#define TCE0_CCA_vect sim_TCE0_CCA_vect		// Called from rtos_main.cpp
+#define TCE0_CCB_vect sim_TCE0_CCB_vect
+#define TCE0_OVF_vect sim_TCE0_OVF_vect
+#define TCE1_CCB_vect sim_TCE1_CCB_vect		// Called from rtos_main.cpp
+#define USARTF0_RXC_vect sim_USARTF0_RXC_vect	// Called from sim_vision.cpp
+
+#define PIN0_bm 0x01
+#define PIN1_bm 0x02
+#define PIN2_bm 0x04
+#define PIN3_bm 0x08
+#define PIN7_bm 0x80
+
+extern TC0_t TCC0;							// Motor PWM; the plant reads the buffers
+extern TC1_t TCC1;							// Paces the control loop; see rtos_main.cpp
+extern TC0_t TCD0;							// Free; used by task_user to count cycles
+extern TC1_t TCD1;							// Counts the left (ENC1) encoder
+extern TC0_t TCF0;							// Counts the right (ENC2) encoder
+extern TC0_t TCE0;							// Times both encoders' edges
+extern TC1_t TCE1;							// RTOS tick's timer; paces the odometry too
+extern PORT_t PORTC;
+extern PORT_t PORTD;
+extern PORT_t PORTE;
+extern PORT_t PORTF;
+extern USART_t USARTC0;
+extern USART_t USARTD0;
+extern USART_t USARTF0;						// Receives the vision tracker's packets
+extern PMIC_t PMIC;
+
+#endif // _SIM_AVR_IO_H_
@@ -0,0 +1,372 @@
+//**************************************************************************************
+/** \file sim_hw.cpp
+ *    This file contains the PC versions of the hardware calls made by the control
+ *    code: the ASF PWM service and the quadrature decoder's setup and count reads.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 Added the registers and calls used by the FreeRTOS build
+ *    \li 10-18-26 Added the quadrature decoders' 32 bit counts
+ *    \li 10-18-26 Added the encoder edge timing
+ *    \li 10-18-26 Added pwm_set_duty_cycle_percent(), used by drive_pair
+ *    \li 10-18-26 The PWM calls write TCC0's registers, as ASF does
+ *    \li 10-18-26 Added TCE1, which runs the odometry
+ *    \li 10-18-26 Added USARTF0 and PORTF, for the vision tracker
+ *    \li 10-18-26 Added the interrupt controller
+ *    \li 10-18-26 Added the EEPROM, which starts erased each run
+ *    \li 10-18-26 pwm_init() turns its channel's output on, as ASF does
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <asf.h>
+#include <avr/io.h>
+#include <avr/wdt.h>
+
+#include "qdec_driver.h"
+#include "sim_hw.h"
+
+#define SIM_QDEC_EXT_MAX 2					// One per encoder
+#define SIM_EEPROM_SIZE 2048				// As in the ATxmega128A3U
+
+TC0_t TCC0;
+TC1_t TCC1;
+TC0_t TCD0;
+TC1_t TCD1;
+TC0_t TCF0;
+TC0_t TCE0;
+TC1_t TCE1;
+PORT_t PORTC;
+PORT_t PORTD;
+PORT_t PORTE;
+PORT_t PORTF;
+USART_t USARTC0;
+USART_t USARTD0;
+USART_t USARTF0;
+PMIC_t PMIC = {0, 0, PMIC_HILVLEN_bm | PMIC_MEDLVLEN_bm | PMIC_LOLVLEN_bm};
+
+/// The count each extended decoder had when it was last read
+static struct
+{
+	QDEC_Ext_t* ext;
+	uint16_t count;
+} sim_qdec_last[SIM_QDEC_EXT_MAX];
+
+/// The EEPROM's contents; all 0xFF, as erased, until the first write
+static uint8_t sim_eeprom[SIM_EEPROM_SIZE];
+static bool sim_eeprom_ready = false;
+
+
+//-------------------------------------------------------------------------------------
+/** This function finds the compare buffer of a PWM channel. Only TCC0, which drives
+ *  the motors, is modelled; the other timers' channels go nowhere.
+ */
+
+static uint16_t* sim_pwm_buffer (struct pwm_config* config)
+{
+	static uint16_t nowhere;
+
+	if (config->tc != PWM_TCC0)
+	{
+		return &nowhere;
+	}
+	switch (config->channel)
+	{
+		case PWM_CH_A:	return &TCC0.CCABUF;
+		case PWM_CH_B:	return &TCC0.CCBBUF;
+		case PWM_CH_C:	return &TCC0.CCCBUF;
+		default:		return &TCC0.CCDBUF;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function sets up a PWM channel. The period is worked out as ASF's
+ *  pwm_set_frequency() does, with the smallest prescaler that fits it in 16 bits, and
+ *  the channel's output is turned on.
+ */
+
+void pwm_init (struct pwm_config* config, enum pwm_tc_t tc, enum pwm_channel_t channel,
+			   uint16_t freq_hz)
+{
+	static const uint16_t divides[] = { 1, 2, 4, 8, 64, 256, 1024 };
+	uint32_t counts = 0;
+
+	for (uint8_t index = 0; index < sizeof (divides) / sizeof (divides[0]); index++)
+	{
+		counts = F_CPU / divides[index] / freq_hz;
+		if (counts <= 0xFFFFUL)
+		{
+			break;
+		}
+	}
+	config->tc = tc;
+	config->channel = channel;
+	config->period = (uint16_t)counts;
+	*sim_pwm_buffer (config) = 0;
+	if (tc == PWM_TCC0)
+	{
+		TCC0.CTRLB |= TC0_CCAEN_bm << (channel - PWM_CH_A);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function starts a PWM channel with a duty cycle in percent. As in ASF, it
+ *  also writes the timer's period.
+ */
+
+void pwm_start (struct pwm_config* config, uint8_t duty_cycle_scale)
+{
+	pwm_set_duty_cycle_percent (config, duty_cycle_scale);
+	if (config->tc == PWM_TCC0)
+	{
+		TCC0.PER = config->period;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function changes the duty cycle of a PWM channel, by writing its compare
+ *  buffer as ASF does.
+ */
+
+void pwm_set_duty_cycle_percent (struct pwm_config* config, uint8_t duty_cycle_scale)
+{
+	*sim_pwm_buffer (config) = (uint16_t)((uint32_t)config->period * duty_cycle_scale / 100);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** These functions set up a quadrature decoder, as those in qdec_driver.cpp. The plant
+ *  model writes the count whether or not this has been called, so they just zero it.
+ */
+
+bool QDEC_Total_Setup (PORT_t* qPort, uint8_t qPin, bool invIO, uint8_t qEvMux,
+					   EVSYS_CHMUX_t qPinInput, bool useIndex, EVSYS_QDIRM_t qIndexState,
+					   TC0_t* qTimer, TC_EVSEL_t qEventChannel, uint16_t lineCount)
+{
+	qTimer->CNT = 0;
+	qTimer->PER = lineCount;
+	return (true);
+}
+
+bool QDEC_Total_Setup (PORT_t* qPort, uint8_t qPin, bool invIO, uint8_t qEvMux,
+					   EVSYS_CHMUX_t qPinInput, bool useIndex, EVSYS_QDIRM_t qIndexState,
+					   TC1_t* qTimer, TC_EVSEL_t qEventChannel, uint16_t lineCount)
+{
+	qTimer->CNT = 0;
+	qTimer->PER = lineCount;
+	return (true);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** These functions return a quadrature decoder's count, as those in qdec_driver.cpp.
+ */
+
+uint16_t QDEC_Read_TC (TC0_t* qTimer)
+{
+	return qTimer->CNT;
+}
+
+uint16_t QDEC_Read_TC (TC1_t* qTimer)
+{
+	return qTimer->CNT;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** These functions keep a quadrature decoder's 32 bit count, as those in
+ *  qdec_driver.cpp. The plant model writes the timers' counts but raises no overflow
+ *  interrupts, so the wraps are found when the count is read instead, from how far it
+ *  moved since the last read. That is right as long as it is read more often than
+ *  every half turn of the timer, which the tasks do by a very wide margin.
+ */
+
+void QDEC_Ext_Setup (QDEC_Ext_t* qExt, TC0_t* qTimer, TC_OVFINTLVL_t intLevel)
+{
+	qExt->qTimer = qTimer;
+	qExt->wraps = 0;
+	for (uint8_t i = 0; i < SIM_QDEC_EXT_MAX; i++)
+	{
+		if (sim_qdec_last[i].ext == NULL || sim_qdec_last[i].ext == qExt)
+		{
+			sim_qdec_last[i].ext = qExt;
+			sim_qdec_last[i].count = qTimer->CNT;
+			return;
+		}
+	}
+	printf ("\nToo many extended decoders\n");
+	exit (1);
+}
+
+void QDEC_Ext_Setup (QDEC_Ext_t* qExt, TC1_t* qTimer, TC_OVFINTLVL_t intLevel)
+{
+	QDEC_Ext_Setup (qExt, (TC0_t*)qTimer, intLevel);
+}
+
+void QDEC_Ext_Overflow (QDEC_Ext_t* qExt)
+{
+}
+
+int32_t QDEC_Ext_Read (QDEC_Ext_t* qExt)
+{
+	uint16_t count = qExt->qTimer->CNT;
+	for (uint8_t i = 0; i < SIM_QDEC_EXT_MAX; i++)
+	{
+		if (sim_qdec_last[i].ext == qExt)
+		{
+			int16_t moved = (int16_t)(count - sim_qdec_last[i].count);
+			if (moved > 0 && count < sim_qdec_last[i].count)
+			{
+				qExt->wraps++;
+			}
+			else if (moved < 0 && count > sim_qdec_last[i].count)
+			{
+				qExt->wraps--;
+			}
+			sim_qdec_last[i].count = count;
+		}
+	}
+	return ((int32_t)qExt->wraps << 16) | count;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** These functions time the encoders' edges, as those in qdec_driver.cpp. The edges
+ *  are found in the plant's counts by rtos_main.cpp, which calls the capture
+ *  interrupts.
+ */
+
+bool QDEC_TC_Period_Setup (TC0_t* qTimer, uint8_t qEvMux, EVSYS_CHMUX_t qPinInputA,
+						   EVSYS_CHMUX_t qPinInputB, TC_CLKSEL_t clksel, uint8_t intLevel)
+{
+	qTimer->CNT = 0;
+	qTimer->PER = 0xFFFF;
+	qTimer->CTRLA = clksel;
+	return (true);
+}
+
+void QDEC_Period_Init (QDEC_Period_t* qPeriod, TC0_t* qTimer)
+{
+	qPeriod->qTimer = qTimer;
+	qPeriod->last = 0;
+	qPeriod->period = QDEC_PERIOD_NONE;
+	qPeriod->wraps = 2;
+}
+
+void QDEC_Period_Capture (QDEC_Period_t* qPeriod, uint16_t capture)
+{
+	uint8_t wraps = qPeriod->wraps;
+	if (wraps == 0 || (wraps == 1 && capture < qPeriod->last))
+	{
+		qPeriod->period = capture - qPeriod->last;
+	}
+	else
+	{
+		qPeriod->period = QDEC_PERIOD_NONE;
+	}
+	qPeriod->last = capture;
+	qPeriod->wraps = 0;
+}
+
+void QDEC_Period_Overflow (QDEC_Period_t* qPeriod)
+{
+	if (qPeriod->wraps < 2)
+	{
+		qPeriod->wraps++;
+	}
+}
+
+void QDEC_Period_Read (QDEC_Period_t* qPeriod, uint16_t* period, uint16_t* age)
+{
+	uint16_t now = qPeriod->qTimer->CNT;
+	uint8_t wraps = qPeriod->wraps;
+	*period = qPeriod->period;
+	if (wraps == 0 || (wraps == 1 && now < qPeriod->last))
+	{
+		*age = now - qPeriod->last;
+	}
+	else
+	{
+		*age = QDEC_PERIOD_NONE;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function stands in for turning on the watchdog, which the tasks do in order to
+ *  reset the AVR. A reset ends the simulation.
+ */
+
+void wdt_enable (uint8_t timeout)
+{
+	printf ("\nWatchdog reset\n");
+	exit (1);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function erases the simulated EEPROM the first time it's used.
+ */
+
+static void sim_eeprom_init (void)
+{
+	if (!sim_eeprom_ready)
+	{
+		memset (sim_eeprom, 0xFF, sizeof (sim_eeprom));
+		sim_eeprom_ready = true;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function reads from the EEPROM, as ASF's nvm_eeprom_read_buffer() does. Bytes
+ *  past the end read as erased.
+ */
+
+void nvm_eeprom_read_buffer (eeprom_addr_t address, void* buf, uint16_t len)
+{
+	sim_eeprom_init ();
+	uint8_t* p_dest = (uint8_t*)buf;
+	for (uint16_t index = 0; index < len; index++, address++)
+	{
+		p_dest[index] = (address < SIM_EEPROM_SIZE) ? sim_eeprom[address] : 0xFF;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function writes to the EEPROM, as ASF's nvm_eeprom_erase_and_write_buffer()
+ *  does. Bytes past the end are lost.
+ */
+
+void nvm_eeprom_erase_and_write_buffer (eeprom_addr_t address, const void* buf,
+										uint16_t len)
+{
+	sim_eeprom_init ();
+	const uint8_t* p_src = (const uint8_t*)buf;
+	for (uint16_t index = 0; index < len; index++, address++)
+	{
+		if (address < SIM_EEPROM_SIZE)
+		{
+			sim_eeprom[address] = p_src[index];
+		}
+	}
+}
@@ -0,0 +1,57 @@
+//**************************************************************************************
+/** \file sim_hw.h
+ *    This file contains header stuff for the PC versions of the hardware calls made by
+ *    the control code. The PWM calls are declared in shim/asf.h as in ASF; the
+ *    quadrature decoder reads are declared here, since qdec_driver.h needs the whole
+ *    XMEGA register set.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 Declared the control timer's interrupt
+ *    \li 10-18-26 Declared the edge timer's interrupts
+ *    \li 10-18-26 Declared the odometry timer's interrupt
+ *    \li 10-18-26 Declared the vision link's receiver interrupt
+ *    \li 10-18-26 Declared the interrupt latency timer's interrupt
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _SIM_HW_H_
+#define _SIM_HW_H_
+
+#include <avr/io.h>
+
+uint16_t QDEC_Read_TC (TC0_t* qTimer);
+uint16_t QDEC_Read_TC (TC1_t* qTimer);
+
+/// The control timer's interrupt, in control_timer.cpp
+void TCC1_OVF_vect (void);
+
+/// The edge timer's interrupts, in task_Robot_State.cpp
+void TCE0_CCA_vect (void);
+void TCE0_CCB_vect (void);
+void TCE0_OVF_vect (void);
+
+/// The interrupt latency timer's interrupt, in task_user.cpp
+void TCD0_OVF_vect (void);
+
+/// The odometry timer's interrupt, in odometry_timer.cpp
+void TCE1_CCB_vect (void);
+
+/// The vision link's receiver interrupt, in vision_link.cpp
+void USARTF0_RXC_vect (void);
+
+#endif // _SIM_HW_H_
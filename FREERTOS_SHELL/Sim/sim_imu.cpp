@@ -0,0 +1,286 @@
+//**************************************************************************************
+/** \file sim_imu.cpp
+ *    This file contains the simulated BNO080 IMU. See sim_imu.h.
+ *
+ *    Only what the driver in BNO080_Xmega_Lib.cpp uses is modelled: the product ID
+ *    request, the set feature command which starts the reports, and packets being
+ *    read as a header and then the header again with the data. The IMU holds one
+ *    packet; a report due before the last has been read replaces it. Its INT output
+ *    is low while it holds a packet.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include <math.h>
+#include <string.h>
+
+#include "FreeRTOS.h"                       // Primary header for FreeRTOS
+#include "task.h"                           // For the critical sections
+
+#include "twi.h"							// The calls answered here
+#include "BNO080_Xmega_Lib.h"				// SHTP channels and report IDs
+#include "sim_imu.h"
+
+#define SIM_IMU_ZERO 0.6					// Yaw the IMU reads when the robot starts (rad)
+#define SIM_IMU_DRIFT 0.0003				// Drift of the IMU's yaw (rad/s)
+#define SIM_IMU_PACKET 32					// Biggest packet it sends, header included
+
+static const sim_plant* p_imu_plant = NULL;
+static PORT_t* p_imu_int_port = NULL;
+static uint8_t imu_int_pin_bm = 0;
+static bool imu_present = false;
+
+static uint8_t imu_packet[SIM_IMU_PACKET];	// The packet waiting to be read, header first
+static uint8_t imu_packet_length = 0;		// Its length; zero if there isn't one
+static uint32_t imu_interval_us = 0;		// Time between reports; zero when they're off
+static uint32_t imu_until_us = 0;			// Time until the next report
+static double imu_time_s = 0.0;				// Time since the IMU was attached
+static uint8_t imu_sequence = 0;			// Sequence number of the reports
+static uint32_t imu_reads = 0;				// Reports read out
+
+
+//-------------------------------------------------------------------------------------
+/** This function sets the INT pin to match whether there's a packet waiting.
+ */
+
+static void sim_imu_int (void)
+{
+	if (p_imu_int_port == NULL)
+	{
+		return;
+	}
+	if (imu_packet_length > 0)
+	{
+		p_imu_int_port->IN &= ~imu_int_pin_bm;
+	}
+	else
+	{
+		p_imu_int_port->IN |= imu_int_pin_bm;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function puts a packet in the IMU's output, in place of any already there.
+ *  @param channel The SHTP channel it goes on
+ *  @param data The packet's data, after the header
+ *  @param length The number of data bytes
+ */
+
+static void sim_imu_send (uint8_t channel, const uint8_t* data, uint8_t length)
+{
+	uint8_t total = length + SHTP_HEADER_SIZE;
+	imu_packet[0] = total;
+	imu_packet[1] = 0;
+	imu_packet[2] = channel;
+	imu_packet[3] = 0;
+	memcpy (imu_packet + SHTP_HEADER_SIZE, data, length);
+	imu_packet_length = total;
+	sim_imu_int ();
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function gets the IMU's yaw: the plant's true heading, from a zero of its own
+ *  and drifting slowly, as a gyro does.
+ */
+
+double sim_imu_yaw (void)
+{
+	return (p_imu_plant->heading + SIM_IMU_ZERO + SIM_IMU_DRIFT * imu_time_s);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function puts a game rotation vector report of the yaw in the output. The
+ *  robot stays level, so the quaternion is a turn about Z by the yaw.
+ */
+
+static void sim_imu_report (void)
+{
+	double half = sim_imu_yaw () / 2.0;
+	int16_t k = (int16_t)lround (sin (half) * 16384.0);
+	int16_t real = (int16_t)lround (cos (half) * 16384.0);
+	uint8_t data[17] =
+	{
+		SHTP_REPORT_BASE_TIMESTAMP, 0, 0, 0, 0,
+		SENSOR_REPORTID_GAME_ROTATION_VECTOR, imu_sequence++, 3, 0,
+		0, 0,										// i
+		0, 0,										// j
+		(uint8_t)k, (uint8_t)((uint16_t)k >> 8),
+		(uint8_t)real, (uint8_t)((uint16_t)real >> 8)
+	};
+	sim_imu_send (CHANNEL_REPORTS, data, sizeof (data));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function connects the IMU to the plant and clears it out.
+ */
+
+void sim_imu_attach (const sim_plant* p_plant, PORT_t* p_int_port, uint8_t int_pin_bm,
+					 bool present)
+{
+	p_imu_plant = p_plant;
+	p_imu_int_port = p_int_port;
+	imu_int_pin_bm = int_pin_bm;
+	imu_present = present;
+	imu_packet_length = 0;
+	imu_interval_us = 0;
+	imu_time_s = 0.0;
+	sim_imu_int ();
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function runs the IMU on by some time.
+ */
+
+void sim_imu_step (uint32_t us)
+{
+	taskENTER_CRITICAL ();
+	imu_time_s += us / 1000000.0;
+	if (imu_present && imu_interval_us > 0)
+	{
+		if (imu_until_us > us)
+		{
+			imu_until_us -= us;
+		}
+		else
+		{
+			imu_until_us = imu_interval_us;
+			sim_imu_report ();
+		}
+	}
+	taskEXIT_CRITICAL ();
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function gets how many reports have been read.
+ */
+
+uint32_t sim_imu_reads (void)
+{
+	return (imu_reads);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** These functions answer the TWI calls as the IMU would. A read with the IMU off the
+ *  bus, or at another address, fails as a read with no ACK does.
+ */
+
+void TWI_init (void)
+{
+}
+
+bool TWI_write_reg (uint8_t address, uint8_t reg, const uint8_t* header, uint8_t header_size,
+					const uint8_t* buffer, uint8_t buffer_size)
+{
+	if (!imu_present || address != BNO080_DEFAULT_ADDRESS || header_size < SHTP_HEADER_SIZE)
+	{
+		return (false);
+	}
+	taskENTER_CRITICAL ();
+	if (header[2] == CHANNEL_EXECUTABLE)
+	{
+		imu_packet_length = 0;				// Reset
+		imu_interval_us = 0;
+		sim_imu_int ();
+	}
+	else if (header[2] == CHANNEL_CONTROL && buffer_size >= 1
+			 && buffer[0] == SHTP_REPORT_PRODUCT_ID_REQUEST)
+	{
+		uint8_t data[16] = { SHTP_REPORT_PRODUCT_ID_RESPONSE };
+		sim_imu_send (CHANNEL_CONTROL, data, sizeof (data));
+	}
+	else if (header[2] == CHANNEL_CONTROL && buffer_size >= 9
+			 && buffer[0] == SHTP_REPORT_SET_FEATURE_COMMAND
+			 && buffer[1] == SENSOR_REPORTID_GAME_ROTATION_VECTOR)
+	{
+		imu_interval_us = (uint32_t)buffer[5] | ((uint32_t)buffer[6] << 8)
+						  | ((uint32_t)buffer[7] << 16) | ((uint32_t)buffer[8] << 24);
+		imu_until_us = imu_interval_us;
+	}
+	taskEXIT_CRITICAL ();
+	return (true);
+}
+
+bool TWI_read_reg (uint8_t address, uint8_t reg, uint8_t* buffer, uint8_t buffer_size)
+{
+	return (false);
+}
+
+bool TWI_read (uint8_t address, uint8_t* buffer, uint8_t buffer_size)
+{
+	if (!imu_present || address != BNO080_DEFAULT_ADDRESS)
+	{
+		return (false);
+	}
+	taskENTER_CRITICAL ();
+	for (uint8_t index = 0; index < buffer_size; index++)
+	{
+		buffer[index] = (index < imu_packet_length) ? imu_packet[index] : 0;
+	}
+	taskEXIT_CRITICAL ();
+	return (true);
+}
+
+bool TWI_read_double_buff (uint8_t address, uint8_t* header_buff, uint8_t header_size,
+						   uint8_t* buffer, uint8_t buffer_size)
+{
+	if (!imu_present || address != BNO080_DEFAULT_ADDRESS)
+	{
+		return (false);
+	}
+	taskENTER_CRITICAL ();
+	for (uint16_t index = 0; index < (uint16_t)header_size + buffer_size; index++)
+	{
+		uint8_t byte = (index < imu_packet_length) ? imu_packet[index] : 0;
+		if (index < header_size)
+		{
+			header_buff[index] = byte;
+		}
+		else
+		{
+			buffer[index - header_size] = byte;
+		}
+	}
+	if (imu_packet_length > 0 && imu_packet[2] == CHANNEL_REPORTS)
+	{
+		imu_reads++;
+	}
+	imu_packet_length = 0;					// The whole packet has been read
+	sim_imu_int ();
+	taskEXIT_CRITICAL ();
+	return (true);
+}
+
+bool TWI_read_clear (uint8_t address, uint16_t buffer_size)
+{
+	if (!imu_present || address != BNO080_DEFAULT_ADDRESS)
+	{
+		return (false);
+	}
+	taskENTER_CRITICAL ();
+	imu_packet_length = 0;
+	sim_imu_int ();
+	taskEXIT_CRITICAL ();
+	return (true);
+}
@@ -0,0 +1,58 @@
+//**************************************************************************************
+/** \file sim_imu.h
+ *    This file contains header stuff for the simulated BNO080 IMU. It answers the TWI
+ *    calls in twi.h as the IMU would, so the real BNO080 driver runs against it, and
+ *    sends game rotation vector reports of the plant's true heading.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _SIM_IMU_H_
+#define _SIM_IMU_H_
+
+#include <stdint.h>
+#include <avr/io.h>
+
+#include "sim_plant.h"
+
+/** This function connects the IMU to the plant whose heading it reports.
+ *  @param p_plant The plant
+ *  @param p_int_port Port the IMU's INT output is wired to
+ *  @param int_pin_bm Bit mask of the INT pin
+ *  @param present False to leave the IMU off the bus, as if it weren't fitted
+ */
+void sim_imu_attach (const sim_plant* p_plant, PORT_t* p_int_port, uint8_t int_pin_bm,
+					 bool present);
+
+/** This function runs the IMU on by some time, making a report whenever one is due.
+ *  @param us How long to run it, in microseconds
+ */
+void sim_imu_step (uint32_t us);
+
+/** This function gets the IMU's yaw, as it would report it just now.
+ *  @return The yaw (rad), from where the IMU thinks it started
+ */
+double sim_imu_yaw (void);
+
+/** This function gets how many reports have been read out of the IMU.
+ *  @return The number of game rotation vector reports read
+ */
+uint32_t sim_imu_reads (void);
+
+#endif // _SIM_IMU_H_
@@ -0,0 +1,536 @@
+//**************************************************************************************
+/** \file sim_main.cpp
+ *    This file contains a PC program which runs the robot's control code in closed
+ *    loop against the plant model in sim_plant.cpp and reports how the step responses
+ *    come out, so gains can be tuned without the robot on the bench.
+ *
+ *    The firmware's motorDriver, drive_pair, odometry, drive_control, path_follower and
+ *    motion_profile code is compiled unchanged for the PC; only the PWM and quadrature
+ *    decoder calls are replaced (sim_hw.cpp). Each task's loop body runs at the rate it
+ *    runs at on the robot, but with no RTOS, so a run takes a tiny fraction of the
+ *    simulated time.
+ *
+ *    Usage: sim wheel [options]      Motor 1 alone, position step of --target ticks
+ *           sim goal [options]       Whole robot following a path through each --goal X Y
+ *           sim open [options]       Motor 1 alone at a fixed --pwm, no feedback
+ *    Options: --target N  --goal X Y  --time SECONDS  --csv FILE  --repeat N  --ideal
+ *             --lookahead N  --profile  --v_max N --a_max N --j_max N  --pwm N
+ *             --kp_l N --ki_l N --kd_l N --kp_a N --ki_a N --kd_a N --pwm_lim N
+ *             --d_filter N --aw N
+ *
+ *    One difference from the robot: \c int is 32 bits on the PC, so sums in
+ *    motorDriver::run() which would overflow 16 bits on the AVR don't here.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 Odometry reads the encoders' 32 bit counts, as task_Robot_State does
+ *    \li 10-18-26 Goal runs use drive_pair, as task_motor does
+ *    \li 10-18-26 Motors are given wheel speeds and run with derivative action enabled
+ *    \li 10-18-26 Goal runs follow a path of waypoints, as task_motor does
+ *    \li 10-18-26 Motion profiles for goal runs, and for wheel runs with --profile
+ *    \li 10-18-26 Speed band gains and feedforward; open loop runs for fit_gains
+ *    \li 10-18-26 Odometry runs at the odometry timer's rate, with a binary angle heading
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "motorDriver.h"
+#include "drive_pair.h"
+#include "odometry.h"
+#include "qdec_driver.h"
+#include "drive_control.h"
+#include "path_follower.h"
+#include "motion_profile.h"
+#include "control_timer.h"
+#include "odometry_timer.h"
+#include "pwm_out.h"
+#include "sim_hw.h"
+#include "sim_plant.h"
+
+#define SIM_DT_MS 1							// Plant integration step
+#define SIM_MOTOR_PERIOD_MS (1000 / CONTROL_RATE_HZ)	// task_motor's timer period
+#define SIM_ODOMETRY_PERIOD_MS (1000 / ODOMETRY_RATE_HZ)	// The odometry timer's period
+#define SIM_BAND_FRACTION 0.02				// Settled within 2% of the step...
+#define SIM_BAND_MIN 5.0					// ...or 5 ticks, whichever is bigger
+#define SIM_GOALS_MAX 16					// Waypoints which can be given with --goal
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Step response figures worked out by step_recorder.
+ */
+
+struct step_metrics
+{
+	double rise_s;							// 10% to 90% of the step (s), <0 if never
+	double settling_s;						// Time to stay within the band (s), <0 if never
+	double overshoot_pct;					// Furthest past the target, % of the step
+	double final_error;						// Distance from the target at the end (ticks)
+};
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Collects a step response and works out its metrics.
+ */
+
+class step_recorder
+{
+protected:
+	double step;							// Size of the step (ticks)
+	double band;							// Settled when the error stays within this
+	double peak;							// Largest progress seen, 1.0 is the target
+	double t10, t90;						// When 10% and 90% progress were first reached
+	double t_out;							// Last time the error was outside the band
+	double last_error;
+
+public:
+	step_recorder (double step_size)
+		: step (fabs (step_size)), band (fmax (SIM_BAND_FRACTION * fabs (step_size), SIM_BAND_MIN)),
+		  peak (0.0), t10 (-1.0), t90 (-1.0), t_out (0.0), last_error (fabs (step_size))
+	{
+	}
+
+	/** This method records one sample.
+	 *  @param t Time of the sample (s)
+	 *  @param progress Distance moved towards the target (ticks)
+	 *  @param error Distance from the target (ticks)
+	 */
+	void add (double t, double progress, double error)
+	{
+		double p = (step > 0.0) ? progress / step : 1.0;
+		peak = fmax (peak, p);
+		if (t10 < 0.0 && p >= 0.1) t10 = t;
+		if (t90 < 0.0 && p >= 0.9) t90 = t;
+		if (fabs (error) > band) t_out = t;
+		last_error = error;
+	}
+
+	/** This method works out the metrics of the samples recorded so far.
+	 *  @param t_end Time of the last sample (s)
+	 */
+	step_metrics metrics (double t_end)
+	{
+		step_metrics m;
+		m.rise_s = (t10 >= 0.0 && t90 >= 0.0) ? t90 - t10 : -1.0;
+		m.settling_s = (t_out < t_end) ? t_out : -1.0;
+		m.overshoot_pct = fmax (0.0, peak - 1.0) * 100.0;
+		m.final_error = last_error;
+		return m;
+	}
+};
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Options from the command line.
+ */
+
+struct sim_options
+{
+	drive_gains gains;
+	int16_t target;							// Wheel mode step (ticks)
+	waypoint goals[SIM_GOALS_MAX];			// Goal mode path (ticks)
+	int goal_count;
+	bool ideal;								// Steer from the true pose, not odometry
+	int16_t lookahead;						// Path follower lookahead distance (ticks)
+	bool profile;							// Wheel mode tracks a motion profile
+	motion_limits limits;					// The motion profile's limits
+	int16_t pwm;							// Open mode duty cycle (percent)
+	double time_s;							// Length of each run
+	const char* csv;						// Trace file, NULL for none
+	int repeat;								// Runs to do, for timing
+};
+
+
+//-------------------------------------------------------------------------------------
+/** This function runs motor 1 alone in a position loop, the way motorDriver was first
+ *  tested: its linear setpoint is the target and its position the wheel's encoder
+ *  count. The angular loop is left with zero error.
+ */
+
+static step_metrics run_wheel (const sim_options& opt, FILE* csv)
+{
+	sim_plant plant;
+	motorDriver motor1 ('1', NULL);
+	motorDriver motor2 ('2', NULL);
+	drive_set_gains (motor1, motor2, opt.gains);
+	step_recorder rec (opt.target);
+	motion_profile profile (opt.limits, CONTROL_RATE_HZ);
+	profile.plan (opt.target);
+
+	if (csv) fprintf (csv, "t,position,target,reference,pwm\n");
+	diagnostic diag = diagnostic ();
+	int16_t position = 0;
+	int16_t position_prev = 0;
+	int32_t steps = (int32_t)(opt.time_s * 1000.0 / SIM_DT_MS);
+	for (int32_t i = 0; i <= steps; i++)
+	{
+		int32_t now_ms = i * SIM_DT_MS;
+		if (now_ms % SIM_MOTOR_PERIOD_MS == 0)
+		{
+			position = -1 * QDEC_Read_TC (&TCD1);	// Positive forwards, as in task_Robot_State
+			motor1.set_position (position);
+			motor1.set_velocity ((position - position_prev) * CONTROL_RATE_HZ);
+			position_prev = position;
+			int16_t reference = opt.target;
+			if (opt.profile)
+			{
+				profile.step ();
+				reference = profile.position ();
+				motor1.set_velocity_ref (profile.velocity ());
+				motor1.set_accel_ref (profile.acceleration ());
+				drive_set_band (motor1, motor2, drive_band_index (profile.velocity ()));
+			}
+			motor1.set_setpoint_l (reference);
+			motor1.set_angle (0);
+			motor1.set_setpoint_a (0);
+			diag = motor1.run (true, true, true, true);
+			rec.add (now_ms / 1000.0, position, opt.target - position);
+			if (csv) fprintf (csv, "%.3f,%d,%d,%d,%d\n", now_ms / 1000.0, position, opt.target,
+							  reference, diag.pwm_tot);
+		}
+		plant.step (SIM_DT_MS / 1000.0);
+	}
+	return rec.metrics (opt.time_s);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function drives motor 1 alone at a fixed duty cycle from rest and logs its
+ *  position, as a bench test on the robot would. The logs are what fit_gains reads.
+ *  The final error is left at zero; the wheel's final speed is printed instead.
+ */
+
+static step_metrics run_open (const sim_options& opt, FILE* csv)
+{
+	sim_plant plant;
+	pwm_out_init (PWM_OUT_FREQ_HZ);
+	uint16_t duty = (uint16_t)((uint32_t)pwm_out_period () * abs (opt.pwm) / 100);
+	if (opt.pwm >= 0)
+	{
+		pwm_out_write (duty, 0, 0, 0);
+	}
+	else
+	{
+		pwm_out_write (0, duty, 0, 0);
+	}
+
+	if (csv) fprintf (csv, "t,pwm,position\n");
+	int32_t steps = (int32_t)(opt.time_s * 1000.0 / SIM_DT_MS);
+	for (int32_t i = 0; i <= steps; i++)
+	{
+		int32_t now_ms = i * SIM_DT_MS;
+		if (now_ms % SIM_MOTOR_PERIOD_MS == 0)
+		{
+			int16_t position = -1 * QDEC_Read_TC (&TCD1);
+			if (csv) fprintf (csv, "%.3f,%d,%d\n", now_ms / 1000.0, opt.pwm, position);
+		}
+		plant.step (SIM_DT_MS / 1000.0);
+	}
+	printf ("%-16s %.0f ticks/s\n", "Final speed:", plant.v_left);
+
+	step_metrics m = step_metrics ();
+	m.rise_s = -1.0;
+	m.settling_s = -1.0;
+	return m;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function runs the whole robot as the firmware does: the odometry from the
+ *  odometry timer's interrupt feeding the path follower and both motors from task_motor. The
+ *  waypoints are given to the follower as it has room for them, as task_motor takes
+ *  them from the waypoint queue. Progress is measured on the plant's true position,
+ *  along the straight line from the start to the last waypoint; the error is the true
+ *  distance left to the last waypoint.
+ */
+
+static step_metrics run_goal (const sim_options& opt, FILE* csv)
+{
+	sim_plant plant;
+	odometry odo;
+	drive_pair motors (NULL);
+	drive_set_gains (motors, opt.gains);
+	path_follower path (opt.lookahead);
+	motion_profile profile (opt.limits, CONTROL_RATE_HZ);
+	int given = 0;
+
+	const waypoint& last = opt.goals[opt.goal_count - 1];
+	double dist0 = hypot (last.x, last.y);
+	double ux = (dist0 > 0.0) ? last.x / dist0 : 1.0;
+	double uy = (dist0 > 0.0) ? last.y / dist0 : 0.0;
+	step_recorder rec (dist0);
+
+	if (csv) fprintf (csv, "t,x,y,heading,est_x,est_y,est_heading,distance,steer,target_x,target_y,pwm_1,pwm_2\n");
+	QDEC_Ext_t enc1;
+	QDEC_Ext_t enc2;
+	QDEC_Ext_Setup (&enc1, &TCD1, TC_OVFINTLVL_LO_gc);
+	QDEC_Ext_Setup (&enc2, &TCF0, TC_OVFINTLVL_LO_gc);
+	odo.reset (-1 * QDEC_Ext_Read (&enc1), QDEC_Ext_Read (&enc2));
+	int32_t count_prev[2] = { -1 * QDEC_Ext_Read (&enc1), QDEC_Ext_Read (&enc2) };
+	drive_setpoints sp = drive_setpoints ();
+	diagnostic diag_1 = diagnostic ();
+	diagnostic diag_2 = diagnostic ();
+	int32_t steps = (int32_t)(opt.time_s * 1000.0 / SIM_DT_MS);
+	for (int32_t i = 0; i <= steps; i++)
+	{
+		int32_t now_ms = i * SIM_DT_MS;
+		if (now_ms % SIM_ODOMETRY_PERIOD_MS == 0)
+		{
+			odo.update (-1 * QDEC_Ext_Read (&enc1), QDEC_Ext_Read (&enc2));
+		}
+		if (now_ms % SIM_MOTOR_PERIOD_MS == 0)
+		{
+			// Wheel speeds over the last pass, positive forwards
+			int32_t count[2] = { -1 * QDEC_Ext_Read (&enc1), QDEC_Ext_Read (&enc2) };
+			motors.set_velocity ((int16_t)((count[0] - count_prev[0]) * CONTROL_RATE_HZ),
+								 (int16_t)((count[1] - count_prev[1]) * CONTROL_RATE_HZ));
+			count_prev[0] = count[0];
+			count_prev[1] = count[1];
+
+			while (given < opt.goal_count && path.has_room ())
+			{
+				path.add (opt.goals[given++]);
+			}
+			if (opt.ideal)
+			{
+				uint16_t heading = (uint16_t)(int32_t)lround (plant.heading * FX_BRAD_PER_TURN / (2.0 * M_PI));
+				sp = drive_follow_path (motors, path, profile, (int16_t)lround (plant.x),
+										(int16_t)lround (plant.y), heading);
+			}
+			else
+			{
+				sp = drive_follow_path (motors, path, profile, odo.get_x (), odo.get_y (),
+										odo.get_heading ());
+			}
+			motors.run (true, true, true, true, diag_1, diag_2);
+
+			double progress = plant.x * ux + plant.y * uy;
+			double error = hypot (last.x - plant.x, last.y - plant.y);
+			rec.add (now_ms / 1000.0, progress, error);
+			if (csv)
+			{
+				waypoint target = path.target ();
+				fprintf (csv, "%.3f,%.1f,%.1f,%.3f,%d,%d,%d,%d,%d,%d,%d,%d,%d\n", now_ms / 1000.0,
+						 plant.x, plant.y, plant.heading, odo.get_x (), odo.get_y (),
+						 odo.get_heading (), sp.distance, sp.steer, target.x, target.y,
+						 diag_1.pwm_tot, diag_2.pwm_tot);
+			}
+		}
+		plant.step (SIM_DT_MS / 1000.0);
+	}
+	return rec.metrics (opt.time_s);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function prints how to use the program.
+ */
+
+static int usage (void)
+{
+	printf ("Usage: sim wheel|goal|open [options]\n"
+			"  --target N        wheel: step size in ticks (default 500)\n"
+			"  --goal X Y        goal: waypoint in ticks, repeat for a path (default 385 300,\n"
+			"                    as task_user)\n"
+			"  --ideal           goal: steer from the true pose rather than the odometry\n"
+			"  --lookahead N     goal: path follower lookahead in ticks (default 250)\n"
+			"  --profile         wheel: track a motion profile rather than a step\n"
+			"  --v_max N  --a_max N  --j_max N\n"
+			"                    override the limits in drive_limits_default\n"
+			"  --pwm N           open: duty cycle in percent (default 30)\n"
+			"  --time S          length of each run in seconds (default 10)\n"
+			"  --csv FILE        write a trace of the run\n"
+			"  --repeat N        do the run N times, to time it\n"
+			"  --kp_l N  --ki_l N  --kd_l N  --kp_a N  --ki_a N  --kd_a N  --pwm_lim N\n"
+			"  --d_filter N  --aw N\n"
+			"                    override the gains in drive_gains_default\n");
+	return 1;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function prints a time in seconds, or that it never happened.
+ */
+
+static void print_time (const char* label, double t)
+{
+	if (t < 0.0)
+	{
+		printf ("%-16s never\n", label);
+	}
+	else
+	{
+		printf ("%-16s %.3f s\n", label, t);
+	}
+}
+
+
+int main (int argc, char** argv)
+{
+	if (argc < 2 || (strcmp (argv[1], "wheel") != 0 && strcmp (argv[1], "goal") != 0
+					 && strcmp (argv[1], "open") != 0))
+	{
+		return usage ();
+	}
+	bool wheel = (strcmp (argv[1], "wheel") == 0);
+	bool open = (strcmp (argv[1], "open") == 0);
+
+	sim_options opt;
+	opt.gains = drive_gains_default;
+	opt.target = 500;
+	opt.goals[0].x = 5 * 77;
+	opt.goals[0].y = 300;
+	opt.goal_count = 1;
+	opt.ideal = false;
+	opt.lookahead = PATH_LOOKAHEAD_TICKS;
+	opt.profile = false;
+	opt.limits = drive_limits_default;
+	opt.pwm = 30;
+	bool goal_given = false;
+	opt.time_s = 10.0;
+	opt.csv = NULL;
+	opt.repeat = 1;
+
+	struct { const char* name; int16_t* p_value; } gain_args[] =
+	{
+		{ "--kp_l", &opt.gains.kp_l }, { "--ki_l", &opt.gains.ki_l }, { "--kd_l", &opt.gains.kd_l },
+		{ "--kp_a", &opt.gains.kp_a }, { "--ki_a", &opt.gains.ki_a }, { "--kd_a", &opt.gains.kd_a },
+		{ "--pwm_lim", &opt.gains.pwm_lim }
+	};
+
+	for (int i = 2; i < argc; i++)
+	{
+		bool known = false;
+		for (size_t g = 0; g < sizeof (gain_args) / sizeof (gain_args[0]); g++)
+		{
+			if (strcmp (argv[i], gain_args[g].name) == 0 && i + 1 < argc)
+			{
+				*gain_args[g].p_value = (int16_t)atoi (argv[++i]);
+				known = true;
+			}
+		}
+		if (known)
+		{
+			continue;
+		}
+		if (strcmp (argv[i], "--target") == 0 && i + 1 < argc)
+		{
+			opt.target = (int16_t)atoi (argv[++i]);
+		}
+		else if (strcmp (argv[i], "--goal") == 0 && i + 2 < argc)
+		{
+			if (!goal_given)
+			{
+				opt.goal_count = 0;			// The first one replaces the default
+				goal_given = true;
+			}
+			if (opt.goal_count == SIM_GOALS_MAX)
+			{
+				return usage ();
+			}
+			opt.goals[opt.goal_count].x = (int16_t)atoi (argv[++i]);
+			opt.goals[opt.goal_count].y = (int16_t)atoi (argv[++i]);
+			opt.goal_count++;
+		}
+		else if (strcmp (argv[i], "--ideal") == 0)
+		{
+			opt.ideal = true;
+		}
+		else if (strcmp (argv[i], "--lookahead") == 0 && i + 1 < argc)
+		{
+			opt.lookahead = (int16_t)atoi (argv[++i]);
+		}
+		else if (strcmp (argv[i], "--profile") == 0)
+		{
+			opt.profile = true;
+		}
+		else if (strcmp (argv[i], "--v_max") == 0 && i + 1 < argc)
+		{
+			opt.limits.v_max = (uint16_t)atoi (argv[++i]);
+		}
+		else if (strcmp (argv[i], "--a_max") == 0 && i + 1 < argc)
+		{
+			opt.limits.a_max = (uint16_t)atoi (argv[++i]);
+		}
+		else if (strcmp (argv[i], "--j_max") == 0 && i + 1 < argc)
+		{
+			opt.limits.j_max = (uint32_t)atol (argv[++i]);
+		}
+		else if (strcmp (argv[i], "--pwm") == 0 && i + 1 < argc)
+		{
+			opt.pwm = (int16_t)atoi (argv[++i]);
+		}
+		else if (strcmp (argv[i], "--d_filter") == 0 && i + 1 < argc)
+		{
+			opt.gains.d_filter_shift = (uint8_t)atoi (argv[++i]);
+		}
+		else if (strcmp (argv[i], "--aw") == 0 && i + 1 < argc)
+		{
+			opt.gains.aw_shift = (uint8_t)atoi (argv[++i]);
+		}
+		else if (strcmp (argv[i], "--time") == 0 && i + 1 < argc)
+		{
+			opt.time_s = atof (argv[++i]);
+		}
+		else if (strcmp (argv[i], "--csv") == 0 && i + 1 < argc)
+		{
+			opt.csv = argv[++i];
+		}
+		else if (strcmp (argv[i], "--repeat") == 0 && i + 1 < argc)
+		{
+			opt.repeat = atoi (argv[++i]);
+		}
+		else
+		{
+			return usage ();
+		}
+	}
+
+	FILE* csv = NULL;
+	if (opt.csv && (csv = fopen (opt.csv, "w")) == NULL)
+	{
+		printf ("Cannot write %s\n", opt.csv);
+		return 1;
+	}
+
+	step_metrics m = step_metrics ();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+	for (int r = 0; r < opt.repeat; r++)
+	{
+		m = wheel ? run_wheel (opt, csv) : open ? run_open (opt, csv) : run_goal (opt, csv);
+		if (csv)
+		{
+			fclose (csv);
+			csv = NULL;						// Only the first run is traced
+		}
+	}
+	double wall_s = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+	if (!open)
+	{
+		print_time ("Rise time:", m.rise_s);
+		print_time ("Settling time:", m.settling_s);
+		printf ("%-16s %.1f %%\n", "Overshoot:", m.overshoot_pct);
+		printf ("%-16s %.1f ticks\n", "Final error:", m.final_error);
+	}
+	printf ("Simulated %.1f s x %d in %.2f ms, %.0f times real time\n", opt.time_s, opt.repeat,
+			wall_s * 1000.0, (wall_s > 0.0) ? opt.time_s * opt.repeat / wall_s : 0.0);
+	return 0;
+}
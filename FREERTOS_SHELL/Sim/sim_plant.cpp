@@ -0,0 +1,162 @@
+//**************************************************************************************
+/** \file sim_plant.cpp
+ *    This file contains a model of the differential drive robot, used to run the
+ *    control code in closed loop on a PC.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 Duty cycles are read from TCC0's compare buffers
+ *    \li 10-18-26 The left encoder can be made to slip
+ *    \li 10-18-26 A PWM channel whose output is turned off drives its input low
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include <math.h>
+
+#include <avr/io.h>
+
+#include "odometry.h"						// For WHEELBASE_TICKS
+#include "sim_plant.h"
+
+const sim_motor_params sim_motor_default =
+{
+	3600.0,									// speed_max
+	0.08,									// tau
+	0.08									// deadband
+};
+
+
+//-------------------------------------------------------------------------------------
+/** This constructor makes a robot at rest at the origin.
+ *  @param left Motor parameters for the left (motor 1, ENC1) side
+ *  @param right Motor parameters for the right (motor 2, ENC2) side
+ */
+
+sim_plant::sim_plant (const sim_motor_params& left, const sim_motor_params& right)
+	: left_params (left), right_params (right), wheelbase (WHEELBASE_TICKS), slip_left (0.0)
+{
+	reset ();
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method puts the robot back at rest at the origin, facing along the X axis,
+ *  with both encoders reading zero.
+ */
+
+void sim_plant::reset (void)
+{
+	enc_left = enc_right = 0.0;
+	x = y = heading = 0.0;
+	v_left = v_right = 0.0;
+	TCD1.CNT = 0;
+	TCF0.CNT = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function turns a compare value of TCC0 into the fraction of the PWM period
+ *  the output is high. The timer counts from 0 to PER, and a compare value above PER
+ *  holds the output high. The plant reads the buffers; the copy into the compare
+ *  registers when the timer overflows isn't modelled, as the plant is only stepped
+ *  between control passes anyway. A channel whose output is turned off in CTRLB
+ *  leaves its pin at the port's output value, which is never set, so it's low.
+ *  @param compare The channel's compare buffer
+ *  @param enable The channel's output enable bit in CTRLB
+ */
+
+static double sim_duty (uint16_t compare, uint8_t enable)
+{
+	double period = TCC0.PER + 1.0;
+	if (!(TCC0.CTRLB & enable))
+	{
+		return 0.0;
+	}
+	return (compare >= period) ? 1.0 : compare / period;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method works out the drive on the left wheel from the duty cycles on its two
+ *  H-bridge inputs. Motor 1 drives forwards when IN1 (channel A) is above IN2
+ *  (channel B), in both drive-coast and drive-brake modes.
+ *  @return Average drive as a fraction of full voltage, -1 to 1
+ */
+
+double sim_plant::duty_left (void)
+{
+	return sim_duty (TCC0.CCABUF, TC0_CCAEN_bm) - sim_duty (TCC0.CCBBUF, TC0_CCBEN_bm);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method works out the drive on the right wheel. Motor 2 is mounted facing the
+ *  other way, so it drives forwards when IN2 (channel D) is above IN1 (channel C).
+ *  @return Average drive as a fraction of full voltage, -1 to 1
+ */
+
+double sim_plant::duty_right (void)
+{
+	return sim_duty (TCC0.CCDBUF, TC0_CCDEN_bm) - sim_duty (TCC0.CCCBUF, TC0_CCCEN_bm);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method finds a wheel's acceleration. Duty below the deadband doesn't move the
+ *  motor; above it, the wheel speed heads exponentially for the speed the remaining
+ *  duty gives.
+ *  @param params The motor's parameters
+ *  @param duty Drive as a fraction of full voltage, -1 to 1
+ *  @param speed Current wheel speed (ticks/s)
+ *  @return Acceleration (ticks/s^2)
+ */
+
+double sim_plant::wheel_accel (const sim_motor_params& params, double duty, double speed)
+{
+	double drive = 0.0;
+	if (fabs (duty) > params.deadband)
+	{
+		drive = (duty > 0 ? duty - params.deadband : duty + params.deadband)
+				/ (1.0 - params.deadband);
+	}
+	return (drive * params.speed_max - speed) / params.tau;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method moves the robot on by one time step and updates the encoder counters.
+ *  The left encoder counts backwards when driving forwards, as on the robot, which is
+ *  why task_Robot_State negates it.
+ *  @param dt Time step (s); a millisecond or less keeps the Euler integration honest
+ */
+
+void sim_plant::step (double dt)
+{
+	v_left += wheel_accel (left_params, duty_left (), v_left) * dt;
+	v_right += wheel_accel (right_params, duty_right (), v_right) * dt;
+
+	double v = (v_left + v_right) / 2.0;
+	double omega = (v_right - v_left) / wheelbase;
+	double mid_heading = heading + omega * dt / 2.0;
+	x += v * cos (mid_heading) * dt;
+	y += v * sin (mid_heading) * dt;
+	heading += omega * dt;
+
+	enc_left += v_left * dt * (1.0 + slip_left);
+	enc_right += v_right * dt;
+	TCD1.CNT = (uint16_t)(int32_t)floor (-enc_left);
+	TCF0.CNT = (uint16_t)(int32_t)floor (enc_right);
+}
@@ -0,0 +1,81 @@
+//**************************************************************************************
+/** \file sim_plant.h
+ *    This file contains header stuff for a model of the differential drive robot, used
+ *    to run the control code in closed loop on a PC.
+ *
+ *    Each wheel is driven by a DC motor modeled as a first order lag from PWM duty to
+ *    wheel speed, with a deadband standing in for static friction. The motors read the
+ *    duty cycles from timer TCC0's compare buffers, and the wheels drive the encoder
+ *    counters which QDEC_Read_TC() returns. Distances are in encoder ticks throughout,
+ *    like the firmware.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 Duty cycles are read from TCC0's compare buffers
+ *    \li 10-18-26 The left encoder can be made to slip
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _SIM_PLANT_H_
+#define _SIM_PLANT_H_
+
+#include <stdint.h>
+
+/// Parameters of one wheel's motor and gearbox
+struct sim_motor_params
+{
+	double speed_max;						// Wheel speed at 100% duty (ticks/s)
+	double tau;								// Time constant from duty to speed (s)
+	double deadband;						// Duty fraction lost to static friction
+};
+
+/// A guess at the Fall 2018 robot: about 5 wheel rev/s no load, 725 ticks/rev
+extern const sim_motor_params sim_motor_default;
+
+//-------------------------------------------------------------------------------------
+/** @brief   The robot: two motors, two wheels, two encoders and a caster.
+ */
+
+class sim_plant
+{
+protected:
+	sim_motor_params left_params;
+	sim_motor_params right_params;
+	double wheelbase;						// Distance between the wheels (ticks)
+	double enc_left;						// Wheel travel, positive forwards (ticks)
+	double enc_right;
+
+	double wheel_accel (const sim_motor_params& params, double duty, double speed);
+
+public:
+	double x;								// True position in the inertial frame (ticks)
+	double y;
+	double heading;							// True heading, CCW from the X axis (rad)
+	double v_left;							// Wheel speeds, positive forwards (ticks/s)
+	double v_right;
+	double slip_left;						// Extra the left encoder counts, as a fraction
+
+	sim_plant (const sim_motor_params& left = sim_motor_default,
+			   const sim_motor_params& right = sim_motor_default);
+
+	void reset (void);
+	void step (double dt);
+	double duty_left (void);
+	double duty_right (void);
+};
+
+#endif // _SIM_PLANT_H_
@@ -0,0 +1,175 @@
+//**************************************************************************************
+/** \file sim_vision.cpp
+ *    This file contains the simulated vision tracker. See sim_vision.h.
+ *
+ *    The poses are perfect but late, so any difference between them and the odometry
+ *    is the odometry's error, or a mistake in allowing for the latency. Each packet is
+ *    put through the receiver interrupt in one go, as if the 12 bytes took no time at
+ *    all; at 115200 baud they take about 1 ms, one step of the plant.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include <math.h>
+#include <avr/io.h>
+#include <util/crc16.h>
+
+#include "FreeRTOS.h"                       // Primary header for FreeRTOS
+#include "task.h"                           // For the critical sections
+
+#include "vision_link.h"					// The packet format
+#include "sim_hw.h"							// The receiver interrupt
+#include "sim_vision.h"
+
+#define SIM_VISION_QUEUE 32					// Pictures taken but not yet sent
+
+/// A picture taken, waiting to be sent
+struct sim_vision_picture
+{
+	uint32_t taken_us;						// When it was taken
+	int16_t x;								// The robot's true pose then
+	int16_t y;
+	uint16_t heading;
+};
+
+static const sim_plant* p_vision_plant = NULL;
+static uint32_t vision_period_us = 0;
+static uint32_t vision_latency_us = 0;
+static uint32_t vision_now_us = 0;			// Time since the tracker was attached
+static uint32_t vision_next_us = 0;			// When the next picture is due
+static sim_vision_picture vision_queue[SIM_VISION_QUEUE];
+static uint8_t vision_first = 0;			// Oldest picture in the queue
+static uint8_t vision_count = 0;			// Pictures in the queue
+static uint8_t vision_sequence = 0;
+static uint32_t vision_sent = 0;
+
+
+//-------------------------------------------------------------------------------------
+/** This function connects the tracker to the plant and empties its queue.
+ */
+
+void sim_vision_attach (const sim_plant* p_plant, uint16_t period_ms, uint16_t latency_ms)
+{
+	p_vision_plant = p_plant;
+	vision_period_us = period_ms * 1000UL;
+	vision_latency_us = latency_ms * 1000UL;
+	vision_now_us = 0;
+	vision_next_us = vision_period_us;
+	vision_first = 0;
+	vision_count = 0;
+	vision_sent = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function puts a packet through USARTF0's receiver interrupt, a byte at a time,
+ *  if the receiver and its interrupt are on.
+ *  @param p_bytes The packet
+ *  @param length Its length
+ */
+
+static void sim_vision_receive (const uint8_t* p_bytes, uint8_t length)
+{
+	if (!(USARTF0.CTRLB & USART_RXEN_bm) || !(USARTF0.CTRLA & USART_RXCINTLVL_gm))
+	{
+		return;
+	}
+	for (uint8_t index = 0; index < length; index++)
+	{
+		taskENTER_CRITICAL ();
+		USARTF0.STATUS = 0;
+		USARTF0.DATA = p_bytes[index];
+		USARTF0_RXC_vect ();
+		taskEXIT_CRITICAL ();
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function sends the pose from a picture, with its age as it's sent.
+ *  @param picture The picture
+ */
+
+static void sim_vision_send (const sim_vision_picture& picture)
+{
+	uint16_t age_ms = (uint16_t)((vision_now_us - picture.taken_us) / 1000UL);
+	uint8_t packet[VISION_PACKET] =
+	{
+		VISION_SYNC_1, VISION_SYNC_2, vision_sequence++,
+		(uint8_t)picture.x, (uint8_t)((uint16_t)picture.x >> 8),
+		(uint8_t)picture.y, (uint8_t)((uint16_t)picture.y >> 8),
+		(uint8_t)picture.heading, (uint8_t)(picture.heading >> 8),
+		(uint8_t)age_ms, (uint8_t)(age_ms >> 8),
+		0
+	};
+	uint8_t crc = 0;
+	for (uint8_t index = 2; index < 2 + VISION_PAYLOAD; index++)
+	{
+		crc = _crc8_ccitt_update (crc, packet[index]);
+	}
+	packet[VISION_PACKET - 1] = crc;
+	sim_vision_receive (packet, VISION_PACKET);
+	vision_sent++;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function runs the tracker on by some time.
+ */
+
+void sim_vision_step (uint32_t us)
+{
+	if (p_vision_plant == NULL || vision_period_us == 0)
+	{
+		return;
+	}
+	vision_now_us += us;
+
+	if (vision_now_us >= vision_next_us)
+	{
+		vision_next_us += vision_period_us;
+		if (vision_count < SIM_VISION_QUEUE)
+		{
+			sim_vision_picture& picture 
+				= vision_queue[(vision_first + vision_count++) % SIM_VISION_QUEUE];
+			picture.taken_us = vision_now_us;
+			picture.x = (int16_t)lround (p_vision_plant->x);
+			picture.y = (int16_t)lround (p_vision_plant->y);
+			picture.heading = (uint16_t)(llround (p_vision_plant->heading * 65536.0 
+												  / (2.0 * M_PI)) & 0xFFFF);
+		}
+	}
+
+	while (vision_count > 0 
+		   && vision_now_us - vision_queue[vision_first].taken_us >= vision_latency_us)
+	{
+		sim_vision_send (vision_queue[vision_first]);
+		vision_first = (vision_first + 1) % SIM_VISION_QUEUE;
+		vision_count--;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function gets how many packets the tracker has sent.
+ */
+
+uint32_t sim_vision_sent (void)
+{
+	return (vision_sent);
+}
@@ -0,0 +1,51 @@
+//**************************************************************************************
+/** \file sim_vision.h
+ *    This file contains header stuff for the simulated vision tracker. It takes the
+ *    plant's true pose at the camera's frame rate, and some time later sends it in a
+ *    packet through USARTF0's receiver interrupt, as the tracker on the Pi would.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _SIM_VISION_H_
+#define _SIM_VISION_H_
+
+#include <stdint.h>
+
+#include "sim_plant.h"
+
+/** This function connects the tracker to the plant whose pose it sees.
+ *  @param p_plant The plant
+ *  @param period_ms Time between pictures; zero to leave the tracker off
+ *  @param latency_ms Time from taking a picture to sending the pose from it
+ */
+void sim_vision_attach (const sim_plant* p_plant, uint16_t period_ms, uint16_t latency_ms);
+
+/** This function runs the tracker on by some time, taking pictures and sending poses
+ *  whenever they're due.
+ *  @param us How long to run it, in microseconds
+ */
+void sim_vision_step (uint32_t us);
+
+/** This function gets how many packets the tracker has sent.
+ *  @return The number of packets
+ */
+uint32_t sim_vision_sent (void);
+
+#endif // _SIM_VISION_H_
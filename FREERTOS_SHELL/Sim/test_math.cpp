@@ -0,0 +1,214 @@
+//**************************************************************************************
+/** \file test_math.cpp
+ *    This file contains a PC program which checks the fixed point math library in
+ *    fixed_math.cpp against the C library's floating point functions. Sines and
+ *    cosines are checked at every one of the 65536 binary angles, atan2 over a grid of
+ *    small vectors and a spread of large ones, the square root over every number up to
+ *    2^20 and a spread above that, and hypot over a spread of vectors of all sizes.
+ *
+ *    Usage: test_math
+ *
+ *    The worst error of each function is printed against the limit it is held to, and
+ *    the program exits with 1 if any is over, so "make mathtest" fails.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "fixed_math.h"
+
+#define TEST_SIN_COUNTS 1					// Largest sin/cos error, Q15 counts
+#define TEST_ATAN2_COUNTS 2					// Largest atan2 error, binary angle counts
+#define TEST_HYPOT_RELATIVE 0.0008			// Largest hypot error, fraction of the length
+#define TEST_SPREAD_RUNS 1000000			// Random inputs for the large vector checks
+
+
+//-------------------------------------------------------------------------------------
+/** This function makes the pseudorandom inputs. It's a fixed generator, rather than
+ *  rand(), so every run checks the same numbers on every PC.
+ *  @return The next number, 0 to 2^32 - 1
+ */
+
+static uint32_t next_random (void)
+{
+	static uint32_t state = 12345;
+	state = state * 1664525UL + 1013904223UL;
+	return state;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function makes a pseudorandom number of any size up to a limit, spread evenly
+ *  over the number of bits rather than over the values, so small numbers get checked
+ *  as often as large ones.
+ *  @param bits The most bits the number may have, 1 to 31
+ *  @return The number, positive or negative
+ */
+
+static int32_t random_of_size (uint8_t bits)
+{
+	uint8_t size = 1 + next_random () % bits;
+	int32_t value = (int32_t)(next_random () >> (32 - size));
+	return (next_random () & 0x80000000UL) ? -value : value;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function finds how far apart two binary angles are, the short way round.
+ *  @param a One angle, 65536 counts per revolution
+ *  @param b The other angle
+ *  @return The difference in counts, 0 to 32768
+ */
+
+static int32_t angle_error (double a, double b)
+{
+	double difference = fmod (a - b, (double)FX_BRAD_PER_TURN);
+	if (difference > FX_BRAD_PER_TURN / 2)
+	{
+		difference -= FX_BRAD_PER_TURN;
+	}
+	else if (difference < -FX_BRAD_PER_TURN / 2)
+	{
+		difference += FX_BRAD_PER_TURN;
+	}
+	return (int32_t)ceil (fabs (difference));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function checks fx_atan2() for one vector.
+ *  @param y The y component
+ *  @param x The x component
+ *  @return The error in binary angle counts
+ */
+
+static int32_t atan2_error (int32_t y, int32_t x)
+{
+	if (x == 0 && y == 0)
+	{
+		return fx_atan2 (y, x);				// Defined to be 0
+	}
+	double exact = atan2 ((double)y, (double)x) * FX_BRAD_PER_TURN / (2.0 * M_PI);
+	return angle_error (fx_atan2 (y, x), exact);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function checks that fx_isqrt32() gives exactly the largest number whose
+ *  square is not more than its argument.
+ *  @param n The number
+ *  @return True if the root is exact
+ */
+
+static bool isqrt_exact (uint32_t n)
+{
+	uint64_t root = fx_isqrt32 (n);
+	return root * root <= n && (root + 1) * (root + 1) > n;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function prints one function's worst error against its limit.
+ *  @param name The function
+ *  @param worst The worst error
+ *  @param limit The most it may be
+ *  @param units What the error is in
+ *  @return True if the error is within the limit
+ */
+
+static bool report (const char* name, double worst, double limit, const char* units)
+{
+	bool good = worst <= limit;
+	printf ("%-10s worst %.6g %s, limit %.6g: %s\n", name, worst, units, limit,
+			good ? "pass" : "FAIL");
+	return good;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function runs the checks.
+ *  @return 0 if every function is within its limit, 1 if not
+ */
+
+int main (void)
+{
+	// Sine and cosine at every angle there is
+	int32_t worst_sin = 0, worst_cos = 0;
+	for (uint32_t angle = 0; angle < FX_BRAD_PER_TURN; angle++)
+	{
+		double radians = angle * 2.0 * M_PI / FX_BRAD_PER_TURN;
+		int32_t sin_error = abs (fx_sin (angle) - (int32_t)lround (sin (radians) * FX_Q15_ONE));
+		int32_t cos_error = abs (fx_cos (angle) - (int32_t)lround (cos (radians) * FX_Q15_ONE));
+		worst_sin = (sin_error > worst_sin) ? sin_error : worst_sin;
+		worst_cos = (cos_error > worst_cos) ? cos_error : worst_cos;
+	}
+
+	// Angles of every small vector, as from the motor task's goal offsets, then of
+	// large ones
+	int32_t worst_atan2 = 0;
+	for (int32_t y = -1000; y <= 1000; y++)
+	{
+		for (int32_t x = -1000; x <= 1000; x++)
+		{
+			int32_t error = atan2_error (y, x);
+			worst_atan2 = (error > worst_atan2) ? error : worst_atan2;
+		}
+	}
+	for (uint32_t run = 0; run < TEST_SPREAD_RUNS; run++)
+	{
+		int32_t error = atan2_error (random_of_size (30), random_of_size (30));
+		worst_atan2 = (error > worst_atan2) ? error : worst_atan2;
+	}
+
+	// Square roots of every number up to 2^20, then of large ones and the largest
+	uint32_t isqrt_wrong = 0;
+	for (uint32_t n = 0; n <= (1UL << 20); n++)
+	{
+		isqrt_wrong += isqrt_exact (n) ? 0 : 1;
+	}
+	for (uint32_t run = 0; run < TEST_SPREAD_RUNS; run++)
+	{
+		isqrt_wrong += isqrt_exact (next_random ()) ? 0 : 1;
+	}
+	isqrt_wrong += isqrt_exact (0xFFFFFFFFUL) ? 0 : 1;
+
+	// Lengths of vectors of every size; the result is rounded down, so it may be up to
+	// a count short of the exact length on top of the error allowed
+	double worst_hypot = 0.0;
+	for (uint32_t run = 0; run < TEST_SPREAD_RUNS; run++)
+	{
+		int32_t dx = random_of_size (31);
+		int32_t dy = random_of_size (31);
+		double exact = hypot ((double)dx, (double)dy);
+		if (exact >= 1.0)
+		{
+			double error = (fabs (fx_ihypot (dx, dy) - exact) - 1.0) / exact;
+			worst_hypot = (error > worst_hypot) ? error : worst_hypot;
+		}
+	}
+
+	bool good = report ("fx_sin", worst_sin, TEST_SIN_COUNTS, "counts");
+	good = report ("fx_cos", worst_cos, TEST_SIN_COUNTS, "counts") && good;
+	good = report ("fx_atan2", worst_atan2, TEST_ATAN2_COUNTS, "counts") && good;
+	good = report ("fx_isqrt32", isqrt_wrong, 0, "wrong") && good;
+	good = report ("fx_ihypot", worst_hypot * 100.0, TEST_HYPOT_RELATIVE * 100.0, "%") && good;
+	return good ? 0 : 1;
+}
@@ -5,6 +5,8 @@
  *  Revisions:
  *    \li 12-28-17 Written by Nathan Seidle @ SparkFun Electronics
  *    \li 11-28-18 Adapted for Xmega - Ryan Dunn - Adapted for Xmega
+ *    \li 10-18-26 Game rotation vector, INT pin polling and a fixed point yaw; the
+ *                 rotation vector is really stored when a report is parsed
  *
  *  License:
  *    This program is distributed in the hope that it will be useful,
@@ -76,6 +78,9 @@ BNO080::BNO080 (emstream *debugPort, bool printDebug)
 	commandSequenceNumber =0;
 	_printDebug = printDebug;
 	rotationVector_Q1 = 14;
+	_intPort = NULL;
+	_int = 0;
+	_quatNew = false;
 	
 }
 //STATUS: RFT
@@ -206,6 +211,18 @@ void BNO080::enableRotationVector(uint16_t timeBetweenReports)
 {
   setFeatureCommand(SENSOR_REPORTID_ROTATION_VECTOR, timeBetweenReports);
 }
+
+//Sends the packet to enable the game rotation vector, which leaves out the magnetometer
+
+/** This method configures the IMU to respond with the game rotation vector every timeBetweenReports.
+ *  It's the rotation vector without the magnetometer, so the yaw is from wherever the IMU started
+ *  and drifts slowly, but the motors' magnets and a steel floor can't pull it off.
+ *  @param timeBetweenReports Amount of time between reports from the IMU in ms
+  */
+void BNO080::enableGameRotationVector(uint16_t timeBetweenReports)
+{
+  setFeatureCommand(SENSOR_REPORTID_GAME_ROTATION_VECTOR, timeBetweenReports);
+}
 //STATUS: RFT
 //Given a sensor's report ID, this tells the BNO080 to begin reporting the values
 /** This method takes a report ID and response time and sets the default config, then passes to it's overloaded brethern
@@ -278,6 +295,35 @@ bool BNO080::sendPacket(uint8_t channelNumber, uint8_t dataLength)
 	}
 	return (true);
 }
+//Tells the library where the INT pin is, so reportReady() can look before any I2C is done
+
+/** This method sets the pin wired to the BNO080's INT output, which it pulls low while it has a
+ *  packet waiting. The pin is made an input.
+ *  @param port The port the pin is on
+ *  @param pin_bm The pin's bit mask, such as PIN2_bm
+ */
+void BNO080::setIntPin(PORT_t* port, uint8_t pin_bm)
+{
+  _intPort = port;
+  _int = pin_bm;
+  port->DIRCLR = pin_bm;
+}
+
+//Checks the INT pin; no I2C traffic, so it can be called every pass of a loop
+
+/** This method tells whether the BNO080 has a packet waiting. Reading when it hasn't costs a
+ *  whole I2C header transfer and clock stretching, so callers should look here first.
+ *  @return True if the INT pin is low, or if no INT pin was set and the caller must poll
+ */
+bool BNO080::reportReady(void)
+{
+  if (_intPort == NULL)
+  {
+    return (true);
+  }
+  return ((_intPort->IN & _int) == 0);
+}
+
 //STATUS: RFT
 //Updates the latest variables if possible
 //Returns false if new readings are not available
@@ -499,7 +545,18 @@ void BNO080::parseInputReport(void)
   }
 
   //Store these generic values to their proper global variable
-  /* if (shtpData[5] == SENSOR_REPORTID_ACCELEROMETER)
+  //The first report test must be a plain if; as an else if it hung off the if above
+  if (shtpData[5] == SENSOR_REPORTID_ROTATION_VECTOR || shtpData[5] == SENSOR_REPORTID_GAME_ROTATION_VECTOR)
+  {
+    quatAccuracy = status;
+    rawQuatI = data1;
+    rawQuatJ = data2;
+    rawQuatK = data3;
+    rawQuatReal = data4;
+    rawQuatRadianAccuracy = data5; //Only available on rotation vector, not game rot vector
+    _quatNew = true;
+  }
+  /* else if (shtpData[5] == SENSOR_REPORTID_ACCELEROMETER)
   {
     accelAccuracy = status;
     rawAccelX = data1;
@@ -527,15 +584,6 @@ void BNO080::parseInputReport(void)
     rawMagY = data2;
     rawMagZ = data3;
   } */
-  else if (shtpData[5] == SENSOR_REPORTID_ROTATION_VECTOR || shtpData[5] == SENSOR_REPORTID_GAME_ROTATION_VECTOR)
-  {
-    quatAccuracy = status;
-    rawQuatI = data1;
-    rawQuatJ = data2;
-    rawQuatK = data3;
-    rawQuatReal = data4;
-    rawQuatRadianAccuracy = data5; //Only available on rotation vector, not game rot vector
-  }
   /* else if (shtpData[5] == SENSOR_REPORTID_STEP_COUNTER)
   {
     stepCount = data3; //Bytes 8/9
@@ -662,4 +710,40 @@ float BNO080::getQuatRadianAccuracy()
 {
   float quat = qToFloat(rawQuatRadianAccuracy, rotationVector_Q1);
   return (quat);
-}
\ No newline at end of file
+}
+
+//Return whether a new rotation vector has been parsed since the last call
+/** This method tells whether a rotation vector report has come in since it was last called.
+ *  dataAvailable() is true for any packet, including command responses.
+ *  @return True once for each new rotation vector
+ */
+bool BNO080::quatAvailable()
+{
+  bool fresh = _quatNew;
+  _quatNew = false;
+  return (fresh);
+}
+
+//Return the rotation vector status
+/** This method returns the accuracy status bits of the last rotation vector, 0 (unreliable) to 3 (high)
+ */
+uint8_t BNO080::getQuatAccuracy()
+{
+  return (quatAccuracy);
+}
+
+//Return the yaw from the rotation vector, in fixed point
+/** This method returns the rotation of the IMU about its Z axis, CCW positive, as a binary angle
+ *  (65536 to a turn). It's worked out from the raw Q14 quaternion with fixed point math, as
+ *  atan2(2(wk + ij), 1 - 2(j^2 + k^2)), so it costs no floating point.
+ */
+uint16_t BNO080::getYaw()
+{
+  int32_t qi = (int16_t)rawQuatI;
+  int32_t qj = (int16_t)rawQuatJ;
+  int32_t qk = (int16_t)rawQuatK;
+  int32_t qr = (int16_t)rawQuatReal;
+  int32_t sin_yaw = 2 * (qr * qk + qi * qj);			//Q28
+  int32_t cos_yaw = (1L << 28) - 2 * (qj * qj + qk * qk);	//Q28
+  return (fx_atan2(sin_yaw, cos_yaw));
+}
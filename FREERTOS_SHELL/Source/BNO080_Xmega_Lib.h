@@ -5,6 +5,7 @@
  *  Revisions:
  *    \li 12-28-17 Written by Nathan Seidle @ SparkFun Electronics
  *    \li 11-28-18 Adapted for Xmega - Ryan Dunn - Adapted for Xmega
+ *    \li 10-18-26 Game rotation vector, INT pin polling and a fixed point yaw
  *
  *  License:
  *    This program is distributed in the hope that it will be useful,
@@ -70,6 +71,7 @@
 #include "frt_queue.h"                      // Header of wrapper for FreeRTOS queues
 #include "frt_shared_data.h"                // Header for thread-safe shared data
 #include "shares.h"                         // Global ('extern') queue declarations
+#include "fixed_math.h"						// For the yaw as a binary angle
 
 //The default I2C address for the BNO080 on the SparkX breakout is 0x4B. 0x4A is also possible.
 #define BNO080_DEFAULT_ADDRESS 0x4B
@@ -172,7 +174,7 @@ class BNO080 {
     void printPacket(void); //Prints the current shtp header and data packets
 
     void enableRotationVector(uint16_t timeBetweenReports);
-    //void enableGameRotationVector(uint16_t timeBetweenReports);
+    void enableGameRotationVector(uint16_t timeBetweenReports);
     //void enableAccelerometer(uint16_t timeBetweenReports);
     //void enableLinearAccelerometer(uint16_t timeBetweenReports);
     //void enableGyro(uint16_t timeBetweenReports);
@@ -181,7 +183,10 @@ class BNO080 {
     //void enableStabilityClassifier(uint16_t timeBetweenReports);
     //void enableActivityClassifier(uint16_t timeBetweenReports, uint32_t activitiesToEnable, uint8_t (&activityConfidences)[9]);
 
+    void setIntPin(PORT_t* port, uint8_t pin_bm); //Pin the BNO080's INT output is wired to
+    bool reportReady(void); //True when the INT pin says a packet is waiting, without any I2C traffic
     bool dataAvailable(void);
+    bool quatAvailable(void); //True once after each new rotation vector
     void parseInputReport(void); //Parse sensor readings out of report
     void parseCommandReport(void); //Parse command responses out of report
 
@@ -191,6 +196,7 @@ class BNO080 {
     float getQuatReal();
     float getQuatRadianAccuracy();
     uint8_t getQuatAccuracy();
+    uint16_t getYaw(); //Rotation about the Z axis as a binary angle, from the raw quaternion
 
     /* float getAccelX();
     float getAccelY();
@@ -263,6 +269,8 @@ class BNO080 {
     uint8_t _cs; //Pins needed for SPI
     uint8_t _wake;
     uint8_t _int;
+    PORT_t* _intPort; //Port of the INT pin, NULL if it isn't wired
+    bool _quatNew; //Set when a rotation vector is parsed, cleared by quatAvailable()
     uint8_t _rst;
 
     //These are the raw sensor values pulled from the user requested Input Report
@@ -0,0 +1,167 @@
+//**************************************************************************************
+/** \file control_timer.cpp
+ *    This file contains the timer which paces the motor control loop. See 
+ *    control_timer.h.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include <avr/io.h>                         // Port I/O for SFR's
+#include <avr/interrupt.h>                  // For the timer's interrupt
+
+#include "FreeRTOS.h"                       // Primary header for FreeRTOS
+#include "task.h"                           // Header for FreeRTOS task functions
+#include "semphr.h"                         // FreeRTOS semaphores
+
+#include "control_timer.h"
+
+#define CONTROL_TIMER TCC1					// Free timer; TCC0 makes the motors' PWM
+#define CONTROL_PRESCALE 8					// Must match the clock select below
+#define CONTROL_COUNTS_PER_US (F_CPU / CONTROL_PRESCALE / 1000000UL)
+
+/// Given by the timer interrupt and taken by the control task
+static xSemaphoreHandle control_semaphore = NULL;
+
+/// Counted in the interrupt when the semaphore hadn't been taken since last time
+static volatile uint16_t control_overruns = 0;
+
+/// Timing so far, with the latencies in timer counts; only the control task writes it
+static control_timing control_counts;
+
+
+//-------------------------------------------------------------------------------------
+/** This function sets up TCC1 to overflow at the given rate, with an interrupt at the
+ *  same low level as the RTOS tick. It counts at 4 MHz, so the latency measurement has
+ *  a resolution of a quarter microsecond.
+ *  @param rate_hz How many times a second to wake the control task
+ *  @return True if the semaphore could be made, false if there's no memory for it
+ */
+
+bool control_timer_start (uint16_t rate_hz)
+{
+	vSemaphoreCreateBinary (control_semaphore);
+	if (control_semaphore == NULL)
+	{
+		return (false);
+	}
+	xSemaphoreTake (control_semaphore, 0);	// It's created already given
+
+	uint32_t counts = F_CPU / CONTROL_PRESCALE / rate_hz;
+	if (counts > 0x10000UL)
+	{
+		counts = 0x10000UL;
+	}
+
+	control_counts.period_us = (uint16_t)(counts / CONTROL_COUNTS_PER_US);
+	control_counts.latency_min_us = 0xFFFF;
+	control_counts.latency_max_us = 0;
+	control_counts.latency_last_us = 0;
+	control_counts.runs = 0;
+
+	CONTROL_TIMER.CTRLA = TC_CLKSEL_OFF_gc;
+	CONTROL_TIMER.CTRLB = 0;				// Normal mode, no compare outputs
+	CONTROL_TIMER.CNT = 0;
+	CONTROL_TIMER.PER = (uint16_t)(counts - 1);
+	CONTROL_TIMER.INTCTRLA = TC_OVFINTLVL_LO_gc;
+	CONTROL_TIMER.CTRLA = TC_CLKSEL_DIV8_gc;
+
+	return (true);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This interrupt wakes the control task. If the task is of higher priority than the
+ *  one which was interrupted, it switches to it right away, as the serial port 
+ *  interrupts in the FreeRTOS AVR demos do, rather than waiting for the next tick.
+ */
+
+ISR (TCC1_OVF_vect)
+{
+	signed portBASE_TYPE task_woken = pdFALSE;
+
+	if (xSemaphoreGiveFromISR (control_semaphore, &task_woken) != pdTRUE)
+	{
+		control_overruns++;
+	}
+	if (task_woken != pdFALSE)
+	{
+		taskYIELD ();
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function blocks the calling task until the next timer interrupt. The count in
+ *  the timer when the task wakes up is how long ago the interrupt happened, as the
+ *  timer was reset to zero when it overflowed. If the timer couldn't be started, this
+ *  just delays for one period.
+ */
+
+void control_timer_wait (void)
+{
+	if (control_semaphore == NULL)
+	{
+		vTaskDelay (configMS_TO_TICKS (1000 / CONTROL_RATE_HZ));
+		return;
+	}
+	xSemaphoreTake (control_semaphore, portMAX_DELAY);
+
+	uint16_t latency = CONTROL_TIMER.CNT;
+
+	portENTER_CRITICAL ();
+	control_counts.latency_last_us = latency;
+	if (latency < control_counts.latency_min_us)
+	{
+		control_counts.latency_min_us = latency;
+	}
+	if (latency > control_counts.latency_max_us)
+	{
+		control_counts.latency_max_us = latency;
+	}
+	control_counts.runs++;
+	portEXIT_CRITICAL ();
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function gets the timing measured so far, converted to microseconds. The
+ *  maximum less the minimum latency is the jitter in the loop's period.
+ *  @param p_timing Where to put the figures
+ *  @param reset True to start measuring the minimum and maximum afresh
+ */
+
+void control_timer_stats (control_timing* p_timing, bool reset)
+{
+	portENTER_CRITICAL ();
+	*p_timing = control_counts;
+	p_timing->overruns = control_overruns;
+	if (reset)
+	{
+		control_counts.latency_min_us = 0xFFFF;
+		control_counts.latency_max_us = 0;
+	}
+	portEXIT_CRITICAL ();
+
+	if (p_timing->runs == 0 || p_timing->latency_min_us > p_timing->latency_max_us)
+	{
+		p_timing->latency_min_us = p_timing->latency_max_us = 0;
+	}
+	p_timing->latency_min_us /= CONTROL_COUNTS_PER_US;
+	p_timing->latency_max_us /= CONTROL_COUNTS_PER_US;
+	p_timing->latency_last_us /= CONTROL_COUNTS_PER_US;
+}
@@ -0,0 +1,68 @@
+//**************************************************************************************
+/** \file control_timer.h
+ *    This file contains header stuff for the timer which paces the motor control loop.
+ *    Timer TCC1 interrupts at a fixed rate and wakes task_motor through a semaphore,
+ *    so the loop runs at a steady period no matter how long each pass takes. The time
+ *    from the interrupt to the task actually running is measured on every pass, which
+ *    shows how much jitter the loop sees.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _CONTROL_TIMER_H_
+#define _CONTROL_TIMER_H_
+
+#include <stdint.h>
+
+/** The rate at which the motor control loop runs. The gains in drive_control.cpp were
+ *  tuned at 100 Hz; the integral and derivative gains need retuning if this changes.
+ *  The timer can do from 62 Hz to several kHz.
+ */
+#define CONTROL_RATE_HZ 100
+
+/// Timing of the control loop, as returned by control_timer_stats()
+struct control_timing
+{
+	uint16_t period_us;						// Period the timer is set to
+	uint16_t latency_min_us;				// Shortest time from interrupt to task
+	uint16_t latency_max_us;				// Longest time from interrupt to task
+	uint16_t latency_last_us;				// Time from interrupt to task last pass
+	uint16_t overruns;						// Interrupts which came before the task
+											// had finished with the previous one
+	uint32_t runs;							// Passes through the loop
+};
+
+/** This function starts the control timer and its interrupt.
+ *  @param rate_hz How many times a second to wake the control task
+ *  @return True if the semaphore could be made, false if there's no memory for it
+ */
+bool control_timer_start (uint16_t rate_hz);
+
+/** This function blocks the calling task until the next timer interrupt, then notes
+ *  how late the task got going.
+ */
+void control_timer_wait (void);
+
+/** This function gets the timing measured so far.
+ *  @param p_timing Where to put the figures
+ *  @param reset True to start measuring the minimum and maximum afresh
+ */
+void control_timer_stats (control_timing* p_timing, bool reset);
+
+#endif // _CONTROL_TIMER_H_
@@ -0,0 +1,367 @@
+//**************************************************************************************
+/** \file drive_control.cpp
+ *    This file contains the steering logic which turns the robot's position and a goal
+ *    point into setpoints for the two motorDriver objects or the drive_pair controller.
+ *
+ *  Revisions:
+ *    \li 12-4-18 RT Steering written in task_motor
+ *    \li 10-18-26 Moved into functions of its own, with no RTOS calls
+ *    \li 10-18-26 Added versions for the drive_pair controller
+ *    \li 10-18-26 Derivative filter and anti-windup settings
+ *    \li 10-18-26 Added path following by pure pursuit
+ *    \li 10-18-26 Path following tracks a motion profile
+ *    \li 10-18-26 Feedforward, and linear gains scheduled by speed band
+ *    \li 10-18-26 Autotuned linear gains can be used in place of the speed bands
+ *
+ *  License:
+ *    This file is copyright 2018 by Ricky Tan and released under the Lesser GNU 
+ *    Public License, version 2. It intended for educational use only, but its use
+ *    is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include "drive_control.h"
+
+// The speed band table goes in flash on the AVR; anywhere else it's an ordinary constant
+#ifdef __AVR__
+	#include <avr/pgmspace.h>
+	#define DRIVE_BAND_WORD(band, field) ((int16_t)pgm_read_word (&drive_bands[band].field))
+#else
+	#define PROGMEM
+	#define DRIVE_BAND_WORD(band, field) (drive_bands[band].field)
+#endif
+
+const drive_gains drive_gains_default =
+{
+	100,					// pwm_scale
+	30, 1, 1,				// kp_l, ki_l, kd_l; kd_l acts on the wheel speeds. Following
+							// a path, drive_bands below has these instead
+	60, 10, 0,				// kp_a, ki_a, kd_a
+	50,						// pwm_lim
+	3 * 50 / 5,				// pwm_lim_linear, the rest of pwm_lim is for angular
+	50 * 100 / 5,			// esum_l_lim, used prior to the pwm being scaled; with ki_l
+							// of 1, enough for the integral to beat static friction
+	(50 - 3 * 50 / 5) * 100,	// esum_a_lim
+	2,						// d_filter_shift, a time constant of about 4 passes
+	3						// aw_shift, an eighth of what's clipped off comes off the integral
+};
+
+const motion_limits drive_limits_default =
+{
+	800,					// v_max, ticks/s; a wheel reaches about 850 at pwm_lim_linear
+	2500,					// a_max, ticks/s^2
+	25000					// j_max, ticks/s^3, so the acceleration ramps up over 0.1 s
+};
+
+// Made by Sim/fit_gains from open loop step responses at 15, 20, 25 and 30% PWM. These
+// are of the simulator's plant ("sim open"); refit them from logs of the robot
+static const drive_band drive_bands[DRIVE_BANDS] PROGMEM =
+{
+	// speed, kp_l, ki_l, kd_l, kv, ka, ks
+	{ 372, 28, 1, 1, 654, 51, 800 },	// open_15.csv: 274 ticks/s, tau 0.077 s
+	{ 567, 29, 1, 1, 654, 51, 800 },	// open_20.csv: 470 ticks/s, tau 0.078 s
+	{ 763, 29, 1, 1, 654, 51, 801 },	// open_25.csv: 665 ticks/s, tau 0.078 s
+	{ 32767, 29, 1, 1, 654, 51, 801 }	// open_30.csv: 861 ticks/s, tau 0.078 s
+};
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Gives both motors the same gains and limits.
+ *  @param   motor1 The motorDriver for motor 1
+ *  @param   motor2 The motorDriver for motor 2
+ *  @param   gains The gains and limits
+ */
+
+void drive_set_gains (motorDriver& motor1, motorDriver& motor2, const drive_gains& gains)
+{
+	motor1.set_pwm_scaling(gains.pwm_scale);
+	motor2.set_pwm_scaling(gains.pwm_scale);
+	motor1.set_k_l(gains.kp_l, gains.ki_l, gains.kd_l);
+	motor2.set_k_l(gains.kp_l, gains.ki_l, gains.kd_l);
+	motor1.set_k_a(gains.kp_a, gains.ki_a, gains.kd_a);
+	motor2.set_k_a(gains.kp_a, gains.ki_a, gains.kd_a);
+	motor1.set_pwm_lim(gains.pwm_lim); // Needs to be performed prior to set_pwm_lim_linear
+	motor2.set_pwm_lim(gains.pwm_lim);
+	motor1.set_pwm_lim_linear(gains.pwm_lim_linear);
+	motor2.set_pwm_lim_linear(gains.pwm_lim_linear);
+	motor1.set_esum_l_lim(gains.esum_l_lim);
+	motor2.set_esum_l_lim(gains.esum_l_lim);
+	motor1.set_esum_a_lim(gains.esum_a_lim);
+	motor2.set_esum_a_lim(gains.esum_a_lim);
+	motor1.set_d_filter(gains.d_filter_shift);
+	motor2.set_d_filter(gains.d_filter_shift);
+	motor1.set_antiwindup(gains.aw_shift);
+	motor2.set_antiwindup(gains.aw_shift);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Works out the distance and direction to a goal.
+ *  @param   pos_x Current X position of the robot (ticks)
+ *  @param   pos_y Current Y position of the robot (ticks)
+ *  @param   goal_x X position of the goal (ticks)
+ *  @param   goal_y Y position of the goal (ticks)
+ *  @return  The setpoints for the motors
+ */
+
+static drive_setpoints drive_goal_setpoints (int16_t pos_x, int16_t pos_y,
+											 int16_t goal_x, int16_t goal_y)
+{
+	drive_setpoints sp;
+	sp.steer = 0;
+
+	//calculate linear distance from the setpoint, then pass that linear distance to both motors.
+	// Fixed point versions of sqrt() and atan2(); see fixed_math.h
+	sp.distance = fx_ihypot((goal_x - pos_x), (goal_y - pos_y));
+	sp.angle_goal = fx_brad_to_rad(fx_atan2((goal_y - pos_y), (goal_x - pos_x)));
+	sp.setpoint_a = sp.angle_goal - sp.distance;
+	if(goal_x - pos_x <= 0)
+	{
+		sp.distance = sp.distance * -1;
+	}
+
+	return sp;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Updates both motors' setpoints to drive towards a goal.
+ *  @details We control distance from goal and angular heading. The linear distance to
+ *           the goal is given to both motors as their linear setpoint, and the heading
+ *           error as their angle. The motors' run() methods are not called.
+ *  @param   motor1 The motorDriver for motor 1
+ *  @param   motor2 The motorDriver for motor 2
+ *  @param   pos_x Current X position of the robot (ticks)
+ *  @param   pos_y Current Y position of the robot (ticks)
+ *  @param   theta Current angle of the robot (rad)
+ *  @param   goal_x X position of the goal (ticks)
+ *  @param   goal_y Y position of the goal (ticks)
+ *  @return  The setpoints given to the motors
+ */
+
+drive_setpoints drive_to_goal (motorDriver& motor1, motorDriver& motor2,
+							   int16_t pos_x, int16_t pos_y, int16_t theta,
+							   int16_t goal_x, int16_t goal_y)
+{
+	drive_setpoints sp = drive_goal_setpoints (pos_x, pos_y, goal_x, goal_y);
+
+	// Updating positions, always zero because we've calculated the error above
+	motor1.set_position(0);
+	motor2.set_position(0);
+
+	// Updating motor linear setpoints
+	motor1.set_setpoint_l(sp.distance);
+	motor2.set_setpoint_l(sp.distance);
+
+	// Updating angles
+	motor1.set_angle(sp.angle_goal - theta);
+	motor2.set_angle(sp.angle_goal - theta);
+
+	// Updating angular setpoints, setpoint_a is the goal angle of the robot.
+	motor1.set_setpoint_a(sp.setpoint_a);
+	motor2.set_setpoint_a(sp.setpoint_a);
+
+	return sp;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Gives the drive_pair controller the gains and limits.
+ *  @param   motors The controller for both motors
+ *  @param   gains The gains and limits
+ */
+
+void drive_set_gains (drive_pair& motors, const drive_gains& gains)
+{
+	motors.set_pwm_scaling(gains.pwm_scale);
+	motors.set_k_l(gains.kp_l, gains.ki_l, gains.kd_l);
+	motors.set_k_a(gains.kp_a, gains.ki_a, gains.kd_a);
+	motors.set_pwm_lim(gains.pwm_lim); // Needs to be performed prior to set_pwm_lim_linear
+	motors.set_pwm_lim_linear(gains.pwm_lim_linear);
+	motors.set_esum_l_lim(gains.esum_l_lim);
+	motors.set_esum_a_lim(gains.esum_a_lim);
+	motors.set_d_filter(gains.d_filter_shift);
+	motors.set_antiwindup(gains.aw_shift);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Finds which speed band a reference speed is in.
+ *  @param   speed The reference speed, either way (ticks/s)
+ *  @return  The index of the band in the table
+ */
+
+uint8_t drive_band_index (int16_t speed)
+{
+	if (speed < 0)
+	{
+		speed = (speed == -32768) ? 32767 : -speed;
+	}
+	uint8_t band = 0;
+	while (band < DRIVE_BANDS - 1 && speed >= DRIVE_BAND_WORD(band, speed))
+	{
+		band++;
+	}
+	return band;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Gives both motors the linear gains and feedforward of a speed band.
+ *  @details The motors keep their integrals as terms rather than error sums, so
+ *           changing band doesn't make the output jump.
+ *  @param   motor1 The motorDriver for motor 1
+ *  @param   motor2 The motorDriver for motor 2
+ *  @param   band The index of the band, from drive_band_index()
+ */
+
+void drive_set_band (motorDriver& motor1, motorDriver& motor2, uint8_t band)
+{
+	int16_t kp_l = DRIVE_BAND_WORD(band, kp_l);
+	int16_t ki_l = DRIVE_BAND_WORD(band, ki_l);
+	int16_t kd_l = DRIVE_BAND_WORD(band, kd_l);
+	int16_t kv = DRIVE_BAND_WORD(band, kv);
+	int16_t ka = DRIVE_BAND_WORD(band, ka);
+	int16_t ks = DRIVE_BAND_WORD(band, ks);
+
+	motor1.set_k_l(kp_l, ki_l, kd_l);
+	motor2.set_k_l(kp_l, ki_l, kd_l);
+	motor1.set_feedforward(kv, ka, ks);
+	motor2.set_feedforward(kv, ka, ks);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Gives the drive_pair controller the linear gains and feedforward of a
+ *           speed band.
+ *  @param   motors The controller for both motors
+ *  @param   band The index of the band, from drive_band_index()
+ */
+
+void drive_set_band (drive_pair& motors, uint8_t band)
+{
+	motors.set_k_l(DRIVE_BAND_WORD(band, kp_l), DRIVE_BAND_WORD(band, ki_l),
+				   DRIVE_BAND_WORD(band, kd_l));
+	motors.set_feedforward(DRIVE_BAND_WORD(band, kv), DRIVE_BAND_WORD(band, ka),
+						   DRIVE_BAND_WORD(band, ks));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Updates the drive_pair controller's setpoints to drive towards a goal.
+ *  @details As the motorDriver version, with each setpoint given once rather than to
+ *           each motor.
+ *  @param   motors The controller for both motors
+ *  @param   pos_x Current X position of the robot (ticks)
+ *  @param   pos_y Current Y position of the robot (ticks)
+ *  @param   theta Current angle of the robot (rad)
+ *  @param   goal_x X position of the goal (ticks)
+ *  @param   goal_y Y position of the goal (ticks)
+ *  @return  The setpoints given to the motors
+ */
+
+drive_setpoints drive_to_goal (drive_pair& motors,
+							   int16_t pos_x, int16_t pos_y, int16_t theta,
+							   int16_t goal_x, int16_t goal_y)
+{
+	drive_setpoints sp = drive_goal_setpoints (pos_x, pos_y, goal_x, goal_y);
+
+	motors.set_position(0);
+	motors.set_setpoint_l(sp.distance);
+	motors.set_angle(sp.angle_goal - theta);
+	motors.set_setpoint_a(sp.setpoint_a);
+
+	return sp;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Updates the drive_pair controller's setpoints to follow a path.
+ *  @details The path follower gives the distance left along the path and how far each
+ *           wheel has to travel more or less than the middle of the robot to reach its
+ *           lookahead point. Rather than the whole distance left, which would saturate
+ *           the linear loop until the robot was nearly there, the linear setpoint is
+ *           how far the robot is behind a motion profile: the distance left for the
+ *           robot less the distance left for the profile's reference. The profile is
+ *           planned for the path's length when the robot sets off, and made longer by
+ *           however much the path grows as waypoints are added. While the robot turns
+ *           on the spot or is at the end of the path, the profile is held at rest.
+ *           The profile's speed and acceleration are given to the motors for the
+ *           feedforward, and its speed picks the speed band whose gains they use;
+ *           if the gains have been autotuned, the linear gains are those instead,
+ *           and only the feedforward comes from the band.
+ *
+ *           The steering is given as the angle, with an angular setpoint of zero, so
+ *           the angular loop's derivative acts on how fast it changes. A positive steer
+ *           makes the angular error negative, which slows the left wheel and speeds the
+ *           right, turning left.
+ *  @param   motors The controller for both motors
+ *  @param   path The path follower, which is moved on along its path
+ *  @param   profile The motion profile, which is moved on by one control pass
+ *  @param   pos_x Current X position of the robot (ticks)
+ *  @param   pos_y Current Y position of the robot (ticks)
+ *  @param   heading Current heading of the robot (binary angle)
+ *  @param   p_tuned Autotuned gains, whose linear gains are used in place of the speed
+ *           band's, or NULL to use the band's
+ *  @return  The setpoints given to the motors
+ */
+
+drive_setpoints drive_follow_path (drive_pair& motors, path_follower& path,
+								   motion_profile& profile, int16_t pos_x, int16_t pos_y,
+								   uint16_t heading, const drive_gains* p_tuned)
+{
+	path_steering steering = path.update(pos_x, pos_y, heading);
+	drive_setpoints sp;
+
+	if (steering.turning || steering.done)
+	{
+		profile.reset();
+	}
+	else if (steering.added != 0)
+	{
+		profile.plan((int32_t)profile.remaining() + steering.added);
+	}
+	else if (profile.idle() && steering.distance != profile.remaining())
+	{
+		profile.plan((int32_t)steering.distance - profile.remaining());
+	}
+	profile.step();
+
+	int16_t speed = profile.velocity();
+	motors.set_velocity_ref(speed);
+	motors.set_accel_ref(profile.acceleration());
+	drive_set_band(motors, drive_band_index(speed));
+	if (p_tuned != NULL)
+	{
+		motors.set_k_l(p_tuned->kp_l, p_tuned->ki_l, p_tuned->kd_l);
+	}
+
+	sp.distance = steering.distance - profile.remaining();
+	sp.angle_goal = fx_brad_to_rad(steering.bearing);
+	sp.setpoint_a = 0;
+	sp.steer = steering.steer;
+
+	if (steering.turning)
+	{
+		motors.zero_esum_l();	// Don't creep forwards on what's left of the integral
+	}
+	if (steering.done)
+	{
+		motors.zero_esum_a();	// Nothing left to steer for; don't keep turning
+	}
+	motors.set_position(0);
+	motors.set_setpoint_l(sp.distance);
+	motors.set_angle(sp.steer);
+	motors.set_setpoint_a(sp.setpoint_a);
+
+	return sp;
+}
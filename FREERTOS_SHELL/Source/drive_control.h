@@ -0,0 +1,137 @@
+//**************************************************************************************
+/** \file drive_control.h
+ *    This file contains header stuff for the steering logic which turns the robot's
+ *    position and a goal point into setpoints for the two motorDriver objects. It was
+ *    split out of task_motor so it can also be built and run on a PC by the plant
+ *    simulator in ../Sim.
+ *
+ *  Revisions:
+ *    \li 12-4-18 RT Steering written in task_motor
+ *    \li 10-18-26 Moved into functions of its own, with no RTOS calls
+ *    \li 10-18-26 Added versions for the drive_pair controller
+ *    \li 10-18-26 Feedforward, and linear gains scheduled by speed band
+ *    \li 10-18-26 Autotuned linear gains can be used in place of the speed bands
+ *
+ *  License:
+ *    This file is copyright 2018 by Ricky Tan and released under the Lesser GNU 
+ *    Public License, version 2. It intended for educational use only, but its use
+ *    is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _DRIVE_CONTROL_H_
+#define _DRIVE_CONTROL_H_
+
+#include <stdint.h>
+
+#include "motorDriver.h"					// Motor driver class header file
+#include "drive_pair.h"						// Both motors in one controller
+#include "fixed_math.h"					// Integer math for calculating line length
+#include "path_follower.h"					// Pure pursuit along a list of waypoints
+#include "motion_profile.h"					// Smooth reference along the path
+
+//-------------------------------------------------------------------------------------
+/** @brief   Gains and limits given to both motorDriver objects.
+ *  @details See task_motor::run() for what each one does.
+ */
+
+struct drive_gains
+{
+	int16_t pwm_scale;		// Factor by which summed signals are divided
+	int16_t kp_l;			// Linear PID gains
+	int16_t ki_l;
+	int16_t kd_l;
+	int16_t kp_a;			// Angular PID gains
+	int16_t ki_a;
+	int16_t kd_a;
+	int16_t pwm_lim;		// Max percentage pwm output
+	int16_t pwm_lim_linear;	// Portion of pwm_lim used for linear driving
+	int16_t esum_l_lim;		// Limits for the accumulation of error terms
+	int16_t esum_a_lim;
+	uint8_t d_filter_shift;	// Derivative low pass filter, 1/2^shift per pass
+	uint8_t aw_shift;		// Integral wind-back, 1/2^shift of the clipped signal
+};
+
+/// The gains the robot runs with
+extern const drive_gains drive_gains_default;
+
+/// The speed, acceleration and jerk limits for driving along a path
+extern const motion_limits drive_limits_default;
+
+/// Number of rows in the speed band table in drive_control.cpp
+#define DRIVE_BANDS 4
+
+//-------------------------------------------------------------------------------------
+/** @brief   Linear gains and feedforward for one band of reference speeds.
+ *  @details The table of these is kept in flash, lowest band first. The gains are in
+ *           the same units as in drive_gains; kv and ka are in 1/256ths of 1/pwm_scale
+ *           percent per tick/s and per tick/s^2, and ks in 1/pwm_scale percent, as
+ *           drive_pair::set_feedforward() takes them. Sim/fit_gains.cpp works the table out from logged step
+ *           responses.
+ */
+
+struct drive_band
+{
+	int16_t speed;			// Band is for reference speeds below this (ticks/s)
+	int16_t kp_l;			// Linear PID gains
+	int16_t ki_l;
+	int16_t kd_l;
+	int16_t kv;				// Speed feedforward
+	int16_t ka;				// Acceleration feedforward
+	int16_t ks;				// Static friction feedforward
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   Setpoints worked out by drive_to_goal(), kept for diagnostics.
+ */
+
+struct drive_setpoints
+{
+	int16_t distance;		// Linear distance to the goal, negative if it's behind in X; when
+							// following a path, how far the robot is behind the reference
+	int16_t angle_goal;		// Direction of the goal from the robot (rad)
+	int16_t setpoint_a;		// Angular setpoint given to both motors
+	int16_t steer;			// Wheel travel to the lookahead point, when following a path
+};
+
+// Gives both motors the same gains and limits
+void drive_set_gains (motorDriver& motor1, motorDriver& motor2, const drive_gains& gains);
+
+// Gives the drive_pair controller the gains and limits
+void drive_set_gains (drive_pair& motors, const drive_gains& gains);
+
+// Finds which speed band a reference speed is in
+uint8_t drive_band_index (int16_t speed);
+
+// Gives both motors the linear gains and feedforward of a speed band
+void drive_set_band (motorDriver& motor1, motorDriver& motor2, uint8_t band);
+
+// Gives the drive_pair controller the linear gains and feedforward of a speed band
+void drive_set_band (drive_pair& motors, uint8_t band);
+
+// Updates both motors' setpoints to drive from the given position towards a goal
+drive_setpoints drive_to_goal (motorDriver& motor1, motorDriver& motor2,
+							   int16_t pos_x, int16_t pos_y, int16_t theta,
+							   int16_t goal_x, int16_t goal_y);
+
+// Updates the drive_pair controller's setpoints the same way
+drive_setpoints drive_to_goal (drive_pair& motors,
+							   int16_t pos_x, int16_t pos_y, int16_t theta,
+							   int16_t goal_x, int16_t goal_y);
+
+// Updates the drive_pair controller's setpoints to follow a path of waypoints
+drive_setpoints drive_follow_path (drive_pair& motors, path_follower& path,
+								   motion_profile& profile, int16_t pos_x, int16_t pos_y,
+								   uint16_t heading, const drive_gains* p_tuned = NULL);
+
+#endif // _DRIVE_CONTROL_H_
@@ -0,0 +1,591 @@
+//**************************************************************************************
+/** \file drive_pair.cpp
+ *    This file contains a controller which runs both drive motors at once, doing the
+ *    work of two motorDriver objects in one pass.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 PWM written through pwm_out.h at the timer's full resolution
+ *    \li 10-18-26 Filtered derivatives and back-calculation anti-windup
+ *    \li 10-18-26 Speed, acceleration and static friction feedforward
+ *    \li 10-18-26 run_open() drives set signals with no feedback, for the autotuner
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include "drive_pair.h"                     // Header for this file
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Works out the duty cycles of a motor's two driver inputs.
+ *  @details In drive-brake mode (op_type true) the input on the side away from the
+ *           direction of travel is modulated low while the other is held high; in
+ *           drive-coast mode the input on the side of travel is modulated high while
+ *           the other is held low. This is what motorDriver::run() does.
+ *  @param   forwards True if the motor is to drive forwards
+ *  @param   counts Drive in timer counts, from zero to the period
+ *  @param   period Timer counts in a PWM period
+ *  @param   op_type Whether operation is drive-coast or drive-brake
+ *  @param   duty Two element array for the duty cycles of IN1 and IN2 (counts)
+ */
+
+static inline void drive_duty (bool forwards, uint16_t counts, uint16_t period, bool op_type,
+							   uint16_t* duty)
+{
+	if (op_type)
+	{
+		duty[0] = forwards ? period : period - counts;
+		duty[1] = forwards ? period - counts : period;
+	}
+	else
+	{
+		duty[0] = forwards ? counts : 0;
+		duty[1] = forwards ? 0 : counts;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Limits a signal to plus or minus a limit.
+ *  @param   value The signal
+ *  @param   limit The limit, which should not be negative
+ *  @return  The signal, clipped to the limit
+ */
+
+static inline int32_t drive_limit (int32_t value, int32_t limit)
+{
+	if (value > limit)
+	{
+		return (limit);
+	}
+	else if (value < -limit)
+	{
+		return (-limit);
+	}
+	return (value);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Create a drive_pair object.
+ *  @details This constructor sets up timer TCC0 with channels A and B for the left
+ *           motor and C and D for the right, as motorDriver does for motors '1' and
+ *           '2', with both motors stopped. All gains, limits and setpoints are zero,
+ *           so the motors won't run until they are set. The derivatives are unfiltered
+ *           and the back-calculation gain is one.
+ *  @param   ser_dev Serial device for debugging, may be NULL
+ */
+
+drive_pair::drive_pair (emstream* ser_dev)
+{
+	ser_out = ser_dev;
+
+	// If this fails the period is zero, so run() leaves the outputs low
+	pwm_out_init (PWM_OUT_FREQ_HZ);
+
+	pwm_lim = 0;							// So scale_limits() has something to go on
+	pwm_lim_linear = 0;
+	pwm_scale = 1;
+	esum_l_lim = 0;							// So set_k_l() and set_k_a() can use them
+	esum_a_lim = 0;
+	set_d_filter (0);
+	set_antiwindup (0);
+	set_feedforward (0, 0, 0);
+	zero_esum_l ();
+	zero_esum_a ();
+	set_k_l (0, 0, 0);
+	set_k_a (0, 0, 0);
+	set_pwm_lim (0);
+	set_pwm_lim_linear (0);
+	set_esum_l_lim (0);
+	set_esum_a_lim (0);
+	set_setpoint_l (0);
+	set_setpoint_a (0);
+	set_position (0);
+	set_angle (0);
+	set_velocity (0, 0);
+	set_velocity_ref (0);
+	set_accel_ref (0);
+	set_pwm_scaling (1);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the linear PID gains.
+ *  @param   kp_l_in The linear proportional gain
+ *  @param   ki_l_in The linear integral gain
+ *  @param   kd_l_in The linear derivative gain
+ */
+
+void drive_pair::set_k_l (int16_t kp_l_in, int16_t ki_l_in, int16_t kd_l_in)
+{
+	kp_l = kp_l_in;
+	ki_l = ki_l_in;
+	kd_l = kd_l_in;
+	integ_l_lim = (int32_t)ki_l * esum_l_lim;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the angular PID gains.
+ *  @param   kp_a_in The angular proportional gain
+ *  @param   ki_a_in The angular integral gain
+ *  @param   kd_a_in The angular derivative gain
+ */
+
+void drive_pair::set_k_a (int16_t kp_a_in, int16_t ki_a_in, int16_t kd_a_in)
+{
+	kp_a = kp_a_in;
+	ki_a = ki_a_in;
+	kd_a = kd_a_in;
+	integ_a_lim = (int32_t)ki_a * esum_a_lim;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the factor by which the summed signals are divided.
+ *  @param   pwm_scale_in The pwm scaling
+ */
+
+void drive_pair::set_pwm_scaling (int16_t pwm_scale_in)
+{
+	pwm_scale = pwm_scale_in;
+	scale_limits ();
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the limit for the pwm output, at most 100.
+ *  @param   pwm_lim_in The pwm limit, which should be positive
+ */
+
+void drive_pair::set_pwm_lim (int16_t pwm_lim_in)
+{
+	pwm_lim = (pwm_lim_in > 100) ? 100 : pwm_lim_in;
+	scale_limits ();
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the limit for the linear pwm output.
+ *  @details The difference between pwm_lim and pwm_lim_linear is what's left for the
+ *           angular loop. The input is limited to pwm_lim, so set pwm_lim first.
+ *  @param   pwm_lim_linear_in The linear pwm limit
+ */
+
+void drive_pair::set_pwm_lim_linear (int16_t pwm_lim_linear_in)
+{
+	pwm_lim_linear = (pwm_lim_linear_in > pwm_lim) ? pwm_lim : pwm_lim_linear_in;
+	scale_limits ();
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Works out the limits and the PWM conversion in run()'s units.
+ *  @details run() keeps its signals in 1/pwm_scale percent. A signal of 100 percent
+ *           is then 100 * pwm_scale, which should make the whole period, so each unit
+ *           is period / (100 * pwm_scale) timer counts. This is kept times 2^16 and
+ *           rounded up, so a full signal makes at least the whole period; run() clips
+ *           the count to the period. The product in run() is then at most the period
+ *           times 2^16 plus 100 * pwm_scale, which fits in 32 bits.
+ */
+
+void drive_pair::scale_limits (void)
+{
+	int32_t full_scale = 100 * (int32_t)pwm_scale;
+
+	lim_scaled = pwm_lim * (int32_t)pwm_scale;
+	lim_linear_scaled = pwm_lim_linear * (int32_t)pwm_scale;
+	lim_angular_scaled = lim_scaled - lim_linear_scaled;
+	if (full_scale > 0)
+	{
+		counts_per_unit = ((uint32_t)pwm_out_period () << 16) / full_scale + 1;
+	}
+	else
+	{
+		counts_per_unit = 0;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the limit for the linear integral error sum.
+ *  @details The integral term is held to ki_l times this, as if it were the error sum
+ *           which was limited. Back-calculation normally keeps it well inside.
+ *  @param   esum_l_lim_in The limit, in encoder counts
+ */
+
+void drive_pair::set_esum_l_lim (int16_t esum_l_lim_in)
+{
+	esum_l_lim = esum_l_lim_in;
+	integ_l_lim = (int32_t)ki_l * esum_l_lim;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the limit for the angular integral error sum.
+ *  @param   esum_a_lim_in The limit
+ */
+
+void drive_pair::set_esum_a_lim (int16_t esum_a_lim_in)
+{
+	esum_a_lim = esum_a_lim_in;
+	integ_a_lim = (int32_t)ki_a * esum_a_lim;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets how strongly the derivative terms are filtered.
+ *  @details Each pass the filtered term moves 1/2^shift of the way to the new value, a
+ *           first order low pass with a time constant of about 2^shift passes. Zero
+ *           leaves the derivatives unfiltered.
+ *  @param   d_filter_shift_in The shift, at most DRIVE_SHIFT_MAX
+ */
+
+void drive_pair::set_d_filter (uint8_t d_filter_shift_in)
+{
+	d_filter_shift = (d_filter_shift_in > DRIVE_SHIFT_MAX) ? DRIVE_SHIFT_MAX : d_filter_shift_in;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the back-calculation gain of the anti-windup.
+ *  @details Each pass, the amount by which a loop's signal was clipped, divided by
+ *           2^shift, is taken off its integral term. Zero takes it all off, so the
+ *           integral never holds the output past its limit; larger shifts let it
+ *           unwind over about 2^shift passes.
+ *  @param   aw_shift_in The shift, at most DRIVE_SHIFT_MAX
+ */
+
+void drive_pair::set_antiwindup (uint8_t aw_shift_in)
+{
+	aw_shift = (aw_shift_in > DRIVE_SHIFT_MAX) ? DRIVE_SHIFT_MAX : aw_shift_in;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the feedforward gains of the linear loop.
+ *  @param   kv_l_in Signal per tick/s of the setpoint's speed, in 1/256ths of 1/pwm_scale
+ *           percent
+ *  @param   ka_l_in Signal per tick/s^2 of the setpoint's acceleration, in 1/256ths of
+ *           1/pwm_scale percent
+ *  @param   ks_l_in Signal to get past static friction, in 1/pwm_scale percent, added
+ *           in the direction the setpoint moves
+ */
+
+void drive_pair::set_feedforward (int16_t kv_l_in, int16_t ka_l_in, int16_t ks_l_in)
+{
+	kv_l = kv_l_in;
+	ka_l = ka_l_in;
+	ks_l = ks_l_in;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the linear setpoint of both motors.
+ *  @param   setpoint_l_in The linear setpoint, in encoder counts
+ */
+
+void drive_pair::set_setpoint_l (int16_t setpoint_l_in)
+{
+	setpoint_l = setpoint_l_in;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the angular setpoint.
+ *  @param   setpoint_a_in The angular setpoint
+ */
+
+void drive_pair::set_setpoint_a (int16_t setpoint_a_in)
+{
+	setpoint_a = setpoint_a_in;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the current position.
+ *  @param   position_in The position, in encoder counts
+ */
+
+void drive_pair::set_position (int16_t position_in)
+{
+	position = position_in;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the current angle.
+ *  @param   angle_in The angle
+ */
+
+void drive_pair::set_angle (int16_t angle_in)
+{
+	angle = angle_in;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets both wheels' measured speeds, which the linear derivative term uses.
+ *  @param   left_in Speed of the left (motor 1) wheel, positive forwards, in ticks/s
+ *  @param   right_in Speed of the right (motor 2) wheel, positive forwards, in ticks/s
+ */
+
+void drive_pair::set_velocity (int16_t left_in, int16_t right_in)
+{
+	velocity[DRIVE_LEFT] = left_in;
+	velocity[DRIVE_RIGHT] = right_in;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the speed the linear setpoint is moving at, for the feedforward.
+ *  @param   velocity_ref_in The speed, positive forwards, in ticks/s
+ */
+
+void drive_pair::set_velocity_ref (int16_t velocity_ref_in)
+{
+	velocity_ref = velocity_ref_in;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the acceleration of the linear setpoint, for the feedforward.
+ *  @param   accel_ref_in The acceleration, positive forwards, in ticks/s^2
+ */
+
+void drive_pair::set_accel_ref (int16_t accel_ref_in)
+{
+	accel_ref = accel_ref_in;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Resets the linear integral term and derivative filters to zero.
+ */
+
+void drive_pair::zero_esum_l (void)
+{
+	integ_l = 0;
+	deriv_l[DRIVE_LEFT] = 0;
+	deriv_l[DRIVE_RIGHT] = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Resets the angular integral term and derivative filter to zero.
+ *  @details The next run() takes the angle's rate of change as zero, as there's no
+ *           angle before it to compare with.
+ */
+
+void drive_pair::zero_esum_a (void)
+{
+	integ_a = 0;
+	deriv_a = 0;
+	angle_prev = 0;
+	angle_prev_valid = false;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Calculates and sets both motors' pwm output signals.
+ *  @details The proportional and integral parts of the linear signal and the whole
+ *           angular signal are worked out once; the angular signal is added to the left
+ *           wheel and taken from the right, which turns the other way. Only the linear
+ *           derivative term is worked out per wheel. The signals are limited as
+ *           motorDriver::run() limits them, but before rather than after dividing by
+ *           pwm_scale, and are then turned into timer counts. The four duty cycles are
+ *           written with the timer's buffer update locked, so neither wheel can change a
+ *           PWM period before the other.
+ *
+ *           The linear error is the distance left to go, which shrinks as fast as each
+ *           wheel drives forwards and grows as fast as the setpoint moves, so its
+ *           derivative is the setpoint's speed less the wheel's. With a setpoint that
+ *           jumps rather than moves, that's the derivative on measurement, minus the
+ *           wheel's speed. The angular error is the angular setpoint less the angle, so its
+ *           derivative is minus the change in angle since the last pass. The linear
+ *           integral is shared by both wheels, so it's wound back by the average of
+ *           what was clipped off the two of them.
+ *  @param   en_p Enable proportional action input
+ *  @param   en_i Enable integral action input
+ *  @param   en_d Enable derivative action input
+ *  @param   op_type Whether operation is drive-coast (0) or drive-brake (1)
+ *  @param   diag_1 Diagnostics for motor 1, the left
+ *  @param   diag_2 Diagnostics for motor 2, the right
+ */
+
+void drive_pair::run (bool en_p, bool en_i, bool en_d, bool op_type,
+					  diagnostic& diag_1, diagnostic& diag_2)
+{
+	// Error terms, the same for both motors
+	int16_t error_l = setpoint_l - position;
+	int16_t error_a = setpoint_a - angle;
+	int16_t rate_a = angle_prev_valid ? angle - angle_prev : 0;
+	angle_prev = angle;
+	angle_prev_valid = true;
+
+	// Angular signal, positive on the left wheel and negative on the right
+	deriv_a += ((int32_t)kd_a * -rate_a - deriv_a) >> d_filter_shift;
+	int32_t signal_a_pid = 0;
+	if (en_p)
+	{
+		signal_a_pid += (int32_t)kp_a * error_a;
+	}
+	if (en_i)
+	{
+		integ_a = drive_limit (integ_a + (int32_t)ki_a * error_a, integ_a_lim);
+		signal_a_pid += integ_a;
+	}
+	if (en_d)
+	{
+		signal_a_pid += deriv_a;
+	}
+	int32_t signal_a = drive_limit (signal_a_pid, lim_angular_scaled);
+	if (en_i)
+	{
+		integ_a += (signal_a - signal_a_pid) >> aw_shift;
+	}
+
+	// Proportional and integral parts of the linear signal
+	int32_t signal_l_pi = 0;
+	if (en_p)
+	{
+		signal_l_pi += (int32_t)kp_l * error_l;
+	}
+	if (en_i)
+	{
+		integ_l = drive_limit (integ_l + (int32_t)ki_l * error_l, integ_l_lim);
+		signal_l_pi += integ_l;
+	}
+
+	// Feedforward from the setpoint's speed and acceleration
+	signal_l_pi += ((int32_t)kv_l * velocity_ref + (int32_t)ka_l * accel_ref) >> 8;
+	if (velocity_ref > 0)
+	{
+		signal_l_pi += ks_l;
+	}
+	else if (velocity_ref < 0)
+	{
+		signal_l_pi -= ks_l;
+	}
+
+	// The right motor is mounted the other way round, so its total is negated
+	int32_t signal_l[2];
+	int32_t signal[2];
+	int32_t clipped_l = 0;
+	for (uint8_t wheel = DRIVE_LEFT; wheel <= DRIVE_RIGHT; wheel++)
+	{
+		deriv_l[wheel] += ((int32_t)kd_l * (velocity_ref - velocity[wheel]) - deriv_l[wheel])
+						  >> d_filter_shift;
+		int32_t signal_l_pid = signal_l_pi;
+		if (en_d)
+		{
+			signal_l_pid += deriv_l[wheel];
+		}
+		signal_l[wheel] = drive_limit (signal_l_pid, lim_linear_scaled);
+		clipped_l += signal_l[wheel] - signal_l_pid;
+
+		signal[wheel] = (wheel == DRIVE_LEFT) ? signal_l[wheel] + signal_a
+											  : signal_a - signal_l[wheel];
+		signal[wheel] = drive_limit (signal[wheel], lim_scaled);
+	}
+	if (en_i)
+	{
+		integ_l += clipped_l >> (aw_shift + 1);
+	}
+
+	write_signals (signal, op_type);
+
+	diag_1.pwm_tot = signal[DRIVE_LEFT] / pwm_scale;
+	diag_1.pwm_lin = signal_l[DRIVE_LEFT] / pwm_scale;
+	diag_1.pwm_ang = signal_a / pwm_scale;
+	diag_1.esum_a_ = integ_a / pwm_scale;
+	diag_1.esum_l_ = integ_l / pwm_scale;
+
+	diag_2.pwm_tot = signal[DRIVE_RIGHT] / pwm_scale;
+	diag_2.pwm_lin = signal_l[DRIVE_RIGHT] / pwm_scale;
+	diag_2.pwm_ang = -diag_1.pwm_ang;
+	diag_2.esum_a_ = diag_1.esum_a_;
+	diag_2.esum_l_ = diag_1.esum_l_;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets both motors' pwm output signals from given linear and angular signals.
+ *  @details There's no feedback: the signals are limited as run() limits its own and
+ *           written the same way, so the gains and setpoints make no difference and
+ *           the integrals are left alone. The relay autotuner drives the motors with
+ *           this while it finds out how they respond.
+ *  @param   signal_l_in The linear signal, positive forwards, in 1/pwm_scale percent
+ *  @param   signal_a_in The angular signal, positive on the left wheel and negative on
+ *           the right, in 1/pwm_scale percent
+ *  @param   op_type Whether operation is drive-coast (0) or drive-brake (1)
+ *  @param   diag_1 Diagnostics for motor 1, the left
+ *  @param   diag_2 Diagnostics for motor 2, the right
+ */
+
+void drive_pair::run_open (int16_t signal_l_in, int16_t signal_a_in, bool op_type,
+						   diagnostic& diag_1, diagnostic& diag_2)
+{
+	int32_t signal_l = drive_limit (signal_l_in, lim_linear_scaled);
+	int32_t signal_a = drive_limit (signal_a_in, lim_angular_scaled);
+	int32_t signal[2];
+
+	signal[DRIVE_LEFT] = drive_limit (signal_l + signal_a, lim_scaled);
+	signal[DRIVE_RIGHT] = drive_limit (signal_a - signal_l, lim_scaled);
+	write_signals (signal, op_type);
+
+	diag_1.pwm_tot = signal[DRIVE_LEFT] / pwm_scale;
+	diag_1.pwm_lin = signal_l / pwm_scale;
+	diag_1.pwm_ang = signal_a / pwm_scale;
+	diag_1.esum_a_ = integ_a / pwm_scale;
+	diag_1.esum_l_ = integ_l / pwm_scale;
+
+	diag_2.pwm_tot = signal[DRIVE_RIGHT] / pwm_scale;
+	diag_2.pwm_lin = diag_1.pwm_lin;
+	diag_2.pwm_ang = -diag_1.pwm_ang;
+	diag_2.esum_a_ = diag_1.esum_a_;
+	diag_2.esum_l_ = diag_1.esum_l_;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Turns both wheels' signals into duty cycles and writes them.
+ *  @details The four duty cycles are written with the timer's buffer update locked, so
+ *           neither wheel can change a PWM period before the other.
+ *  @param   signal Two element array of the left and right signals, each already
+ *           limited to pwm_lim, in 1/pwm_scale percent
+ *  @param   op_type Whether operation is drive-coast (0) or drive-brake (1)
+ */
+
+void drive_pair::write_signals (const int32_t* signal, bool op_type)
+{
+	uint16_t duty[4];
+	uint16_t period = pwm_out_period ();
+
+	for (uint8_t wheel = DRIVE_LEFT; wheel <= DRIVE_RIGHT; wheel++)
+	{
+		// No more than 100 * pwm_scale, so the product fits; see scale_limits()
+		uint32_t magnitude = (signal[wheel] < 0) ? -signal[wheel] : signal[wheel];
+		uint32_t counts = (magnitude * counts_per_unit) >> 16;
+		if (counts > period)
+		{
+			counts = period;
+		}
+		drive_duty (signal[wheel] > 0, (uint16_t)counts, period, op_type, duty + 2 * wheel);
+	}
+
+	pwm_out_write (duty[0], duty[1], duty[2], duty[3]);
+}
@@ -0,0 +1,167 @@
+//**************************************************************************************
+/** \file drive_pair.h
+ *    This file contains header stuff for a controller which runs both drive motors at
+ *    once. It does what two motorDriver objects given the same gains and setpoints do,
+ *    but works out the terms the two wheels share once, and sets all four PWM channels
+ *    of timer TCC0 together so both wheels change in the same PWM period.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 PWM written through pwm_out.h at the timer's full resolution
+ *    \li 10-18-26 Filtered derivatives and back-calculation anti-windup
+ *    \li 10-18-26 Speed, acceleration and static friction feedforward
+ *    \li 10-18-26 run_open() drives set signals with no feedback, for the autotuner
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _DRIVE_PAIR_H_
+#define _DRIVE_PAIR_H_
+
+#include <stdlib.h>
+
+#include "emstream.h"                       // Base class for the debugging serial port
+#include "motorDriver.h"					// For struct diagnostic
+#include "pwm_out.h"						// Compare buffer writes for the PWM
+
+/// Index of each motor's state in a drive_pair; motor '1' and motor '2' of motorDriver
+#define DRIVE_LEFT 0
+#define DRIVE_RIGHT 1
+
+/// The largest shift for the derivative filter and the back-calculation gain
+#define DRIVE_SHIFT_MAX 15
+
+//-------------------------------------------------------------------------------------
+/** @brief   A PID closed-loop controller for both drive motors.
+ *  @details Both motors always get the same gains, limits, linear setpoint and angle,
+ *           so the proportional and integral terms are the same for both; only the
+ *           linear derivative term, which uses each wheel's own speed, differs. The
+ *           angular term has opposite signs on the two wheels. Each call to run() works
+ *           out the shared terms once, then both wheels' duty cycles, and only then
+ *           writes the four compare buffers of TCC0, with the buffer update locked so
+ *           they all take effect at the same timer overflow.
+ *
+ *           The signals are kept in units of 1/pwm_scale percent, as they are before
+ *           motorDriver divides them by pwm_scale, and the limits are scaled to match.
+ *           They're turned into timer counts by multiplying by a factor worked out
+ *           when the gains are set, so the duty cycle has the resolution of the gains
+ *           rather than of whole percent. The percentages in the diagnostics are only
+ *           for display.
+ *
+ *           Each loop's integral is kept as its term in those units, rather than as an
+ *           error sum, so it can be wound back by however much the signal is clipped
+ *           (back-calculation): each pass, the amount clipped off the signal, divided
+ *           by 2^aw_shift, is added to the integral, so it stops growing once the output
+ *           saturates and unwinds as soon as it comes out. The derivative terms act on
+ *           the measurement rather than the error, so a setpoint step gives no kick, and
+ *           go through a first order low pass filter which moves 1/2^d_filter_shift of
+ *           the way to each new value. All products are worked out in 32 bits.
+ *
+ *           The linear signal also gets a feedforward from how the setpoint is moving:
+ *           kv_l/256 per tick/s of its speed, which is what holds that speed, and
+ *           ka_l/256 per tick/s^2 of its acceleration, which makes up for the motors'
+ *           lag, plus ks_l in the direction it moves to get past static friction. The
+ *           feedback then only has to make up what the feedforward gets wrong, so the
+ *           wheels reach the commanded speed sooner and the integral has less to do.
+ *           The linear derivative term acts on the setpoint's speed less each wheel's,
+ *           rather than on the wheel's speed alone, so it doesn't drag on a moving
+ *           setpoint.
+ */
+
+class drive_pair
+{
+	protected:
+		emstream *ser_out;			// Debugging serial connection
+		int16_t kp_l;				// Linear proportional gain constant
+		int16_t ki_l;				// Linear integral gain constant
+		int16_t kd_l;				// Linear derivative gain constant
+		int16_t kp_a;				// Angular proportional gain constant
+		int16_t ki_a;				// Angular integral gain constant
+		int16_t kd_a;				// Angular derivative gain constant
+		int16_t pwm_scale;			// Scaling for pwm
+
+		int16_t setpoint_l;			// Linear setpoint of both motors
+		int16_t position;			// Current position in encoder counts
+		int16_t angle;				// Current angle of the robot
+		int16_t setpoint_a;			// Angular setpoint
+		int16_t velocity[2];		// Speed of each wheel, positive forwards (ticks/s)
+		int16_t velocity_ref;		// Speed the linear setpoint is moving at (ticks/s)
+		int16_t accel_ref;			// Acceleration of the linear setpoint (ticks/s^2)
+		int16_t kv_l;				// Speed feedforward, 1/256ths of a unit per tick/s
+		int16_t ka_l;				// Acceleration feedforward, 1/256ths per tick/s^2
+		int16_t ks_l;				// Static friction feedforward
+
+		int32_t integ_l;			// Linear integral term, in 1/pwm_scale percent
+		int32_t integ_a;			// Angular integral term, in 1/pwm_scale percent
+		int32_t integ_l_lim;		// ki_l times esum_l_lim
+		int32_t integ_a_lim;		// ki_a times esum_a_lim
+		int32_t deriv_l[2];			// Each wheel's filtered linear derivative term
+		int32_t deriv_a;			// Filtered angular derivative term
+		int16_t angle_prev;			// Angle at the last run(), for its rate of change
+		bool angle_prev_valid;		// False until run() has seen an angle
+		uint8_t d_filter_shift;		// Derivative filter moves 1/2^this of the way each pass
+		uint8_t aw_shift;			// Back-calculation gain is 1/2^this
+
+		int16_t pwm_lim;			// Total PWM percentage limit
+		int16_t pwm_lim_linear;		// Non-turning PWM percentage limit, < pwm_lim
+		int16_t	esum_l_lim;			// Limit for accumulation of error terms
+		int16_t	esum_a_lim;			// Limit for accumulation of error terms
+
+		int32_t lim_scaled;			// pwm_lim times pwm_scale
+		int32_t lim_linear_scaled;	// pwm_lim_linear times pwm_scale
+		int32_t lim_angular_scaled;	// What's left of lim_scaled for the angular signal
+		uint32_t counts_per_unit;	// Timer counts per 1/pwm_scale percent, times 2^16
+
+		void scale_limits (void);	// Works out the four values above
+
+		// Turns both wheels' signals into duty cycles and writes them
+		void write_signals (const int32_t* signal, bool op_type);
+
+	public:
+		drive_pair (emstream* ser_dev);	// Sets up the PWM timer, motors stopped
+
+		void set_k_l (int16_t kp_l_in, int16_t ki_l_in, int16_t kd_l_in);	// Linear PID gains
+		void set_k_a (int16_t kp_a_in, int16_t ki_a_in, int16_t kd_a_in);	// Angular PID gains
+		void set_pwm_scaling (int16_t pwm_scale_in);	// Sets the pwm scaling
+		void set_pwm_lim (int16_t pwm_lim_in);	// Sets the PWM limit, pwm_lim
+		void set_pwm_lim_linear (int16_t pwm_lim_linear_in);	// Sets pwm_lim_linear
+		void set_esum_l_lim (int16_t esum_l_lim_in);	// Sets esum_l_lim
+		void set_esum_a_lim (int16_t esum_a_lim_in);	// Sets esum_a_lim
+		void set_d_filter (uint8_t d_filter_shift_in);	// Sets the derivative filter
+		void set_antiwindup (uint8_t aw_shift_in);	// Sets the back-calculation gain
+		void set_feedforward (int16_t kv_l_in, int16_t ka_l_in, int16_t ks_l_in);	// Feedforward
+
+		void set_setpoint_l (int16_t setpoint_l_in);	// Sets the linear setpoint
+		void set_setpoint_a (int16_t setpoint_a_in);	// Sets the angular setpoint
+		void set_position (int16_t position_in);	// Sets the current position
+		void set_angle (int16_t angle_in);	// Sets the current angle
+		void set_velocity (int16_t left_in, int16_t right_in);	// Sets both wheels' speeds
+		void set_velocity_ref (int16_t velocity_ref_in);	// Sets the setpoint's speed
+		void set_accel_ref (int16_t accel_ref_in);	// Sets the setpoint's acceleration
+
+		void zero_esum_l (void);	// Resets the linear integral and derivative
+		void zero_esum_a (void);	// Resets the angular integral and derivative
+
+		// Calculates and sets both motors' PWM signals
+		void run (bool en_p, bool en_i, bool en_d, bool op_type,
+				  diagnostic& diag_1, diagnostic& diag_2);
+
+		// Sets both motors' PWM signals from given linear and angular signals
+		void run_open (int16_t signal_l_in, int16_t signal_a_in, bool op_type,
+					   diagnostic& diag_1, diagnostic& diag_2);
+};
+
+#endif // _DRIVE_PAIR_H_
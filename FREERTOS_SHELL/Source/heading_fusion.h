@@ -0,0 +1,80 @@
+//**************************************************************************************
+/** \file heading_fusion.h
+ *    This file contains header stuff for the heading fusion, which blends the yaw from
+ *    the BNO080 IMU into the encoder odometry's heading. Like odometry.h it has no RTOS
+ *    or hardware calls, so the simulator can run it.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 The IMU's zero follows corrections from the vision tracker
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _HEADING_FUSION_H_
+#define _HEADING_FUSION_H_
+
+#include <stdint.h>
+
+#define HEADING_FUSION_SHIFT 4				// Each report takes 1/2^this of the difference
+#define HEADING_FUSION_GATE 0x0C00			// Bigger differences are bad reports (binary angle)
+#define HEADING_FUSION_REZERO 50			// After this many bad reports in a row, start again
+
+//-------------------------------------------------------------------------------------
+/** @brief   Complementary filter between the odometry heading and the IMU's yaw.
+ *  @details The encoders give the heading every update with no noise, but it drifts
+ *           away whenever a wheel slips; the IMU's yaw doesn't care about slip, but
+ *           comes less often, a few ms late and with some noise. Each IMU report, the
+ *           heading is moved 1/2^HEADING_FUSION_SHIFT of the way towards the IMU's yaw.
+ *           So the fused heading follows the encoders over a fraction of a second and the
+ *           IMU over longer than that: with reports at 50 Hz, a slip's error dies away
+ *           with a time constant of about a third of a second.
+ *
+ *           The IMU's yaw is from wherever it was when it started, so the first report
+ *           sets the IMU's zero to make it agree with the odometry then. A report which
+ *           disagrees by more than HEADING_FUSION_GATE is ignored, as the IMU being
+ *           bumped or giving rubbish; if HEADING_FUSION_REZERO come in a row, the IMU
+ *           has most likely reset itself, so its zero is set again.
+ */
+
+class heading_fusion
+{
+protected:
+	uint16_t imu_zero;				// The IMU's yaw when the heading was zero
+	bool zeroed;					// False until imu_zero has been set
+	uint8_t rejected;				// Reports ignored in a row
+	int16_t difference;				// IMU's yaw less the heading at the last report
+
+public:
+	// This constructor creates a filter which takes its zero from the first report
+	heading_fusion (void);
+
+	// Forgets the IMU's zero, so the next report sets it again
+	void reset (void);
+
+	// Works out the correction to the heading from an IMU report
+	int16_t update (uint16_t imu_yaw, uint16_t heading);
+
+	// Moves the IMU's zero with a correction made to the heading by another sensor
+	void turn (int16_t correction);
+
+	/** This method gets how far the odometry was from the IMU at the last report.
+	 *  @return The IMU's yaw less the heading (binary angle)
+	 */
+	int16_t get_difference (void) { return difference; }
+};
+
+#endif // _HEADING_FUSION_H_
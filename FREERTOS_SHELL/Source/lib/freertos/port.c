@@ -93,6 +93,17 @@ extern "C" {
 /* Start tasks with interrupts enabled. */
 #define portFLAGS_INT_ENABLED					( ( portSTACK_TYPE ) 0x80 )
 
+/* On the xmega the tick timer isn't cleared on its compare match, so the tick
+interrupt moves compare A on by a tick's worth of counts each time; see
+prvSetupTimerInterrupt(), which picks the timer the same way. */
+#if (defined TIMER5_COMPA_vect) || (defined TIMER3_COMPA_vect) || (defined TIMER1_COMPA_vect)
+#elif (defined TCE1_CCA_vect)
+	#define portXMEGA_TICK_TIMER				TCE1
+#elif (defined TCD0_CCA_vect)
+	#define portXMEGA_TICK_TIMER				TCD0
+#endif
+#define portXMEGA_TICK_COUNTS					( ( uint16_t ) ( configCPU_CLOCK_HZ / ( configTICK_RATE_HZ * portCLOCK_PRESCALER ) ) )
+
 /*-----------------------------------------------------------*/
 
 /* We require the address of the pxCurrentTCB variable, but don't want to know
@@ -539,6 +550,9 @@ void vPortYieldFromTick( void ) __attribute__ ( ( naked ) );
 void vPortYieldFromTick( void )
 {
 	portSAVE_CONTEXT();
+	#ifdef portXMEGA_TICK_TIMER
+		portXMEGA_TICK_TIMER.CCA += portXMEGA_TICK_COUNTS;
+	#endif
 	vTaskIncrementTick();
 	vTaskSwitchContext();
 	portRESTORE_CONTEXT();
@@ -623,23 +637,14 @@ static void prvSetupTimerInterrupt( void )
 /*  This is the ISR which runs when the tick timer hits a compare match. It comes in 
  *  two flavors, one for a preemptive scheduler and one for a cooperative scheduler. 
  *  We can use the "naked" attribute, as the context is saved at the start of 
- *  vPortYieldFromTick().  The tick count is incremented after the context is saved. 
+ *  vPortYieldFromTick().  The tick count is incremented after the context is saved, 
+ *  and on the xmega the timer's compare A is moved on then too; nothing may be done 
+ *  here before that, as no registers have been saved. 
  */
 
 void RT_VECT (void) __attribute__ ((signal, naked));
 void RT_VECT (void)
 {
-	#if (RT_VECT == TCD0_CCA_vect)
-		static uint16_t compare_interval = (uint16_t)(configCPU_CLOCK_HZ / (configTICK_RATE_HZ 
-						 * portCLOCK_PRESCALER)) - 1;
-		TCD0.CCA += compare_interval;
-	#elif (RT_VECT = TCE1_CCA_vect))
-		static uint16_t compare_interval = (uint16_t)(configCPU_CLOCK_HZ / (configTICK_RATE_HZ 
-						 * portCLOCK_PRESCALER)) - 1;
-		TCE1.CCA += compare_interval;
-	#endif
-	
-	
 	// For the preemptive scheduler, enable a context switch
 	#if configUSE_PREEMPTION == 1
 		vPortYieldFromTick ();
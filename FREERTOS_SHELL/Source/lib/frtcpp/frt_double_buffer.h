@@ -0,0 +1,133 @@
+//*************************************************************************************
+/** \file frt_double_buffer.h
+ *    This file contains a template class for data which one task or ISR writes and
+ *    others read, kept in two copies so that neither side has to turn interrupts off.
+ *
+ *  Revised:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 Says the writer's priority mustn't be that of a reader
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//*************************************************************************************
+
+// This define prevents this .h file from being included more than once in a .cpp file
+#ifndef _FRT_DOUBLE_BUFFER_H_
+#define _FRT_DOUBLE_BUFFER_H_
+
+#include <stdint.h>
+
+
+//-------------------------------------------------------------------------------------
+/** \brief This class implements an item of data which one writer shares with any
+ *  number of readers, without critical sections.
+ *  \details A \c shared_data<data_type> turns interrupts off while it copies the data,
+ *  so a big item holds off the RTOS tick and the encoder interrupts for as long as the
+ *  copy takes. A \c double_buffer<data_type> keeps two copies instead. The writer
+ *  fills the copy which isn't published, then publishes it by counting \c published
+ *  up by one; being one byte, that count is written and read in one instruction, so
+ *  readers always see whole items and all of an item from the same write.
+ *
+ *  A reader copies the item which \c published points to and then looks at the count
+ *  again. If the writer has published once since, it wrote the other copy, so what the
+ *  reader has is still whole; if twice, the reader's copy may have been written over
+ *  while it read, so it reads again. That can only happen when a reader is held up for
+ *  two of the writer's periods, so in practice readers never read twice.
+ *
+ *  The count only shows writes which have been published, not one under way, so a
+ *  reader must never finish a copy while the writer is half way through writing that
+ *  same copy. There must only be one writer, which may be an ISR, or a task whose
+ *  priority is different from that of every task reading; readers may be tasks or
+ *  ISRs. Then the two never take turns part way through: a reader which interrupts the
+ *  writer, or is of higher priority, finishes its copy before the writer goes on, and
+ *  a writer of higher priority than a reader finishes each write before the reader
+ *  goes on. A writer and a reader of the same priority can be switched back and forth
+ *  by time slicing, the reader's copy being written over after one publish with the
+ *  writer stopped before the next, which the count can't show; don't share a double
+ *  buffer between tasks of the same priority.
+ */
+
+template <class data_type> class double_buffer
+{
+	protected:
+		data_type copies[2];				///< The published copy and the one being written
+		volatile uint8_t published;			///< Counts writes; bit 0 picks the published copy
+
+	public:
+		/** This constructor makes a double buffer whose published copy is copies[0].
+		 *  Until the first write it holds whatever data_type's constructor leaves.
+		 */
+		double_buffer<data_type> (void)
+		{
+			published = 0;
+		}
+
+		//-----------------------------------------------------------------------------
+		/** This method writes data into the double buffer. It may be called from a task
+		 *  or an ISR, but only ever by the one writer.
+		 *  @param new_data The data which is to be written
+		 */
+		void put (const data_type& new_data)
+		{
+			uint8_t next = published + 1;
+			copies[next & 1] = new_data;
+
+			// The copy has to be finished before the count says so
+			asm volatile ("" ::: "memory");
+			published = next;
+		}
+
+		//-----------------------------------------------------------------------------
+		/** This method reads data from the double buffer into a variable. It may be
+		 *  called from a task or an ISR.
+		 *  @param p_item A pointer to the variable where what we got is put
+		 */
+		void get (data_type* p_item)
+		{
+			uint8_t seen;
+			do
+			{
+				seen = published;
+				asm volatile ("" ::: "memory");
+				*p_item = copies[seen & 1];
+				asm volatile ("" ::: "memory");
+			}
+			while ((uint8_t)(published - seen) > 1);
+		}
+
+		//-----------------------------------------------------------------------------
+		/** This method reads data from the double buffer. It may be called from a task
+		 *  or an ISR.
+		 *  @return The most recently written data
+		 */
+		data_type get (void)
+		{
+			data_type temporary_copy;
+			get (&temporary_copy);
+			return (temporary_copy);
+		}
+
+		//-----------------------------------------------------------------------------
+		/** This method gets how many times the data has been written, modulo 256. A
+		 *  reader can use it to see whether there's anything new.
+		 *  @return The number of writes so far, modulo 256
+		 */
+		uint8_t get_count (void)
+		{
+			return (published);
+		}
+
+}; // class double_buffer<data_type>
+
+#endif  // _FRT_DOUBLE_BUFFER_H_
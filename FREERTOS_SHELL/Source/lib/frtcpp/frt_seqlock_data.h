@@ -0,0 +1,147 @@
+//*************************************************************************************
+/** \file frt_seqlock_data.h
+ *    This file contains a template class for data which one task or ISR writes and
+ *    others read, protected by a sequence count instead of by turning interrupts off.
+ *
+ *  Revised:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//*************************************************************************************
+
+// This define prevents this .h file from being included more than once in a .cpp file
+#ifndef _FRT_SEQLOCK_DATA_H_
+#define _FRT_SEQLOCK_DATA_H_
+
+#include <stdint.h>
+
+
+//-------------------------------------------------------------------------------------
+/** \brief This class implements an item of data which one writer shares with any
+ *  number of readers, without critical sections and in only one copy.
+ *  \details A \c shared_data<data_type> turns interrupts off while it copies the data,
+ *  so the RTOS tick and the encoder interrupts wait for as long as the copy takes,
+ *  which is longer the bigger the item. A \c seqlock_data<data_type> has a sequence
+ *  count instead, one byte so that it's written and read in one instruction. The
+ *  writer makes the count odd, writes the data and makes the count even again; it
+ *  never waits for anything. A reader notes the count, copies the data and looks at
+ *  the count again. If the count was odd or has changed, the writer was busy with the
+ *  data while it was being copied, so the reader copies it again.
+ *
+ *  There must only be one writer, which may be a task or an ISR. Tasks read with
+ *  \c get(). As a task reading only waits while the writer finishes, the writer has
+ *  to be an ISR, or a task whose priority is no lower than that of any task reading;
+ *  otherwise a reader could wait for a writer which can't run. ISRs read with
+ *  \c ISR_get(), which doesn't wait: if it has interrupted the writer half way, there
+ *  is no whole item to be had, so it says so and the ISR has to make do without.
+ *
+ *  Compared with \c double_buffer<data_type>, this keeps one copy of the data instead
+ *  of two, but a reader which catches the writer part way has to wait for it to finish
+ *  rather than taking the copy from before.
+ */
+
+template <class data_type> class seqlock_data
+{
+	protected:
+		data_type the_data;					///< Holds the data to be shared
+		volatile uint8_t sequence;			///< Odd while the data is being written
+
+	public:
+		/** This constructor makes a shared item which, until the first write, holds
+		 *  whatever data_type's constructor leaves.
+		 */
+		seqlock_data<data_type> (void)
+		{
+			sequence = 0;
+		}
+
+		//-----------------------------------------------------------------------------
+		/** This method writes data into the shared item. It may be called from a task
+		 *  or an ISR, but only ever by the one writer, and it never waits.
+		 *  @param new_data The data which is to be written
+		 */
+		void put (const data_type& new_data)
+		{
+			uint8_t count = sequence;
+			sequence = count + 1;
+			asm volatile ("" ::: "memory");
+			the_data = new_data;
+			asm volatile ("" ::: "memory");
+			sequence = count + 2;
+		}
+
+		//-----------------------------------------------------------------------------
+		/** This method reads data from the shared item into a variable. It must only be
+		 *  called from a task; an ISR must use \c ISR_get(). It copies the data again
+		 *  until it gets a copy which the writer didn't touch while it was being made.
+		 *  @param p_item A pointer to the variable where what we got is put
+		 */
+		void get (data_type* p_item)
+		{
+			uint8_t before;
+			do
+			{
+				before = sequence;
+				asm volatile ("" ::: "memory");
+				*p_item = the_data;
+				asm volatile ("" ::: "memory");
+			}
+			while ((before & 1) || sequence != before);
+		}
+
+		//-----------------------------------------------------------------------------
+		/** This method reads data from the shared item. It must only be called from a
+		 *  task; an ISR must use \c ISR_get().
+		 *  @return The most recently written data
+		 */
+		data_type get (void)
+		{
+			data_type temporary_copy;
+			get (&temporary_copy);
+			return (temporary_copy);
+		}
+
+		//-----------------------------------------------------------------------------
+		/** This method enables an ISR to read data from the shared item. If the ISR has
+		 *  interrupted the writer half way through, waiting would never end, so the
+		 *  variable is left alone and false is returned. If it is the writer which
+		 *  interrupts the copy, as an ISR at a higher level can, it's copied again.
+		 *  @param p_item A pointer to the variable where what we got is put
+		 *  @return True if a whole item was copied, false if the writer was busy
+		 */
+		bool ISR_get (data_type* p_item)
+		{
+			uint8_t before;
+			data_type temporary_copy;
+			do
+			{
+				before = sequence;
+				if (before & 1)
+				{
+					return (false);
+				}
+				asm volatile ("" ::: "memory");
+				temporary_copy = the_data;
+				asm volatile ("" ::: "memory");
+			}
+			while (sequence != before);
+
+			*p_item = temporary_copy;
+			return (true);
+		}
+
+}; // class seqlock_data<data_type>
+
+#endif  // _FRT_SEQLOCK_DATA_H_
@@ -10,6 +10,7 @@
  *
  *  Revised:
  *    \li 10-21-2012 JRR Original file
+ *    \li 10-18-26 Stack top is a size_t so it holds an address on a PC as well
  *
  *  Credits:
  *    Much of this code uses techniques learned from Amigo software, which is 
@@ -245,7 +246,7 @@ class frt_task
 			/** This is a pointer to the top (beginning) of the task's stack. It is
 			 *  used when we want to print out the stack for debugging purposes.
 			 */
-			uint16_t top_of_stack;
+			size_t top_of_stack;
 		#endif
 
 		/** This is the state in which the finite state machine of the task is. This
@@ -28,6 +28,7 @@
  *    \li 10-27-2012 JRR Changed name from \c queue to \c circ_buffer for FreeRTOS 
  *                       compatibility because FreeRTOS uses a file called \c queue.c
  *    \li 12-17-2012 JRR Removed fancy index size, replaced with simpler \c size_t
+ *    \li 10-18-26 Added recent(); fixed the index wrap in the subscript operator
  *
  *  License:
  *    This file is copyright 2012 by JR Ridgely and released under the Lesser GNU 
@@ -128,6 +129,9 @@ class circ_buffer
 		// This operator returns an item at the given index in the buffer
 		qType operator[] (size_t);
 
+		// This method gets an item by how long ago it was put in, newest first
+		qType& recent (size_t);
+
 		/** This method returns the number of items in the buffer.
 		 *  @return The number of items currently in the buffer
 		 */
@@ -303,14 +307,14 @@ template <class qType, size_t qSize>
 qType circ_buffer<qType, qSize>::operator[] (size_t index)
 {
 	// Check if there's data written at the given location
-	if (index > how_full)
+	if (index >= how_full)
 	{
 		return ((qType)(-1));
 	}
 
 	// Find an index pointing to the correct location in the buffer
 	size_t getIndex = i_get + index;
-	if (getIndex > qSize)
+	if (getIndex >= qSize)
 	{
 		getIndex -= qSize;
 	}
@@ -319,4 +323,23 @@ qType circ_buffer<qType, qSize>::operator[] (size_t index)
 	return (buffer[getIndex]);
 }
 
+
+//-------------------------------------------------------------------------------------
+/** This method gets an item by how long ago it was put in, without taking it out of
+ *  the buffer. Unlike the subscript operator, which counts from the oldest item, this
+ *  counts back from the newest, which suits a buffer kept full with \c jam() as a
+ *  history. A reference is returned, so the item can be changed where it is, and so
+ *  that the buffer can hold structures, which can't be cast from -1. The caller has 
+ *  to check that there are more than \c age items in the buffer.
+ *  @param age How many items were put in after this one; 0 gets the newest item
+ *  @return A reference to the item
+ */
+
+template <class qType, size_t qSize> 
+qType& circ_buffer<qType, qSize>::recent (size_t age)
+{
+	size_t index = (i_put > age) ? (i_put - 1 - age) : (i_put + qSize - 1 - age);
+	return (buffer[index]);
+}
+
 #endif // _CIRC_BUFFER_H_
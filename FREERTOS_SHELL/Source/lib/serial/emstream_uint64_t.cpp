@@ -6,6 +6,8 @@
  *  Revised:
  *    \li 12-02-2012 JRR Split this file off from the main \c emstream.cpp to
  *                       allow smaller machine code if stuff in this file isn't used
+ *    \li 10-18-26 Numbers which fit in 32 bits print normally in bases other than 
+ *                       hex, octal and binary
  *
  *  License:
  *    This file released under the Lesser GNU Public License, version 2. This program
@@ -31,8 +33,10 @@
 
 //-------------------------------------------------------------------------------------
 /** This operator writes a long long (64-bit) unsigned integer to the serial port as a 
- *  text string.  It only writes such numbers in unsigned hexadecimal format. The
+ *  text string.  It only writes big numbers in unsigned hexadecimal format. The
  *  number is written by breaking it into two unsigned longs, writing them in order.
+ *  Numbers which fit in 32 bits, such as a PC's \c size_t values mostly do, are 
+ *  written as \c uint32_t's in bases such as decimal.
  *  @return A reference to the serial device to which the data was printed. This
  *          reference is used to string printable items together with "<<" operators
  *  @param num The 64-bit number to be sent out
@@ -44,6 +48,10 @@ emstream& emstream::operator<< (uint64_t num)
 		   uint64_t whole;
 		   uint8_t bits[8];
 		  } parts;
+	if (base != 16 && base != 8 && base != 2 && num <= 0xFFFFFFFFUL)
+	{
+		return (*this << (uint32_t)num);
+	}
 	parts.whole = num;
 	*this << parts.bits[7] << parts.bits[6] << parts.bits[5] << parts.bits[4]
 		  << parts.bits[3] << parts.bits[2] << parts.bits[1] << parts.bits[0];
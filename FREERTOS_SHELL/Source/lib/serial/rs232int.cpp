@@ -10,6 +10,7 @@
  *
  *  Revised:
  *    \li 09-14-2017 CTR Adapted from JRR code for AVR to be compatibile with xmega series
+ *    \li 10-18-26 No USARTF0 receiver interrupt if RSINT_NO_USARTF0 is defined
  *
  *  License:
  *		This file is copyright 2012 by JR Ridgely and released under the Lesser GNU 
@@ -349,7 +350,7 @@ ISR (USARTE1_RXC_vect)
 }
 #endif
 
-#ifdef USARTF0_RXC_vect
+#if defined (USARTF0_RXC_vect) && !defined (RSINT_NO_USARTF0)
 ISR (USARTF0_RXC_vect)
 {
 	// When this ISR is triggered, there's a character waiting in the USART data reg-
@@ -11,6 +11,7 @@
  *  Revisions:
  *    \li 09-14-2017 CTR Adapted from JRR code for AVR to be compatible with xmega 
  *                       series
+ *    \li 10-18-26 USARTF0's receiver interrupt is left to vision_link.cpp
  *
  *  License:
  *    This file is released under the Lesser GNU Public License, version 2. This 
@@ -35,6 +36,12 @@
  */
 #define RSINT_BUF_SIZE		100
 
+/** USARTF0 receives the vision tracker's packets, which vision_link.cpp decodes in its
+ *  own receiver interrupt, so this driver doesn't define one for it. An \c rs232 
+ *  can't be made on USARTF0 while this is defined.
+ */
+#define RSINT_NO_USARTF0
+
 
 //-------------------------------------------------------------------------------------
 /** \brief This class controls a UART (Universal Asynchronous Receiver Transmitter), 
@@ -5,6 +5,9 @@
  *
  *  Revisions:
  *    \li 09-14-2017 CTR Adapted from JRR code for AVR to be compatible with xmega 
+ *    \li 10-18-26 Added the waypoint queue
+ *    \li 10-18-26 Loads the parameter block from the EEPROM before the tasks start
+ *    \li 10-18-26 Creates the user interface task, with room for its new commands
  *
  *  License:
  *    This file is released under the Lesser GNU Public License, version 2. This 
@@ -39,8 +42,10 @@
 #include "task_motor.h"                     // Header for motor task
 #include "task_Robot_State.h"               // Header for motor task
 #include "task_diag.h"						// Header for diagnostic task
+#include "robot_params.h"					// Calibration, gains and limits
 
 frt_text_queue print_ser_queue (32, NULL, 10);
+frt_queue<waypoint> waypoint_queue (8, NULL, 0);	// task_user's 'p' puts, task_motor gets
 
 //=====================================================================================
 /** The main function sets up the RTOS.  Some test tasks are created. Then the 
@@ -71,11 +76,20 @@ int main (void)
 	// the task scheduler has been started by the function vTaskStartScheduler()
 	rs232 ser_dev(0,&USARTD0); // Create a serial device on USART E0
 	ser_dev << clrscr << "FreeRTOS Xmega Testing Program" << endl << endl;
+
+	// The calibration, gains and limits are read from the EEPROM once, here, so the
+	// tasks can read them from RAM with no locking
+	if (!params_load ())
+	{
+		ser_dev << "No good parameters in the EEPROM; using the defaults" << endl;
+	}
 	
 
-	/*// The user interface is at low priority; it could have been run in the idle task
-	// but it is desired to exercise the RTOS more thoroughly in this test program
-	new task_user ("UserInt", task_priority (0), 260, &ser_dev);*/
+	// The user interface is at low priority; it could have been run in the idle task
+	// but it is desired to exercise the RTOS more thoroughly in this test program. It
+	// sends the waypoints, starts the autotune and tunes the parameters, and its timing
+	// commands and parameter copies need more stack than the 260 it used to have
+	new task_user ("UserInt", task_priority (0), 500, &ser_dev);
 	
 	/*// The LED blinking task is also low priority and is used to test the timing accuracy
 	// of the task transitions.
@@ -0,0 +1,383 @@
+//**************************************************************************************
+/** \file motion_profile.cpp
+ *    This file contains a motion profile generator, which turns a move of some
+ *    distance into a smooth position reference with limited speed, acceleration and
+ *    jerk.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 Gives the reference acceleration, for the feedforward
+ *    \li 10-18-26 Limits kept to what it can run; the cruise allows for rounding
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include "motion_profile.h"                 // Header for this file
+
+#define PROFILE_BISECTIONS 16				// Halvings of the range of the peak speed
+
+
+//-------------------------------------------------------------------------------------
+/** This constructor makes a profile at rest at position zero, with nothing planned.
+ *  @param limits The speed, acceleration and jerk limits
+ *  @param rate_hz How many times a second step() is called
+ */
+
+motion_profile::motion_profile (const motion_limits& limits, uint16_t rate_hz)
+{
+	set_limits (limits, rate_hz);
+	reset ();
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method sets the limits, turning them into units of control passes. A move
+ *  already planned carries on with the old ones. The acceleration and jerk are
+ *  kept to at least PROFILE_LIM_MIN, below which rounding the jerk to a whole count
+ *  would leave the ramps well short. The speed is kept to what velocity() can give,
+ *  and each limit to no more than PROFILE_RAMP_MAX passes' worth of the next one down,
+ *  so no ramp or hold is too long for its 16 bit length. The parameter table doesn't
+ *  let the user set anything these change, but a bad block from EEPROM might.
+ *  @param limits The speed, acceleration and jerk limits
+ *  @param rate_hz How many times a second step() is called
+ */
+
+void motion_profile::set_limits (const motion_limits& limits, uint16_t rate_hz)
+{
+	uint32_t rate_sq = (uint32_t)rate_hz * rate_hz;
+	uint32_t j_per_pass = limits.j_max / rate_hz;
+
+	rate = rate_hz;
+	v_lim = ((uint32_t)limits.v_max << 16) / rate_hz;
+	a_lim = ((uint32_t)limits.a_max << 16) / rate_sq;
+	if (j_per_pass > 0x7FFF)
+	{
+		j_per_pass = 0x7FFF;
+	}
+	j_lim = (j_per_pass << 16) / rate_sq;
+
+	// None can be zero, or a move would never end, and too little acceleration or
+	// jerk leaves the ramps short
+	if (v_lim < 1) v_lim = 1;
+	if (a_lim < PROFILE_LIM_MIN) a_lim = PROFILE_LIM_MIN;
+	if (j_lim < PROFILE_LIM_MIN) j_lim = PROFILE_LIM_MIN;
+
+	if (v_lim > ((int32_t)PROFILE_V_MAX << 16) / rate_hz)
+	{
+		v_lim = ((int32_t)PROFILE_V_MAX << 16) / rate_hz;
+	}
+	if (a_lim > j_lim * PROFILE_RAMP_MAX)
+	{
+		a_lim = j_lim * PROFILE_RAMP_MAX;
+	}
+	if (v_lim > a_lim * PROFILE_RAMP_MAX)
+	{
+		v_lim = a_lim * PROFILE_RAMP_MAX;
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method stops the reference dead at position zero, with nothing planned.
+ */
+
+void motion_profile::reset (void)
+{
+	for (uint8_t index = 0; index < PROFILE_PHASES; index++)
+	{
+		phase_len[index] = 0;
+		phase_jerk[index] = 0;
+	}
+	phase = PROFILE_PHASES;
+	phase_tick = 0;
+	pos = 0;
+	vel = 0;
+	acc = 0;
+	end = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method works out how long the jerk ramps and the constant acceleration between
+ *  them have to be to change the speed by some amount. The ramps are long enough to
+ *  reach the acceleration limit without going over the jerk limit, unless the change
+ *  is too small to need the whole acceleration; the hold is just long enough to make
+ *  up the rest of the change.
+ *  @param dv The change of speed, not negative (Q16 ticks/pass)
+ *  @param n_jerk Set to the length of each ramp (passes)
+ *  @param n_hold Set to the length of the constant acceleration (passes)
+ */
+
+void motion_profile::ramp_shape (int32_t dv, uint16_t& n_jerk, uint16_t& n_hold)
+{
+	if (dv <= 0)
+	{
+		n_jerk = 0;
+		n_hold = 0;
+		return;
+	}
+
+	int32_t n_full = (a_lim + j_lim - 1) / j_lim;	// Ramp to the acceleration limit
+	if (dv / a_lim < n_full)
+	{
+		uint32_t square = (dv + j_lim - 1) / j_lim;
+		uint16_t root = fx_isqrt32 (square);
+		if ((uint32_t)root * root < square)
+		{
+			root++;
+		}
+		n_jerk = root;
+		n_hold = 0;
+	}
+	else
+	{
+		n_jerk = (uint16_t)n_full;
+		n_hold = (uint16_t)((dv + a_lim - 1) / a_lim - n_full);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method works out how far the reference goes while changing speed. The speed
+ *  changes symmetrically about the middle of the change, so the distance is the mean
+ *  of the two speeds times how long it takes.
+ *  @param v_start The speed at the start (Q16 ticks/pass)
+ *  @param v_end The speed at the end (Q16 ticks/pass)
+ *  @return The distance (Q8 ticks)
+ */
+
+int32_t motion_profile::ramp_distance (int32_t v_start, int32_t v_end)
+{
+	uint16_t n_jerk, n_hold;
+	int32_t dv = v_end - v_start;
+
+	ramp_shape ((dv < 0) ? -dv : dv, n_jerk, n_hold);
+	return (((v_start + v_end + 256) >> 9) * (2 * (int32_t)n_jerk + n_hold));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method fills three phases with a change of speed: a jerk ramp, a constant
+ *  acceleration and a jerk ramp back to zero acceleration. The jerk is worked out from
+ *  the whole number lengths of the phases, so the speed changes by just the right
+ *  amount, less what rounding the jerk down to a whole Q16 count loses.
+ *  @param first The first of the three phases
+ *  @param v_start The speed at the start, in the direction of the move (Q16)
+ *  @param v_end The speed at the end, in the direction of the move (Q16)
+ *  @param dir 1 if the move is forwards, -1 if it's backwards
+ *  @return The speed the phases really end at, in the direction of the move (Q16)
+ */
+
+int32_t motion_profile::ramp_phases (uint8_t first, int32_t v_start, int32_t v_end,
+									 int32_t dir)
+{
+	uint16_t n_jerk, n_hold;
+	int32_t dv = v_end - v_start;
+	int32_t jerk = 0;
+	int32_t sign = 1;
+
+	if (dv < 0)
+	{
+		dv = -dv;
+		dir = -dir;
+		sign = -1;
+	}
+	ramp_shape (dv, n_jerk, n_hold);
+	if (n_jerk > 0)
+	{
+		jerk = dv / ((int32_t)n_jerk * ((int32_t)n_jerk + n_hold));
+	}
+
+	phase_len[first] = n_jerk;
+	phase_jerk[first] = dir * jerk;
+	phase_len[first + 1] = n_hold;
+	phase_jerk[first + 1] = 0;
+	phase_len[first + 2] = n_jerk;
+	phase_jerk[first + 2] = -dir * jerk;
+
+	return (v_start + sign * jerk * (int32_t)n_jerk * ((int32_t)n_jerk + n_hold));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method plans a move of the given distance from wherever the reference is, and
+ *  however fast it's going. It can be called in the middle of a move, to make the move
+ *  longer or shorter. If the reference can't stop in the distance given, it slows down
+ *  as fast as the limits allow, and jumps back to the end when it has stopped.
+ *  @param distance How far to move the reference (ticks)
+ */
+
+void motion_profile::plan (int32_t distance)
+{
+	end = pos + distance * 256;
+	int32_t dir = (distance < 0) ? -1 : 1;
+
+	// Phase 0 brings the acceleration back to zero. It's run here, as step() will run
+	// it, to see where it leaves the reference
+	int32_t p = pos;
+	int32_t v = vel;
+	phase_len[0] = 0;
+	phase_jerk[0] = 0;
+	if (acc != 0)
+	{
+		int32_t a = acc;
+		uint16_t n_zero = (uint16_t)((((a < 0) ? -a : a) + j_lim - 1) / j_lim);
+		phase_len[0] = n_zero;
+		phase_jerk[0] = -a / n_zero;
+		for (uint16_t tick = 0; tick < n_zero; tick++)
+		{
+			a += phase_jerk[0];
+			v += a;
+			p += (v + 128) >> 8;
+		}
+	}
+
+	// From there, in the direction of the move
+	int32_t v_0 = dir * v;
+	int32_t left = dir * (end - p);
+
+	// The peak speed is the top speed if there's room to get there and back; if not,
+	// the highest for which there is room
+	int32_t v_peak = v_lim;
+	int32_t needed = ramp_distance (v_0, v_peak) + ramp_distance (v_peak, 0);
+	if (needed > left)
+	{
+		int32_t v_lo = (v_0 < v_lim) ? v_0 : v_lim;
+		int32_t v_hi = v_lim;
+		if (v_lo < 0)
+		{
+			v_lo = 0;
+		}
+		if (ramp_distance (v_0, v_lo) + ramp_distance (v_lo, 0) >= left)
+		{
+			v_hi = v_lo;					// No room to stop; slow down
+		}
+		for (uint8_t halving = 0; halving < PROFILE_BISECTIONS; halving++)
+		{
+			int32_t v_mid = (v_lo + v_hi) >> 1;
+			if (ramp_distance (v_0, v_mid) + ramp_distance (v_mid, 0) > left)
+			{
+				v_hi = v_mid;
+			}
+			else
+			{
+				v_lo = v_mid;
+			}
+		}
+		v_peak = v_lo;
+		needed = ramp_distance (v_0, v_peak) + ramp_distance (v_peak, 0);
+	}
+
+	// The ramps are filled in first, as rounding the jerk makes them end a little short
+	// of the speeds asked for; whatever distance they really leave over is covered at
+	// the speed the first one reaches
+	v_peak = ramp_phases (1, v_0, v_peak, dir);
+	int32_t v_stop = ramp_phases (5, v_peak, 0, dir);
+	needed = ((v_0 + v_peak + 256) >> 9) * (2 * (int32_t)phase_len[1] + phase_len[2])
+		   + ((v_peak + v_stop + 256) >> 9) * (2 * (int32_t)phase_len[5] + phase_len[6]);
+	uint32_t n_cruise = 0;
+	if (left > needed && ((v_peak + 128) >> 8) > 0)
+	{
+		// Rounded as step() rounds each pass's move
+		n_cruise = (uint32_t)(left - needed) / (uint32_t)((v_peak + 128) >> 8);
+		if (n_cruise > 0xFFFF)
+		{
+			n_cruise = 0xFFFF;
+		}
+	}
+	phase_len[4] = (uint16_t)n_cruise;
+	phase_jerk[4] = 0;
+
+	phase = 0;
+	phase_tick = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method moves the reference on by one control pass. At the end of the move the
+ *  reference is put exactly at the end, at rest.
+ */
+
+void motion_profile::step (void)
+{
+	while (phase < PROFILE_PHASES && phase_tick >= phase_len[phase])
+	{
+		phase++;
+		phase_tick = 0;
+		if (phase == 1 || phase == 4)
+		{
+			acc = 0;						// Lose what the jerk's rounding left
+		}
+	}
+	if (phase >= PROFILE_PHASES)
+	{
+		pos = end;
+		vel = 0;
+		acc = 0;
+		return;
+	}
+
+	acc += phase_jerk[phase];
+	vel += acc;
+	pos += (vel + 128) >> 8;
+	phase_tick++;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method gets the reference position.
+ *  @return The position, relative to where the reference was last reset (ticks)
+ */
+
+int16_t motion_profile::position (void)
+{
+	int32_t ticks = (pos + 128) >> 8;
+	return ((int16_t)((ticks > 32767) ? 32767 : (ticks < -32767) ? -32767 : ticks));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method gets the distance from the reference to the end of the move.
+ *  @return The distance, negative if the move is backwards (ticks)
+ */
+
+int16_t motion_profile::remaining (void)
+{
+	int32_t ticks = (end - pos + 128) >> 8;
+	return ((int16_t)((ticks > 32767) ? 32767 : (ticks < -32767) ? -32767 : ticks));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method gets the reference speed.
+ *  @return The speed (ticks/s)
+ */
+
+int16_t motion_profile::velocity (void)
+{
+	return ((int16_t)((vel * (int32_t)rate) >> 16));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method gets the reference acceleration.
+ *  @return The acceleration (ticks/s^2)
+ */
+
+int16_t motion_profile::acceleration (void)
+{
+	int32_t accel = (((acc * (int32_t)rate) >> 8) * rate) >> 8;
+	return ((int16_t)((accel > 32767) ? 32767 : (accel < -32767) ? -32767 : accel));
+}
@@ -0,0 +1,134 @@
+//**************************************************************************************
+/** \file motion_profile.h
+ *    This file contains header stuff for a motion profile generator, which turns a
+ *    move of some distance into a smooth position reference with limited speed,
+ *    acceleration and jerk. Like odometry.h it has no RTOS or hardware calls, so the
+ *    simulator can run it.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 Gives the reference acceleration, for the feedforward
+ *    \li 10-18-26 Limits kept to what it can run; the cruise allows for rounding
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _MOTION_PROFILE_H_
+#define _MOTION_PROFILE_H_
+
+#include <stdint.h>
+
+#include "fixed_math.h"					// For the square root
+
+#define PROFILE_PHASES 8				// Phases of a move; see motion_profile
+#define PROFILE_V_MAX 32767				// Top speed velocity() can give (ticks/s)
+#define PROFILE_RAMP_MAX 2000			// Longest ramp or hold the limits may need (passes)
+#define PROFILE_LIM_MIN 64				// Least acceleration and jerk kept (Q16 per pass)
+
+/// Limits for a motion profile
+struct motion_limits
+{
+	uint16_t v_max;			// Top speed (ticks/s)
+	uint16_t a_max;			// Largest acceleration (ticks/s^2)
+	uint32_t j_max;			// Largest jerk (ticks/s^3)
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   Makes an S-curve position reference for a move of a given distance.
+ *  @details When a move is planned, the profile is worked out once as up to eight
+ *           phases, each a whole number of control passes long with a constant jerk:
+ *           the acceleration is first brought back to zero, if the move was planned
+ *           while the reference was speeding up or slowing down; then it ramps up,
+ *           holds and ramps down to change the speed to the peak speed; then the
+ *           speed is held; then the acceleration ramps down, holds and ramps back up
+ *           to stop at the end. Where the move is too short to reach the top speed,
+ *           the peak speed is found by bisection. Each pass, step() only adds the
+ *           jerk to the acceleration, the acceleration to the speed and the speed to
+ *           the position, so evaluating the profile costs three additions.
+ *
+ *           The jerk in each ramp is worked out from the ramp's whole number length,
+ *           so the speed changes by just the right amount; the length of the cruise
+ *           is rounded to a whole number of passes, and whatever distance that leaves
+ *           out is made up when the reference snaps to the end of the move. With no
+ *           jerk limit to speak of, the ramps are one pass long and the profile is a
+ *           trapezoid.
+ *
+ *           Speeds, accelerations and jerks are kept per control pass in Q16 fixed
+ *           point, and positions in ticks in Q8, so moves of up to 32767 ticks fit.
+ */
+
+class motion_profile
+{
+protected:
+	int32_t v_lim;						// Limits per pass, Q16
+	int32_t a_lim;
+	int32_t j_lim;
+	uint16_t rate;						// Control passes per second
+
+	uint16_t phase_len[PROFILE_PHASES];	// Length of each phase (passes)
+	int32_t phase_jerk[PROFILE_PHASES];	// Jerk in each phase, Q16 ticks/pass^3
+	uint8_t phase;						// The phase being run; PROFILE_PHASES when done
+	uint16_t phase_tick;				// Passes of it run so far
+
+	int32_t pos;						// Reference position, Q8 ticks
+	int32_t vel;						// Reference speed, Q16 ticks/pass
+	int32_t acc;						// Reference acceleration, Q16 ticks/pass^2
+	int32_t end;						// Where the move ends, Q8 ticks
+
+	// Works out the jerk ramp and hold lengths for a change of speed
+	void ramp_shape (int32_t dv, uint16_t& n_jerk, uint16_t& n_hold);
+
+	// Works out how far the reference goes while changing speed (Q8 ticks)
+	int32_t ramp_distance (int32_t v_start, int32_t v_end);
+
+	// Fills three phases with a change of speed, giving the speed they really reach
+	int32_t ramp_phases (uint8_t first, int32_t v_start, int32_t v_end, int32_t dir);
+
+public:
+	// This constructor makes a profile at rest at position zero
+	motion_profile (const motion_limits& limits, uint16_t rate_hz);
+
+	// Sets the limits, which take effect at the next plan()
+	void set_limits (const motion_limits& limits, uint16_t rate_hz);
+
+	// Stops the reference dead at position zero, with nothing planned
+	void reset (void);
+
+	// Plans a move of the given distance from wherever the reference is now
+	void plan (int32_t distance);
+
+	// Moves the reference on by one control pass
+	void step (void);
+
+	/** This method tells whether the reference has come to the end of the move.
+	 *  @return True if it's at rest at the end
+	 */
+	bool idle (void) { return (phase >= PROFILE_PHASES); }
+
+	// Gets the reference position (ticks)
+	int16_t position (void);
+
+	// Gets the distance from the reference to the end of the move (ticks)
+	int16_t remaining (void);
+
+	// Gets the reference speed (ticks/s)
+	int16_t velocity (void);
+
+	// Gets the reference acceleration (ticks/s^2)
+	int16_t acceleration (void);
+};
+
+#endif // _MOTION_PROFILE_H_
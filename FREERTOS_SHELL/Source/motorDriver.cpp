@@ -6,6 +6,9 @@
  *  @b Revisions:
  *    11-26-18 RT Original file
  *	  12-5-18 RT Troubleshooting, added angular PID control
+ *	  10-18-26 Linear derivative term uses the measured wheel speed
+ *	  10-18-26 Filtered derivatives, back-calculation anti-windup, 32 bit products
+ *	  10-18-26 Speed, acceleration and static friction feedforward
  *
  *  @b Usage:
  *    This file is intended to be used on an XMEGA MCU, providing classes to run motors
@@ -62,6 +65,9 @@ motorDriver::motorDriver(char motor, emstream* ser_dev)
 	 }
 
 	 // Initializing variables. Everything is set to zero or unity to ensure motor does not run.
+	 set_d_filter(0);
+	 set_antiwindup(0);
+	 set_feedforward(0,0,0);
 	 zero_esum_l();
 	 zero_esum_a();
 	 set_k_l(0,0,0);
@@ -74,6 +80,9 @@ motorDriver::motorDriver(char motor, emstream* ser_dev)
 	 set_setpoint_a(0);
 	 set_position(0);
 	 set_angle(0);
+	 set_velocity(0);
+	 set_velocity_ref(0);
+	 set_accel_ref(0);
 	 set_pwm_scaling(1);
    
  }
@@ -185,7 +194,8 @@ void motorDriver::set_pwm_lim_linear(int16_t pwm_lim_linear_in)
  //-------------------------------------------------------------------------------------
 /** @brief   Sets the limit for the linear integral error sum.
  *  @details This method sets the integral error sum limit of the object, the protected
- *		     variable esum_l_lim, in encoder counts.
+ *		     variable esum_l_lim, in encoder counts. The integral term is held to
+ *			 ki_l times this.
  *  @param   esum_l_lim_in The input integral error sum limit.
  *  @var     int16_t esum_l_lim The class variable for the integral error sum limit.
  */
@@ -212,6 +222,63 @@ void motorDriver::set_esum_a_lim(int16_t esum_a_lim_in)
  }
 
 
+ //-------------------------------------------------------------------------------------
+/** @brief   Sets the derivative filter.
+ *  @details This method sets how strongly the derivative terms are filtered. Each run()
+ *			 the filtered terms move 1/2^shift of the way to their new values, a first
+ *			 order low pass with a time constant of about 2^shift runs. Zero leaves
+ *			 them unfiltered.
+ *  @param   d_filter_shift_in The input shift, at most 15.
+ *  @var     uint8_t d_filter_shift The class variable for the filter shift.
+ */
+
+void motorDriver::set_d_filter(uint8_t d_filter_shift_in)
+ {
+	 // Setting d_filter_shift
+	 d_filter_shift = (d_filter_shift_in > 15) ? 15 : d_filter_shift_in;
+ }
+
+
+ //-------------------------------------------------------------------------------------
+/** @brief   Sets the back-calculation gain of the anti-windup.
+ *  @details This method sets how quickly the integral terms are wound back when the
+ *			 output is clipped. Each run() the amount clipped off a signal, divided by
+ *			 2^shift, is taken off its integral term. Zero takes it all off.
+ *  @param   aw_shift_in The input shift, at most 15.
+ *  @var     uint8_t aw_shift The class variable for the back-calculation shift.
+ */
+
+void motorDriver::set_antiwindup(uint8_t aw_shift_in)
+ {
+	 // Setting aw_shift
+	 aw_shift = (aw_shift_in > 15) ? 15 : aw_shift_in;
+ }
+
+
+ //-------------------------------------------------------------------------------------
+/** @brief   Sets the feedforward gains.
+ *  @details This method sets the speed feedforward gain, kv_l, in 1/256ths of the
+ *			 signal per tick/s of the reference speed, the acceleration feedforward
+ *			 gain, ka_l, in 1/256ths of the signal per tick/s^2, and the static
+ *			 friction feedforward, ks_l, which is added in the direction the reference
+ *			 moves.
+ *  @param   kv_l_in The input speed feedforward gain.
+ *  @var     int16_t kv_l The class variable for the speed feedforward gain.
+ *  @param   ka_l_in The input acceleration feedforward gain.
+ *  @var     int16_t ka_l The class variable for the acceleration feedforward gain.
+ *  @param   ks_l_in The input static friction feedforward.
+ *  @var     int16_t ks_l The class variable for the static friction feedforward.
+ */
+
+void motorDriver::set_feedforward(int16_t kv_l_in, int16_t ka_l_in, int16_t ks_l_in)
+ {
+	 // Setting kv_l, ka_l and ks_l
+	 kv_l = kv_l_in;
+	 ka_l = ka_l_in;
+	 ks_l = ks_l_in;
+ }
+
+
  //-------------------------------------------------------------------------------------
 /** @brief   Sets the target linear setpoint.
  *  @details This method sets the target linear setpoint of the object, the protected
@@ -273,30 +340,78 @@ void motorDriver::set_angle(int16_t angle_in)
 
 
 //-------------------------------------------------------------------------------------
-/** @brief   Resets the linear integral error sum to zero.
- *  @details This method resets the integral linear error sum, the protected
- *		     esum_l, to zero.
- *  @param   esum_l The sum of the linear error terms for integral gain in encoder counts.
+/** @brief   Sets the current wheel speed.
+ *  @details This method sets the measured speed of the wheel, the protected
+ *		     variable velocity, which the linear derivative term uses.
+ *  @param   velocity_in The input speed, positive forwards, in ticks/s.
+ *  @var     int16_t velocity The class variable for the speed.
+ */
+
+void motorDriver::set_velocity(int16_t velocity_in)
+ {
+	 // Setting velocity
+	 velocity = velocity_in;
+ }
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the reference speed.
+ *  @details This method sets the speed the linear setpoint is moving at, the protected
+ *		     variable velocity_ref, which the feedforward uses.
+ *  @param   velocity_ref_in The input speed, positive forwards, in ticks/s.
+ *  @var     int16_t velocity_ref The class variable for the reference speed.
+ */
+
+void motorDriver::set_velocity_ref(int16_t velocity_ref_in)
+ {
+	 // Setting velocity_ref
+	 velocity_ref = velocity_ref_in;
+ }
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Sets the reference acceleration.
+ *  @details This method sets how fast the reference speed is changing, the protected
+ *		     variable accel_ref, which the feedforward uses.
+ *  @param   accel_ref_in The input acceleration, positive forwards, in ticks/s^2.
+ *  @var     int16_t accel_ref The class variable for the reference acceleration.
+ */
+
+void motorDriver::set_accel_ref(int16_t accel_ref_in)
+ {
+	 // Setting accel_ref
+	 accel_ref = accel_ref_in;
+ }
+
+
+//-------------------------------------------------------------------------------------
+/** @brief   Resets the linear integral term to zero.
+ *  @details This method resets the linear integral term, the protected integ_l, and
+ *			 the filtered linear derivative term, deriv_l, to zero.
  */
 
 void motorDriver::zero_esum_l(void)
  {
-	 // Resetting esum_l
-	 esum_l = 0;
+	 // Resetting integ_l and deriv_l
+	 integ_l = 0;
+	 deriv_l = 0;
  }
 
 
 //-------------------------------------------------------------------------------------
-/** @brief   Resets the angular integral error sum to zero.
- *  @details This method resets the angular integral error sum, the protected
- *		     esum_a, to zero.
- *  @param   esum_a The sum of the linear error terms for angular gain.
+/** @brief   Resets the angular integral term to zero.
+ *  @details This method resets the angular integral term, the protected integ_a, and
+ *			 the filtered angular derivative term, deriv_a, to zero. The next run()
+ *			 takes the angle's rate of change as zero.
  */
 
 void motorDriver::zero_esum_a(void)
  {
-	 // Resetting esum_a
-	 esum_a = 0;
+	 // Resetting integ_a and deriv_a
+	 integ_a = 0;
+	 deriv_a = 0;
+	 angle_prev = 0;
+	 angle_prev_valid = false;
  }
 
 
@@ -305,31 +420,42 @@ void motorDriver::zero_esum_a(void)
  *  @details This method calculates the current pwm output signal. Its arguments are booleans
  *			 dictating whether to include proportional, integral, and derivative action.
  *			 This method sums the difference between setpoint and position to get the error as
- *           well as incrementing the error sum, esum, by the error. It does NOT update the
- *           position or setpoint variable of the motorDriver object. The drive can be either
- *			 drive-coast (op_type=0) or drive-brake (op_type=1). Coast is lower performance
- *			 and lower power, brake is higher performance higher power.
+ *           well as adding the error times the integral gain to the integral term. It does
+ *           NOT update the position or setpoint variable of the motorDriver object. The drive
+ *			 can be either drive-coast (op_type=0) or drive-brake (op_type=1). Coast is lower
+ *			 performance and lower power, brake is higher performance higher power.
+ *
+ *			 The signals are worked out in 32 bits in 1/pwm_scale percent and limited
+ *			 before being divided by pwm_scale. Whatever is clipped off the linear or
+ *			 angular signal, divided by 2^aw_shift, is added to its integral term
+ *			 (back-calculation), so the integral stops growing while the output is
+ *			 saturated. The derivative terms act on the measurement, not the error, and
+ *			 are low pass filtered; see set_d_filter(). The linear one allows for the
+ *			 reference speed, so it doesn't hold the wheel back from following a moving
+ *			 setpoint.
  *  @param   en_p Enable proportional action input.
  *  @param   en_i Enable integral action input.
  *  @param   en_d Enable derivative action input.
  *	@param	 op_type Whether operation is drive-coast or drive-brake
  *	@var	 int16_t error_l Linear error term
  *	@var	 int16_t error_a Angular error term
- *	@var	 int16_t esum_l Linear cumulative error term
- *	@var	 int16_t esum_a Angular cumulative error term
- *	@var	 int16_t eder_l Linear error derivative term. Currently placeholder
- *	@var	 int16_t eder_a Angular error derivative term. Currently placeholder
- *	@var	 int16_t signal_l_p Proportional action term for linear action
- *	@var	 int16_t signal_l_i Integral action term for linear action
- *	@var	 int16_t signal_l_d Derivative action term for linear action
- *	@var	 int16_t signal_a_p Proportional action term for angular action
- *	@var	 int16_t signal_a_i Integral action term for angular action
- *	@var	 int16_t signal_a_d Derivative action term for angular action
- *	@var	 int16_t pwm_percent_linear Scaled PWM percentage due to linear control
- *	@var	 int16_t pwm_percent_angular Scaled PWM percentage due to angular control
+ *	@var	 int32_t integ_l Linear integral term, held to ki_l*esum_l_lim
+ *	@var	 int32_t integ_a Angular integral term, held to ki_a*esum_a_lim
+ *	@var	 int32_t deriv_l Filtered linear derivative term. The linear error is the distance
+ *				 left to go, which shrinks as fast as the wheel drives forwards, so its
+ *				 derivative is minus the wheel speed in ticks/s
+ *	@var	 int32_t deriv_a Filtered angular derivative term. The derivative of the angular
+ *				 error is minus the change in angle since the last run()
+ *	@var	 int32_t signal_l Linear signal before limiting
+ *	@var	 int32_t signal_a Angular signal before limiting
+ *	@var	 int32_t signal_l_lim Linear signal after limiting
+ *	@var	 int32_t signal_a_lim Angular signal after limiting
+ *	@var	 int16_t pwm_percent_linear PWM percentage due to linear control
+ *	@var	 int16_t pwm_percent_angular PWM percentage due to angular control
  *	@var	 int16_t pwm_percent Total angular actuation. This is what is sent to the motor
  *  @return  diag Struct of type diagnostic that holds motor's information to be passed to
- *				task_diag when unpacked by task_motor
+ *				task_diag when unpacked by task_motor. Its esum_ values are the integral
+ *				terms in percent
  */
 
 diagnostic motorDriver::run(bool en_p = 0, bool en_i = 0, bool en_d = 0, bool op_type = 0)
@@ -337,58 +463,110 @@ diagnostic motorDriver::run(bool en_p = 0, bool en_i = 0, bool en_d = 0, bool op
 	// Calculating error terms
    error_l = setpoint_l - position;
    error_a = setpoint_a - angle;
-   esum_l += error_l;
-   if (esum_l > esum_l_lim) // Rounding esum_l to esum_l_lim on either end
+   int16_t rate_a = angle_prev_valid ? angle - angle_prev : 0;
+   angle_prev = angle;
+   angle_prev_valid = true;
+
+   // Filtered derivatives on measurement, so a setpoint jump gives no kick. The linear
+   // one allows for the speed the setpoint is moving at, if it's given one
+   deriv_l += ((int32_t)kd_l*(velocity_ref - velocity) - deriv_l) >> d_filter_shift;
+   deriv_a += ((int32_t)kd_a*(-rate_a) - deriv_a) >> d_filter_shift;
+
+   // Limits in 1/pwm_scale percent
+   int32_t lim_linear = (int32_t)pwm_lim_linear*pwm_scale;
+   int32_t lim_angular = (int32_t)(pwm_lim - pwm_lim_linear)*pwm_scale;
+   int32_t integ_l_lim = (int32_t)ki_l*esum_l_lim;
+   int32_t integ_a_lim = (int32_t)ki_a*esum_a_lim;
+
+   // Calculating linear signal components
+   int32_t signal_l = 0;
+   if (en_p)
    {
-       esum_l = esum_l_lim;
-   } else if (esum_l < -esum_l_lim)
+	   signal_l += (int32_t)kp_l*error_l;
+   }
+   if (en_i)
    {
-       esum_l = -esum_l_lim;
+	   integ_l += (int32_t)ki_l*error_l;
+	   if (integ_l > integ_l_lim) // Rounding integ_l to its limit on either end
+	   {
+		   integ_l = integ_l_lim;
+	   } else if (integ_l < -integ_l_lim)
+	   {
+		   integ_l = -integ_l_lim;
+	   }
+	   signal_l += integ_l;
    }
-   esum_a += error_a;
-   if (esum_a > esum_a_lim) // Rounding esum_a to esum_a_lim on either end
+   if (en_d)
    {
-	   esum_a = esum_a_lim;
-   } else if (esum_a < -esum_a_lim)
+	   signal_l += deriv_l;
+   }
+   signal_l += ((int32_t)kv_l*velocity_ref + (int32_t)ka_l*accel_ref) >> 8;	// Feedforward
+   if (velocity_ref > 0)
    {
-	   esum_a = -esum_a_lim;
+	   signal_l += ks_l;
    }
-   eder_l = 0;  // Placeholder
-   eder_a = 0;  // Placeholder
-
-   // Calculating linear signal components
-   int16_t signal_l_p = kp_l*error_l;
-   int16_t signal_l_i = ki_l*esum_l;
-   int16_t signal_l_d = kd_l*eder_l;
-   int16_t pwm_percent_linear = (((int16_t) en_p)*signal_l_p + ((int16_t) en_i)*signal_l_i + ((int16_t) en_d)*signal_l_d)/pwm_scale;
-   if (pwm_percent_linear > pwm_lim_linear)	// Saturating linear component of pwm_percent
+   else if (velocity_ref < 0)
    {
-	   pwm_percent_linear = pwm_lim_linear;
+	   signal_l -= ks_l;
    }
-   else if (pwm_percent_linear < -pwm_lim_linear)
+   int32_t signal_l_lim = signal_l;
+   if (signal_l_lim > lim_linear)	// Saturating linear component of pwm_percent
    {
-	   pwm_percent_linear = -pwm_lim_linear;
-   } 
+	   signal_l_lim = lim_linear;
+   }
+   else if (signal_l_lim < -lim_linear)
+   {
+	   signal_l_lim = -lim_linear;
+   }
+   if (en_i)	// Winding back by what was clipped off
+   {
+	   integ_l += (signal_l_lim - signal_l) >> aw_shift;
+   }
 
    // Calculating angular signal components
-   int16_t signal_a_p = kp_a*error_a;
-   int16_t signal_a_i = ki_a*esum_a;
-   int16_t signal_a_d = kd_a*eder_a;
-   int16_t pwm_percent_angular = (((int16_t) en_p)*signal_a_p + ((int16_t) en_i)*signal_a_i + ((int16_t) en_d)*signal_a_d)*motor_dir/pwm_scale;	// This entire term needs to be either positive or negative depending on how we define the angle externally
-   if (pwm_percent_angular > (pwm_lim - pwm_lim_linear))	// Saturating angular component of pwm_percent
+   int32_t signal_a = 0;
+   if (en_p)
+   {
+	   signal_a += (int32_t)kp_a*error_a;
+   }
+   if (en_i)
+   {
+	   integ_a += (int32_t)ki_a*error_a;
+	   if (integ_a > integ_a_lim) // Rounding integ_a to its limit on either end
+	   {
+		   integ_a = integ_a_lim;
+	   } else if (integ_a < -integ_a_lim)
+	   {
+		   integ_a = -integ_a_lim;
+	   }
+	   signal_a += integ_a;
+   }
+   if (en_d)
    {
-	   pwm_percent_angular = pwm_lim - pwm_lim_linear;
+	   signal_a += deriv_a;
    }
-   else if (pwm_percent_angular < -(pwm_lim - pwm_lim_linear))
+   int32_t signal_a_lim = signal_a;
+   if (signal_a_lim > lim_angular)	// Saturating angular component of pwm_percent
    {
-	   pwm_percent_angular = -(pwm_lim - pwm_lim_linear);
+	   signal_a_lim = lim_angular;
    }
+   else if (signal_a_lim < -lim_angular)
+   {
+	   signal_a_lim = -lim_angular;
+   }
+   if (en_i)
+   {
+	   integ_a += (signal_a_lim - signal_a) >> aw_shift;
+   }
+
+   int16_t pwm_percent_linear = signal_l_lim/pwm_scale;
+   int16_t pwm_percent_angular = signal_a_lim*motor_dir/pwm_scale;	// This entire term needs to be either positive or negative depending on how we define the angle externally
    
    // Calculating total signal to motors
    int16_t pwm_percent = (pwm_percent_linear + pwm_percent_angular)*motor_dir;
    
    // Serial diagnostics
-   //*ser_out << "Motor " << motor_ID << " Signal P " << signal_l_p << " I " << signal_l_i << " esum " << esum_l << " D " << signal_l_d << " PWM % " << pwm_percent << endl;
+   //*ser_out << "Motor " << motor_ID << " Signal L " << signal_l << " I " << integ_l << " D " << deriv_l << " PWM % " << pwm_percent << endl;
    
    // Limiting total pwm percentage 
    if (pwm_percent > pwm_lim)	
@@ -428,8 +606,8 @@ diagnostic motorDriver::run(bool en_p = 0, bool en_i = 0, bool en_d = 0, bool op
    diag.pwm_tot = pwm_percent;
    diag.pwm_lin = pwm_percent_linear;
    diag.pwm_ang = pwm_percent_angular;
-   diag.esum_a_ = esum_a;
-   diag.esum_l_ = esum_l;
+   diag.esum_a_ = integ_a/pwm_scale;
+   diag.esum_l_ = integ_l/pwm_scale;
 
    return diag;
  }
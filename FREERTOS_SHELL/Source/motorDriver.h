@@ -6,6 +6,10 @@
  *  Revisions:
  *    11-26-18 RT Original file
  *	  12-5-18 RT Troubleshooting, added angular PID control
+ *	  10-18-26 Only includes what it uses, so it also builds in ../Sim
+ *	  10-18-26 Takes the wheel speed for the linear derivative term
+ *	  10-18-26 Filtered derivatives, back-calculation anti-windup, 32 bit products
+ *	  10-18-26 Speed, acceleration and static friction feedforward
  *
  *  Usage:
  *    This file is intended to be used on an XMEGA MCU, providing classes to run motors
@@ -35,18 +39,7 @@
 #include <asf.h>
 #include <stdlib.h>                         // Prototype declarations for I/O functions
 
-#include "FreeRTOS.h"                       // Primary header for FreeRTOS
-#include "task.h"                           // Header for FreeRTOS task functions
-#include "queue.h"                          // FreeRTOS inter-task communication queues
-
-#include "rs232int.h"                       // ME405/507 library for serial comm.
-#include "time_stamp.h"                     // Class to implement a microsecond timer
-#include "frt_task.h"                       // Header for ME405/507 base task class
-#include "frt_queue.h"                      // Header of wrapper for FreeRTOS queues
-#include "frt_text_queue.h"                 // Header for a "<<" queue class
-#include "frt_shared_data.h"                // Header for thread-safe shared data
-
-#include "shares.h"                         // Global ('extern') queue declarations
+#include "emstream.h"                       // Base class for the debugging serial port
 
 #include "math.h"
 
@@ -61,8 +54,14 @@ struct diagnostic		// Contains diagnostic information
 
 //-------------------------------------------------------------------------------------
 /** @brief   A PID closed-loop motor controller class.
- *  @details This class allows for closed-loop PI control of a DC motor through a
- *           motor driver chip. Class needs to be given pins for motor.
+ *  @details This class allows for closed-loop PID control of a DC motor through a
+ *           motor driver chip. Class needs to be given pins for motor. The integral
+ *           terms are wound back by however much the output is clipped, and the
+ *           derivative terms act on the measurement through a low pass filter. A
+ *           feedforward of kv_l/256 per tick/s of the reference speed and ka_l/256 per
+ *           tick/s^2 of its acceleration, plus ks_l in the direction it moves to get
+ *           past static friction, is added to the linear signal, so the feedback only
+ *           has to make up the difference.
  */
 class motorDriver
 {
@@ -84,15 +83,25 @@ class motorDriver
 		int16_t position;		// Current position of motor in encoder counts
 		int16_t angle;			// Current angle of motor
 		int16_t setpoint_a;		// Angular setpoint for motor
+		int16_t velocity;		// Speed of the wheel, positive forwards (ticks/s)
+		int16_t velocity_ref;	// Speed the reference is moving at (ticks/s)
+		int16_t accel_ref;		// Acceleration of the reference (ticks/s^2)
+		int16_t kv_l;			// Speed feedforward gain, 1/256ths
+		int16_t ka_l;			// Acceleration feedforward gain, 1/256ths
+		int16_t ks_l;			// Static friction feedforward
 		
 		int16_t motor_dir;		// Direction of motor. 1 or -1 depending on motor		
 
 		int16_t error_l;		// Positional error in encoder counts
-		int16_t	esum_l;			// Error sum for integral control
-		int16_t eder_l;			// Derivative of the linear error
+		int32_t integ_l;		// Linear integral term, in 1/pwm_scale percent
+		int32_t deriv_l;		// Filtered linear derivative term, in 1/pwm_scale percent
 		int16_t error_a;		// Angular error, units TBD
-		int16_t esum_a;			// Angular error integral
-		int16_t eder_a;			// Derivative of the angular error
+		int32_t integ_a;		// Angular integral term, in 1/pwm_scale percent
+		int32_t deriv_a;		// Filtered angular derivative term, in 1/pwm_scale percent
+		int16_t angle_prev;		// Angle at the last run(), for its rate of change
+		bool angle_prev_valid;	// False until run() has seen an angle
+		uint8_t d_filter_shift;	// Derivative filter moves 1/2^this of the way each pass
+		uint8_t aw_shift;		// Back-calculation gain is 1/2^this
 
 		int16_t pwm_lim;		// Total PWM percentage limit
 		int16_t pwm_lim_linear;	// Non-turning PWM percentage limit, pwm_lin_linear < pwm_lim
@@ -111,14 +120,20 @@ class motorDriver
 		void set_pwm_lim_linear(int16_t pwm_lim_linear_in);	// Sets the linear PWM limit, pwm_lim_linear
 		void set_esum_l_lim(int16_t esum_l_lim_in);	// Sets the linear error sum limit, esum_l_lim
 		void set_esum_a_lim(int16_t esum_a_lim_in);	// Sets the angular error sum limit, esum_a_lim
+		void set_d_filter(uint8_t d_filter_shift_in);	// Sets the derivative filter, d_filter_shift
+		void set_antiwindup(uint8_t aw_shift_in);	// Sets the back-calculation gain, aw_shift
+		void set_feedforward(int16_t kv_l_in, int16_t ka_l_in, int16_t ks_l_in);	// Sets the feedforward gains
 
 		void set_setpoint_l(int16_t setpoint_l_in);	// Sets the current linear setpoint for the motor
 		void set_setpoint_a(int16_t setpoint_l_in);	// Sets the current angular setpoint for the motor
 		void set_position(int16_t position_in);	// Sets the current position of the motor
 		void set_angle(int16_t angle_in);	// Sets the current angle of the motor
+		void set_velocity(int16_t velocity_in);	// Sets the current speed of the wheel
+		void set_velocity_ref(int16_t velocity_ref_in);	// Sets the reference speed
+		void set_accel_ref(int16_t accel_ref_in);	// Sets the reference acceleration
 
-		void zero_esum_l(void);		// Resets esum_l to zero
-		void zero_esum_a(void);		// Resets esum_a to zero 
+		void zero_esum_l(void);		// Resets integ_l and deriv_l to zero
+		void zero_esum_a(void);		// Resets integ_a and deriv_a to zero
 		diagnostic run(bool en_p, bool en_i, bool en_d, bool op_type);	// Calculates pwm signal. Needs to be told what control
 };
 
@@ -0,0 +1,188 @@
+//**************************************************************************************
+/** \file odometry.cpp
+ *    This file contains the encoder odometry of a 2wd robot with a caster wheel.
+ *
+ *  Revisions:
+ *    \li 12-05-2018 RGD - Odometry written in task Robot State.
+ *    \li 10-18-26 - Moved into a class of its own, with no RTOS or hardware calls.
+ *    \li 10-18-26 - 32 bit encoder counts, and the travel is worked out in 32 bits.
+ *    \li 10-18-26 - Midpoint integration of a 32 bit pose, with a binary angle heading.
+ *    \li 10-18-26 - The heading can be corrected, for the IMU fusion.
+ *    \li 10-18-26 - The position can be corrected, for the vision fusion.
+ *    \li 10-18-26 - The wheelbase is set at run time, from the parameter block.
+ *
+ *  License:
+ *    This file is copyright 2018 by RG Dunn and released under the Lesser GNU 
+ *    Public License, version 2. It intended for educational use only, but its use
+ *    is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include "odometry.h"                       // Header for this file
+
+
+//-------------------------------------------------------------------------------------
+/** This constructor creates an odometry object at the origin, with both encoders
+ *  taken to read zero.
+ */
+
+odometry::odometry (void)
+{
+	set_wheelbase (WHEELBASE_TICKS);
+	reset (0, 0);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method sets the wheelbase, from which the turn for one tick more on the right
+ *  wheel than the left is worked out. It's read by every update, so it should be set
+ *  before the odometry starts rather than while it runs.
+ *  @param wheelbase_ticks The distance between the wheels, in encoder ticks
+ */
+
+void odometry::set_wheelbase (int16_t wheelbase_ticks)
+{
+	if (wheelbase_ticks < 1)
+	{
+		wheelbase_ticks = WHEELBASE_TICKS;
+	}
+	heading_per_tick = (ODOMETRY_TURN_PER_RADIAN + wheelbase_ticks / 2) / wheelbase_ticks;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method puts the robot back at the origin, facing along the X axis.
+ *  @param enc1 Current count of the left encoder, positive forwards
+ *  @param enc2 Current count of the right encoder, positive forwards
+ */
+
+void odometry::reset (int32_t enc1, int32_t enc2)
+{
+	M_Enc1_Val_Prev = enc1;
+	M_Enc2_Val_Prev = enc2;
+	R_INERT_Heading = 0;
+	R_I_POS_X = 0;
+	R_I_POS_Y = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method moves the pose estimate on by the wheel travel since the last call.
+ *  The robot turns by the difference of the wheels' travel over the wheelbase, and
+ *  moves by the mean of their travel along the heading halfway through the turn. The
+ *  chord of an arc is shorter than the arc by a factor of sin(a/2)/(a/2), a being the
+ *  turn; called often enough that the turn is a few degrees at most, that's less than
+ *  a part in ten thousand, so it's left out.
+ *  @param enc1 Current count of the left encoder, positive forwards
+ *  @param enc2 Current count of the right encoder, positive forwards
+ */
+
+void odometry::update (int32_t enc1, int32_t enc2)
+{
+	//travel of each wheel since the last update (ticks)
+	int32_t M_1_DistTick = enc1 - M_Enc1_Val_Prev;
+	int32_t M_2_DistTick = enc2 - M_Enc2_Val_Prev;
+	M_Enc1_Val_Prev = enc1;
+	M_Enc2_Val_Prev = enc2;
+	if (M_1_DistTick == 0 && M_2_DistTick == 0)
+	{
+		return;		//standing still, nothing to do
+	}
+
+	//turn, and the heading halfway through it; both wrap round as binary angles do
+	uint32_t R_THETA_Delta = (uint32_t)((M_2_DistTick - M_1_DistTick) * heading_per_tick);
+	uint16_t R_Heading_Mid = (uint16_t)((R_INERT_Heading + (uint32_t)((int32_t)R_THETA_Delta / 2)) >> 16);
+	R_INERT_Heading += R_THETA_Delta;
+
+	//the sum of the wheels' travel is twice the robot's; the Q15 sine and cosine times
+	//that, shifted down by 16 - ODOMETRY_FRAC_BITS, is the travel along each axis
+	int32_t R_Travel_2 = M_1_DistTick + M_2_DistTick;
+	R_I_POS_X += (R_Travel_2 * fx_cos (R_Heading_Mid) + (1L << (15 - ODOMETRY_FRAC_BITS)))
+				 >> (16 - ODOMETRY_FRAC_BITS);
+	R_I_POS_Y += (R_Travel_2 * fx_sin (R_Heading_Mid) + (1L << (15 - ODOMETRY_FRAC_BITS)))
+				 >> (16 - ODOMETRY_FRAC_BITS);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method turns the heading by a correction worked out from another sensor, such
+ *  as the IMU. The position is left where it is; from then on it moves along the
+ *  corrected heading.
+ *  @param correction How far to turn the heading, CCW positive (binary angle)
+ */
+
+void odometry::correct_heading (int16_t correction)
+{
+	R_INERT_Heading += (uint32_t)((int32_t)correction << 16);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method moves the position by a correction worked out from another sensor, such
+ *  as the vision tracker. 
+ *  @param dx How far to move the position along X (ticks)
+ *  @param dy How far to move the position along Y (ticks)
+ */
+
+void odometry::correct_position (int16_t dx, int16_t dy)
+{
+	R_I_POS_X += (int32_t)dx << ODOMETRY_FRAC_BITS;
+	R_I_POS_Y += (int32_t)dy << ODOMETRY_FRAC_BITS;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function rounds a fixed point position to whole ticks.
+ *  @param position The position, with ODOMETRY_FRAC_BITS fraction bits
+ *  @return The position in ticks, limited to what fits in 16 bits
+ */
+
+static int16_t odometry_ticks (int32_t position)
+{
+	int32_t ticks = (position + (1L << (ODOMETRY_FRAC_BITS - 1))) >> ODOMETRY_FRAC_BITS;
+	return ((int16_t)((ticks > 32767) ? 32767 : (ticks < -32767) ? -32767 : ticks));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method gets the X position.
+ *  @return The position in the inertial frame (ticks)
+ */
+
+int16_t odometry::get_x (void)
+{
+	return odometry_ticks (R_I_POS_X);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method gets the Y position.
+ *  @return The position in the inertial frame (ticks)
+ */
+
+int16_t odometry::get_y (void)
+{
+	return odometry_ticks (R_I_POS_Y);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method gets the position and heading together.
+ *  @param pose Filled in with the pose
+ */
+
+void odometry::get_pose (odometry_pose& pose)
+{
+	pose.x = get_x ();
+	pose.y = get_y ();
+	pose.heading = get_heading ();
+}
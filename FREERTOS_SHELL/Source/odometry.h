@@ -0,0 +1,114 @@
+//**************************************************************************************
+/** \file odometry.h
+ *    This file contains header stuff for the encoder odometry of a 2wd robot with a
+ *    caster wheel. The math was split out of task_Robot_State so it can also be built
+ *    and run on a PC by the plant simulator in ../Sim.
+ *
+ *  Revisions:
+ *    \li 12-05-2018 RGD - Odometry written in task Robot State.
+ *    \li 10-18-26 - Moved into a class of its own, with no RTOS or hardware calls.
+ *    \li 10-18-26 - Takes 32 bit encoder counts, so a wrap of the 16 bit timers
+ *                   can't be mistaken for motion.
+ *    \li 10-18-26 - Midpoint integration of a 32 bit pose, with a binary angle heading.
+ *    \li 10-18-26 - The heading can be corrected, for the IMU fusion.
+ *    \li 10-18-26 - The position can be corrected, for the vision fusion.
+ *    \li 10-18-26 - The wheelbase is set at run time, from the parameter block.
+ *
+ *  License:
+ *    This file is copyright 2018 by RG Dunn and released under the Lesser GNU 
+ *    Public License, version 2. It intended for educational use only, but its use
+ *    is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _ODOMETRY_H_
+#define _ODOMETRY_H_
+
+#include <stdint.h>
+
+#include "fixed_math.h"					//Fixed point library for trignometric functions
+
+#define DELAYINTERVAL_MS 5    //This defines the interval that the task will run on.
+#define WHEELBASE_TICKS	531		//The wheelbase of the robot in ticks, unless the EEPROM has another
+
+#define ODOMETRY_FRAC_BITS 8	//Fraction bits of the positions kept by odometry
+
+/// A radian in 2^-32 turns; over the wheelbase, the heading change for one tick more
+/// on the right wheel than the left
+#define ODOMETRY_TURN_PER_RADIAN ((int32_t)(4294967296.0 / (2.0 * 3.14159265) + 0.5))
+
+/// The robot's pose, all from the same update
+struct odometry_pose
+{
+	int16_t x;				// Position in the inertial frame (ticks)
+	int16_t y;
+	uint16_t heading;		// Heading, CCW from the X axis (binary angle)
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   Dead reckoning of the robot's position from its two wheel encoders.
+ *  @details Each update takes the wheel travel since the last one as an arc, and moves
+ *           the robot along the chord of that arc, which points along the heading
+ *           halfway through the turn (midpoint integration). The heading is kept as a
+ *           32 bit binary angle, a whole turn being 2^32, so it wraps round by itself
+ *           and its top 16 bits are the binary angle fixed_math.h uses; the positions
+ *           are kept in 32 bits with ODOMETRY_FRAC_BITS fraction bits, so nothing is
+ *           lost to rounding between updates however small they are. Encoder counts
+ *           are taken so that positive is forwards on both sides; ENC1 is the left
+ *           side, ENC2 the right. The wheels must each go less than about 1600 ticks
+ *           between updates.
+ */
+
+class odometry
+{
+protected:
+	int32_t M_Enc1_Val_Prev;		// Encoder counts at the last update
+	int32_t M_Enc2_Val_Prev;
+	uint32_t R_INERT_Heading;		// Heading in the inertial frame (2^-32 turns)
+	int32_t R_I_POS_X;				// Position in the inertial frame (ticks, fixed point)
+	int32_t R_I_POS_Y;
+	int32_t heading_per_tick;		// Turn for one tick of difference (2^-32 turns)
+
+public:
+	// This constructor creates an odometry object at the origin
+	odometry (void);
+
+	// Sets the wheelbase, which the turn for a difference in the wheels' travel uses
+	void set_wheelbase (int16_t wheelbase_ticks);
+
+	// Starts again at the origin from the given encoder counts
+	void reset (int32_t enc1, int32_t enc2);
+
+	// Moves the estimate on by the encoder counts since the last call
+	void update (int32_t enc1, int32_t enc2);
+
+	// Turns the heading by a correction from another sensor
+	void correct_heading (int16_t correction);
+
+	// Moves the position by a correction from another sensor
+	void correct_position (int16_t dx, int16_t dy);
+
+	// Gets the position (ticks)
+	int16_t get_x (void);
+	int16_t get_y (void);
+
+	/** This method gets the heading.
+	 *  @return The heading, CCW from the X axis (binary angle)
+	 */
+	uint16_t get_heading (void) { return (uint16_t)(R_INERT_Heading >> 16); }
+
+	// Gets the position and heading together
+	void get_pose (odometry_pose& pose);
+};
+
+#endif // _ODOMETRY_H_
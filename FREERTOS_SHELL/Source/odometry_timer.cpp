@@ -0,0 +1,237 @@
+//**************************************************************************************
+/** \file odometry_timer.cpp
+ *    This file contains the timer which runs the odometry. See odometry_timer.h.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 The heading can be corrected, for the IMU fusion
+ *    \li 10-18-26 Runs off TCE1's compare channel B, leaving the RTOS tick alone
+ *    \li 10-18-26 The whole pose can be corrected, for the vision fusion
+ *    \li 10-18-26 The pose is published through a seqlock_data
+ *    \li 10-18-26 Takes the wheelbase, from the parameter block
+ *    \li 10-18-26 Says what port.c really does with TCE1
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include <avr/io.h>                         // Port I/O for SFR's
+#include <avr/interrupt.h>                  // For the timer's interrupt
+
+#include "FreeRTOS.h"                       // Primary header for FreeRTOS
+#include "task.h"                           // For the critical sections
+#include "frt_seqlock_data.h"               // The pose, read without critical sections
+
+#include "odometry_timer.h"
+
+#define ODOMETRY_TIMER TCE1					// The RTOS tick's timer; see odometry_timer.h
+#define ODOMETRY_COUNTS_PER_US (F_CPU / 1000000UL)
+
+/// The encoders, read only by the interrupt once the timer is started
+static QDEC_Ext_t* p_odometry_left = NULL;
+static QDEC_Ext_t* p_odometry_right = NULL;
+
+/// The pose estimate and the counts it was last moved on from; only the interrupt
+/// writes them once the timer is started
+static odometry odometry_estimate;
+static int32_t odometry_left_count = 0;
+static int32_t odometry_right_count = 0;
+
+/// The pose as of the latest update, for tasks to read; written by the interrupt, or by
+/// a correction with the interrupt held off, so there's only ever one writer at a time
+static seqlock_data<odometry_pose> odometry_published;
+
+/// Timer counts between updates
+static uint16_t odometry_period = 0;
+
+/// Timing so far, with the times in timer counts
+static odometry_timing odometry_counts;
+
+
+//-------------------------------------------------------------------------------------
+/** This function copies the pose estimate to where tasks read it. The caller has to be
+ *  the interrupt, or hold the interrupt off.
+ */
+
+static inline void odometry_timer_publish (void)
+{
+	odometry_pose pose;
+	odometry_estimate.get_pose (pose);
+	odometry_published.put (pose);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function sets up TCE1's compare channel B to interrupt at the given rate. The
+ *  RTOS tick already has the timer counting at the CPU clock, never cleared; the
+ *  tick's interrupt moves compare A on by a tick each time (in vPortYieldFromTick()
+ *  in port.c), and this one moves compare B on by the period, so neither disturbs
+ *  the other, and the period can be up to the 65536 counts the timer takes to wrap.
+ *  The tick moves compare A on with interrupts off, as the 16 bit registers go
+ *  through the timer's shared TEMP register, and this function does the same. The
+ *  interrupt is at the same low level as the tick and the encoders' overflow
+ *  interrupts. At a higher level it could cut into one of them between the wrap of the
+ *  count and the count of the wrap, and read the encoder a whole turn of the timer out.
+ *  @param p_left The left encoder's extended count
+ *  @param p_right The right encoder's extended count
+ *  @param rate_hz How many times a second to update the pose
+ *  @param wheelbase_ticks The distance between the wheels (ticks)
+ */
+
+void odometry_timer_start (QDEC_Ext_t* p_left, QDEC_Ext_t* p_right, uint16_t rate_hz,
+						   int16_t wheelbase_ticks)
+{
+	uint32_t counts = F_CPU / rate_hz;
+	if (counts > 0xFFFFUL)
+	{
+		counts = 0xFFFFUL;
+	}
+
+	ODOMETRY_TIMER.INTCTRLB &= ~TC1_CCBINTLVL_gm;
+
+	p_odometry_left = p_left;
+	p_odometry_right = p_right;
+	odometry_left_count = -1 * QDEC_Ext_Read (p_left);
+	odometry_right_count = QDEC_Ext_Read (p_right);
+	odometry_estimate.set_wheelbase (wheelbase_ticks);
+	odometry_estimate.reset (odometry_left_count, odometry_right_count);
+	odometry_timer_publish ();
+
+	odometry_period = (uint16_t)counts;
+	odometry_counts.period_us = (uint16_t)(counts / ODOMETRY_COUNTS_PER_US);
+	odometry_counts.isr_last_us = 0;
+	odometry_counts.isr_max_us = 0;
+	odometry_counts.runs = 0;
+
+	portENTER_CRITICAL ();					// The tick uses TEMP too
+	ODOMETRY_TIMER.CCB = ODOMETRY_TIMER.CNT + odometry_period;
+	ODOMETRY_TIMER.CTRLB |= TC1_CCBEN_bm;
+	ODOMETRY_TIMER.INTFLAGS = TC1_CCBIF_bm;	// Forget matches from before now
+	ODOMETRY_TIMER.INTCTRLB |= TC_CCBINTLVL_LO_gc;
+	portEXIT_CRITICAL ();
+}
+
+
+/** \cond NOT_ENABLED  (This ISR is not to be documented by Doxygen)
+ *  This interrupt moves the pose on by what the wheels have turned since the last one.
+ *  The next match is a whole period after this one was due, however late this one
+ *  ran, so the rate doesn't drift. The count in the timer at the end less the match
+ *  is how long ago the match was, so it's the time the interrupt took plus however
+ *  long it waited to start.
+ */
+ISR (TCE1_CCB_vect)
+{
+	uint16_t due = ODOMETRY_TIMER.CCB;
+	ODOMETRY_TIMER.CCB = due + odometry_period;
+
+	odometry_left_count = -1 * QDEC_Ext_Read (p_odometry_left);	// Positive forwards
+	odometry_right_count = QDEC_Ext_Read (p_odometry_right);
+	odometry_estimate.update (odometry_left_count, odometry_right_count);
+	odometry_timer_publish ();
+
+	uint16_t time = ODOMETRY_TIMER.CNT - due;
+	odometry_counts.isr_last_us = time;
+	if (time > odometry_counts.isr_max_us)
+	{
+		odometry_counts.isr_max_us = time;
+	}
+	odometry_counts.runs++;
+}
+/// \endcond
+
+
+//-------------------------------------------------------------------------------------
+/** This function gets the latest pose. It's copied again if the interrupt updates it
+ *  meanwhile, so the position and heading are all from the same update, but the
+ *  interrupt is never held off.
+ *  @param p_pose Where to put the pose
+ */
+
+void odometry_timer_pose (odometry_pose* p_pose)
+{
+	odometry_published.get (p_pose);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function turns the pose's heading by a correction from another sensor. The
+ *  interrupt is held off, so the correction isn't lost to an update going on at the
+ *  same time.
+ *  @param correction How far to turn the heading, CCW positive (binary angle)
+ */
+
+void odometry_timer_correct (int16_t correction)
+{
+	portENTER_CRITICAL ();
+	odometry_estimate.correct_heading (correction);
+	odometry_timer_publish ();
+	portEXIT_CRITICAL ();
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function moves and turns the pose by a correction from another sensor, all in
+ *  one go, so no update sees it half made.
+ *  @param dx How far to move the position along X (ticks)
+ *  @param dy How far to move the position along Y (ticks)
+ *  @param dheading How far to turn the heading, CCW positive (binary angle)
+ */
+
+void odometry_timer_correct_pose (int16_t dx, int16_t dy, int16_t dheading)
+{
+	portENTER_CRITICAL ();
+	odometry_estimate.correct_position (dx, dy);
+	odometry_estimate.correct_heading (dheading);
+	odometry_timer_publish ();
+	portEXIT_CRITICAL ();
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function gets the encoder counts the latest pose was worked out from, so that
+ *  tasks which need the counts too needn't read the encoders behind the interrupt's
+ *  back.
+ *  @param p_left Where to put the left count, positive forwards
+ *  @param p_right Where to put the right count, positive forwards
+ */
+
+void odometry_timer_counts (int32_t* p_left, int32_t* p_right)
+{
+	portENTER_CRITICAL ();
+	*p_left = odometry_left_count;
+	*p_right = odometry_right_count;
+	portEXIT_CRITICAL ();
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function gets the timing measured so far, converted to microseconds. The
+ *  longest time over the period is the most of the processor the odometry takes.
+ *  @param p_timing Where to put the figures
+ *  @param reset True to start measuring the maximum afresh
+ */
+
+void odometry_timer_stats (odometry_timing* p_timing, bool reset)
+{
+	portENTER_CRITICAL ();
+	*p_timing = odometry_counts;
+	if (reset)
+	{
+		odometry_counts.isr_max_us = 0;
+	}
+	portEXIT_CRITICAL ();
+
+	p_timing->isr_last_us /= ODOMETRY_COUNTS_PER_US;
+	p_timing->isr_max_us /= ODOMETRY_COUNTS_PER_US;
+}
@@ -0,0 +1,106 @@
+//**************************************************************************************
+/** \file odometry_timer.h
+ *    This file contains header stuff for the timer which runs the odometry. Compare
+ *    channel B of timer TCE1 interrupts at a fixed rate, faster than any task runs,
+ *    and its interrupt reads both encoders and moves the pose estimate on. TCE1 is the
+ *    RTOS tick's timer, which port.c starts at the CPU clock and never clears, so it
+ *    counts through all 65536 values; the tick's interrupt moves compare channel A on
+ *    by a tick each time, and this one moves channel B on by its own period, so the
+ *    two share the count without touching each other's channel. Tasks take a
+ *    copy of the pose, all from the same update, whenever they need it, so none of them
+ *    has to keep up with the encoders itself; the copy goes through a seqlock_data, so
+ *    taking it doesn't hold the interrupt off.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 The heading can be corrected, for the IMU fusion
+ *    \li 10-18-26 Runs off TCE1's compare channel B, leaving the RTOS tick alone
+ *    \li 10-18-26 The whole pose can be corrected, for the vision fusion
+ *    \li 10-18-26 The pose is published through a seqlock_data
+ *    \li 10-18-26 Takes the wheelbase, from the parameter block
+ *    \li 10-18-26 Says what port.c really does with TCE1
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _ODOMETRY_TIMER_H_
+#define _ODOMETRY_TIMER_H_
+
+#include <stdint.h>
+
+#include "qdec_driver.h"					// The encoders' 32 bit counts
+#include "odometry.h"						// The pose and the math which keeps it
+
+/** The rate at which the odometry runs. The shorter the step, the less the heading
+ *  changes in it and the closer the midpoint rule is to the true arc; at 500 Hz the
+ *  robot turns a fraction of a degree per step at full speed, and the interrupt takes
+ *  a few percent of the processor. Compare B's period is in counts of the CPU clock,
+ *  which port.c sets TCE1 to, and has to fit in 16 bits, so the rate can't be below
+ *  489 Hz (32 MHz / 65536); slower rates are run at that. It can be up to several kHz.
+ */
+#define ODOMETRY_RATE_HZ 500
+
+/// Timing of the odometry interrupt, as returned by odometry_timer_stats()
+struct odometry_timing
+{
+	uint16_t period_us;						// Period the timer is set to
+	uint16_t isr_last_us;					// Time from the overflow to the end of the
+	uint16_t isr_max_us;					// interrupt, last time and longest
+	uint32_t runs;							// Updates of the pose
+};
+
+/** This function starts the odometry at the origin from the encoders' current counts,
+ *  then starts the timer and its interrupt. The encoders must have been set up, with
+ *  their overflow interrupts, beforehand; from then on only the odometry interrupt may
+ *  read them. ENC1 is the left side and counts backwards going forwards.
+ *  @param p_left The left encoder's extended count
+ *  @param p_right The right encoder's extended count
+ *  @param rate_hz How many times a second to update the pose
+ *  @param wheelbase_ticks The distance between the wheels (ticks)
+ */
+void odometry_timer_start (QDEC_Ext_t* p_left, QDEC_Ext_t* p_right, uint16_t rate_hz,
+						   int16_t wheelbase_ticks);
+
+/** This function gets the latest pose.
+ *  @param p_pose Where to put the pose
+ */
+void odometry_timer_pose (odometry_pose* p_pose);
+
+/** This function turns the pose's heading by a correction from another sensor.
+ *  @param correction How far to turn the heading, CCW positive (binary angle)
+ */
+void odometry_timer_correct (int16_t correction);
+
+/** This function moves and turns the pose by a correction from another sensor.
+ *  @param dx How far to move the position along X (ticks)
+ *  @param dy How far to move the position along Y (ticks)
+ *  @param dheading How far to turn the heading, CCW positive (binary angle)
+ */
+void odometry_timer_correct_pose (int16_t dx, int16_t dy, int16_t dheading);
+
+/** This function gets the encoder counts the latest pose was worked out from.
+ *  @param p_left Where to put the left count, positive forwards
+ *  @param p_right Where to put the right count, positive forwards
+ */
+void odometry_timer_counts (int32_t* p_left, int32_t* p_right);
+
+/** This function gets the timing measured so far.
+ *  @param p_timing Where to put the figures
+ *  @param reset True to start measuring the maximum afresh
+ */
+void odometry_timer_stats (odometry_timing* p_timing, bool reset);
+
+#endif // _ODOMETRY_TIMER_H_
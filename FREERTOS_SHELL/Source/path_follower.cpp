@@ -0,0 +1,237 @@
+//**************************************************************************************
+/** \file path_follower.cpp
+ *    This file contains a pure pursuit path follower, which steers the robot along a
+ *    list of waypoints without stopping at each one.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 Reports how much longer the path has got, for the motion profile
+ *    \li 10-18-26 The wheelbase is set at run time, from the parameter block
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include "path_follower.h"                  // Header for this file
+
+
+//-------------------------------------------------------------------------------------
+/** This constructor makes a follower with no path. Until a waypoint is added, update()
+ *  asks for no movement.
+ *  @param lookahead_ticks Distance from the robot to the lookahead point
+ *  @param arrived_ticks Closer than this to the last waypoint, the robot is there
+ */
+
+path_follower::path_follower (int16_t lookahead_ticks, int16_t arrived_ticks)
+{
+	lookahead = lookahead_ticks;
+	arrived = arrived_ticks;
+	wheelbase = WHEELBASE_TICKS;
+	clear ();
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method forgets the path. The next waypoint added starts a new one from wherever
+ *  the robot is when update() is next called.
+ */
+
+void path_follower::clear (void)
+{
+	start.x = 0;
+	start.y = 0;
+	count = 0;
+	started = false;
+	seg_dx = 0;
+	seg_dy = 0;
+	seg_len = 0;
+	carrot = 0;
+	tail_len = 0;
+	added = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method adds a waypoint to the end of the path.
+ *  @param point The waypoint
+ *  @return True if it was added, false if PATH_WAYPOINTS are already held
+ */
+
+bool path_follower::add (const waypoint& point)
+{
+	if (count >= PATH_WAYPOINTS)
+	{
+		return (false);
+	}
+	if (count > 0)
+	{
+		int32_t length = fx_ihypot ((int32_t)point.x - points[count - 1].x,
+									(int32_t)point.y - points[count - 1].y);
+		tail_len += length;
+		added += length;
+	}
+	points[count++] = point;
+	return (true);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method works out the vector and length of the segment from the start point to
+ *  the first waypoint, and puts the lookahead point at its start.
+ */
+
+void path_follower::begin_segment (void)
+{
+	seg_dx = (int32_t)points[0].x - start.x;
+	seg_dy = (int32_t)points[0].y - start.y;
+	seg_len = fx_ihypot (seg_dx, seg_dy);
+	carrot = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method works out how to steer the robot along the path. It moves the lookahead
+ *  point on, onto the following segments if need be, then finds the bearing alpha of
+ *  the point from the robot's heading. Each wheel has to travel (wheelbase / 2) *
+ *  curvature * L, which is wheelbase * sin(alpha), more or less than the middle of the
+ *  robot to get there; that's the steering. The turn the drive can make at speed is
+ *  limited, so if the point is more than PATH_TURN_BRAD off the heading the robot
+ *  turns on the spot to face it first. Within the lookahead distance of the last
+ *  waypoint, the distance and steering are scaled by cos(alpha), so if the waypoint
+ *  is nearly behind, as it is when the robot has overshot, the robot backs up to it
+ *  rather than turning round.
+ *  @param x The robot's X position (ticks)
+ *  @param y The robot's Y position (ticks)
+ *  @param heading The robot's heading, CCW from the X axis (binary angle)
+ *  @return The distance to drive and the steering
+ */
+
+path_steering path_follower::update (int16_t x, int16_t y, uint16_t heading)
+{
+	path_steering steering;
+	steering.distance = 0;
+	steering.steer = 0;
+	steering.bearing = heading;
+	steering.done = (count == 0);
+	steering.turning = false;
+	steering.added = 0;
+
+	if (count == 0)
+	{
+		return (steering);
+	}
+	if (!started)
+	{
+		start.x = x;
+		start.y = y;
+		started = true;
+		begin_segment ();
+		added += seg_len;
+	}
+
+	// How far along the segment the robot is. The lookahead point is kept at least the
+	// lookahead distance ahead of that, but never moves back
+	int32_t along = 0;
+	if (seg_len > 0)
+	{
+		along = (((int32_t)x - start.x) * seg_dx + ((int32_t)y - start.y) * seg_dy) / seg_len;
+	}
+	if (along + lookahead > carrot)
+	{
+		carrot = along + lookahead;
+	}
+
+	// Past the end of the segment, the lookahead point goes round the corner onto the
+	// next one; with no next one it stops at the last waypoint
+	while (carrot >= seg_len && count > 1)
+	{
+		int32_t overrun = carrot - seg_len;
+		start = points[0];
+		for (uint8_t index = 1; index < count; index++)
+		{
+			points[index - 1] = points[index];
+		}
+		count--;
+		begin_segment ();
+		tail_len -= seg_len;
+		carrot = overrun;
+	}
+	bool last = (count == 1 && carrot >= seg_len);
+	if (carrot > seg_len)
+	{
+		carrot = seg_len;
+	}
+
+	// The lookahead point, and the way to it from the robot
+	int32_t carrot_x = start.x;
+	int32_t carrot_y = start.y;
+	if (seg_len > 0)
+	{
+		carrot_x += seg_dx * carrot / seg_len;
+		carrot_y += seg_dy * carrot / seg_len;
+	}
+	int32_t dx = carrot_x - x;
+	int32_t dy = carrot_y - y;
+	int32_t dist = fx_ihypot (dx, dy);
+	int32_t remaining = dist + (seg_len - carrot) + tail_len;
+
+	steering.bearing = fx_atan2 (dy, dx);
+	int16_t alpha = (int16_t)(steering.bearing - heading);
+	int16_t sin_alpha = fx_sin ((uint16_t)alpha);
+	int16_t cos_alpha = fx_sin ((uint16_t)(alpha + FX_BRAD_QUARTER));
+
+	bool sideways = (alpha > PATH_TURN_BRAD || alpha < -PATH_TURN_BRAD);
+	bool near_end = (last && dist < lookahead);
+	if (near_end && (alpha > 0x8000 - PATH_TURN_BRAD || alpha < PATH_TURN_BRAD - 0x8000))
+	{
+		sideways = false;					// Gone past it; back up rather than turn round
+	}
+
+	if (last && dist < arrived)
+	{
+		steering.done = true;				// Close enough; don't chase small errors
+		remaining = fx_mul_q15 (dist, cos_alpha);	// but don't drive away from it either
+	}
+	else if (sideways)
+	{
+		steering.steer = (alpha > 0) ? wheelbase : -wheelbase;
+		remaining = 0;						// Turn on the spot to face it
+		steering.turning = true;
+	}
+	else if (near_end)
+	{
+		// Near the last waypoint, drive forwards or backwards to it, whichever way
+		// the robot faces, steering the front or the back towards it
+		remaining = fx_mul_q15 (dist, cos_alpha);
+		steering.steer = (int16_t)fx_mul_q15 (fx_mul_q15 (wheelbase, sin_alpha),
+											  cos_alpha);
+	}
+	else
+	{
+		steering.steer = (int16_t)fx_mul_q15 (wheelbase, sin_alpha);
+	}
+
+	if (remaining > 32767)
+	{
+		remaining = 32767;
+	}
+	else if (remaining < -32767)
+	{
+		remaining = -32767;
+	}
+	steering.distance = (int16_t)remaining;
+	steering.added = (int16_t)((added > 32767) ? 32767 : added);
+	added = 0;
+	return (steering);
+}
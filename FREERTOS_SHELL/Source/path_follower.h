@@ -0,0 +1,130 @@
+//**************************************************************************************
+/** \file path_follower.h
+ *    This file contains header stuff for a pure pursuit path follower, which steers the
+ *    robot along a list of waypoints without stopping at each one. Like odometry.h it
+ *    has no RTOS or hardware calls, so the simulator can run it.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-18-26 Reports how much longer the path has got, for the motion profile
+ *    \li 10-18-26 The wheelbase is set at run time, from the parameter block
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _PATH_FOLLOWER_H_
+#define _PATH_FOLLOWER_H_
+
+#include <stdint.h>
+
+#include "fixed_math.h"					// Fixed point trig for the steering
+#include "odometry.h"					// For WHEELBASE_TICKS
+
+#define PATH_WAYPOINTS 4				// Waypoints held by the follower, the target included
+#define PATH_LOOKAHEAD_TICKS 250		// Default distance from the robot to the lookahead point
+#define PATH_ARRIVED_TICKS 20			// Closer than this to the last waypoint, stop steering
+#define PATH_TURN_BRAD 0x2000			// Further off the heading than this, turn on the spot
+
+/// A point in the inertial frame to drive through, in encoder ticks
+struct waypoint
+{
+	int16_t x;
+	int16_t y;
+};
+
+/// What the follower wants the motors to do
+struct path_steering
+{
+	int16_t distance;		// Path left to drive, negative if past the last waypoint (ticks)
+	int16_t steer;			// Travel of each wheel relative to the middle needed to reach the
+							// lookahead point, positive to turn left (ticks)
+	uint16_t bearing;		// Direction of the lookahead point from the robot (binary angle)
+	int16_t added;			// Length added to the path since the last update (ticks)
+	bool turning;			// True when the robot is to turn on the spot
+	bool done;				// True when there's no path or the robot is at its end
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   Follows a path of waypoints by pure pursuit.
+ *  @details The path runs from where the robot was when the first waypoint was given
+ *           through each waypoint in turn. The follower keeps a lookahead point on the
+ *           path and steers along the arc which joins the robot to it; the curvature of
+ *           that arc is 2 sin(alpha) / L, where alpha is the bearing of the point from
+ *           the robot's heading and L is the distance to it. The point only ever moves
+ *           forwards along the path, a little each update: it's kept at least the
+ *           lookahead distance ahead of where the robot is along the segment it's on,
+ *           and carries on round a corner onto the next segment without waiting for the
+ *           robot to reach the waypoint, so the robot cuts the corner and keeps going.
+ *
+ *           The distance given to the linear loop is what's left of the path from the
+ *           robot, through the lookahead point, to the last waypoint held, so the
+ *           robot only slows down for the last one. Waypoints given after the robot has
+ *           stopped at the last one start a new segment from it.
+ *
+ *           Positions are in encoder ticks and must stay within about 20000 ticks of
+ *           each other, so squared lengths fit in 32 bits.
+ */
+
+class path_follower
+{
+protected:
+	waypoint start;						// Start of the segment the lookahead point is on
+	waypoint points[PATH_WAYPOINTS];	// End of that segment, then the waypoints after it
+	uint8_t count;						// Number of waypoints in points[]
+	bool started;						// False until update() has set the start point
+	int32_t seg_dx;						// The segment's vector and length
+	int32_t seg_dy;
+	int32_t seg_len;
+	int32_t carrot;						// How far along the segment the lookahead point is
+	int32_t tail_len;					// Length of the path after the segment
+	int32_t added;						// Length added since the last update()
+	int16_t lookahead;					// Distance from the robot to the lookahead point
+	int16_t arrived;					// Closer than this to the last waypoint is there
+	int16_t wheelbase;					// Distance between the wheels (ticks)
+
+	void begin_segment (void);			// Works out the segment to points[0]
+
+public:
+	// This constructor makes a follower with no path, which holds the robot still
+	path_follower (int16_t lookahead_ticks = PATH_LOOKAHEAD_TICKS,
+				   int16_t arrived_ticks = PATH_ARRIVED_TICKS);
+
+	// Adds a waypoint to the end of the path; false if PATH_WAYPOINTS are already held
+	bool add (const waypoint& point);
+
+	// Forgets the path; the next waypoint starts from wherever the robot is then
+	void clear (void);
+
+	/** This method sets the wheelbase, which the steering is worked out from.
+	 *  @param wheelbase_ticks The distance between the wheels (ticks)
+	 */
+	void set_wheelbase (int16_t wheelbase_ticks) { wheelbase = wheelbase_ticks; }
+
+	/** This method tells whether there's room for another waypoint.
+	 *  @return True if add() will take one
+	 */
+	bool has_room (void) { return (count < PATH_WAYPOINTS); }
+
+	/** This method gets the waypoint the lookahead point is heading for.
+	 *  @return The waypoint, or the start of the path if there isn't one
+	 */
+	waypoint target (void) { return (count ? points[0] : start); }
+
+	// Works out how to steer from the robot's current position and heading
+	path_steering update (int16_t x, int16_t y, uint16_t heading);
+};
+
+#endif // _PATH_FOLLOWER_H_
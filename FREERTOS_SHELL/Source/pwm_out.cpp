@@ -0,0 +1,106 @@
+//**************************************************************************************
+/** \file pwm_out.cpp
+ *    This file contains the setup of timer TCC0, which makes the motors' PWM signals.
+ *    The duty cycles are written by pwm_out_write() in pwm_out.h.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include "pwm_out.h"
+
+/// Prescalers TCC0 can use, smallest first, with their clock selections
+static const struct
+{
+	uint16_t divide;
+	TC_CLKSEL_t clock;
+} pwm_out_prescales[] =
+{
+	{ 1, TC_CLKSEL_DIV1_gc },
+	{ 2, TC_CLKSEL_DIV2_gc },
+	{ 4, TC_CLKSEL_DIV4_gc },
+	{ 8, TC_CLKSEL_DIV8_gc },
+	{ 64, TC_CLKSEL_DIV64_gc },
+	{ 256, TC_CLKSEL_DIV256_gc },
+	{ 1024, TC_CLKSEL_DIV1024_gc }
+};
+
+/// Counts in a PWM period; zero until the timer has been set up
+static uint16_t pwm_out_counts = 0;
+
+
+//-------------------------------------------------------------------------------------
+/** This function sets up TCC0 for single slope PWM on all four compare channels. The
+ *  timer counts from 0 to PER, so PER is one less than the period; an output is high
+ *  from the start of the period until the count reaches its compare value. A compare
+ *  value of zero holds the output low and one above PER holds it high.
+ *  @param freq_hz The PWM frequency
+ *  @return True if the frequency could be made with at least PWM_OUT_MIN_PERIOD counts
+ */
+
+bool pwm_out_init (uint16_t freq_hz)
+{
+	const uint8_t num_prescales = sizeof (pwm_out_prescales) / sizeof (pwm_out_prescales[0]);
+	uint32_t counts = 0;
+	uint8_t index;
+
+	pwm_out_counts = 0;
+	if (freq_hz == 0)
+	{
+		return (false);
+	}
+	for (index = 0; index < num_prescales; index++)
+	{
+		counts = F_CPU / pwm_out_prescales[index].divide / freq_hz;
+		if (counts <= 0xFFFFUL)
+		{
+			break;
+		}
+	}
+	if (index == num_prescales || counts < PWM_OUT_MIN_PERIOD)
+	{
+		return (false);
+	}
+
+	PORTC.DIRSET = PIN0_bm | PIN1_bm | PIN2_bm | PIN3_bm;
+
+	TCC0.CTRLA = TC_CLKSEL_OFF_gc;
+	TCC0.CTRLB = TC0_CCAEN_bm | TC0_CCBEN_bm | TC0_CCCEN_bm | TC0_CCDEN_bm
+				 | TC_WGMODE_SS_gc;
+	TCC0.CNT = 0;
+	TCC0.PER = (uint16_t)(counts - 1);
+	TCC0.CCA = 0;
+	TCC0.CCB = 0;
+	TCC0.CCC = 0;
+	TCC0.CCD = 0;
+	pwm_out_write (0, 0, 0, 0);
+	TCC0.CTRLA = pwm_out_prescales[index].clock;
+
+	pwm_out_counts = (uint16_t)counts;
+	return (true);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function gets the number of timer counts in a PWM period.
+ *  @return The period, or zero if the timer isn't set up
+ */
+
+uint16_t pwm_out_period (void)
+{
+	return (pwm_out_counts);
+}
@@ -0,0 +1,78 @@
+//**************************************************************************************
+/** \file pwm_out.h
+ *    This file contains header stuff for the motors' PWM outputs. Timer TCC0 makes
+ *    four single slope PWM signals on pins PC0 to PC3, the IN1 and IN2 inputs of the
+ *    two H-bridges. The period is worked out once when the timer is set up, and duty
+ *    cycles are given in timer counts and written straight into the compare buffer
+ *    registers, rather than through ASF's pwm_start(), which works out the count from
+ *    a whole percentage with a 32 bit multiply and divide and rewrites the period and
+ *    clock source on every call.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _PWM_OUT_H_
+#define _PWM_OUT_H_
+
+#include <stdint.h>
+#include <avr/io.h>
+
+/** The PWM frequency of the motors, as motorDriver has always used. At 32 MHz the
+ *  timer runs undivided with a period of 64000 counts.
+ */
+#define PWM_OUT_FREQ_HZ 500
+
+/// The shortest period allowed, so there are at least whole percent steps
+#define PWM_OUT_MIN_PERIOD 100
+
+/** This function sets up TCC0 for single slope PWM at the given frequency with all
+ *  four outputs low, picking the smallest prescaler which fits the period in 16 bits.
+ *  @param freq_hz The PWM frequency
+ *  @return True if the frequency could be made with at least PWM_OUT_MIN_PERIOD counts
+ */
+bool pwm_out_init (uint16_t freq_hz);
+
+/** This function gets the number of timer counts in a PWM period. A duty cycle of this
+ *  many counts or more is fully on.
+ *  @return The period, or zero if pwm_out_init() failed or hasn't been called
+ */
+uint16_t pwm_out_period (void);
+
+/** This function sets the duty cycles of all four outputs, in timer counts. The
+ *  compare buffers are copied into the compare registers by the hardware when the
+ *  timer overflows, so a period never sees part of an old duty cycle and part of a
+ *  new one. The copy is held off (LUPD) while the buffers are written, so all four
+ *  new duty cycles start in the same period.
+ *  @param in1_left Duty cycle of the left motor's IN1, channel A
+ *  @param in2_left Duty cycle of the left motor's IN2, channel B
+ *  @param in1_right Duty cycle of the right motor's IN1, channel C
+ *  @param in2_right Duty cycle of the right motor's IN2, channel D
+ */
+inline void pwm_out_write (uint16_t in1_left, uint16_t in2_left,
+						   uint16_t in1_right, uint16_t in2_right)
+{
+	TCC0.CTRLFSET = TC0_LUPD_bm;
+	TCC0.CCABUF = in1_left;
+	TCC0.CCBBUF = in2_left;
+	TCC0.CCCBUF = in1_right;
+	TCC0.CCDBUF = in2_right;
+	TCC0.CTRLFCLR = TC0_LUPD_bm;
+}
+
+#endif // _PWM_OUT_H_
@@ -62,6 +62,8 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  *****************************************************************************/
 
+#include <avr/interrupt.h>
+
 #include "qdec_driver.h"
 
 /*! \brief Wrapperfunction to set up all parameters for the quadrature decoder.
@@ -272,6 +274,57 @@ void QDEC_TC_Freq_Setup(TC0_t * qTimer,
 }
 
 
+/*! \brief This function sets up a Timer/Counter to time the edges of two
+ *         encoders, one on each of capture channels A and B.
+ *
+ *  Unlike QDEC_TC_Freq_Setup(), the counter runs freely and is not reset by
+ *  the edges, so one timer serves two encoders. With the pins sensing levels,
+ *  as the decoder needs, each rising edge of an encoder's QDPH0 input (one per
+ *  line, or four counts) captures the count, as in QDEC_TC_Freq_Setup();
+ *  QDEC_Period_Capture() works out the time since the one before. Event channels qEvMux and qEvMux + 1 must not be in use by
+ *  the quadrature decoders themselves.
+ *
+ * \param qTimer      The timer to use for capture.
+ * \param qEvMux      First of the two event channels to use, 0 to 6.
+ * \param qPinInputA  The pin input of the first encoder's QDPH0.
+ * \param qPinInputB  The pin input of the second encoder's QDPH0.
+ * \param clksel      The clk div to use for timer.
+ * \param intLevel    Level of the capture and overflow interrupts, 1 to 3.
+ *
+ * \return bool       True if setup was ok, false if any errors.
+ */
+bool QDEC_TC_Period_Setup(TC0_t * qTimer,
+                          uint8_t qEvMux,
+                          EVSYS_CHMUX_t qPinInputA,
+                          EVSYS_CHMUX_t qPinInputB,
+                          TC_CLKSEL_t clksel,
+                          uint8_t intLevel)
+{
+	if (qEvMux > 6 || intLevel < 1 || intLevel > 3){
+		return false;
+	}
+
+	/* The channels are in pairs of MUX and CTRL registers, 8 of each. */
+	(&EVSYS.CH0MUX)[qEvMux] = qPinInputA;
+	(&EVSYS.CH0CTRL)[qEvMux] = EVSYS_DIGFILT_4SAMPLES_gc;
+	(&EVSYS.CH0MUX)[qEvMux + 1] = qPinInputB;
+	(&EVSYS.CH0CTRL)[qEvMux + 1] = EVSYS_DIGFILT_4SAMPLES_gc;
+
+	/* Configure TC to capture on channel A from qEvMux and B from the next. */
+	qTimer->CTRLA = TC_CLKSEL_OFF_gc;
+	qTimer->CTRLD = (uint8_t) TC_EVACT_CAPT_gc | (TC_EVSEL_CH0_gc + qEvMux);
+	qTimer->PER = 0xFFFF;
+	qTimer->CNT = 0;
+	qTimer->CTRLB = TC0_CCAEN_bm | TC0_CCBEN_bm;
+	qTimer->INTFLAGS = TC0_OVFIF_bm | TC0_CCAIF_bm | TC0_CCBIF_bm;
+	qTimer->INTCTRLA = (qTimer->INTCTRLA & ~TC0_OVFINTLVL_gm) | (intLevel << TC0_OVFINTLVL_gp);
+	qTimer->INTCTRLB = (intLevel << TC0_CCAINTLVL_gp) | (intLevel << TC0_CCBINTLVL_gp);
+	qTimer->CTRLA = clksel;
+
+	return true;
+}
+
+
 /*! \brief This function return the direction of the counter/QDEC.
  *
  * \param qTimer      The timer used for QDEC.
@@ -303,4 +356,154 @@ uint16_t QDEC_Read_TC(TC1_t *qTimer)
 	return combined;
 }
 
-/* \brief This function returns the current value of the specified timer class. */
\ No newline at end of file
+/* \brief This function returns the current value of the specified timer class. */
+
+/*! \brief This function starts keeping a 32 bit count for a quadrature decoder
+ *         which has already been set up with a period of 0xFFFF.
+ *
+ *  The count starts from whatever the timer holds now. The caller must also
+ *  provide the timer's overflow interrupt, which calls QDEC_Ext_Overflow().
+ *
+ * \param qExt      The extended count to keep.
+ * \param qTimer    The timer used for QDEC.
+ * \param intLevel  Level of the timer's overflow interrupt.
+ */
+void QDEC_Ext_Setup(QDEC_Ext_t * qExt, TC0_t * qTimer, TC_OVFINTLVL_t intLevel)
+{
+	uint8_t sreg = SREG;
+	cli();
+	qExt->qTimer = qTimer;
+	qExt->wraps = 0;
+	qTimer->INTFLAGS = TC0_OVFIF_bm;
+	qTimer->INTCTRLA = (qTimer->INTCTRLA & ~TC0_OVFINTLVL_gm) | intLevel;
+	SREG = sreg;
+}
+
+void QDEC_Ext_Setup(QDEC_Ext_t * qExt, TC1_t * qTimer, TC_OVFINTLVL_t intLevel)
+{
+	QDEC_Ext_Setup(qExt, (TC0_t *)qTimer, intLevel);
+}
+
+/*! \brief This function is called from the timer's overflow interrupt to count a
+ *         wrap of the decoder.
+ *
+ *  An overflow and an underflow set the same flag. Just after counting up past
+ *  0xFFFF the count is small, and just after counting down past 0 it is large,
+ *  so the count tells which it was as long as the interrupt is served within
+ *  half a turn of the counter.
+ *
+ * \param qExt      The extended count.
+ */
+void QDEC_Ext_Overflow(QDEC_Ext_t * qExt)
+{
+	if (qExt->qTimer->CNT < 0x8000)
+	{
+		qExt->wraps++;
+	}
+	else
+	{
+		qExt->wraps--;
+	}
+}
+
+/*! \brief This function returns the 32 bit count of a quadrature decoder.
+ *
+ *  The count and the wraps are read together with interrupts off. If the
+ *  counter has wrapped but the interrupt hasn't been served yet, the wrap is
+ *  counted here too, so no counts are lost however long ago the last read was.
+ *
+ * \param qExt      The extended count.
+ *
+ * \return int32_t  The count, from when QDEC_Ext_Setup() was called plus the
+ *                  timer's count then.
+ */
+int32_t QDEC_Ext_Read(QDEC_Ext_t * qExt)
+{
+	uint8_t sreg = SREG;
+	cli();
+	uint16_t count = qExt->qTimer->CNT;
+	int16_t wraps = qExt->wraps;
+	if (qExt->qTimer->INTFLAGS & TC0_OVFIF_bm)
+	{
+		count = qExt->qTimer->CNT;
+		wraps += (count < 0x8000) ? 1 : -1;
+	}
+	SREG = sreg;
+	return ((int32_t)wraps << 16) | count;
+}
+
+/*! \brief This function starts timing the edges of one encoder.
+ *
+ * \param qPeriod   The edge timing to keep.
+ * \param qTimer    The timer set up by QDEC_TC_Period_Setup().
+ */
+void QDEC_Period_Init(QDEC_Period_t * qPeriod, TC0_t * qTimer)
+{
+	uint8_t sreg = SREG;
+	cli();
+	qPeriod->qTimer = qTimer;
+	qPeriod->last = 0;
+	qPeriod->period = QDEC_PERIOD_NONE;
+	qPeriod->wraps = 2;
+	SREG = sreg;
+}
+
+/*! \brief This function is called from the capture interrupt at each edge.
+ *
+ * \param qPeriod   The edge timing.
+ * \param capture   The capture register, CCA or CCB.
+ */
+void QDEC_Period_Capture(QDEC_Period_t * qPeriod, uint16_t capture)
+{
+	uint8_t wraps = qPeriod->wraps;
+	if (wraps == 0 || (wraps == 1 && capture < qPeriod->last))
+	{
+		qPeriod->period = capture - qPeriod->last;
+	}
+	else
+	{
+		qPeriod->period = QDEC_PERIOD_NONE;
+	}
+	qPeriod->last = capture;
+	qPeriod->wraps = 0;
+}
+
+/*! \brief This function is called from the timer's overflow interrupt.
+ *
+ * \param qPeriod   The edge timing.
+ */
+void QDEC_Period_Overflow(QDEC_Period_t * qPeriod)
+{
+	if (qPeriod->wraps < 2)
+	{
+		qPeriod->wraps++;
+	}
+}
+
+/*! \brief This function gets the time between the last two edges, and the time
+ *         since the last one, in timer counts.
+ *
+ *  Once the encoder stops, the period stays at its last value; the age tells
+ *  that no edge has come for a while.
+ *
+ * \param qPeriod   The edge timing.
+ * \param period    Where to put the period.
+ * \param age       Where to put the time since the last edge.
+ */
+void QDEC_Period_Read(QDEC_Period_t * qPeriod, uint16_t * period, uint16_t * age)
+{
+	uint8_t sreg = SREG;
+	cli();
+	uint16_t now = qPeriod->qTimer->CNT;
+	uint8_t wraps = qPeriod->wraps;
+	*period = qPeriod->period;
+	if (wraps == 0 || (wraps == 1 && now < qPeriod->last))
+	{
+		*age = now - qPeriod->last;
+	}
+	else
+	{
+		*age = QDEC_PERIOD_NONE;
+	}
+	SREG = sreg;
+}
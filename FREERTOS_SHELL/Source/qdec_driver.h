@@ -80,6 +80,38 @@ extern "C" {
 #define GetCaptureValue(_tc)  ( _tc.CCA )
 
 
+/*! \brief Software extension of a quadrature decoder's count to 32 bits.
+ *
+ *  The timer must count over its full range (PER = 0xFFFF). Every time the count
+ *  wraps, the timer's overflow interrupt must call QDEC_Ext_Overflow(), and the high
+ *  16 bits are kept in \c wraps. A TC1 is kept as a TC0 pointer; the registers used
+ *  are at the same place in both.
+ */
+typedef struct QDEC_Ext_struct
+{
+	TC0_t * qTimer;             /* The timer doing the decoding. */
+	volatile int16_t wraps;     /* Wraps of the count so far, positive upwards. */
+} QDEC_Ext_t;
+
+
+/*! \brief Time between edges of one encoder, measured by a capture channel.
+ *
+ *  The capture and overflow interrupts of the timer set up by
+ *  QDEC_TC_Period_Setup() must call QDEC_Period_Capture() and
+ *  QDEC_Period_Overflow(). A period or age of QDEC_PERIOD_NONE means it was
+ *  longer than the timer can measure.
+ */
+typedef struct QDEC_Period_struct
+{
+	TC0_t * qTimer;             /* The capture timer. */
+	volatile uint16_t last;     /* Timer count at the last edge. */
+	volatile uint16_t period;   /* Timer counts between the last two edges. */
+	volatile uint8_t wraps;     /* Timer wraps since the last edge, up to 2. */
+} QDEC_Period_t;
+
+#define QDEC_PERIOD_NONE 0xFFFF
+
+
 /* Prototyping of functions. */
 
 bool QDEC_Total_Setup(PORT_t * qPort,
@@ -120,11 +152,27 @@ void QDEC_TC_Freq_Setup(TC0_t * qTimer,
                         TC_EVSEL_t qEventChannel,
                         EVSYS_CHMUX_t qPinInput,
                         TC_CLKSEL_t clksel);
+bool QDEC_TC_Period_Setup(TC0_t * qTimer,
+                          uint8_t qEvMux,
+                          EVSYS_CHMUX_t qPinInputA,
+                          EVSYS_CHMUX_t qPinInputB,
+                          TC_CLKSEL_t clksel,
+                          uint8_t intLevel);
 
 uint8_t QDEC_Get_Direction(TC0_t * qTimer);
 uint16_t QDEC_Read_TC(TC0_t * qTimer);
 uint16_t QDEC_Read_TC(TC1_t *qTimer);
 
+void QDEC_Ext_Setup(QDEC_Ext_t * qExt, TC0_t * qTimer, TC_OVFINTLVL_t intLevel);
+void QDEC_Ext_Setup(QDEC_Ext_t * qExt, TC1_t * qTimer, TC_OVFINTLVL_t intLevel);
+void QDEC_Ext_Overflow(QDEC_Ext_t * qExt);
+int32_t QDEC_Ext_Read(QDEC_Ext_t * qExt);
+
+void QDEC_Period_Init(QDEC_Period_t * qPeriod, TC0_t * qTimer);
+void QDEC_Period_Capture(QDEC_Period_t * qPeriod, uint16_t capture);
+void QDEC_Period_Overflow(QDEC_Period_t * qPeriod);
+void QDEC_Period_Read(QDEC_Period_t * qPeriod, uint16_t * period, uint16_t * age);
+
 #endif /* __QDEC_DRIVER_H__ */
 
 /*
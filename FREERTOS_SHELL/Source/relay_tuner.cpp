@@ -0,0 +1,167 @@
+//**************************************************************************************
+/** \file relay_tuner.cpp
+ *    This file contains a relay feedback autotuner for one control loop. See
+ *    relay_tuner.h.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include "relay_tuner.h"                    // Header for this file
+
+
+//-------------------------------------------------------------------------------------
+/** This constructor creates a tuner with no experiment running, so update() gives no
+ *  signal until start() is called.
+ */
+
+relay_tuner::relay_tuner (void)
+{
+	start (0, 0, 0);
+	finished = true;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method starts an experiment. The relay switches about the measurement as it is
+ *  now, starting on the positive side.
+ *  @param y The measurement now
+ *  @param relay_amplitude The relay's signal, d, which should be positive
+ *  @param relay_hysteresis How far past the starting point the measurement has to go
+ *         before the relay switches, in the measurement's units
+ */
+
+void relay_tuner::start (int32_t y, int16_t relay_amplitude, int16_t relay_hysteresis)
+{
+	centre = y;
+	amplitude = relay_amplitude;
+	hysteresis = relay_hysteresis;
+	high = true;
+	finished = false;
+	rose = false;
+	passes = 0;
+	last_rise = 0;
+	y_max = y;
+	y_min = y;
+	cycles = 0;
+	measured = 0;
+	period_sum = 0;
+	swing_sum = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method runs the relay for one pass. It should be called once each pass of the
+ *  control loop, in place of the controller, until done() says it's over.
+ *  @param y The measurement this pass
+ *  @return The signal to drive the loop with this pass: plus or minus d, or zero once
+ *          it's over
+ */
+
+int16_t relay_tuner::update (int32_t y)
+{
+	if (finished)
+	{
+		return (0);
+	}
+	if (++passes >= RELAY_PASSES_MAX)
+	{
+		finished = true;					// No oscillation; gains() says so
+		return (0);
+	}
+
+	if (y > y_max)
+	{
+		y_max = y;
+	}
+	if (y < y_min)
+	{
+		y_min = y;
+	}
+
+	int32_t error = centre - y;
+	if (high && error < -hysteresis)
+	{
+		high = false;
+	}
+	else if (!high && error > hysteresis)
+	{
+		// Switching to high ends a cycle, unless it's the first time
+		high = true;
+		if (rose && ++cycles > RELAY_SKIP_CYCLES)
+		{
+			period_sum += passes - last_rise;
+			swing_sum += y_max - y_min;
+			if (++measured >= RELAY_CYCLES)
+			{
+				finished = true;
+				return (0);
+			}
+		}
+		rose = true;
+		last_rise = passes;
+		y_max = y;
+		y_min = y;
+	}
+
+	return (high ? amplitude : -amplitude);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method works out PI gains from the ultimate gain and period. With the swing
+ *  summed over m cycles as S, Ku = 4d / (pi a) = 8 d m / (pi S); pi is taken as
+ *  355/113. The integral gain is kp times the pass time over the integral time, so
+ *  kp * m / (RELAY_TI_NUM / RELAY_TI_DEN * the passes in m cycles). kp is worked out
+ *  in sixteenths first, so ki isn't rounded twice; that fits in 32 bits for relay
+ *  signals up to 7000. Neither gain is let go below one: the integral has to be able to
+ *  get past static friction.
+ *  @param kp Where to put the proportional gain
+ *  @param ki Where to put the integral gain, added each pass
+ *  @return True if the gains were worked out, false if the experiment didn't finish
+ *          or didn't see the loop move
+ */
+
+bool relay_tuner::gains (int16_t& kp, int16_t& ki)
+{
+	if (!finished || measured < RELAY_CYCLES || swing_sum <= 0 || period_sum == 0)
+	{
+		return (false);
+	}
+
+	int32_t ku_num = 8L * amplitude * measured * 113;
+	int32_t kp_den = 355L * swing_sum * RELAY_KP_DEN;
+	int32_t kp16 = (ku_num * 16 * RELAY_KP_NUM + kp_den / 2) / kp_den;
+	if (kp16 > 32767L * 16)
+	{
+		kp16 = 32767L * 16;
+	}
+	int32_t ki_den = 16L * period_sum * RELAY_TI_NUM;
+	int32_t ki_32 = (kp16 * RELAY_TI_DEN * measured + ki_den / 2) / ki_den;
+
+	kp = (int16_t)((kp16 + 8) >> 4);
+	ki = (int16_t)ki_32;
+	if (kp < 1)
+	{
+		kp = 1;
+	}
+	if (ki < 1)
+	{
+		ki = 1;
+	}
+	return (true);
+}
@@ -0,0 +1,109 @@
+//**************************************************************************************
+/** \file relay_tuner.h
+ *    This file contains header stuff for a relay feedback autotuner, which finds the
+ *    ultimate gain and period of a control loop and works out PI gains from them.
+ *    Like odometry.h it has no RTOS or hardware calls, so the simulator can run it.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _RELAY_TUNER_H_
+#define _RELAY_TUNER_H_
+
+#include <stdint.h>
+
+#define RELAY_SKIP_CYCLES 2					// Cycles let go by while the oscillation settles
+#define RELAY_CYCLES 4						// Cycles measured after those
+#define RELAY_PASSES_MAX 1000				// Gives up if not done in this many passes
+
+// Tyreus-Luyben PI rule: kp = Ku * RELAY_KP_NUM / RELAY_KP_DEN, and an integral time of
+// Tu * RELAY_TI_NUM / RELAY_TI_DEN
+#define RELAY_KP_NUM 5
+#define RELAY_KP_DEN 16
+#define RELAY_TI_NUM 22
+#define RELAY_TI_DEN 10
+
+//-------------------------------------------------------------------------------------
+/** @brief   Relay feedback (Astrom-Hagglund) experiment on one control loop.
+ *  @details In place of the controller, a relay drives the loop with plus or minus a
+ *           fixed signal d, switching each time the measurement crosses the point it
+ *           started from, give or take a little hysteresis. Nearly any motor settles
+ *           into an oscillation like that, at the frequency where the loop's phase lag
+ *           is half a turn. The relay's first harmonic is 4d/pi, so if the measurement
+ *           swings by plus or minus a, the loop's gain there is pi a / 4d, and a
+ *           proportional controller of gain Ku = 4d / (pi a) would just keep it
+ *           oscillating, with the period Tu the relay found.
+ *
+ *           After RELAY_SKIP_CYCLES cycles, the period and swing are summed over
+ *           RELAY_CYCLES more and averaged; a cycle runs from one switch of the relay
+ *           to the positive side to the next. The PI gains come from Ku and Tu by the
+ *           Tyreus-Luyben rule, which has less overshoot than Ziegler-Nichols. They
+ *           are in the units the loop's controller uses: the gains multiply an error
+ *           in the measurement's units to give a signal in the relay's, and the
+ *           integral gain is what's added each pass, as drive_pair uses it.
+ */
+
+class relay_tuner
+{
+protected:
+	int32_t centre;					// The measurement when the experiment started
+	int16_t amplitude;				// The relay's signal, d
+	int16_t hysteresis;				// How far past centre before the relay switches
+	bool high;						// True while the relay is on the positive side
+	bool finished;					// True once measured, or given up
+	bool rose;						// True once the relay has switched to high once
+	uint16_t passes;				// Passes since the start
+	uint16_t last_rise;				// Pass at which the relay last switched to high
+	int32_t y_max;					// Highest and lowest measurement this cycle
+	int32_t y_min;
+	uint8_t cycles;					// Whole cycles seen
+	uint8_t measured;				// Cycles in the sums below
+	uint16_t period_sum;			// Passes in the cycles measured
+	int32_t swing_sum;				// Peak to peak swings of the cycles measured
+
+public:
+	// This constructor creates a tuner which is finished, with nothing measured
+	relay_tuner (void);
+
+	// Starts an experiment about the measurement as it is now
+	void start (int32_t y, int16_t relay_amplitude, int16_t relay_hysteresis);
+
+	// Takes one pass's measurement and gives the relay's signal for the pass
+	int16_t update (int32_t y);
+
+	// Works out PI gains from what was measured
+	bool gains (int16_t& kp, int16_t& ki);
+
+	/** This method says whether the experiment is over, whether or not it worked.
+	 *  @return True once enough cycles have been measured, or it has given up
+	 */
+	bool done (void) { return finished; }
+
+	/** This method gets the average period of the cycles measured.
+	 *  @return Tu, in passes, or zero if nothing was measured
+	 */
+	uint16_t get_period (void) { return measured ? period_sum / measured : 0; }
+
+	/** This method gets the average peak to peak swing of the cycles measured.
+	 *  @return 2a, in the measurement's units, or zero if nothing was measured
+	 */
+	int32_t get_swing (void) { return measured ? swing_sum / measured : 0; }
+};
+
+#endif // _RELAY_TUNER_H_
@@ -0,0 +1,290 @@
+//**************************************************************************************
+/** \file robot_params.cpp
+ *    This file contains the robot's parameter block, which keeps its calibration,
+ *    gains and limits in the XMEGA's EEPROM. See robot_params.h.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file, as gain_store.cpp, for the autotuned gains
+ *    \li 10-18-26 Versioned and CRC checked block of the calibration, gains and limits
+ *    \li 10-18-26 Table of the parameters by name, for setting them over serial
+ *    \li 10-18-26 Motion limits kept to what the profile can run
+ *    \li 10-19-26 Dropped the ticks per inch, which nothing read
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+
+#include <stddef.h>                         // For offsetof()
+#include <string.h>                         // For memset()
+#include <asf.h>                            // For the nvm driver
+#include <util/crc16.h>                     // Header for cyclic redundancy checks
+#include <avr/pgmspace.h>                   // For the table in flash
+
+#include "robot_params.h"                   // Header for this file
+#include "control_timer.h"                  // For CONTROL_RATE_HZ
+
+
+robot_params params;
+
+// How each parameter is kept in robot_params
+#define PARAM_INT16 0
+#define PARAM_UINT16 1
+#define PARAM_UINT8 2
+#define PARAM_UINT32 3
+
+/// One row of the table of parameters
+struct params_entry
+{
+	char name[PARAMS_NAME_SIZE];	// What the user calls it
+	uint8_t offset;					// Where it is in robot_params
+	uint8_t type;					// How it's kept, PARAM_INT16 and so on
+	int32_t min;					// Smallest and largest values allowed
+	int32_t max;
+};
+
+// The least acceleration and jerk the profile keeps, in ticks/s^2 and ticks/s^3, at
+// the rate the control loop runs it
+#define PARAMS_A_MIN ((PROFILE_LIM_MIN * (int32_t)CONTROL_RATE_HZ * CONTROL_RATE_HZ \
+					   + 0xFFFF) >> 16)
+#define PARAMS_J_MIN (PARAMS_A_MIN * CONTROL_RATE_HZ)
+
+// The table of parameters, in flash, in the order the user sees them
+#define PARAMS_ROW(name, field, type, min, max) \
+	{ name, (uint8_t)offsetof (robot_params, field), type, min, max }
+
+static const params_entry params_table[PARAMS_COUNT] PROGMEM =
+{
+	PARAMS_ROW ("wheelbase", wheelbase_ticks, PARAM_INT16, 1, 32767),
+	PARAMS_ROW ("pwm_scale", gains.pwm_scale, PARAM_INT16, 1, 1000),
+	PARAMS_ROW ("kp_l", gains.kp_l, PARAM_INT16, 0, 32767),
+	PARAMS_ROW ("ki_l", gains.ki_l, PARAM_INT16, 0, 32767),
+	PARAMS_ROW ("kd_l", gains.kd_l, PARAM_INT16, 0, 32767),
+	PARAMS_ROW ("kp_a", gains.kp_a, PARAM_INT16, 0, 32767),
+	PARAMS_ROW ("ki_a", gains.ki_a, PARAM_INT16, 0, 32767),
+	PARAMS_ROW ("kd_a", gains.kd_a, PARAM_INT16, 0, 32767),
+	PARAMS_ROW ("pwm_lim", gains.pwm_lim, PARAM_INT16, 0, 100),
+	PARAMS_ROW ("pwm_lin", gains.pwm_lim_linear, PARAM_INT16, 0, 100),
+	PARAMS_ROW ("esum_l", gains.esum_l_lim, PARAM_INT16, 0, 32767),
+	PARAMS_ROW ("esum_a", gains.esum_a_lim, PARAM_INT16, 0, 32767),
+	PARAMS_ROW ("d_filter", gains.d_filter_shift, PARAM_UINT8, 0, DRIVE_SHIFT_MAX),
+	PARAMS_ROW ("aw_shift", gains.aw_shift, PARAM_UINT8, 0, DRIVE_SHIFT_MAX),
+	PARAMS_ROW ("v_max", limits.v_max, PARAM_UINT16, 1, PROFILE_V_MAX),
+	PARAMS_ROW ("a_max", limits.a_max, PARAM_UINT16, PARAMS_A_MIN, 65535),
+	PARAMS_ROW ("j_max", limits.j_max, PARAM_UINT32, PARAMS_J_MIN, 10000000),
+	PARAMS_ROW ("tuned", tuned, PARAM_UINT8, 0, 1)
+};
+
+
+//-------------------------------------------------------------------------------------
+/** This function works out the CRC of a block as emstream's hex protocol does, with
+ *  avr-libc's CRC-CCITT starting from 0xFFFF.
+ *  @param p_data The start of the block
+ *  @param size How many bytes are in it
+ *  @return The CRC
+ */
+
+static uint16_t params_crc (const void* p_data, uint16_t size)
+{
+	const uint8_t* p_byte = (const uint8_t*)p_data;
+	uint16_t crc = 0xFFFF;
+
+	while (size--)
+	{
+		crc = _crc_ccitt_update (crc, *p_byte++);
+	}
+	return (crc);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function fills in the parameters the firmware was built with.
+ *  @param defaults The parameters to fill in
+ */
+
+void params_default (robot_params& defaults)
+{
+	defaults.wheelbase_ticks = WHEELBASE_TICKS;
+	defaults.gains = drive_gains_default;
+	defaults.limits = drive_limits_default;
+	defaults.tuned = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function loads the parameters from the EEPROM into params. If the block there
+ *  was never written, was written by firmware with a different version of it, or
+ *  fails its CRC, the defaults are used instead and the EEPROM is left alone until
+ *  params_save() is called. It's meant to be called once, from main() before the
+ *  scheduler starts, so the tasks can read params with no locking.
+ *  @return True if the parameters came from the EEPROM, false if they're the defaults
+ */
+
+bool params_load (void)
+{
+	params_block block;
+
+	nvm_eeprom_read_buffer (PARAMS_ADDR, &block, sizeof (block));
+	if (block.magic != PARAMS_MAGIC || block.version != PARAMS_VERSION
+		|| block.size != sizeof (robot_params)
+		|| block.crc != params_crc (&block, offsetof (params_block, crc)))
+	{
+		params_default (params);
+		return (false);
+	}
+
+	params = block.params;
+	return (true);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function writes parameters to the EEPROM, for params_load() to find after a
+ *  reset. It waits while the EEPROM is written, a few ms a page, so it mustn't be
+ *  called from the motor control loop; task_user does it.
+ *  @param to_save The parameters to write
+ */
+
+void params_save (const robot_params& to_save)
+{
+	params_block block;
+
+	memset (&block, 0, sizeof (block));
+	block.magic = PARAMS_MAGIC;
+	block.version = PARAMS_VERSION;
+	block.size = sizeof (robot_params);
+	block.params = to_save;
+	block.crc = params_crc (&block, offsetof (params_block, crc));
+	nvm_eeprom_erase_and_write_buffer (PARAMS_ADDR, &block, sizeof (block));
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function finds a parameter in the table by its name.
+ *  @param name The name, ended by a zero
+ *  @return The parameter's index in the table, or -1 if there's none of that name
+ */
+
+int8_t params_find (const char* name)
+{
+	for (uint8_t index = 0; index < PARAMS_COUNT; index++)
+	{
+		const char* p_row = params_table[index].name;
+		uint8_t letter = 0;
+		char in_table;
+		while ((in_table = (char)pgm_read_byte (p_row + letter)) == name[letter]
+			   && in_table != '\0')
+		{
+			letter++;
+		}
+		if (in_table == name[letter])
+		{
+			return ((int8_t)index);
+		}
+	}
+	return (-1);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function copies a parameter's name out of the table.
+ *  @param index The parameter's index in the table
+ *  @param p_name Where to put the name, room for PARAMS_NAME_SIZE characters
+ */
+
+void params_name (uint8_t index, char* p_name)
+{
+	for (uint8_t letter = 0; letter < PARAMS_NAME_SIZE; letter++)
+	{
+		p_name[letter] = (char)pgm_read_byte (params_table[index].name + letter);
+	}
+	p_name[PARAMS_NAME_SIZE - 1] = '\0';
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function gets the range a parameter may be set in.
+ *  @param index The parameter's index in the table
+ *  @param min Where to put the smallest value allowed
+ *  @param max Where to put the largest value allowed
+ */
+
+void params_range (uint8_t index, int32_t& min, int32_t& max)
+{
+	min = (int32_t)pgm_read_dword (&params_table[index].min);
+	max = (int32_t)pgm_read_dword (&params_table[index].max);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function gets a parameter's value, however it's kept.
+ *  @param from The parameters to look in
+ *  @param index The parameter's index in the table
+ *  @return The value
+ */
+
+int32_t params_get (const robot_params& from, uint8_t index)
+{
+	const uint8_t* p_field = (const uint8_t*)&from + pgm_read_byte (&params_table[index].offset);
+
+	switch (pgm_read_byte (&params_table[index].type))
+	{
+		case (PARAM_INT16):
+			return (*(const int16_t*)p_field);
+		case (PARAM_UINT16):
+			return (*(const uint16_t*)p_field);
+		case (PARAM_UINT8):
+			return (*p_field);
+		default:
+			return ((int32_t)*(const uint32_t*)p_field);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function sets a parameter, if the value is in its range.
+ *  @param to The parameters to change
+ *  @param index The parameter's index in the table
+ *  @param value The new value
+ *  @return True if it was set, false if the value is out of range
+ */
+
+bool params_set (robot_params& to, uint8_t index, int32_t value)
+{
+	int32_t min;
+	int32_t max;
+	params_range (index, min, max);
+	if (value < min || value > max)
+	{
+		return (false);
+	}
+
+	uint8_t* p_field = (uint8_t*)&to + pgm_read_byte (&params_table[index].offset);
+	switch (pgm_read_byte (&params_table[index].type))
+	{
+		case (PARAM_INT16):
+			*(int16_t*)p_field = (int16_t)value;
+			break;
+		case (PARAM_UINT16):
+			*(uint16_t*)p_field = (uint16_t)value;
+			break;
+		case (PARAM_UINT8):
+			*p_field = (uint8_t)value;
+			break;
+		default:
+			*(uint32_t*)p_field = (uint32_t)value;
+			break;
+	}
+	return (true);
+}
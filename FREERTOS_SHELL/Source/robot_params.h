@@ -0,0 +1,98 @@
+//**************************************************************************************
+/** \file robot_params.h
+ *    This file contains header stuff for the robot's parameter block: its calibration,
+ *    and its controller gains and limits. They're kept in the XMEGA's EEPROM, through
+ *    the ASF nvm driver, and loaded into RAM once at boot, so each robot can be set up
+ *    without a rebuild.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file, as gain_store.h, for the autotuned gains
+ *    \li 10-18-26 Versioned and CRC checked block of the calibration, gains and limits
+ *    \li 10-18-26 Table of the parameters by name, for setting them over serial
+ *    \li 10-19-26 Dropped the ticks per inch, which nothing read
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _ROBOT_PARAMS_H_
+#define _ROBOT_PARAMS_H_
+
+#include <stdint.h>
+
+#include "drive_control.h"					// For drive_gains and motion_limits
+#include "odometry.h"						// For WHEELBASE_TICKS
+
+#define PARAMS_ADDR 0x0000					// Where in the EEPROM the block is kept
+#define PARAMS_MAGIC 0x5250					// Marks the block as written; erased is 0xFFFF
+#define PARAMS_VERSION 2					// Goes up by one whenever robot_params changes
+
+#define PARAMS_COUNT 18						// Parameters in the table in robot_params.cpp
+#define PARAMS_NAME_SIZE 10					// Longest name, with its terminating zero
+
+/// The robot's calibration, gains and limits
+struct robot_params
+{
+	int16_t wheelbase_ticks;	// Distance between the wheels (ticks)
+	drive_gains gains;			// Controller gains and limits
+	motion_limits limits;		// Speed, acceleration and jerk along a path
+	uint8_t tuned;				// Nonzero once autotuned, or once a linear gain is
+								// set by hand; the linear gains are then used in
+								// place of the speed bands'
+};
+
+/// The parameters as they're kept in the EEPROM
+struct params_block
+{
+	uint16_t magic;				// PARAMS_MAGIC once the block has been written
+	uint8_t version;			// PARAMS_VERSION of the firmware which wrote it
+	uint8_t size;				// Size of the parameters, in case they change anyway
+	robot_params params;		// The parameters
+	uint16_t crc;				// CRC-CCITT of all the above
+};
+
+/// The parameters the robot runs with. params_load() fills them in at boot, before
+/// the scheduler starts; after that only task_motor changes them, and other tasks go
+/// through params_staged and params_live in shares.h. The one exception is
+/// task_Robot_State, which reads the wheelbase as it starts the odometry; it runs
+/// first, above the other robot tasks, so nothing can have been applied by then
+extern robot_params params;
+
+// Fills in the parameters the firmware was built with
+void params_default (robot_params& defaults);
+
+// Loads the parameters from the EEPROM, or the defaults if there aren't any good ones
+bool params_load (void);
+
+// Writes the parameters to the EEPROM
+void params_save (const robot_params& to_save);
+
+// Finds a parameter in the table by name; -1 if there's none of that name
+int8_t params_find (const char* name);
+
+// Copies a parameter's name, which has up to PARAMS_NAME_SIZE characters with the zero
+void params_name (uint8_t index, char* p_name);
+
+// Gets the smallest and largest values a parameter may be set to
+void params_range (uint8_t index, int32_t& min, int32_t& max);
+
+// Gets a parameter's value
+int32_t params_get (const robot_params& from, uint8_t index);
+
+// Sets a parameter; false if the value is out of its range
+bool params_set (robot_params& to, uint8_t index, int32_t value);
+
+#endif // _ROBOT_PARAMS_H_
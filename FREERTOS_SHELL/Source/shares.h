@@ -7,6 +7,15 @@
  *    \li 09-30-2012 JRR Original file was a one-file demonstration with two tasks
  *    \li 10-05-2012 JRR Split into multiple files, one for each task plus a main one
  *    \li 10-29-2012 JRR Reorganized with global queue and shared data references
+ *    \li 10-18-26 Added the wheel speed shares
+ *    \li 10-18-26 Diagnostic esum_ shares hold the integral terms
+ *    \li 10-18-26 Added the waypoint queue
+ *    \li 10-18-26 The robot's heading is a binary angle
+ *    \li 10-18-26 The robot's pose is one double buffered share
+ *    \li 10-18-26 Added the autotune request
+ *    \li 10-18-26 Added the staged and running parameters, for live tuning
+ *    \li 10-18-26 The wheel speeds are one double buffered share
+ *    \li 10-18-26 Added the flag which pauses task_motor for the 'm' benchmark
  *
  *  License:
  *		This file is copyright 2012 by JR Ridgely and released under the Lesser GNU 
@@ -28,6 +37,12 @@
 #ifndef _SHARES_H_
 #define _SHARES_H_
 
+#include "path_follower.h"					// For struct waypoint
+#include "odometry.h"						// For struct odometry_pose
+#include "wheel_speed.h"					// For struct wheel_speeds
+#include "frt_double_buffer.h"				// Shares written without critical sections
+#include "frt_seqlock_data.h"				// The same, with one copy
+#include "robot_params.h"					// For struct robot_params
 
 //-------------------------------------------------------------------------------------
 // Externs:  In this section, we declare variables and functions that are used in all
@@ -41,30 +56,31 @@
  */
 extern frt_text_queue print_ser_queue;			// This queue allows tasks to send characters to the user interface task for display.
 
+/**
+ * \var waypoint_queue
+ * \brief This queue carries waypoints from the user interface task to the motor task,
+ *        which drives through them in the order they were sent.
+ */
+extern frt_queue<waypoint> waypoint_queue;		// Waypoints for the motor task's path follower
+
 
 // Motor-related shares
 //-----------------------------------------------
 //-----------------------------------------------
 /**
- * \var Robot_Pos_X_INERT
- * \brief This share contains the current X position of the robot.
- */
- extern int16_t Robot_Pos_X_INERT;			// Contains current position of robot in X_INERTIAL
- 
-
- 
- /**
- * \var Robot_Pos_Y_INERT
- * \brief This share contains the current Y position of the robot.
+ * \var robot_pose
+ * \brief This share contains the robot's position (ticks) and heading, CCW from the X
+ * axis as a binary angle (65536 to a turn). All three come from the same update.
+ * task_Robot_State writes it, at a priority no task reading it has.
  */
- extern  int16_t Robot_Pos_Y_INERT;			// Contains current position of robot in Y_INERTIAL
- //---------
+ extern double_buffer<odometry_pose> robot_pose;	// Robot's pose in the inertial frame
 
  /**
- * \var Robot_Angle_Theta_INERT
- * \brief This share contains the current angle of the robot.
+ * \var robot_speeds
+ * \brief This share contains the speeds of the left and right wheels in ticks/s, both
+ * from the same update. task_Robot_State writes it, as it does robot_pose.
  */
- extern int16_t Robot_Angle_Theta_INERT;	// Contains current angle of the robot in THETA_INERTIAL
+ extern double_buffer<wheel_speeds> robot_speeds;	// Speeds of both wheels
  /**
   
  /**
@@ -114,7 +130,8 @@ extern frt_text_queue print_ser_queue;			// This queue allows tasks to send char
  * \var pwm_lin_2
  * \var pwm_ang_1
  * \var pwm_ang_2
- * \brief These shares are for diagnostic purposes only.
+ * \brief These shares are for diagnostic purposes only. The esum_ shares hold the
+ *        integral terms, in PWM percent.
  */
  extern int16_t pwm_tot_1;
  extern int16_t pwm_tot_2;
@@ -128,6 +145,42 @@ extern frt_text_queue print_ser_queue;			// This queue allows tasks to send char
  extern int16_t pwm_ang_2;
  extern int16_t LinearDistance;
 
+ /**
+ * \var autotune_request
+ * \brief Set by task_user to have task_motor autotune its PI gains; task_motor clears it
+ *        when it starts.
+ */
+ extern bool autotune_request;
+
+ /**
+ * \var motors_paused
+ * \brief Set by task_user while it has the motor PWM timer to itself, to time the
+ *        motor control; task_motor skips its passes until it's cleared.
+ */
+ extern bool motors_paused;
+
+ /**
+ * \var params_staged
+ * \brief Parameters task_user has staged for task_motor. Each time it writes them,
+ *        task_motor swaps them in whole between two passes of its loop. task_user is
+ *        the lower priority, so task_motor never has to read them twice.
+ */
+ extern double_buffer<robot_params> params_staged;
+
+ /**
+ * \var params_live
+ * \brief The parameters task_motor is running with, written by it whenever they change,
+ *        for task_user to show and save.
+ */
+ extern seqlock_data<robot_params> params_live;
+
+ /**
+ * \var params_save_request
+ * \brief Set by task_motor to have task_user write params_live to the EEPROM, which
+ *        takes too long for the control loop.
+ */
+ extern bool params_save_request;
+
 
 
 #endif // _SHARES_H_
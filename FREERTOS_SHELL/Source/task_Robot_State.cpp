@@ -4,6 +4,16 @@
  *
  *  Revisions:
  *    \li 12-05-2018 RGD - Created task Robot State.
+ *    \li 10-18-26 - Odometry uses fixed point sin/cos instead of the float library.
+ *    \li 10-18-26 - Odometry math moved to odometry.cpp; the shares are really updated now.
+ *    \li 10-18-26 - Encoders are read as 32 bit counts, extended by overflow interrupts.
+ *    \li 10-18-26 - Wheel speeds, timed from the encoder edges at low speed.
+ *    \li 10-18-26 - Odometry runs in the TCE1 interrupt; this task publishes its pose.
+ *    \li 10-18-26 - The BNO080's yaw is blended into the heading when it has a report.
+ *    \li 10-18-26 - Poses from the vision tracker correct the odometry as it was when seen.
+ *    \li 10-18-26 - The pose is published through a double buffer, all three parts together.
+ *    \li 10-18-26 - The odometry's wheelbase comes from the parameter block.
+ *    \li 10-18-26 - The wheel speeds are published through a double buffer, both together.
  *
  *  License:
  *    This file is copyright 2018 by RG Dunn and released under the Lesser GNU 
@@ -23,15 +33,54 @@
 
 #include <avr/io.h>                         // Port I/O for SFR's
 #include <avr/wdt.h>                        // Watchdog timer header
+#include <avr/interrupt.h>                  // For the encoder timers' interrupts
 
 #include "shared_data_sender.h"
 #include "shared_data_receiver.h"
 #include "task_Robot_State.h"                      // Header for this file
 
 // Initializing encoder-based positions
-int16_t Robot_Pos_X_INERT = 0;			// Contains current position of robot in X_INERTIAL
-int16_t Robot_Pos_Y_INERT = 0;			// Contains current position of robot in Y_INERTIAL
-int16_t Robot_Angle_Theta_INERT = 0;	// Contains current angle of the robot in THETA_INERTIAL
+double_buffer<odometry_pose> robot_pose;	// Robot's position and heading in the inertial frame
+double_buffer<wheel_speeds> robot_speeds;	// Speeds of both wheels, positive forwards (ticks/s)
+
+// The encoders' counts extended to 32 bits; the timers' overflow interrupts keep them
+static QDEC_Ext_t M_Enc1_Ext;
+static QDEC_Ext_t M_Enc2_Ext;
+
+// Times between the encoders' edges, captured by TCE0 channels A and B
+static QDEC_Period_t M_Enc1_Period;
+static QDEC_Period_t M_Enc2_Period;
+
+/** \cond NOT_ENABLED  (These ISRs are not to be documented by Doxygen)
+ *  These interrupts count the wraps of the encoder timers.
+ */
+ISR (TCD1_OVF_vect)
+{
+	QDEC_Ext_Overflow (&M_Enc1_Ext);
+}
+
+ISR (TCF0_OVF_vect)
+{
+	QDEC_Ext_Overflow (&M_Enc2_Ext);
+}
+
+ISR (TCE0_CCA_vect)
+{
+	QDEC_Period_Capture (&M_Enc1_Period, TCE0.CCA);
+}
+
+ISR (TCE0_CCB_vect)
+{
+	QDEC_Period_Capture (&M_Enc2_Period, TCE0.CCB);
+}
+
+ISR (TCE0_OVF_vect)
+{
+	QDEC_Period_Overflow (&M_Enc1_Period);
+	QDEC_Period_Overflow (&M_Enc2_Period);
+}
+/// \endcond
+
 //-------------------------------------------------------------------------------------
 /** This constructor creates a new data acquisition task. Its main job is to call the
  *  parent class's constructor which does most of the work.
@@ -48,10 +97,10 @@ task_Robot_State::task_Robot_State (const char* a_name,
 					  size_t a_stack_size,
 					  emstream* p_ser_dev
 					 )
-	: frt_task (a_name, a_priority, a_stack_size, p_ser_dev)
+	: frt_task (a_name, a_priority, a_stack_size, p_ser_dev), imu (p_ser_dev, false)
 {
-	//This constructor does nothing.
-	
+	//This constructor does nothing else; the IMU is set up when the task starts.
+	imu_ok = false;
 }
 
 
@@ -66,6 +115,18 @@ void task_Robot_State::run (void)
 	// Wait a little while for user interface task to finish up
 	delay_ms(10);
 	bool success = false; //declare bool for checking success of function calls
+	uint16_t period;	//edge timing of an encoder, in capture timer counts
+	uint16_t age;
+	portTickType previousSpeedTicks = previousTicks;	//when the wheel speeds were last worked out; the loop delays twice, so it's timed
+	portTickType speedTicks;
+	uint16_t interval_ms;
+	wheel_speeds speeds;	//both wheels' speeds, published together
+	odometry_pose pose;	//position and heading, all from the same odometry update
+	uint8_t imu_reads;	//packets read from the IMU this pass
+	vision_fix fix;		//newest pose from the vision tracker
+	int16_t fix_dx;		//correction to the odometry it gives
+	int16_t fix_dy;
+	int16_t fix_dheading;
 	//configure both quadrature counter elements
 	
 	while(1)
@@ -82,61 +143,78 @@ void task_Robot_State::run (void)
 			success = false;
 			success = QDEC_Total_Setup(&PORTE, 4, false, 2, EVSYS_CHMUX_PORTE_PIN4_gc, false, EVSYS_QDIRM_00_gc, &TCF0, TC_EVSEL_CH2_gc, 0xFFFF); //setup M_ENC2 quad. encoder
 			//*p_serial << "ENC2 Setup Success? " << success << endl;
-			M_Enc1_Val_Prev = QDEC_Read_TC(&TCD1); //read value of encoders for starting value
-			M_Enc2_Val_Prev = QDEC_Read_TC(&TCF0);
-			R_THETA_Delta = 0; //zero out the angular position of the robot upon startup.
-			R_I_POS_X = 0;
-			R_I_POS_Y = 0;
-			Robot_Pos_X_INERT = 0;			
-			Robot_Pos_Y_INERT = 0;			
-			Robot_Angle_Theta_INERT = 0;	
+			QDEC_Ext_Setup(&M_Enc1_Ext, &TCD1, TC_OVFINTLVL_LO_gc); //count the encoders' wraps so no counts are lost at speed
+			QDEC_Ext_Setup(&M_Enc2_Ext, &TCF0, TC_OVFINTLVL_LO_gc);
+			//time the encoders' edges on TCE0 for the speed at low speed; event channels 4 and 5 are free of the decoders
+			QDEC_Period_Init(&M_Enc1_Period, &TCE0);
+			QDEC_Period_Init(&M_Enc2_Period, &TCE0);
+			QDEC_TC_Period_Setup(&TCE0, 4, EVSYS_CHMUX_PORTD_PIN4_gc, EVSYS_CHMUX_PORTE_PIN4_gc, TC_CLKSEL_DIV64_gc, 1); //DIV64 to match WHEEL_SPEED_CAPTURE_HZ
+			//the odometry interrupt zeroes out the position of the robot from the encoders' starting values, and reads them from then on
+			odometry_timer_start(&M_Enc1_Ext, &M_Enc2_Ext, ODOMETRY_RATE_HZ, params.wheelbase_ticks);
+			odometry_timer_counts(&M_Enc1_Val, &M_Enc2_Val);
+			speed1.reset(M_Enc1_Val);
+			speed2.reset(M_Enc2_Val);
+			speeds.left = 0;
+			speeds.right = 0;
+			robot_speeds.put(speeds);
+			//the IMU's game rotation vector has no magnetometer in it, so the motors can't pull it off; without the IMU the heading is the encoders' alone
+			imu.setIntPin(&IMU_INT_PORT, IMU_INT_PIN_bm);
+			imu_ok = imu.begin();
+			if (imu_ok)
+			{
+				imu.enableGameRotationVector(IMU_REPORT_MS);
+			}
+			else
+			{
+				*p_serial << "IMU not found; heading from the encoders only" << endl;
+			}
+			fusion.reset();
+			//the vision tracker's poses come in on USARTF0; the odometry's path is kept from here on to compare them with
+			vision_link_start();
+			odometry_timer_pose(&pose);
+			vision.reset(pose);
+			previousSpeedTicks = xTaskGetTickCount();
+			robot_pose.put(pose);
 			transition_to(1);
 			break;
 			
 		case (1):
-				//get current encoder values
-				M_Enc1_Val = -1 * QDEC_Read_TC(&TCD1); //multiply by -1 so that positive encoder count is forwards on both sides.
-				M_Enc2_Val = QDEC_Read_TC(&TCF0);
-				
-				//calculate ticks elapsed since last iteration, we'll left shift by 2 bits to increase data resolution (at max speed, we run the risk of losing MSB data, should quantify this risk)
-				M_1_DistTick = ((M_Enc1_Val-M_Enc1_Val_Prev) << 2);
-				M_2_DistTick = ((M_Enc2_Val-M_Enc2_Val_Prev) << 2);
-				//calculate differential ticks between the motors.
-				//Positive M_DifferTick = CCW Rotation (right faster than left)
-				//Negative M_DifferTick = CW Rotation (left side faster than right)
-				M_DifferTick = (M_2_DistTick - M_1_DistTick); //left shifted by two from earlier
-				*p_serial << "Differential Encoder Values" << M_1_DistTick << " " << M_2_DistTick << endl;
-				
-				//remain in tick units (leftshifted two) to maintain maximal resolution
-				//calculate v1 & v2 (ticks/timetasktakestorun)
-				M_1_v1 = M_1_DistTick / (DELAYINTERVAL_MS << 2);			//calculate linear velocity of left wheel (ticks/ms)
-				M_2_v2 = M_2_DistTick / (DELAYINTERVAL_MS << 2);			//calculate linear velocity of right wheel (ticks/ms)
-				*p_serial << "M vel 1" << hex << (M_1_v1>>0) << " " << (M_1_v1>>1)  << " M2 V " << (M_2_v2) << " " << (M_2_v2 >> 1) << endl;
-				//calculate vbar and angular position of the drivebase in robot coordinates.
-				R_V_Bar = (M_2_v2 + M_1_v1) / (2<<2);					//calculate Vbar for the robot (ticks/ms)
-				R_POS_Y_delta = ((M_2_v2 + M_1_v1) / (2<<2)) * (DELAYINTERVAL_MS << 2); //delta y position in local frame
-				R_Omega = (M_2_v2 - M_1_v1) / (WHEELBASE_TICKS << 2);	//angular velocity (rad/ms) -> only calculated for debugging. Angular position is calculated directly.
-				R_THETA_Delta = ((M_2_v2 - M_1_v1) * (DELAYINTERVAL_MS << 2)) / (WHEELBASE_TICKS<<2);		//calculate angular position change for the robot (we calculate directly to avoid losing resolution (rad))
-				
-				*p_serial << "R_V_Bar " << hex << R_V_Bar << " RPOSYDELTA " << R_POS_Y_delta << " ROMEGA " << R_Omega << " R_THETA_DELTA " << R_THETA_Delta << endl;
-				R_INERT_Theta = R_INERT_Theta + (R_THETA_Delta>>2); //update the angular position of the robot with the new estimate (right shift two for compatibility).
-				//now translate R_POS_Y_delta back to inertial frame
+				//get current encoder values, as the odometry interrupt last read them; positive is forwards on both sides
+				odometry_timer_counts(&M_Enc1_Val, &M_Enc2_Val);
 				
-				R_I_POS_X_delta = R_POS_Y_delta * cos(R_INERT_Theta);	//calculate vbar component in x inertial frame
-				R_I_POS_Y_delta = R_POS_Y_delta * sin(R_INERT_Theta);	//calculate vbar component in y intertial frame
-				R_I_POS_X = R_I_POS_X + (R_I_POS_X_delta>>2);				//compute new robot position in X inertial
-				R_I_POS_Y = R_I_POS_Y + (R_I_POS_Y_delta>>2);				//compute new robot position in Y inertial
+				//wheel speeds, from the edge timing when slow and the counts when fast
+				speedTicks = xTaskGetTickCount();
+				interval_ms = (uint16_t)((speedTicks - previousSpeedTicks) * portTICK_RATE_MS);
+				previousSpeedTicks = speedTicks;
+				QDEC_Period_Read(&M_Enc1_Period, &period, &age);
+				speeds.left = speed1.update(M_Enc1_Val, interval_ms, period, age);
+				QDEC_Period_Read(&M_Enc2_Period, &period, &age);
+				speeds.right = speed2.update(M_Enc2_Val, interval_ms, period, age);
+				robot_speeds.put(speeds);
 				
-				//we are back to regular no leftshift data!
-				//output X,Y,Theta to motordriver task via shares.
-				Robot_Pos_X_INERT = R_I_POS_X;
-				Robot_Pos_Y_INERT = R_I_POS_Y;
-				Robot_Angle_Theta_INERT = R_INERT_Theta;
+				//blend in the IMU's yaw; the INT pin is looked at first, so there's no I2C traffic unless a report is waiting
+				for (imu_reads = 0; imu_ok && imu_reads < IMU_READS_MAX && imu.reportReady(); imu_reads++)
+				{
+					if (imu.dataAvailable() && imu.quatAvailable())
+					{
+						odometry_timer_pose(&pose);
+						odometry_timer_correct(fusion.update(imu.getYaw(), pose.heading));
+					}
+				}
 				
+				//correct with the vision tracker's newest pose, against where the odometry had the robot when the picture was taken
+				odometry_timer_pose(&pose);
+				vision.record(pose, (uint16_t)(xTaskGetTickCount() * portTICK_RATE_MS));
+				if (vision_link_get(&fix) && vision.update(fix, fix_dx, fix_dy, fix_dheading))
+				{
+					odometry_timer_correct_pose(fix_dx, fix_dy, fix_dheading);
+					fusion.turn(fix_dheading);	//so the IMU doesn't pull the heading back
+					odometry_timer_pose(&pose);
+				}
 				
+				//output X,Y,Theta to the other tasks in one go, so readers never get them from different updates; the odometry math lives in odometry.cpp so the simulator can run it too
+				robot_pose.put(pose);
 				
-				M_Enc1_Val_Prev = M_Enc1_Val;
-				M_Enc2_Val_Prev = M_Enc2_Val;
 				runs++;
 				delay_from_to_ms(previousTicks,DELAYINTERVAL_MS);
 			
@@ -4,6 +4,14 @@
  *
  *  Revisions:
  *    \li 12-05-2018 RGD - Created task Robot State.
+ *    \li 10-18-26 - Odometry math moved to class odometry.
+ *    \li 10-18-26 - Encoder values are 32 bits.
+ *    \li 10-18-26 - Added the wheel speed estimates.
+ *    \li 10-18-26 - Odometry moved to the odometry timer's interrupt.
+ *    \li 10-18-26 - BNO080 yaw blended into the heading.
+ *    \li 10-18-26 - Vision tracker's poses fused, allowing for their latency.
+ *    \li 10-18-26 - TICKSPERINCH moved to the parameter block, robot_params.h.
+ *    \li 10-19-26 - TICKSPERINCH back here, as nothing read it from the block.
  *
  *  License:
  *    This file is copyright 2018 by RG Dunn and released under the Lesser GNU 
@@ -40,15 +48,23 @@
 
 #include "shares.h"                         // Global ('extern') queue declarations
 
-#include "math.h"
-
 #include "qdec_driver.h"					//quadrature encoder driver
-#include <math.h>							//Math library for trignometric functions
+#include "odometry_timer.h"					//encoder odometry, run by a timer interrupt
+#include "wheel_speed.h"					//wheel speeds from the encoders
+#include "BNO080_Xmega_Lib.h"				//BNO080 IMU on TWIE
+#include "heading_fusion.h"					//blends the IMU's yaw into the heading
+#include "vision_link.h"					//poses from the vision tracker, on USARTF0
+#include "vision_fusion.h"					//corrects the odometry with the tracker's late poses
+#include "robot_params.h"					//calibration, loaded from the EEPROM at boot
 
 #define TICKSPERINCH 77			//this defined value relates ticks of encoder to linear distance on the 2D plane, accounting for wheel diameter. UNITS: ticks/inch
-#define DELAYINTERVAL_MS 5    //This defines the interval that the task will run on.
+
 #define WHEELBASE_INCH 10		//This defines the wheelbase of the robot in inches
-#define WHEELBASE_TICKS	531		//This defines the wheelbase of the robot in ticks
+
+#define IMU_REPORT_MS 20		//Time between the IMU's rotation vector reports; longer than a pass of the loop
+#define IMU_INT_PORT PORTE		//The BNO080's INT output is wired to PE2, next to the TWI pins
+#define IMU_INT_PIN_bm PIN2_bm
+#define IMU_READS_MAX 2			//Most packets read in one pass, so a backlog can't hold up the loop
 
 class task_Robot_State : public frt_task
 {
@@ -63,32 +79,16 @@ protected:
 		ROBOT_S3
 	};	*/				//!< Task state
 	uint8_t ctr;		//!< Loop counter
-	//Encoder value storage variables -> Current and previous state
-	int16_t M_Enc1_Val;
-	int16_t M_Enc2_Val;
-	int16_t M_Enc1_Val_Prev;
-	int16_t M_Enc2_Val_Prev;
-	
-	int16_t M_1_DistTick;
-	int16_t M_2_DistTick;
-	int16_t M_DifferTick;
-	
-	int16_t M_1_v1; 
-	int16_t M_2_v2; 
-	int16_t R_V_Bar; 
-	int16_t R_Omega;
-	int16_t R_POS_Y_delta; //robot only moves in Y direction in the local coordinate system
-	int16_t R_THETA_Delta;		//
-	int16_t R_THETA_PREV; //previous angular positon of the robot.
+	//Encoder value storage variables -> Current state
+	int32_t M_Enc1_Val;
+	int32_t M_Enc2_Val;
 	
-	int16_t R_INERT_Theta;	
-	int16_t R_I_POS_X_delta; 
-	int16_t R_I_POS_Y_delta;
-	int16_t R_I_POS_X;
-	int16_t R_I_POS_Y;
-	int16_t Robot_Pos_X_INERT;			// Contains current position of robot in X_INERTIAL
-	int16_t Robot_Pos_Y_INERT;			// Contains current position of robot in Y_INERTIAL
-	int16_t Robot_Angle_Theta_INERT;	// Contains current angle of the robot in THETA_INERTIAL
+	wheel_speed speed1;	//!< Speed of the left wheel
+	wheel_speed speed2;	//!< Speed of the right wheel
+	BNO080 imu;			//!< The IMU, read only when its INT pin says it has a report
+	bool imu_ok;		//!< True if the IMU answered at startup
+	heading_fusion fusion;	//!< Blends the IMU's yaw into the odometry's heading
+	vision_fusion vision;	//!< Odometry's recent path, to compare the tracker's late poses with
 public:
 	// This constructor creates a user interface task object
 	task_Robot_State (const char*, unsigned portBASE_TYPE, size_t, emstream*);
@@ -4,6 +4,14 @@
  *
  *  Revisions:
  *    12-5-18 RT Original file
+ *    10-18-26 Prints the control loop's timing
+ *    10-18-26 Prints the wheel speeds
+ *    10-18-26 Prints the integral terms in percent
+ *    10-18-26 Prints the path follower's steering
+ *    10-18-26 Prints the heading in degrees, and the odometry interrupt's timing
+ *    10-18-26 Prints what the vision link has received
+ *    10-18-26 Reads the pose from the double buffered share
+ *    10-18-26 Reads both wheel speeds from one double buffered share
  *
  *  License:
  *    This file is copyright 2018 by Ricky Tan and released under the Lesser GNU 
@@ -54,19 +62,44 @@ task_diag::task_diag (const char* a_name,
 void task_diag::run (void)
 {
 	portTickType previousTicks = xTaskGetTickCount ();
+	control_timing timing;
+	odometry_timing odo_timing;
+	vision_link_counts vision_counts;
+	odometry_pose pose;
+	wheel_speeds speeds;
 
 	while(1)
 	{
 		// Sending serial diagnostics
 		*p_serial << "--- MOTOR 1 ---" << endl;
 		*p_serial << "| Total PWM: " << pwm_tot_1 << " | Linear PWM: " << pwm_lin_1 << " | Angular PWM: " << pwm_ang_1 << endl;
-		*p_serial << "| Robot Position: " << Robot_Pos_X_INERT << " " << Robot_Pos_Y_INERT << " | Angle: " << Robot_Angle_Theta_INERT << endl;
-		*p_serial << "| esum-L: " << esum_l_1 << " | esum-A:" << esum_a_1 << endl;
+		robot_pose.get (&pose);
+		robot_speeds.get (&speeds);
+		*p_serial << "| Robot Position: " << pose.x << " " << pose.y << " | Heading: " << (uint16_t)(((uint32_t)pose.heading * 360) >> 16) << " deg" << endl;
+		*p_serial << "| I-L: " << esum_l_1 << " % | I-A: " << esum_a_1 << " %" << endl;
+		*p_serial << "| Wheel Speed: " << speeds.left << " ticks/s" << endl;
 		*p_serial << "| Linear Distance: " << LinearDistance << endl;
 		*p_serial << "--- MOTOR 2 ---" << endl;
 		*p_serial << "| Total PWM: " << pwm_tot_2 << " | Linear PWM: " << pwm_lin_2 << " | Angular PWM: " << pwm_ang_2 << endl;
-		*p_serial << " | Goal Position: " << setpoint_l_1 << " "<< setpoint_l_2 << " | Angle Setpoint: " << setpoint_a_1 << endl;
-		*p_serial << "| esum-L: " << esum_l_2 << " | esum-A:" << esum_a_2 << endl;
+		*p_serial << " | Goal Position: " << setpoint_l_1 << " "<< setpoint_l_2 << " | Steer: " << setpoint_a_1 << endl;
+		*p_serial << "| I-L: " << esum_l_2 << " % | I-A: " << esum_a_2 << " %" << endl;
+		*p_serial << "| Wheel Speed: " << speeds.right << " ticks/s" << endl;
+
+		// Control loop timing since the last print; max - min latency is the jitter
+		control_timer_stats(&timing, true);
+		*p_serial << "--- CONTROL LOOP ---" << endl;
+		*p_serial << "| Period: " << timing.period_us << " us | Runs: " << timing.runs << " | Overruns: " << timing.overruns << endl;
+		*p_serial << "| Latency min: " << timing.latency_min_us << " us | max: " << timing.latency_max_us << " us | Jitter: " << (uint16_t)(timing.latency_max_us - timing.latency_min_us) << " us" << endl;
+
+		// Odometry interrupt's time since the last print, out of its period
+		odometry_timer_stats(&odo_timing, true);
+		*p_serial << "--- ODOMETRY ---" << endl;
+		*p_serial << "| Period: " << odo_timing.period_us << " us | Runs: " << odo_timing.runs << " | ISR last: " << odo_timing.isr_last_us << " us | max: " << odo_timing.isr_max_us << " us" << endl;
+
+		// Packets from the vision tracker since the start
+		vision_link_stats(&vision_counts);
+		*p_serial << "--- VISION ---" << endl;
+		*p_serial << "| Packets: " << vision_counts.packets << " | CRC errors: " << vision_counts.crc_errors << " | Line errors: " << vision_counts.line_errors << " | Skipped: " << vision_counts.skipped << endl;
 		*p_serial << "=============================================================";
 
 		// Delaying
@@ -39,6 +39,9 @@
 #include "frt_shared_data.h"                // Header for thread-safe shared data
 
 #include "shares.h"                         // Global ('extern') queue declarations
+#include "control_timer.h"					// Control loop timing
+#include "odometry_timer.h"					// Odometry interrupt timing
+#include "vision_link.h"					// Vision tracker packet counts
 
 //-------------------------------------------------------------------------------------
 /** This task periodically prints out diagnostic information for the system.
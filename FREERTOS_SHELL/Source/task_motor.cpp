@@ -4,6 +4,21 @@
  *
  *  Revisions:
  *    \li 12-4-18 RT Original file
+ *    \li 10-18-26 Distance and heading to the goal use fixed point math
+ *    \li 10-18-26 Gains and steering moved to drive_control.cpp
+ *    \li 10-18-26 Loop is paced by the control timer interrupt, not by delays
+ *    \li 10-18-26 Motors are given their wheel speeds
+ *    \li 10-18-26 Both motors run by one drive_pair controller
+ *    \li 10-18-26 Derivative action enabled
+ *    \li 10-18-26 Follows a path of waypoints from waypoint_queue
+ *    \li 10-18-26 Tracks a motion profile along the path
+ *    \li 10-18-26 Feedforward, and linear gains scheduled by speed band
+ *    \li 10-18-26 Steers from the odometry interrupt's latest pose
+ *    \li 10-18-26 Relay autotuning of the PI gains, which are kept in the EEPROM
+ *    \li 10-18-26 Gains, limits and wheelbase come from the parameter block
+ *    \li 10-18-26 Parameters staged by task_user are swapped in between passes
+ *    \li 10-18-26 Both wheel speeds are read from one double buffered share
+ *    \li 10-18-26 Passes are skipped while task_user times the motor control
  *
  *  License:
  *    This file is copyright 2018 by Ricky Tan and released under the Lesser GNU 
@@ -22,6 +37,17 @@
 //**************************************************************************************
 
 #include "task_motor.h"
+#include "relay_tuner.h"				// Relay feedback experiment for autotuning
+#include "robot_params.h"				// Gains and limits, loaded from the EEPROM
+
+// Autotuning: the relay's signal for each loop (1/pwm_scale percent), its hysteresis
+// (ticks), and which experiment is running
+#define TUNE_AMP_L 2000
+#define TUNE_AMP_A 1500
+#define TUNE_HYST 2
+#define TUNE_OFF 0
+#define TUNE_LINEAR 1
+#define TUNE_ANGULAR 2
 
 // Shares
 int16_t pwm_tot_1 = 0;
@@ -35,7 +61,12 @@ int16_t pwm_lin_2 = 0;
 int16_t pwm_ang_1 = 0;
 int16_t pwm_ang_2 = 0;
 int16_t LinearDistance;			// Current linear distance
-int16_t setpoint_a_1 = 0;		// Contains current angular setpoint of Robot
+int16_t setpoint_a_1 = 0;		// Contains the steering towards the lookahead point
+bool autotune_request = false;	// Set by task_user to autotune the PI gains
+bool motors_paused = false;		// Set by task_user while it times the motor control
+double_buffer<robot_params> params_staged;	// New parameters from task_user
+seqlock_data<robot_params> params_live;		// The parameters this task runs with
+bool params_save_request = false;	// Set to have task_user save params_live
 
 //-------------------------------------------------------------------------------------
 /** @brief   Constructor for task_motor. Utilizes base task frt_task
@@ -67,8 +98,7 @@ task_motor::task_motor (const char* a_name,
  *  @details This task initializes the motor objects and updates the motors with their 
  *		current position and setpoints (intertask variables) and adjusts the output pwm signals.
  *		It also updates shared task variables for task_diag for diagnostic use.
-*   @var motorDriver motor1 Object of class motorDriver for first motor
-*   @var motorDriver motor2 Object of class motorDriver for second motor
+*   @var drive_pair motors Object of class drive_pair which runs both motors
 *   @var int16_t pwm_scale Scaling factor for PWM output. Divides summed signals to allow for
 *			greater resolution.
 *   @var int16_t kp_l Linear proportional gain. Given to both motors
@@ -82,116 +112,210 @@ task_motor::task_motor (const char* a_name,
 *			the linear control loop. pwm_lim_linear - pwm_lin is the portion for angular
 *   @var int16_t esum_l_lim Limit for the accumulation of linear error terms
 *   @var int16_t esum_a_lim Limit for the accumulation of angular error terms
-*   @var diagnostic diag_1 Object of struct diagnostic for motor 1 that catches the output of the motorDriver
+*   @var diagnostic diag_1 Object of struct diagnostic for motor 1 that catches the output of the drive_pair
 *			run method. Its values are passed to shared task variables used by task_diag
 *			to print diagnostic information
 *   @var diagnostic diag_2 Same as diag_1 but for motor 2
-*   @var int16_t LinearDistance Shared task variable containing the linear target distance. Drives the
-*			linear control loop
-*   @var int16_t AngleGoal Shared task variable for target angle for robot
-*   @var int16_t Robot_Angle_Theta_INERT Shared task variable for current robot angle
-*   @var int16_t setpoint_a_1 Angular setpoint given to both motors. Development artefact
+*   @var path_follower path Pure pursuit follower for the path of waypoints. The goal in
+*			setpoint_l_1 and setpoint_l_2 is its first waypoint; more are taken from
+*			waypoint_queue whenever it has room for them
+*   @var motion_profile profile Smooth position reference along the path, limited to the
+*			speed, acceleration and jerk in drive_limits_default
+*   @var int16_t LinearDistance Shared task variable containing how far the robot is behind
+*			the reference. Drives the linear control loop
+*   @var odometry_pose pose The robot's position and heading, copied from the odometry
+*			interrupt each pass so they're from the same update and no older than its period
+*   @var wheel_speeds speeds Both wheels' speeds, copied from robot_speeds each pass so
+*			they're from the same update
+*   @var int16_t setpoint_a_1 Steering towards the lookahead point, for display
+*   @var robot_params params The gains, limits and wheelbase the robot runs with, which
+*			main() loaded from the EEPROM's parameter block, or the defaults, until
+*			task_user stages new ones. Whatever they are, they're copied to params_live
+*   @var relay_tuner tuner Relay experiment run on each loop in turn when task_user sets
+*			autotune_request. The robot rocks back and forth, then turns one way and the
+*			other, on the spot; the PI gains are worked out from how it oscillates,
+*			used at once, and task_user saves them in the parameter block for the next reset
+*   @var uint8_t params_seen How many times task_user had staged parameters when they
+*			were last swapped in; when params_staged's count moves on, there are new ones
 */
 
 void task_motor::run (void)
 {
 	// Initializing objects driver
 		// All gains, limits, and positions are initialized to zero.
-	motorDriver motor1 ('1', p_serial);
-	motorDriver motor2 ('2', p_serial);
+	drive_pair motors (p_serial);
 	
-	// Setting gain scaling
+	// Setting gains and limits
 		// Gain scaling is the factor by which signals are divided. Allows for gains
-		// to be scaled appropriately for int limits. Currently set to 1 (no scaling).
-	int16_t pwm_scale = 100;
-	motor1.set_pwm_scaling(pwm_scale);
-	motor2.set_pwm_scaling(pwm_scale);
-
-	// Setting linear gains
-	int16_t kp_l = 30;
-	int16_t ki_l = 1;
-	int16_t kd_l = 0;
-	motor1.set_k_l(kp_l,ki_l,kd_l);
-	motor2.set_k_l(kp_l,ki_l,kd_l);
-
-	// Setting angular gains
-	int16_t kp_a = 60;
-	int16_t ki_a = 10;
-	int16_t kd_a = 0;
-	motor1.set_k_a(kp_a,ki_a,kd_a);
-	motor2.set_k_a(kp_a,ki_a,kd_a);
-	
-	// Setting limits
-		// The limit for pwm_lim is 100. The purpose of pwm_lim is to artificially
-		// limit the output of the motors. Setting to 100 == no artificial cap.
+		// to be scaled appropriately for int limits. The limit for pwm_lim is 100.
+		// The purpose of pwm_lim is to artificially limit the output of the motors.
 		// esum_lim is the limit for the accumulation of errors for integral gain.
-	int16_t pwm_lim = 50;	// Max percentage pwm output
-	int16_t pwm_lim_linear = 3*pwm_lim/5;	// Portion of pwm_lim used for linear driving. Rest is for angular
-	int16_t esum_l_lim = pwm_lim*pwm_scale/10;	// Note: esum_lim is used prior to the pwm being scaled
-	int16_t esum_a_lim = (pwm_lim-pwm_lim_linear)*pwm_scale;
-	motor1.set_pwm_lim(pwm_lim); // Needs to be performed prior to set_pwm_lim_linear
-	motor2.set_pwm_lim(pwm_lim);
-	motor1.set_pwm_lim_linear(pwm_lim_linear);
-	motor2.set_pwm_lim_linear(pwm_lim_linear);
-	motor1.set_esum_l_lim(esum_l_lim);
-	motor2.set_esum_l_lim(esum_l_lim);
-	motor1.set_esum_a_lim(esum_a_lim);
-	motor2.set_esum_a_lim(esum_a_lim);
+		// The derivative terms are low pass filtered, and the integrals are wound
+		// back by part of whatever is clipped off the outputs.
+		// The values are in the parameter block; the defaults are in drive_control.cpp,
+		// shared with the simulator.
+		// While following the path, the linear gains and the feedforward are
+		// replaced each pass with those for the profile's speed, from the table
+		// of speed bands there, unless the gains have been autotuned.
+	drive_set_gains(motors, params.gains);
+	relay_tuner tuner;
+	uint8_t tuning = TUNE_OFF;
+	int16_t kp_tuned = 0;
+	int16_t ki_tuned = 0;
+	bool tuned_l = false;
+	int32_t count_l;
+	int32_t count_r;
+	params_live.put(params);
+	uint8_t params_seen = params_staged.get_count();
 
 
 	/*//-------------------------------
 	// Test condition
-	motor1.set_position(0);	
-	motor2.set_position(0);
+	motors.set_position(0);
 
-	motor1.set_angle(0);
-	motor2.set_angle(0);
+	motors.set_angle(0);
 
-	motor1.set_setpoint_l(100);
-	motor2.set_setpoint_l(100);
+	motors.set_setpoint_l(100);
 
-	motor1.set_setpoint_a(100);
-	motor2.set_setpoint_a(100);
+	motors.set_setpoint_a(100);
 	//------------------------------*/
 
 	// Diagnostic outputs
 	diagnostic diag_1;
 	diagnostic diag_2;
 
+	// The path starts with the goal task_user set up, and goes on through whatever
+	// waypoints are sent after it
+	path_follower path;
+	path.set_wheelbase(params.wheelbase_ticks);
+	motion_profile profile(params.limits, CONTROL_RATE_HZ);
+	waypoint goal;
+	odometry_pose pose;
+	wheel_speeds speeds;
+	goal.x = setpoint_l_1;
+	goal.y = setpoint_l_2;
+	path.add(goal);
+
+	// The loop is woken by timer TCC1 at CONTROL_RATE_HZ. Delaying from the time
+	// at the end of each pass made the period 10 ms plus however long the pass took
+	if (!control_timer_start(CONTROL_RATE_HZ))
+	{
+		*p_serial << "Control timer not started; loop will drift" << endl;
+	}
+
 	// This is an infinite loop; it runs until the power is turned off. This loop
 	// continually updates motor position, setpoint, and pwm output.
-	portTickType previousTicks = xTaskGetTickCount ();
 	*p_serial << "this should only appear once" << endl;
 	while(1)
 	{
-		
-		//calculate linear distance from the setpoint, then pass that linear distance to both motors. We control distance from goal and angular heading.
-		LinearDistance = sqrt(pow((setpoint_l_2 - Robot_Pos_Y_INERT),2) + pow((setpoint_l_1-Robot_Pos_X_INERT),2));
-		int16_t AngleGoal = atan2((setpoint_l_2 - Robot_Pos_Y_INERT), (setpoint_l_1-Robot_Pos_X_INERT));
-		setpoint_a_1 = AngleGoal - LinearDistance;
-		if(setpoint_l_1-Robot_Pos_X_INERT <= 0)
+		control_timer_wait();
+
+		// task_user has the PWM timer to itself while it times the motor control, and
+		// sets it up again for this task when it's done; see task_user::time_motors()
+		if (motors_paused)
+		{
+			continue;
+		}
+
+		// Parameters staged by task_user are swapped in whole here, between passes, so
+		// no pass runs with some of the old ones and some of the new
+		if (params_staged.get_count() != params_seen)
 		{
-			LinearDistance = LinearDistance * -1;
+			params_seen = params_staged.get_count();
+			params_staged.get(&params);
+			drive_set_gains(motors, params.gains);
+			path.set_wheelbase(params.wheelbase_ticks);
+			profile.set_limits(params.limits, CONTROL_RATE_HZ);
+			params_live.put(params);
 		}
-		else {
-			//do nothing
+
+		// Autotuning; see relay_tuner.h. The relay drives the motors in place of the
+		// controller, first on the linear loop and then on the angular one, and the
+		// path following waits until it's done
+		if (autotune_request && tuning == TUNE_OFF)
+		{
+			autotune_request = false;
+			odometry_timer_counts(&count_l, &count_r);
+			tuner.start((count_l + count_r) / 2, TUNE_AMP_L, TUNE_HYST);
+			tuning = TUNE_LINEAR;
+			*p_serial << "Autotuning the linear loop" << endl;
+		}
+		if (tuning != TUNE_OFF)
+		{
+			odometry_timer_counts(&count_l, &count_r);
+			if (tuning == TUNE_LINEAR)
+			{
+				motors.run_open(tuner.update((count_l + count_r) / 2), 0, true,
+								diag_1, diag_2);
+				if (tuner.done())
+				{
+					tuned_l = tuner.gains(kp_tuned, ki_tuned);
+					*p_serial << "Linear: Tu " << tuner.get_period() << " passes, swing "
+							  << tuner.get_swing() << " ticks" << endl;
+					tuner.start(count_l - count_r, TUNE_AMP_A, TUNE_HYST);
+					tuning = TUNE_ANGULAR;
+					*p_serial << "Autotuning the angular loop" << endl;
+				}
+			}
+			else
+			{
+				motors.run_open(0, tuner.update(count_l - count_r), true, diag_1, diag_2);
+				if (tuner.done())
+				{
+					int16_t kp_a;
+					int16_t ki_a;
+					bool tuned_a = tuner.gains(kp_a, ki_a);
+					*p_serial << "Angular: Tu " << tuner.get_period() << " passes, swing "
+							  << tuner.get_swing() << " ticks" << endl;
+					if (tuned_l && tuned_a)
+					{
+						drive_gains& gains = params.gains;
+						*p_serial << "Gains were kp_l " << gains.kp_l << ", ki_l "
+								  << gains.ki_l << ", kp_a " << gains.kp_a << ", ki_a "
+								  << gains.ki_a << endl;
+						gains.kp_l = kp_tuned;
+						gains.ki_l = ki_tuned;
+						gains.kp_a = kp_a;
+						gains.ki_a = ki_a;
+						params.tuned = 1;
+						drive_set_gains(motors, gains);
+						params_live.put(params);
+						params_save_request = true;
+						*p_serial << "Gains now kp_l " << gains.kp_l << ", ki_l "
+								  << gains.ki_l << ", kp_a " << gains.kp_a << ", ki_a "
+								  << gains.ki_a << endl;
+					}
+					else
+					{
+						*p_serial << "Autotuning failed; the gains are unchanged" << endl;
+					}
+					motors.zero_esum_l();
+					motors.zero_esum_a();
+					profile.reset();
+					tuning = TUNE_OFF;
+				}
+			}
+			continue;
 		}
-		
-		// Updating positions, always zero because we've calculated the error above
-		motor1.set_position(0);
-		motor2.set_position(0);
-		
-		// Updating motor linear setpoints
-		motor1.set_setpoint_l(LinearDistance);
-		motor2.set_setpoint_l(LinearDistance);
-
-		// Updating angles
-		motor1.set_angle(AngleGoal - Robot_Angle_Theta_INERT);
-		motor2.set_angle(AngleGoal - Robot_Angle_Theta_INERT);
-		
-		// Updating angular setpoints, setpoint_a_1 is the goal angle of the robot.
-		motor1.set_setpoint_a(setpoint_a_1);
-		motor2.set_setpoint_a(setpoint_a_1);
+
+		// Following the path; see path_follower.cpp. The waypoints are taken as the
+		// follower has room for them, so the queue never holds up this loop. The linear
+		// loop tracks the motion profile's reference along the path rather than the
+		// whole distance left, so it doesn't sit at pwm_lim and then overshoot
+		while (path.has_room() && waypoint_queue.not_empty())
+		{
+			path.add(waypoint_queue.get());
+		}
+		odometry_timer_pose(&pose);
+		drive_setpoints sp = drive_follow_path(motors, path, profile, pose.x, pose.y,
+											   pose.heading, params.tuned ? &params.gains : NULL);
+		goal = path.target();
+		setpoint_l_1 = goal.x;
+		setpoint_l_2 = goal.y;
+		LinearDistance = sp.distance;
+		setpoint_a_1 = sp.steer;
+		robot_speeds.get(&speeds);
+		motors.set_velocity(speeds.left, speeds.right);
 
 		// Updating pwm outputs
 			// Input is run(proportional, integral, derivative, mode).
@@ -199,9 +323,9 @@ void task_motor::run (void)
 			// enabled (the first three arguments). The pins are modulated
 			// according to the drive mode. True means higher performance,
 			// false means lower current (ish). Higher performance is recommended,
-			// especially for lower pwm's.
-		diag_1 = motor1.run(true,true,false,true);
-		diag_2 = motor2.run(true,true,false,true);	// Currently is set to run in PI mode
+			// especially for lower pwm's. Both motors' outputs change in the
+			// same PWM period.
+		motors.run(true,true,true,true,diag_1,diag_2);	// Runs in PID mode
 
 		// Updating diagnostic shares
 		pwm_tot_1 = diag_1.pwm_tot;
@@ -216,11 +340,7 @@ void task_motor::run (void)
 		esum_a_2 = diag_2.esum_a_;
 
 		// Sending serial diagnostics
-		//*p_serial << "PWM setting (M1)" << pwm_1 << " (M2) " << pwm_2 << " time " << previousTicks << endl;
-
-		// Delaying
-		previousTicks = xTaskGetTickCount();
-		delay_from_to_ms(previousTicks,10);
+		//*p_serial << "PWM setting (M1)" << pwm_1 << " (M2) " << pwm_2 << endl;
 	}
 
 }
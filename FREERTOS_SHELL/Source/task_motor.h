@@ -4,6 +4,7 @@
  *
  *  Revisions:
  *    RT 12/4/18 - Original file
+ *    10/18/26 - Motors are run by a drive_pair controller
  *
  *  License:
  *    This file is copyright 2018 by Ricky Tan and released under the Lesser GNU 
@@ -41,8 +42,10 @@
 
 #include "shares.h"                         // Global ('extern') queue declarations
 
-#include "motorDriver.h"					// Motor driver class header file
-#include <math.h>							// Math Lib for calculating line length
+#include "drive_pair.h"						// Controller for both motors
+#include "drive_control.h"					// Steering towards the goal
+#include "control_timer.h"					// Timer interrupt which paces the loop
+#include "odometry_timer.h"					// The pose, kept by the odometry interrupt
 
 //-------------------------------------------------------------------------------------
 /** @brief   A motor controller task class.
@@ -58,8 +61,8 @@ private:
 	// No private variables or methods for this class
 
 protected:
-	motorDriver motor1 (char);	// motorDriver object for motor 1
-	motorDriver motor2 (char);	// motorDriver object for motor 2
+	// No protected variables or methods for this class; the motors are run by a
+	// drive_pair object local to run()
 
 public:
 	// This constructor creates a motor task object
@@ -8,6 +8,19 @@
  *    \li 10-05-2012 JRR Split into multiple files, one for each task
  *    \li 10-25-2012 JRR Changed to a more fully C++ version with class task_user
  *    \li 11-04-2012 JRR Modified from the data acquisition example to the test suite
+ *    \li 10-18-26 Added the 'c' command to time the fixed point math library
+ *    \li 10-18-26 Added the 'm' command to time the motor controllers
+ *    \li 10-18-26 The 'm' command also times the PWM updates
+ *    \li 10-18-26 The 'm' command times the controllers with derivative action on
+ *    \li 10-18-26 Added the 'p' command to send waypoints to the path follower
+ *    \li 10-18-26 Added the 'd' command to time the shared data classes
+ *    \li 10-18-26 Added seqlock_data to 'd', and the 'l' command for interrupt latency
+ *    \li 10-18-26 Added the 'a' command to autotune the drive gains
+ *    \li 10-18-26 Added the 'k' command to tune the parameters while the robot runs
+ *    \li 10-18-26 The 'm' command pauses task_motor and turns the motor outputs off
+ *    \li 10-18-26 Staging a linear gain sets 'tuned', so the speed bands don't undo it
+ *    \li 10-18-26 Added the 't' command to show the control and odometry timing
+ *    \li 10-18-26 The 'm' command's PWM timing leaves the motor outputs off too
  *
  *  License:
  *    This file is copyright 2012 by JR Ridgely and released under the Lesser GNU 
@@ -27,10 +40,18 @@
 
 #include <avr/io.h>                         // Port I/O for SFR's
 #include <avr/wdt.h>                        // Watchdog timer header
+#include <avr/interrupt.h>                  // For cli() and sei() while timing
+#include <math.h>                           // Float library, timed against ours
+#include <string.h>                         // For parsing tuning commands
+#include <avr/pgmspace.h>                   // For strcmp_P()
 
 #include "shared_data_sender.h"
 #include "shared_data_receiver.h"
 #include "task_user.h"                      // Header for this file
+#include "fixed_math.h"                     // Fixed point math library
+#include "drive_control.h"                  // Motor controllers, timed by 'm'
+#include "control_timer.h"                  // Control loop timing, shown by 't'
+#include "odometry_timer.h"                 // Odometry interrupt timing, shown by 't'
 
 
 /** This constant sets how many RTOS ticks the task delays if the user's not talking.
@@ -155,11 +176,61 @@ void task_user::run (void)
 							show_status ();
 							break;
 
+						// The 't' command shows the control loop's jitter and overruns
+						case ('t'):
+							show_timing ();
+							break;
+
 						// The 's' command has all the tasks dump their stacks
 						case ('s'):
 							print_task_stacks (p_serial);
 							break;
 
+						// The 'c' command counts cycles taken by the trig functions
+						case ('c'):
+							time_math ();
+							break;
+
+						// The 'm' command counts cycles taken by the motor controllers
+						case ('m'):
+							time_motors ();
+							break;
+
+						// The 'd' command counts cycles taken to share the robot's pose
+						case ('d'):
+							time_shares ();
+							break;
+
+						// The 'l' command finds how long sharing data holds off interrupts
+						case ('l'):
+							time_latency ();
+							break;
+
+						// The 'a' command has task_motor autotune its PI gains
+						case ('a'):
+							*p_serial << PMS ("Autotuning; keep clear of the robot")
+									  << endl;
+							autotune_request = true;
+							break;
+
+						// The 'k' command tunes the parameters in a shadow copy
+						case ('k'):
+							params_live.get (&tune_params);
+							tune_length = 0;
+							*p_serial << PMS ("Parameters: 'name value' stages one, 'name'")
+									  << PMS (" shows it; list, apply, save, revert,")
+									  << PMS (" default; Esc ends") << endl;
+							transition_to (3);
+							break;
+
+						// The 'p' command starts sending waypoints to task_motor
+						case ('p'):
+							*p_serial << PMS ("Waypoints as x y, one per line; Esc ends")
+									  << endl;
+							clear_waypoint ();
+							transition_to (2);
+							break;
+
 						// The 'h' command is a plea for help
 						case ('h'):
 							print_help_message ();
@@ -186,6 +257,45 @@ void task_user::run (void)
 				
 				break; // End of state 1
 
+			// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+			// In state 2, lines typed by the user are waypoints for the path follower.
+			// The escape key goes back to command mode
+			case (2):
+				if (p_serial->check_for_char ())
+				{
+					char_in = p_serial->getchar ();
+					if (char_in == 27)
+					{
+						*p_serial << endl << PMS ("End of waypoints") << endl;
+						transition_to (1);
+					}
+					else
+					{
+						waypoint_char (char_in);
+					}
+				}
+				break; // End of state 2
+
+			// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+			// In state 3, lines typed by the user tune the parameters. The escape key
+			// goes back to command mode; staged parameters which weren't applied are
+			// forgotten
+			case (3):
+				if (p_serial->check_for_char ())
+				{
+					char_in = p_serial->getchar ();
+					if (char_in == 27)
+					{
+						*p_serial << endl << PMS ("End of tuning") << endl;
+						transition_to (1);
+					}
+					else
+					{
+						tune_char (char_in);
+					}
+				}
+				break; // End of state 3
+
 			// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 			// We should never get to the default state. If we do, complain and restart
 			default:
@@ -196,6 +306,15 @@ void task_user::run (void)
 
 		} // End switch state
 
+		// Writing the EEPROM takes a few ms, too long for task_motor's loop, so when
+		// it has new parameters to keep it asks for them to be written here
+		if (params_save_request)
+		{
+			params_save_request = false;
+			params_save (params_live.get ());
+			*p_serial << PMS ("Parameters saved") << endl;
+		}
+
 		runs++;                             // Increment counter for debugging
 
 		// No matter the state, wait for approximately a millisecond before we 
@@ -220,11 +339,247 @@ void task_user::print_help_message (void)
 	*p_serial << PMS ("    n:   Show the time right now") << endl;
 	*p_serial << PMS ("    v:   Version and setup information") << endl;
 	*p_serial << PMS ("    s:   Stack dump for tasks") << endl;
+	*p_serial << PMS ("    t:   Control loop and odometry timing") << endl;
+	*p_serial << PMS ("    c:   Cycle counts for fixed point math") << endl;
+	*p_serial << PMS ("    m:   Cycle counts for motor control and PWM (stops the motors)") << endl;
+	*p_serial << PMS ("    d:   Cycle counts for sharing the robot's pose") << endl;
+	*p_serial << PMS ("    l:   Worst interrupt latency while sharing data") << endl;
+	*p_serial << PMS ("    p:   Send waypoints to the path follower") << endl;
+	*p_serial << PMS ("    a:   Autotune the drive gains (rocks and turns on the spot)") << endl;
+	*p_serial << PMS ("    k:   Tune the gains, limits and calibration") << endl;
 	*p_serial << PMS ("    e:   Exit command mode") << endl;
 	*p_serial << PMS ("    h:   HALP!") << endl;
 }
 
 
+//-------------------------------------------------------------------------------------
+/** This method clears the waypoint being typed, ready for the next one.
+ */
+
+void task_user::clear_waypoint (void)
+{
+	wp_coord[0] = 0;
+	wp_coord[1] = 0;
+	wp_index = 0;
+	wp_negative = false;
+	wp_digits = false;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method takes one character of a waypoint typed by the user. A waypoint is two
+ *  whole numbers of encoder ticks, x then y, separated by a space or a comma and ended
+ *  by Enter. Each one is put into waypoint_queue for task_motor, which takes them as its
+ *  path follower has room; if the queue is full, the waypoint is dropped and the user
+ *  is told to send it again later. Blank lines are ignored, so either or both of CR and
+ *  LF can end a line.
+ *  @param char_in The character typed
+ */
+
+void task_user::waypoint_char (char char_in)
+{
+	if (char_in >= '0' && char_in <= '9')
+	{
+		int32_t value = (int32_t)wp_coord[wp_index] * 10 + (char_in - '0');
+		wp_coord[wp_index] = (value > 32767) ? 32767 : (int16_t)value;
+		wp_digits = true;
+		p_serial->putchar (char_in);
+	}
+	else if (char_in == '-' && !wp_digits && !wp_negative)
+	{
+		wp_negative = true;
+		p_serial->putchar (char_in);
+	}
+	else if ((char_in == ' ' || char_in == ',') && wp_index == 0 && wp_digits)
+	{
+		if (wp_negative)
+		{
+			wp_coord[0] = -wp_coord[0];
+		}
+		wp_index = 1;
+		wp_negative = false;
+		wp_digits = false;
+		p_serial->putchar (' ');
+	}
+	else if (char_in == '\r' || char_in == '\n')
+	{
+		if (wp_index == 1 && wp_digits)
+		{
+			waypoint point;
+			point.x = wp_coord[0];
+			point.y = wp_negative ? -wp_coord[1] : wp_coord[1];
+			if (waypoint_queue.put (point))
+			{
+				*p_serial << PMS (" ok") << endl;
+			}
+			else
+			{
+				*p_serial << PMS (" queue full, send again") << endl;
+			}
+		}
+		else if (wp_index != 0 || wp_digits || wp_negative)
+		{
+			*p_serial << PMS (" ?") << endl;
+		}
+		clear_waypoint ();
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method takes one character of a tuning command typed by the user. Printable
+ *  characters are echoed and kept, up to TUNE_LINE_SIZE - 1 of them; Enter carries
+ *  out the command, and either or both of CR and LF can end a line.
+ *  @param char_in The character typed
+ */
+
+void task_user::tune_char (char char_in)
+{
+	if (char_in == '\r' || char_in == '\n')
+	{
+		if (tune_length > 0)
+		{
+			tune_line[tune_length] = '\0';
+			tune_command ();
+			tune_length = 0;
+		}
+	}
+	else if (char_in >= ' ' && char_in <= '~' && tune_length < TUNE_LINE_SIZE - 1)
+	{
+		tune_line[tune_length++] = char_in;
+		p_serial->putchar (char_in);
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method carries out a tuning command. Parameters are changed in tune_params, a
+ *  shadow copy, and nothing reaches task_motor until "apply" stages the whole copy in
+ *  params_staged; task_motor swaps it in between two passes of its loop, so no pass
+ *  runs with half of a set of changes. The commands are:
+ *    \li name value: Stages a new value of a parameter, if it's in range
+ *    \li name: Shows the staged value of a parameter
+ *    \li list: Shows all the staged parameters, and the running ones which differ
+ *    \li apply: Sends the staged parameters to task_motor
+ *    \li save: Writes the running parameters to the EEPROM
+ *    \li revert: Stages the running parameters again
+ *    \li default: Stages the parameters the firmware was built with
+ *  The wheelbase reaches the odometry only after a reset, so it has to be saved. The
+ *  speed bands set the linear gains on every pass unless 'tuned' is 1, so staging
+ *  kp_l, ki_l or kd_l sets it too; staging 'tuned 0' goes back to the bands.
+ */
+
+void task_user::tune_command (void)
+{
+	char* p_value = strchr (tune_line, ' ');
+	if (p_value != NULL)
+	{
+		*p_value++ = '\0';
+		while (*p_value == ' ')
+		{
+			p_value++;
+		}
+	}
+
+	if (strcmp_P (tune_line, PSTR ("list")) == 0)
+	{
+		*p_serial << endl;
+		tune_list ();
+	}
+	else if (strcmp_P (tune_line, PSTR ("apply")) == 0)
+	{
+		params_staged.put (tune_params);
+		*p_serial << PMS (" applied") << endl;
+	}
+	else if (strcmp_P (tune_line, PSTR ("save")) == 0)
+	{
+		params_save (params_live.get ());
+		*p_serial << PMS (" running parameters saved") << endl;
+	}
+	else if (strcmp_P (tune_line, PSTR ("revert")) == 0)
+	{
+		params_live.get (&tune_params);
+		*p_serial << PMS (" staged the running parameters") << endl;
+	}
+	else if (strcmp_P (tune_line, PSTR ("default")) == 0)
+	{
+		params_default (tune_params);
+		*p_serial << PMS (" staged the defaults") << endl;
+	}
+	else
+	{
+		int8_t index = params_find (tune_line);
+		if (index < 0)
+		{
+			*p_serial << PMS (" ?") << endl;
+		}
+		else if (p_value == NULL || *p_value == '\0')
+		{
+			*p_serial << PMS (" = ") << params_get (tune_params, index) << endl;
+		}
+		else
+		{
+			char* p_end;
+			int32_t value = strtol (p_value, &p_end, 10);
+			int32_t min;
+			int32_t max;
+			params_range (index, min, max);
+			if (p_end == p_value || *p_end != '\0')
+			{
+				*p_serial << PMS (" ?") << endl;
+			}
+			else if (!params_set (tune_params, index, value))
+			{
+				*p_serial << PMS (" out of range, ") << min << PMS (" to ") << max << endl;
+			}
+			else if (!tune_params.tuned
+					 && (strcmp_P (tune_line, PSTR ("kp_l")) == 0
+						 || strcmp_P (tune_line, PSTR ("ki_l")) == 0
+						 || strcmp_P (tune_line, PSTR ("kd_l")) == 0))
+			{
+				tune_params.tuned = 1;
+				*p_serial << PMS (" staged, and tuned 1 so the speed bands don't")
+						  << PMS (" override it") << endl;
+			}
+			else
+			{
+				*p_serial << PMS (" staged") << endl;
+			}
+		}
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method shows each parameter's staged value. Where the running value differs,
+ *  it's shown too, so the user can see what "apply" would change.
+ */
+
+void task_user::tune_list (void)
+{
+	robot_params running;
+	char name[PARAMS_NAME_SIZE];
+
+	params_live.get (&running);
+	for (uint8_t index = 0; index < PARAMS_COUNT; index++)
+	{
+		params_name (index, name);
+		*p_serial << PMS ("  ") << name;
+		for (uint8_t pad = strlen (name); pad < PARAMS_NAME_SIZE; pad++)
+		{
+			p_serial->putchar (' ');
+		}
+		int32_t staged = params_get (tune_params, index);
+		*p_serial << staged;
+		if (params_get (running, index) != staged)
+		{
+			*p_serial << PMS ("  (running ") << params_get (running, index) << ')';
+		}
+		*p_serial << endl;
+	}
+}
+
+
 //-------------------------------------------------------------------------------------
 /** This method displays information about the status of the system, including the
  *  following: 
@@ -251,3 +606,358 @@ void task_user::show_status (void)
 	print_task_list (p_serial);
 }
 
+
+//-------------------------------------------------------------------------------------
+/** This method shows how well the control loop and the odometry interrupt are keeping
+ *  time. The control loop's jitter is the spread of the time from its timer interrupt
+ *  to task_motor running; the latencies and the odometry interrupt's longest time are
+ *  measured afresh after each showing, while the runs and overruns count from the
+ *  start. task_diag shows the same figures when it's running.
+ */
+
+void task_user::show_timing (void)
+{
+	control_timing timing;
+	odometry_timing odo_timing;
+
+	control_timer_stats (&timing, true);
+	*p_serial << endl << PMS ("Control loop period: ") << timing.period_us
+			  << PMS (" us, runs: ") << timing.runs << PMS (", overruns: ")
+			  << timing.overruns << endl;
+	*p_serial << PMS ("  Latency min: ") << timing.latency_min_us << PMS (" us, max: ")
+			  << timing.latency_max_us << PMS (" us, jitter: ")
+			  << (uint16_t)(timing.latency_max_us - timing.latency_min_us)
+			  << PMS (" us") << endl;
+
+	odometry_timer_stats (&odo_timing, true);
+	*p_serial << PMS ("Odometry period: ") << odo_timing.period_us
+			  << PMS (" us, runs: ") << odo_timing.runs << PMS (", ISR last: ")
+			  << odo_timing.isr_last_us << PMS (" us, max: ") << odo_timing.isr_max_us
+			  << PMS (" us") << endl;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method measures how many CPU cycles the float library and the fixed point
+ *  library in fixed_math.h take for the functions used by the motor and odometry tasks.
+ *  Timer TCD0, which is otherwise unused, counts at the CPU clock while each function
+ *  runs with interrupts off; the result is the average over MATH_TIMING_RUNS inputs,
+ *  including a few cycles of call overhead.
+ */
+
+#define MATH_TIMING_RUNS 64
+
+// Runs one expression with interrupts off and adds the TCD0 count it took to the total
+#define TIME_CYCLES(total, expression)		\
+	do {									\
+		cli ();								\
+		TCD0.CNT = 0;						\
+		expression;							\
+		total += TCD0.CNT;					\
+		sei ();								\
+	} while (0)
+
+void task_user::time_math (void)
+{
+	// Volatile so the compiler can't throw away the results or hoist the calls
+	volatile double f_result;
+	volatile int32_t i_result;
+	volatile int16_t input = 0;
+	uint32_t t_sin = 0, t_fx_sin = 0, t_atan2 = 0, t_fx_atan2 = 0, t_sqrt = 0, t_fx_hypot = 0;
+
+	TCD0.PER = 0xFFFF;
+	TCD0.CTRLA = TC_CLKSEL_DIV1_gc;
+
+	for (uint8_t run = 0; run < MATH_TIMING_RUNS; run++)
+	{
+		int16_t x = input + run * 97 - 3000;
+		int16_t y = 2500 - run * 71;
+
+		TIME_CYCLES (t_sin, f_result = y * sin (x));
+		TIME_CYCLES (t_fx_sin, i_result = fx_mul_q15 (y, fx_sin (fx_rad_to_brad (x))));
+		TIME_CYCLES (t_atan2, f_result = atan2 (y, x));
+		TIME_CYCLES (t_fx_atan2, i_result = fx_brad_to_rad (fx_atan2 (y, x)));
+		TIME_CYCLES (t_sqrt, f_result = sqrt (pow (y, 2) + pow (x, 2)));
+		TIME_CYCLES (t_fx_hypot, i_result = fx_ihypot (x, y));
+	}
+	(void)f_result;							// The results are only stored, not looked at
+	(void)i_result;
+
+	TCD0.CTRLA = TC_CLKSEL_OFF_gc;
+
+	*p_serial << PMS ("Average cycles over ") << MATH_TIMING_RUNS << PMS (" inputs:") << endl;
+	*p_serial << PMS ("  y*sin(x):      float ") << (t_sin / MATH_TIMING_RUNS)
+			  << PMS (", fixed ") << (t_fx_sin / MATH_TIMING_RUNS) << endl;
+	*p_serial << PMS ("  atan2(y,x):    float ") << (t_atan2 / MATH_TIMING_RUNS)
+			  << PMS (", fixed ") << (t_fx_atan2 / MATH_TIMING_RUNS) << endl;
+	*p_serial << PMS ("  hypot(x,y):    float ") << (t_sqrt / MATH_TIMING_RUNS)
+			  << PMS (", fixed ") << (t_fx_hypot / MATH_TIMING_RUNS) << endl;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method measures how many CPU cycles a pass of the motor control takes with two
+ *  motorDriver objects, as task_motor used to run, and with one drive_pair. Each is
+ *  timed for the setpoint update from drive_to_goal() and the run() calls together,
+ *  and for the run() calls alone, as time_math() times the math functions. Setting
+ *  the four PWM duty cycles is timed on its own too, through ASF's pwm_start() as
+ *  motorDriver does it and through pwm_out_write() as drive_pair does. The
+ *  controllers write timer TCC0's compare registers as task_motor does, so task_motor
+ *  is paused through motors_paused and TCC0's outputs are turned off while they run;
+ *  the motor driver's inputs then sit low, which lets the motors coast. At the end
+ *  TCC0 is set up again, all four outputs low, and task_motor carries on from its next
+ *  pass. The objects are made on the heap, as this task's stack is too small for them.
+ */
+
+// Turns TCC0's compare outputs off, which leaves the motor driver's inputs at their
+// port pins' output values; these are cleared so the inputs are low
+#define PWM_OUTPUTS_OFF()										\
+	do {														\
+		TCC0.CTRLB &= ~(TC0_CCAEN_bm | TC0_CCBEN_bm | TC0_CCCEN_bm | TC0_CCDEN_bm);	\
+		PORTC.OUTCLR = PIN0_bm | PIN1_bm | PIN2_bm | PIN3_bm;	\
+	} while (0)
+
+void task_user::time_motors (void)
+{
+	// task_motor is the higher priority, so it's waiting for its next pass right now;
+	// it skips passes from here on until it's let go again
+	motors_paused = true;
+	PWM_OUTPUTS_OFF ();
+
+	motorDriver* p_motor1 = new motorDriver ('1', NULL);
+	motorDriver* p_motor2 = new motorDriver ('2', NULL);
+	drive_pair* p_motors = new drive_pair (NULL);
+	diagnostic diag_1, diag_2;
+	uint32_t t_single = 0, t_single_run = 0, t_pair = 0, t_pair_run = 0;
+	uint32_t t_pwm_start = 0, t_pwm_out = 0;
+	struct pwm_config pwm[4];
+	volatile uint8_t percent;				// Volatile so the writes aren't folded
+	volatile uint16_t counts;
+	uint16_t period = pwm_out_period ();
+
+	// Setting up the controllers set TCC0 up and turned its outputs back on
+	PWM_OUTPUTS_OFF ();
+
+	drive_set_gains (*p_motor1, *p_motor2, drive_gains_default);
+	drive_set_gains (*p_motors, drive_gains_default);
+
+	TCD0.PER = 0xFFFF;
+	TCD0.CTRLA = TC_CLKSEL_DIV1_gc;
+
+	for (uint8_t run = 0; run < MATH_TIMING_RUNS; run++)
+	{
+		int16_t goal_x = run * 13 - 400;
+		int16_t goal_y = 300 - run * 7;
+		int16_t theta = run * 5 - 150;
+		int16_t speed = run * 3 - 90;
+
+		TIME_CYCLES (t_single,
+					 drive_to_goal (*p_motor1, *p_motor2, 0, 0, theta, goal_x, goal_y);
+					 p_motor1->set_velocity (speed);
+					 p_motor2->set_velocity (-speed);
+					 diag_1 = p_motor1->run (true, true, true, true);
+					 diag_2 = p_motor2->run (true, true, true, true));
+		TIME_CYCLES (t_single_run,
+					 diag_1 = p_motor1->run (true, true, true, true);
+					 diag_2 = p_motor2->run (true, true, true, true));
+		TIME_CYCLES (t_pair,
+					 drive_to_goal (*p_motors, 0, 0, theta, goal_x, goal_y);
+					 p_motors->set_velocity (speed, -speed);
+					 p_motors->run (true, true, true, true, diag_1, diag_2));
+		TIME_CYCLES (t_pair_run,
+					 p_motors->run (true, true, true, true, diag_1, diag_2));
+	}
+
+	// The channels as motorDriver sets them up, for the PWM update alone
+	pwm_init (&pwm[0], PWM_TCC0, PWM_CH_A, PWM_OUT_FREQ_HZ);
+	pwm_init (&pwm[1], PWM_TCC0, PWM_CH_B, PWM_OUT_FREQ_HZ);
+	pwm_init (&pwm[2], PWM_TCC0, PWM_CH_C, PWM_OUT_FREQ_HZ);
+	pwm_init (&pwm[3], PWM_TCC0, PWM_CH_D, PWM_OUT_FREQ_HZ);
+
+	// ASF turned the outputs on again; the duty cycles timed here go up to 63%
+	PWM_OUTPUTS_OFF ();
+	for (uint8_t run = 0; run < MATH_TIMING_RUNS; run++)
+	{
+		percent = run;
+		counts = run * 1000U;
+
+		TIME_CYCLES (t_pwm_start,
+					 pwm_start (&pwm[0], 100);
+					 pwm_start (&pwm[1], 100 - percent);
+					 pwm_start (&pwm[2], 100 - percent);
+					 pwm_start (&pwm[3], 100));
+		TIME_CYCLES (t_pwm_out,
+					 pwm_out_write (period, period - counts, period - counts, period));
+	}
+
+	TCD0.CTRLA = TC_CLKSEL_OFF_gc;
+
+	// Setting the timer up again, as task_motor's drive_pair did, turns the outputs
+	// back on with all four inputs low; task_motor sets them on its next pass
+	pwm_out_init (PWM_OUT_FREQ_HZ);
+	delete p_motors;
+	delete p_motor2;
+	delete p_motor1;
+	motors_paused = false;
+
+	*p_serial << PMS ("Average cycles over ") << MATH_TIMING_RUNS << PMS (" passes:") << endl;
+	*p_serial << PMS ("  setpoints and run:  2 x motorDriver ") << (t_single / MATH_TIMING_RUNS)
+			  << PMS (", drive_pair ") << (t_pair / MATH_TIMING_RUNS) << endl;
+	*p_serial << PMS ("  run only:           2 x motorDriver ") << (t_single_run / MATH_TIMING_RUNS)
+			  << PMS (", drive_pair ") << (t_pair_run / MATH_TIMING_RUNS) << endl;
+	*p_serial << PMS ("  four PWM channels:  pwm_start ") << (t_pwm_start / MATH_TIMING_RUNS)
+			  << PMS (", pwm_out_write ") << (t_pwm_out / MATH_TIMING_RUNS) << endl;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method measures how many CPU cycles it takes to write and read the robot's
+ *  pose through a shared_data, as plain globals would have to be protected, through a
+ *  double_buffer, as task_Robot_State shares it, and through a seqlock_data, as the
+ *  odometry interrupt shares it. Each is timed as time_math() times the math functions.
+ *  The items timed are this method's own, so the real shares, which each have only one
+ *  writer, aren't touched. See time_latency() for how long each holds off interrupts.
+ */
+
+void task_user::time_shares (void)
+{
+	shared_data<odometry_pose> locked_pose;
+	double_buffer<odometry_pose> buffered_pose;
+	seqlock_data<odometry_pose> sequenced_pose;
+	odometry_pose pose;
+	volatile int16_t check;					// Volatile so the reads can't be dropped
+	uint32_t t_shared_put = 0, t_shared_get = 0, t_buffer_put = 0, t_buffer_get = 0;
+	uint32_t t_seqlock_put = 0, t_seqlock_get = 0;
+
+	TCD0.PER = 0xFFFF;
+	TCD0.CTRLA = TC_CLKSEL_DIV1_gc;
+
+	for (uint8_t run = 0; run < MATH_TIMING_RUNS; run++)
+	{
+		pose.x = run * 13 - 400;
+		pose.y = 300 - run * 7;
+		pose.heading = run * 1021U;
+
+		TIME_CYCLES (t_shared_put, locked_pose.put (pose));
+		TIME_CYCLES (t_shared_get, locked_pose.get (&pose); check = pose.x);
+		TIME_CYCLES (t_buffer_put, buffered_pose.put (pose));
+		TIME_CYCLES (t_buffer_get, buffered_pose.get (&pose); check = pose.x);
+		TIME_CYCLES (t_seqlock_put, sequenced_pose.put (pose));
+		TIME_CYCLES (t_seqlock_get, sequenced_pose.get (&pose); check = pose.x);
+	}
+	(void)check;							// Only stored, as time_math()'s results are
+
+	TCD0.CTRLA = TC_CLKSEL_OFF_gc;
+
+	*p_serial << PMS ("Average cycles over ") << MATH_TIMING_RUNS << PMS (" poses:") << endl;
+	*p_serial << PMS ("  put:  shared_data ") << (t_shared_put / MATH_TIMING_RUNS)
+			  << PMS (", double_buffer ") << (t_buffer_put / MATH_TIMING_RUNS)
+			  << PMS (", seqlock_data ") << (t_seqlock_put / MATH_TIMING_RUNS) << endl;
+	*p_serial << PMS ("  get:  shared_data ") << (t_shared_get / MATH_TIMING_RUNS)
+			  << PMS (", double_buffer ") << (t_buffer_get / MATH_TIMING_RUNS)
+			  << PMS (", seqlock_data ") << (t_seqlock_get / MATH_TIMING_RUNS) << endl;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** These are for time_latency(). TCD0's overflow interrupt notes how many counts after
+ *  the overflow it got to run, which is how long it waited plus how long it takes the
+ *  processor to get into an interrupt.
+ */
+
+#define LATENCY_PERIOD 4000					// TCD0's period, far longer than any copy
+#define LATENCY_OFFSETS 200					// Overflows this many places into each copy
+
+static volatile uint16_t latency_worst;		// Longest wait so far (CPU cycles)
+static volatile uint8_t latency_runs;		// Counts the interrupts, to wait for each one
+
+/** \cond NOT_ENABLED  (This ISR is not to be documented by Doxygen)
+ *  This interrupt keeps the longest time it has had to wait to run.
+ */
+ISR (TCD0_OVF_vect)
+{
+	uint16_t late = TCD0.CNT;
+	if (late > latency_worst)
+	{
+		latency_worst = late;
+	}
+	latency_runs++;
+}
+/// \endcond
+
+// Runs one expression LATENCY_OFFSETS times, with TCD0 overflowing 1, 2, 3... counts
+// into it, and puts the longest TCD0's interrupt waited into worst. Only the high level
+// interrupts are left on, so no other interrupt can be what held it up. The wait for
+// the interrupt gives up after a while, so this doesn't hang where TCD0 doesn't count
+#define TIME_LATENCY(worst, expression)								\
+	do {															\
+		uint8_t levels = PMIC.CTRL;									\
+		PMIC.CTRL = levels & ~(PMIC_LOLVLEN_bm | PMIC_MEDLVLEN_bm);	\
+		latency_worst = 0;											\
+		for (uint16_t offset = 0; offset < LATENCY_OFFSETS; offset++)	\
+		{															\
+			uint8_t runs_before = latency_runs;						\
+			TCD0.CNT = LATENCY_PERIOD - offset;						\
+			expression;												\
+			for (uint16_t wait = 0; latency_runs == runs_before		\
+				 && wait < LATENCY_PERIOD; wait++);					\
+		}															\
+		worst = latency_worst;										\
+		PMIC.CTRL = levels;											\
+	} while (0)
+
+
+//-------------------------------------------------------------------------------------
+/** This method finds the worst case interrupt latency while data is shared through a
+ *  shared_data and through a seqlock_data, for the robot's pose and for a set of
+ *  drive gains, which is four times the size. TCD0 is set to overflow at every point
+ *  through each put() and get() in turn, with its overflow interrupt at the high level,
+ *  which waits only while interrupts are turned off altogether. The latency with
+ *  nothing going on is the time it takes to get into an interrupt at all; anything
+ *  over that is time the sharing held interrupts off. The other interrupts are held
+ *  off for a few ms while it's measured, so the RTOS tick and the odometry are late
+ *  once each.
+ */
+
+void task_user::time_latency (void)
+{
+	shared_data<odometry_pose> locked_pose;
+	seqlock_data<odometry_pose> sequenced_pose;
+	shared_data<drive_gains> locked_gains;
+	seqlock_data<drive_gains> sequenced_gains;
+	odometry_pose pose = {100, -200, 0x4000};
+	drive_gains gains = drive_gains_default;
+	uint16_t l_none, l_pose_shared_put, l_pose_shared_get, l_pose_seqlock_put;
+	uint16_t l_pose_seqlock_get, l_gains_shared_put, l_gains_shared_get;
+	uint16_t l_gains_seqlock_put, l_gains_seqlock_get;
+
+	TCD0.CTRLA = TC_CLKSEL_OFF_gc;
+	TCD0.PER = LATENCY_PERIOD;
+	TCD0.INTFLAGS = TC0_OVFIF_bm;
+	TCD0.INTCTRLA = TC_OVFINTLVL_HI_gc;
+	TCD0.CTRLA = TC_CLKSEL_DIV1_gc;
+
+	TIME_LATENCY (l_none, );
+	TIME_LATENCY (l_pose_shared_put, locked_pose.put (pose));
+	TIME_LATENCY (l_pose_shared_get, locked_pose.get (&pose));
+	TIME_LATENCY (l_pose_seqlock_put, sequenced_pose.put (pose));
+	TIME_LATENCY (l_pose_seqlock_get, sequenced_pose.get (&pose));
+	TIME_LATENCY (l_gains_shared_put, locked_gains.put (gains));
+	TIME_LATENCY (l_gains_shared_get, locked_gains.get (&gains));
+	TIME_LATENCY (l_gains_seqlock_put, sequenced_gains.put (gains));
+	TIME_LATENCY (l_gains_seqlock_get, sequenced_gains.get (&gains));
+
+	TCD0.CTRLA = TC_CLKSEL_OFF_gc;
+	TCD0.INTCTRLA = TC_OVFINTLVL_OFF_gc;
+
+	*p_serial << PMS ("Worst interrupt latency in cycles, ") << l_none
+			  << PMS (" with nothing going on:") << endl;
+	*p_serial << PMS ("  pose put:   shared_data ") << l_pose_shared_put
+			  << PMS (", seqlock_data ") << l_pose_seqlock_put << endl;
+	*p_serial << PMS ("  pose get:   shared_data ") << l_pose_shared_get
+			  << PMS (", seqlock_data ") << l_pose_seqlock_get << endl;
+	*p_serial << PMS ("  gains put:  shared_data ") << l_gains_shared_put
+			  << PMS (", seqlock_data ") << l_gains_seqlock_put << endl;
+	*p_serial << PMS ("  gains get:  shared_data ") << l_gains_shared_get
+			  << PMS (", seqlock_data ") << l_gains_seqlock_get << endl;
+}
@@ -8,6 +8,9 @@
  *    \li 10-05-2012 JRR Split into multiple files, one for each task
  *    \li 10-25-2012 JRR Changed to a more fully C++ version with class task_user
  *    \li 11-04-2012 JRR Modified from the data acquisition example to the test suite
+ *    \li 10-18-26 Added waypoint entry for the path follower
+ *    \li 10-18-26 Added timing of the shared data classes
+ *    \li 10-18-26 Added the interrupt latency of the shared data classes
  *
  *  License:
  *    This file is copyright 2012 by JR Ridgely and released under the Lesser GNU 
@@ -43,6 +46,7 @@
 #include "frt_queue.h"                      // Header of wrapper for FreeRTOS queues
 #include "frt_text_queue.h"                 // Header for a "<<" queue class
 #include "frt_shared_data.h"                // Header for thread-safe shared data
+#include "frt_seqlock_data.h"               // Shared data without critical sections
 
 #include "shares.h"                         // Global ('extern') queue declarations
 
@@ -50,6 +54,9 @@
 /// This macro defines a string that identifies the name and version of this program. 
 #define PROGRAM_VERSION		PMS ("ME507 FreeRTOS xmega port ")
 
+/// Longest line typed while tuning parameters, with its terminating zero
+#define TUNE_LINE_SIZE 24
+
 
 //-------------------------------------------------------------------------------------
 /** This task interacts with the user for force him/her to do what he/she is told. What
@@ -63,7 +70,13 @@ private:
 	// No private variables or methods for this class
 
 protected:
-
+	int16_t wp_coord[2];					///< Coordinates of the waypoint being typed
+	uint8_t wp_index;						///< Which coordinate is being typed, x or y
+	bool wp_negative;						///< True if that coordinate has a minus sign
+	bool wp_digits;							///< True once it has a digit
+	robot_params tune_params;				///< Shadow copy of the parameters being tuned
+	char tune_line[TUNE_LINE_SIZE];			///< Line being typed while tuning
+	uint8_t tune_length;					///< Characters in it so far
 
 	// This method displays a simple help message telling the user what to do. It's
 	// protected so that only methods of this class or possibly descendants can use it
@@ -72,6 +85,36 @@ protected:
 	// This method displays information about the status of the system
 	void show_status (void);
 
+	// This method shows the control loop's jitter and the odometry interrupt's timing
+	void show_timing (void);
+
+	// This method times the fixed point math library against the float library
+	void time_math (void);
+
+	// This method times the drive_pair controller against two motorDriver objects
+	void time_motors (void);
+
+	// This method times double_buffer and seqlock_data against shared_data
+	void time_shares (void);
+
+	// This method finds the interrupt latency of seqlock_data and shared_data
+	void time_latency (void);
+
+	// This method clears the waypoint being typed
+	void clear_waypoint (void);
+
+	// This method takes a character of a waypoint, sending it to task_motor at the end
+	void waypoint_char (char char_in);
+
+	// This method takes a character of a tuning command, carrying it out at the end
+	void tune_char (char char_in);
+
+	// This method carries out a tuning command
+	void tune_command (void);
+
+	// This method shows the shadow copy of the parameters, and the running ones
+	void tune_list (void);
+
 public:
 	// This constructor creates a user interface task object
 	task_user (const char*, unsigned portBASE_TYPE, size_t, emstream*);
@@ -0,0 +1,227 @@
+//**************************************************************************************
+/** \file vision_fusion.cpp
+ *    This file contains the fusion of the vision tracker's poses into the odometry. See
+ *    vision_fusion.h.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include "vision_fusion.h"					// Header for this file
+
+
+//-------------------------------------------------------------------------------------
+/** This constructor creates a fusion with no history, with the robot at the origin.
+ */
+
+vision_fusion::vision_fusion (void)
+{
+	odometry_pose origin;
+	origin.x = 0;
+	origin.y = 0;
+	origin.heading = 0;
+	reset (origin);
+	counts.used = 0;
+	counts.rejected = 0;
+	counts.stale = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method forgets the history. Poses from the tracker can't be used until the
+ *  pictures for them were taken after the next record().
+ *  @param pose The odometry's pose now
+ */
+
+void vision_fusion::reset (const odometry_pose& pose)
+{
+	steps.flush ();
+	last = pose;
+	rejected = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method records how the odometry has moved since the last call. The positions
+ *  are whole ticks, but the steps add up to just the difference between the poses,
+ *  so nothing is lost to rounding. When the buffer is full the oldest step goes.
+ *  @param pose The odometry's pose now
+ *  @param time_ms The time now (RTOS ticks, in ms)
+ */
+
+void vision_fusion::record (const odometry_pose& pose, uint16_t time_ms)
+{
+	vision_step step;
+	step.time_ms = time_ms;
+	step.dx = pose.x - last.x;
+	step.dy = pose.y - last.y;
+	step.dheading = (int16_t)(pose.heading - last.heading);
+	steps.jam (step);
+	last = pose;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method adds up how the odometry has moved since the given time, going back
+ *  through the steps from the newest. Of the step the time falls in, only the part
+ *  after it is added, taking the robot to have moved steadily through the step.
+ *  @param time_ms The time to add up from (RTOS ticks, in ms)
+ *  @param dx Set to the change in X since then (ticks)
+ *  @param dy Set to the change in Y since then (ticks)
+ *  @param dheading Set to the change in heading since then (binary angle)
+ *  @return False if the time is before the oldest step, so it can't be worked out
+ */
+
+bool vision_fusion::replay (uint16_t time_ms, int32_t& dx, int32_t& dy, int16_t& dheading)
+{
+	dx = 0;
+	dy = 0;
+	dheading = 0;
+
+	size_t count = steps.num_items ();
+	for (size_t age = 0; age < count; age++)
+	{
+		const vision_step& step = steps.recent (age);
+		int16_t after = (int16_t)(step.time_ms - time_ms);
+		if (after <= 0)
+		{
+			return (true);					// The time is after this step
+		}
+		if (age + 1 >= count)
+		{
+			return (false);					// No telling when the oldest step began
+		}
+		uint16_t length = step.time_ms - steps.recent (age + 1).time_ms;
+		if ((uint16_t)after >= length)
+		{
+			dx += step.dx;
+			dy += step.dy;
+			dheading += step.dheading;
+		}
+		else
+		{
+			dx += (int32_t)step.dx * after / length;
+			dy += (int32_t)step.dy * after / length;
+			dheading += (int16_t)((int32_t)step.dheading * after / length);
+			return (true);
+		}
+	}
+	return (false);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method moves the last pose by a correction which has been made to the
+ *  odometry, and turns the history's steps by the correction's heading, so that the
+ *  history is the path the corrected odometry would have followed.
+ *  @param dx The correction to X (ticks)
+ *  @param dy The correction to Y (ticks)
+ *  @param dheading The correction to the heading (binary angle)
+ */
+
+void vision_fusion::shift (int16_t dx, int16_t dy, int16_t dheading)
+{
+	last.x += dx;
+	last.y += dy;
+	last.heading += dheading;
+	if (dheading == 0)
+	{
+		return;
+	}
+
+	int16_t sin_turn = fx_sin ((uint16_t)dheading);
+	int16_t cos_turn = fx_cos ((uint16_t)dheading);
+	size_t count = steps.num_items ();
+	for (size_t age = 0; age < count; age++)
+	{
+		vision_step& step = steps.recent (age);
+		int32_t x = step.dx;
+		int32_t y = step.dy;
+		step.dx = (int16_t)(fx_mul_q15 (x, cos_turn) - fx_mul_q15 (y, sin_turn));
+		step.dy = (int16_t)(fx_mul_q15 (x, sin_turn) + fx_mul_q15 (y, cos_turn));
+	}
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function divides a correction by 2^shift, rounding to nearest.
+ *  @param value The correction
+ *  @param shift How many places to shift it
+ *  @return The shifted correction
+ */
+
+static int32_t vision_scale (int32_t value, uint8_t shift)
+{
+	return ((value + ((1L << shift) >> 1)) >> shift);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method works out how to correct the odometry with a pose from the tracker,
+ *  replaying the odometry's path since the picture was taken from the tracker's pose.
+ *  If it returns true, the caller has to make the correction to the odometry; the
+ *  history has already been corrected.
+ *  @param fix The pose from the tracker, with the time its picture was taken
+ *  @param dx Set to the correction to X (ticks)
+ *  @param dy Set to the correction to Y (ticks)
+ *  @param dheading Set to the correction to the heading (binary angle)
+ *  @return True if the odometry is to be corrected, false if the pose wasn't used
+ */
+
+bool vision_fusion::update (const vision_fix& fix, int16_t& dx, int16_t& dy, int16_t& dheading)
+{
+	int32_t moved_x;
+	int32_t moved_y;
+	int16_t turned;
+	if (!replay (fix.captured_ms, moved_x, moved_y, turned))
+	{
+		counts.stale++;
+		return (false);
+	}
+
+	// The odometry's heading when the picture was taken, and how far off it was
+	int16_t turn = (int16_t)(fix.pose.heading - (uint16_t)(last.heading - turned));
+
+	// The path since then, turned by that and replayed from the tracker's pose
+	int16_t sin_turn = fx_sin ((uint16_t)turn);
+	int16_t cos_turn = fx_cos ((uint16_t)turn);
+	int32_t error_x = fix.pose.x + fx_mul_q15 (moved_x, cos_turn) 
+					  - fx_mul_q15 (moved_y, sin_turn) - last.x;
+	int32_t error_y = fix.pose.y + fx_mul_q15 (moved_x, sin_turn) 
+					  + fx_mul_q15 (moved_y, cos_turn) - last.y;
+
+	uint8_t places = VISION_FUSION_SHIFT;
+	if (error_x > VISION_GATE_TICKS || error_x < -VISION_GATE_TICKS 
+		|| error_y > VISION_GATE_TICKS || error_y < -VISION_GATE_TICKS
+		|| turn > VISION_GATE_BRAD || turn < -VISION_GATE_BRAD)
+	{
+		if (++rejected < VISION_REJECTS_MAX)
+		{
+			counts.rejected++;
+			return (false);
+		}
+		places = 0;							// The odometry is lost; start again from here
+	}
+	rejected = 0;
+
+	dx = (int16_t)vision_scale (error_x, places);
+	dy = (int16_t)vision_scale (error_y, places);
+	dheading = (int16_t)vision_scale (turn, places);
+	shift (dx, dy, dheading);
+	counts.used++;
+	return (true);
+}
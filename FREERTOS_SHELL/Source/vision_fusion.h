@@ -0,0 +1,117 @@
+//**************************************************************************************
+/** \file vision_fusion.h
+ *    This file contains header stuff for fusing the vision tracker's poses into the
+ *    odometry. The tracker's poses are absolute but come late, so each is compared
+ *    with where the odometry had the robot when the picture was taken, not where it
+ *    has it now. Like odometry.h it has no RTOS or hardware calls, so the simulator
+ *    can run it.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _VISION_FUSION_H_
+#define _VISION_FUSION_H_
+
+#include <stdint.h>
+
+#include "circ_buffer.h"					// Holds the history of odometry steps
+#include "fixed_math.h"						// For turning the history
+#include "odometry.h"						// For the pose
+#include "vision_link.h"					// For the tracker's poses
+
+#define VISION_HISTORY_STEPS 32				// Steps kept; at a step per 15 ms pass, 480 ms
+#define VISION_FUSION_SHIFT 1				// Each pose takes 1/2^this of the difference
+#define VISION_GATE_TICKS 400				// Bigger differences are bad poses (ticks)
+#define VISION_GATE_BRAD 0x1000				// and (binary angle)
+#define VISION_REJECTS_MAX 8				// After this many bad poses in a row, the odometry
+											// is taken to be lost and the next is used whole
+
+/// How the odometry moved between one record() and the next
+struct vision_step
+{
+	uint16_t time_ms;						// When the step ended (RTOS ticks, in ms)
+	int16_t dx;								// Change in position (ticks)
+	int16_t dy;
+	int16_t dheading;						// Change in heading (binary angle)
+};
+
+/// What became of the tracker's poses, as returned by vision_fusion::get_counts()
+struct vision_fusion_counts
+{
+	uint16_t used;							// Poses which corrected the odometry
+	uint16_t rejected;						// Poses too far from the odometry to believe
+	uint16_t stale;							// Poses taken before the history starts
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   Corrects the odometry with the vision tracker's late poses.
+ *  @details Each pass of the state task records how the odometry has moved since the
+ *           last pass, with the time, in a circular buffer of VISION_HISTORY_STEPS. A
+ *           pose from the tracker carries the time its picture was taken. The steps
+ *           since then are added up, interpolating the step the picture was taken in,
+ *           to find how far the robot has gone since; the odometry's pose then is its
+ *           pose now less that. The difference between that and the tracker's pose is
+ *           what the odometry had wrong. The path since then is replayed from the
+ *           tracker's pose instead, turned by the heading error, to give where the
+ *           robot really is now. The odometry is moved 1/2^VISION_FUSION_SHIFT of the
+ *           way there, so noise in the tracker's poses is smoothed out.
+ *
+ *           Once the odometry has been corrected, the history is moved and turned with
+ *           it, so that a later pose taken before the correction is replayed against
+ *           the corrected path and the correction isn't made twice.
+ *
+ *           A pose more than VISION_GATE_TICKS or VISION_GATE_BRAD off is ignored as a
+ *           mistake of the tracker's, unless VISION_REJECTS_MAX come in a row. A pose
+ *           taken before the oldest step can't be compared, so it's ignored too.
+ */
+
+class vision_fusion
+{
+protected:
+	circ_buffer<vision_step, VISION_HISTORY_STEPS> steps;	// The odometry's recent path
+	odometry_pose last;						// The pose at the last record()
+	uint8_t rejected;						// Bad poses in a row
+	vision_fusion_counts counts;			// What became of the poses
+
+	// Adds up the steps since the given time
+	bool replay (uint16_t time_ms, int32_t& dx, int32_t& dy, int16_t& dheading);
+
+	// Moves the last pose and turns the history by a correction to the odometry
+	void shift (int16_t dx, int16_t dy, int16_t dheading);
+
+public:
+	// This constructor creates a fusion with no history, at the origin
+	vision_fusion (void);
+
+	// Forgets the history and starts again from the given pose
+	void reset (const odometry_pose& pose);
+
+	// Records how the odometry has moved since the last call
+	void record (const odometry_pose& pose, uint16_t time_ms);
+
+	// Works out the correction to the odometry from a pose from the tracker
+	bool update (const vision_fix& fix, int16_t& dx, int16_t& dy, int16_t& dheading);
+
+	/** This method gets what has become of the tracker's poses so far.
+	 *  @return The counts
+	 */
+	const vision_fusion_counts& get_counts (void) { return (counts); }
+};
+
+#endif // _VISION_FUSION_H_
@@ -0,0 +1,200 @@
+//**************************************************************************************
+/** \file vision_link.cpp
+ *    This file contains the robot's end of the link from the vision tracker. See
+ *    vision_link.h for the packets, and for what sends them, which so far is only
+ *    the simulator.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-19-26 Says that no tracker sends these packets yet
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include <avr/io.h>                         // Port I/O for SFR's
+#include <avr/interrupt.h>                  // For the receiver interrupt
+#include <util/crc16.h>						// For _crc8_ccitt_update()
+
+#include "FreeRTOS.h"                       // Primary header for FreeRTOS
+#include "task.h"                           // For the tick count and critical sections
+
+#include "vision_link.h"
+
+#define VISION_USART USARTF0				// Spare USART; USARTD0 is the user's
+#define VISION_PORT PORTF
+#define VISION_RX_PIN_bm PIN2_bm
+#define VISION_BSEL 33						// 115200 baud at 32 MHz with BSCALE = -1,
+#define VISION_BSCALE 0x0F					// as base232.cpp sets it up
+
+/// The packet being received: how many bytes have come in, the payload, its CRC so
+/// far and the tick count when its first byte came in
+static uint8_t vision_index = 0;
+static uint8_t vision_payload[VISION_PAYLOAD];
+static uint8_t vision_crc = 0;
+static uint16_t vision_start_ms = 0;
+
+/// The newest good packet, and whether it has been read
+static vision_fix vision_newest;
+static bool vision_new = false;
+
+static vision_link_counts vision_counts;
+
+
+//-------------------------------------------------------------------------------------
+/** This function sets up USARTF0 and starts its receiver interrupt. The interrupt is
+ *  at the low level, the same as the RTOS tick, so it can't cut into the tick while
+ *  the tick count is being changed.
+ */
+
+void vision_link_start (void)
+{
+	VISION_USART.CTRLA = USART_RXCINTLVL_OFF_gc;
+	VISION_USART.CTRLB = 0;
+
+	portENTER_CRITICAL ();
+	vision_index = 0;
+	vision_new = false;
+	vision_counts.packets = 0;
+	vision_counts.crc_errors = 0;
+	vision_counts.line_errors = 0;
+	vision_counts.skipped = 0;
+	portEXIT_CRITICAL ();
+
+	VISION_PORT.DIRCLR = VISION_RX_PIN_bm;
+	VISION_USART.CTRLC = USART_CMODE_ASYNCHRONOUS_gc | USART_PMODE_DISABLED_gc
+						 | USART_CHSIZE_8BIT_gc;
+	VISION_USART.BAUDCTRLA = VISION_BSEL;
+	VISION_USART.BAUDCTRLB = (VISION_BSCALE << USART_BSCALE0_bp);
+	VISION_USART.CTRLB = USART_RXEN_bm;
+	(void)VISION_USART.DATA;				// Empty the receiver
+	(void)VISION_USART.DATA;
+	VISION_USART.CTRLA = USART_RXCINTLVL_LO_gc;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function puts together a 16 bit number sent low byte first.
+ *  @param p_bytes The two bytes
+ *  @return The number
+ */
+
+static inline uint16_t vision_word (const uint8_t* p_bytes)
+{
+	return ((uint16_t)p_bytes[0] | ((uint16_t)p_bytes[1] << 8));
+}
+
+
+/** \cond NOT_ENABLED  (This ISR is not to be documented by Doxygen)
+ *  This interrupt takes each byte as it comes in. It waits for the two start bytes,
+ *  stamping the packet with the time the first came in, then collects the payload and
+ *  works out its CRC as it goes. If the CRC byte matches, the packet is decoded into
+ *  the newest pose. A byte with a framing error or after an overrun throws the packet
+ *  away, as some of it has been lost.
+ */
+ISR (USARTF0_RXC_vect)
+{
+	uint8_t status = VISION_USART.STATUS;	// Must be read before the data
+	uint8_t byte = VISION_USART.DATA;
+
+	if (status & (USART_FERR_bm | USART_BUFOVF_bm))
+	{
+		vision_counts.line_errors++;
+		vision_index = 0;
+		return;
+	}
+
+	if (vision_index == 0)
+	{
+		if (byte == VISION_SYNC_1)
+		{
+			vision_start_ms = (uint16_t)(xTaskGetTickCountFromISR () * portTICK_RATE_MS);
+			vision_index = 1;
+		}
+	}
+	else if (vision_index == 1)
+	{
+		if (byte == VISION_SYNC_2)
+		{
+			vision_crc = 0;
+			vision_index = 2;
+		}
+		else if (byte != VISION_SYNC_1)		// A repeated first byte may be the real one
+		{
+			vision_index = 0;
+		}
+	}
+	else if (vision_index < 2 + VISION_PAYLOAD)
+	{
+		vision_payload[vision_index - 2] = byte;
+		vision_crc = _crc8_ccitt_update (vision_crc, byte);
+		vision_index++;
+	}
+	else
+	{
+		vision_index = 0;
+		if (byte != vision_crc)
+		{
+			vision_counts.crc_errors++;
+			return;
+		}
+		if (vision_new)
+		{
+			vision_counts.skipped++;
+		}
+		vision_newest.sequence = vision_payload[0];
+		vision_newest.pose.x = (int16_t)vision_word (vision_payload + 1);
+		vision_newest.pose.y = (int16_t)vision_word (vision_payload + 3);
+		vision_newest.pose.heading = vision_word (vision_payload + 5);
+		vision_newest.captured_ms = vision_start_ms - vision_word (vision_payload + 7);
+		vision_new = true;
+		vision_counts.packets++;
+	}
+}
+/// \endcond
+
+
+//-------------------------------------------------------------------------------------
+/** This function gets the newest pose from the tracker, if there's a new one. The
+ *  interrupt is held off while it's copied, so all of it is from the same packet.
+ *  @param p_fix Where to put the pose
+ *  @return True if there was a new pose, false if p_fix was left alone
+ */
+
+bool vision_link_get (vision_fix* p_fix)
+{
+	bool got = false;
+	portENTER_CRITICAL ();
+	if (vision_new)
+	{
+		*p_fix = vision_newest;
+		vision_new = false;
+		got = true;
+	}
+	portEXIT_CRITICAL ();
+	return (got);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This function gets the counts of packets received so far.
+ *  @param p_counts Where to put the counts
+ */
+
+void vision_link_stats (vision_link_counts* p_counts)
+{
+	portENTER_CRITICAL ();
+	*p_counts = vision_counts;
+	portEXIT_CRITICAL ();
+}
@@ -0,0 +1,94 @@
+//**************************************************************************************
+/** \file vision_link.h
+ *    This file contains header stuff for the link from the vision tracker. A tracker
+ *    works out where the robot is from an overhead camera and sends it down a serial
+ *    line to USARTF0 (PF2 receives). The receiver interrupt decodes the packets as
+ *    the bytes come in and keeps the newest good one, with the time the picture was
+ *    taken as the robot's clock reckons it, for task_Robot_State to fuse.
+ *
+ *    Nothing on the Raspberry Pi sends these packets yet: R_Pi_VisionTrack only sends
+ *    its poses over UDP (Vision_Udp.h), in the arena's frame and units. The sender is
+ *    left for later, as it also has to turn those into the odometry's frame and into
+ *    encoder ticks. For now the only sender is the simulator's, Sim/sim_vision.cpp;
+ *    on the robot, with nothing wired to PF2, no good packets come in and the
+ *    odometry runs on its own.
+ *
+ *    A packet is 12 bytes, with 16 bit numbers sent low byte first:
+ *      \li 0xA5, 0x5A: start of a packet
+ *      \li Sequence number, counting up by one each packet
+ *      \li X and Y of the robot, in encoder ticks, in the odometry's frame (int16)
+ *      \li Heading, CCW from the X axis (binary angle, uint16)
+ *      \li Age: how long before the first byte was sent the picture was taken (ms)
+ *      \li CRC-8 of the 9 bytes from the sequence number to the age, polynomial 0x07
+ *          and starting from 0, as avr-libc's _crc8_ccitt_update() works it out
+ *
+ *    The tracker has its own clock, so rather than a time stamp it sends the age, and
+ *    the interrupt stamps the packet with the RTOS tick count when it arrives.
+ *
+ *  Revisions:
+ *    \li 10-18-26 Original file
+ *    \li 10-19-26 Says that no tracker sends these packets yet
+ *
+ *  License:
+ *    This file is released under the Lesser GNU Public License, version 2. It 
+ *    intended for educational use only, but its use is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _VISION_LINK_H_
+#define _VISION_LINK_H_
+
+#include <stdint.h>
+
+#include "odometry.h"						// For the pose
+
+#define VISION_SYNC_1 0xA5					// First two bytes of each packet
+#define VISION_SYNC_2 0x5A
+#define VISION_PAYLOAD 9					// Bytes from the sequence number to the age
+#define VISION_PACKET (2 + VISION_PAYLOAD + 1)	// Whole packet, with the CRC
+
+/// A pose from the vision tracker
+struct vision_fix
+{
+	odometry_pose pose;						// Where the tracker saw the robot
+	uint16_t captured_ms;					// When the picture was taken (RTOS ticks, in ms)
+	uint8_t sequence;						// The packet's sequence number
+};
+
+/// Counts of what the link has received, as returned by vision_link_stats()
+struct vision_link_counts
+{
+	uint32_t packets;						// Good packets
+	uint16_t crc_errors;					// Packets thrown away for a bad CRC
+	uint16_t line_errors;					// Bytes lost to framing errors or overruns
+	uint16_t skipped;						// Good packets replaced before being read
+};
+
+/** This function sets up USARTF0 to receive at 115200 baud, 8 data bits, no parity,
+ *  and starts its receiver interrupt. Nothing is sent back to the tracker.
+ */
+void vision_link_start (void);
+
+/** This function gets the newest pose from the tracker, if one has come in since the
+ *  last call.
+ *  @param p_fix Where to put the pose
+ *  @return True if there was a new pose, false if p_fix was left alone
+ */
+bool vision_link_get (vision_fix* p_fix);
+
+/** This function gets the counts of packets received so far.
+ *  @param p_counts Where to put the counts
+ */
+void vision_link_stats (vision_link_counts* p_counts);
+
+#endif // _VISION_LINK_H_
@@ -0,0 +1,103 @@
+//**************************************************************************************
+/** \file wheel_speed.cpp
+ *    This file contains the wheel speed estimate, which times the encoder edges when a
+ *    wheel turns slowly and counts them when it turns quickly.
+ *
+ *  Revisions:
+ *    \li 10-18-26 - Original file
+ *
+ *  License:
+ *    This file is copyright 2018 by RG Dunn and released under the Lesser GNU 
+ *    Public License, version 2. It intended for educational use only, but its use
+ *    is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+#include "wheel_speed.h"                    // Header for this file
+
+
+//-------------------------------------------------------------------------------------
+/** This constructor creates an estimate of a wheel at rest, at a count of zero.
+ */
+
+wheel_speed::wheel_speed (void)
+{
+	reset (0);
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method puts the estimate back to a wheel at rest.
+ *  @param count Current count of the encoder, positive forwards
+ */
+
+void wheel_speed::reset (int32_t count)
+{
+	count_prev = count;
+	direction = 1;
+	speed = 0;
+}
+
+
+//-------------------------------------------------------------------------------------
+/** This method works out the wheel's speed.
+ *  @param count Current count of the encoder, positive forwards
+ *  @param interval_ms Time since the last call
+ *  @param period Capture timer counts between the encoder's last two edges
+ *  @param age Capture timer counts since the encoder's last edge
+ *  @return The speed (ticks/s)
+ */
+
+int16_t wheel_speed::update (int32_t count, uint16_t interval_ms, uint16_t period, uint16_t age)
+{
+	int32_t moved = count - count_prev;
+	count_prev = count;
+	if (moved > 0)
+	{
+		direction = 1;
+	}
+	else if (moved < 0)
+	{
+		direction = -1;
+	}
+
+	int32_t estimate;
+	if (moved >= WHEEL_SPEED_SWITCH_COUNTS || moved <= -WHEEL_SPEED_SWITCH_COUNTS)
+	{
+		// Fast: enough counts that differencing them is accurate
+		estimate = moved * 1000 / (interval_ms > 0 ? interval_ms : 1);
+	}
+	else
+	{
+		// Slow: the wheel can't be any quicker than the edge it's overdue for
+		uint16_t time = (age > period) ? age : period;
+		if (time == WHEEL_SPEED_NO_EDGE || time == 0)
+		{
+			estimate = 0;
+		}
+		else
+		{
+			estimate = direction * (WHEEL_SPEED_COUNTS_PER_EDGE * WHEEL_SPEED_CAPTURE_HZ / time);
+		}
+	}
+
+	if (estimate > 32767)
+	{
+		estimate = 32767;
+	}
+	else if (estimate < -32767)
+	{
+		estimate = -32767;
+	}
+	speed = (int16_t)estimate;
+	return speed;
+}
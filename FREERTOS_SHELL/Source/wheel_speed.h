@@ -0,0 +1,75 @@
+//**************************************************************************************
+/** \file wheel_speed.h
+ *    This file contains header stuff for the wheel speed estimate, which times the
+ *    encoder edges when a wheel turns slowly and counts them when it turns quickly.
+ *    Like odometry.h it has no RTOS or hardware calls, so the simulator can run it.
+ *
+ *  Revisions:
+ *    \li 10-18-26 - Original file
+ *
+ *  License:
+ *    This file is copyright 2018 by RG Dunn and released under the Lesser GNU 
+ *    Public License, version 2. It intended for educational use only, but its use
+ *    is not limited thereto. */
+/*    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" 
+ *    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE 
+ *    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE 
+ *    ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE 
+ *    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUEN-
+ *    TIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS 
+ *    OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER 
+ *    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, 
+ *    OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE 
+ *    OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE. */
+//**************************************************************************************
+
+// This define prevents this .h file from being included multiple times in a .cpp file
+#ifndef _WHEEL_SPEED_H_
+#define _WHEEL_SPEED_H_
+
+#include <stdint.h>
+
+#define WHEEL_SPEED_CAPTURE_HZ 500000L		// Edge timer's clock, F_CPU / 64 on TCE0
+#define WHEEL_SPEED_COUNTS_PER_EDGE 4		// One timed edge per encoder line
+#define WHEEL_SPEED_SWITCH_COUNTS 16		// Counts per update above which they're differenced
+#define WHEEL_SPEED_NO_EDGE 0xFFFF			// Period or age too long to time (QDEC_PERIOD_NONE)
+
+/// The speeds of both wheels, from the same update
+struct wheel_speeds
+{
+	int16_t left;			// Left wheel, positive forwards (ticks/s)
+	int16_t right;			// Right wheel, positive forwards
+};
+
+//-------------------------------------------------------------------------------------
+/** @brief   Speed of one wheel in encoder ticks per second.
+ *  @details Differencing the count over a few ms gives a speed in steps of 1000 /
+ *           DELAYINTERVAL_MS ticks/s, which at low speed is mostly noise. Below
+ *           WHEEL_SPEED_SWITCH_COUNTS per update the speed is worked out instead from
+ *           the time between the last two edges of the encoder, as timed by
+ *           QDEC_TC_Period_Setup(). Once edges stop coming, the time since the last one
+ *           is used if it's longer, so the estimate falls away to zero when the wheel
+ *           stops rather than holding its last value.
+ */
+
+class wheel_speed
+{
+protected:
+	int32_t count_prev;				// Encoder count at the last update
+	int8_t direction;				// Sign of the last movement, 1 or -1
+	int16_t speed;					// The latest estimate (ticks/s)
+
+public:
+	// This constructor creates an estimate of a wheel at rest
+	wheel_speed (void);
+
+	// Starts again at rest from the given count
+	void reset (int32_t count);
+
+	// Works out the speed from the count and the edge timing
+	int16_t update (int32_t count, uint16_t interval_ms, uint16_t period, uint16_t age);
+
+	int16_t get_speed (void) { return speed; }
+};
+
+#endif // _WHEEL_SPEED_H_
@@ -0,0 +1,285 @@
+//**************************************************************************************
+/** \file Vision_Batch.cpp
+ *    This file contains the batch mode used to turn a recorded match into a pose log as
+ *    fast as the Pi's cores allow, rather than at camera speed.
+ *
+ *    Every frame is independent as far as finding squares goes, so frames are decoded
+ *    in order by the calling thread and handed to a pool of workers in any order. The
+ *    only state that carries from frame to frame is the tracking (a robot keeps its
+ *    last pose while its squares are hidden), and that is rebuilt by a merge thread
+ *    which takes the results back in frame order before writing them out.
+ *
+ *  Revisions:
+ *    \li 10-18-26 - original file
+ *
+ *  License:
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *    GNU General Public License for more details.
+*/
+//**************************************************************************************
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "opencv2/videoio.hpp"
+#include "Vision_Pipeline.h"
+#include "Vision_Batch.h"
+#include "Vision_PoseLog.h"
+
+using namespace cv;
+using namespace std;
+
+/// One decoded frame waiting for a worker
+struct BatchJob
+{
+    int64_t seq;
+    int64_t timestamp_us;
+    Mat frame;
+};
+
+/// The poses found in one frame, waiting for the merge
+struct BatchResult
+{
+    int64_t timestamp_us;
+    RobotPose robots[NUM_ROBOTS];
+};
+
+//-------------------------------------------------------------------------------------
+/** This class holds the queues shared by the decoder, the workers and the merge. Jobs
+ *  go in bounded so that a fast decoder can't fill memory with frames; results come
+ *  back keyed by frame number so the merge can wait for the next one in order.
+ */
+class BatchQueues
+{
+public:
+    BatchQueues(size_t maxJobs) : maxJobs(maxJobs), decodeDone(false), total(-1) {}
+
+    void putJob(const BatchJob& job)
+    {
+        unique_lock<mutex> guard(lock);
+        jobSpace.wait(guard, [this]{ return jobs.size() < maxJobs; });
+        jobs.push_back(job);
+        jobReady.notify_one();
+    }
+
+    /// Returns false once the decoder is finished and the queue is empty
+    bool getJob(BatchJob& job)
+    {
+        unique_lock<mutex> guard(lock);
+        jobReady.wait(guard, [this]{ return !jobs.empty() || decodeDone; });
+        if (jobs.empty())
+        {
+            return false;
+        }
+        job = jobs.front();
+        jobs.pop_front();
+        jobSpace.notify_one();
+        return true;
+    }
+
+    void finishDecode(int64_t frames)
+    {
+        lock_guard<mutex> guard(lock);
+        decodeDone = true;
+        total = frames;
+        jobReady.notify_all();
+        resultReady.notify_all();
+    }
+
+    void putResult(int64_t seq, const BatchResult& result)
+    {
+        lock_guard<mutex> guard(lock);
+        results[seq] = result;
+        resultReady.notify_all();
+    }
+
+    /// Returns false once every frame has been handed to the merge
+    bool getResult(int64_t seq, BatchResult& result)
+    {
+        unique_lock<mutex> guard(lock);
+        resultReady.wait(guard, [this, seq]{ return results.count(seq) || (total >= 0 && seq >= total); });
+        map<int64_t, BatchResult>::iterator it = results.find(seq);
+        if (it == results.end())
+        {
+            return false;
+        }
+        result = it->second;
+        results.erase(it);
+        return true;
+    }
+
+private:
+    mutex lock;
+    condition_variable jobSpace;
+    condition_variable jobReady;
+    condition_variable resultReady;
+    deque<BatchJob> jobs;
+    size_t maxJobs;
+    map<int64_t, BatchResult> results;
+    bool decodeDone;
+    int64_t total;                      ///< Number of frames decoded, -1 until known
+};
+
+//-------------------------------------------------------------------------------------
+/** This function is run by each worker thread. It processes whatever frame is next in
+ *  the queue; nothing here depends on any other frame.
+ */
+static void batchWorker(BatchQueues& queues, const Mat& homography)
+{
+    BatchJob job;
+    while (queues.getJob(job))
+    {
+        SquareDetection squares[NUM_SQUARES];
+        BatchResult result;
+        result.timestamp_us = job.timestamp_us;
+        findSquares(job.frame, squareMasks, squares);
+        toArena(homography, squares);
+        resolveRobots(squares, job.timestamp_us, 0, result.robots);
+        queues.putResult(job.seq, result);
+    }
+}
+
+//-------------------------------------------------------------------------------------
+/** This function is the ordered merge. It takes results back in frame order, carries
+ *  each robot's last seen pose through frames where it wasn't found, and writes one
+ *  CSV line per robot per frame. The \c seen column tells whether the pose came from
+ *  this frame or was held over. If a binary log is given it gets the same records,
+ *  and the CSV stream is left alone.
+ */
+static void batchMerge(BatchQueues& queues, ostream& log, PoseLogWriter* binLog)
+{
+    RobotPose track[NUM_ROBOTS];
+    for (int r = 0; r < NUM_ROBOTS; r++)
+    {
+        track[r] = RobotPose();
+        track[r].valid = false;
+    }
+
+    if (binLog == NULL)
+    {
+        log << "frame,time_us,robot,seen,x,y,angle,confidence" << endl;
+    }
+    BatchResult result;
+    for (int64_t seq = 0; queues.getResult(seq, result); seq++)
+    {
+        if (binLog != NULL)
+        {
+            // The log writer does its own holding over of unseen robots
+            binLog->append(result.timestamp_us, result.robots);
+            continue;
+        }
+        for (int r = 0; r < NUM_ROBOTS; r++)
+        {
+            const RobotPose& p = result.robots[r];
+            if (p.valid)
+            {
+                track[r] = p;
+            }
+            log << seq << "," << result.timestamp_us << "," << (r + 1) << "," << (p.valid ? 1 : 0) << ","
+                << track[r].x << "," << track[r].y << "," << track[r].angle << "," << track[r].confidence << "\n";
+        }
+    }
+    log.flush();
+    if (binLog != NULL)
+    {
+        binLog->close();
+    }
+}
+
+//-------------------------------------------------------------------------------------
+/** This function processes a whole recording and writes its pose log.
+ *  @param spec The recording, \c file[\@homography.yml] as for the live tracker
+ *  @param logPath Where to write the pose log; binary if it ends in .pl, else CSV
+ *  @param numThreads Number of worker threads; 0 uses one per core
+ *  @return 0 on success, -1 if the recording or log couldn't be opened
+ */
+int runBatch(const string& spec, const string& logPath, int numThreads)
+{
+    size_t at = spec.find('@');
+    string source = spec.substr(0, at);
+    Mat homography;
+    if (at != string::npos && !loadHomography(spec.substr(at + 1), homography))
+    {
+        cout << "No 3x3 homography in " << spec.substr(at + 1) << endl;
+        return -1;
+    }
+
+    VideoCapture cap(source);
+    if (!cap.isOpened())
+    {
+        cout << "Cannot open recording " << source << endl;
+        return -1;
+    }
+    ofstream log;
+    PoseLogWriter binLog;
+    bool binary = logPath.size() > 3 && logPath.compare(logPath.size() - 3, 3, ".pl") == 0;
+    if (binary)
+    {
+        binLog.open(logPath, squareMasks, 1);
+    }
+    else
+    {
+        log.open(logPath.c_str());
+    }
+    if (binary ? !binLog.isOpen() : !log)
+    {
+        cout << "Cannot open pose log " << logPath << endl;
+        return -1;
+    }
+
+    if (numThreads <= 0)
+    {
+        numThreads = (int)thread::hardware_concurrency();
+        if (numThreads <= 0)
+        {
+            numThreads = 1;
+        }
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    BatchQueues queues(numThreads * BATCH_QUEUE_PER_THREAD);
+    vector<thread> workers;
+    for (int i = 0; i < numThreads; i++)
+    {
+        workers.push_back(thread(batchWorker, ref(queues), cref(homography)));
+    }
+    thread merge(batchMerge, ref(queues), ref(log), binary ? &binLog : (PoseLogWriter*)NULL);
+
+    // Decoding has to stay in order and in one thread; it feeds everything else
+    BatchJob job;
+    int64_t seq = 0;
+    int64_t lastStamp_us = 0;
+    while (cap.read(job.frame))
+    {
+        job.seq = seq++;
+        job.timestamp_us = (int64_t)(cap.get(CAP_PROP_POS_MSEC) * 1000.0);
+        lastStamp_us = job.timestamp_us;
+        queues.putJob(job);
+        job.frame = Mat();              // The queued copy shares its pixels; make read() allocate anew
+    }
+    queues.finishDecode(seq);
+
+    for (size_t i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+    merge.join();
+
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    cout << "Processed " << seq << " frames on " << numThreads << " threads in " << elapsed << " s";
+    if (elapsed > 0.0)
+    {
+        cout << " (" << (lastStamp_us / 1e6) / elapsed << "x real time)";
+    }
+    cout << endl;
+    return 0;
+}
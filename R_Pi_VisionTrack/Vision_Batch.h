@@ -0,0 +1,27 @@
+//**************************************************************************************
+/** \file Vision_Batch.h
+ *    This file contains the batch mode used to turn a recorded match into a pose log as
+ *    fast as the Pi's cores allow, rather than at camera speed.
+ *
+ *  Revisions:
+ *    \li 10-18-26 - original file
+ *
+ *  License:
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *    GNU General Public License for more details.
+*/
+//**************************************************************************************
+
+#ifndef VISION_BATCH_H
+#define VISION_BATCH_H
+
+#include <string>
+
+/// Frames decoded ahead of the workers, per worker. Bounds memory on long recordings.
+#define BATCH_QUEUE_PER_THREAD 4
+
+int runBatch(const std::string& spec, const std::string& logPath, int numThreads);
+
+#endif // VISION_BATCH_H
@@ -0,0 +1,74 @@
+//**************************************************************************************
+/** \file Vision_Budget.cpp
+ *    This file contains the frame budget controller, which trades image quality for
+ *    speed so that a loaded Pi keeps up with its cameras rather than falling behind.
+ *
+ *  Revisions:
+ *    \li 10-18-26 - original file
+ *
+ *  License:
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *    GNU General Public License for more details.
+*/
+//**************************************************************************************
+
+#include "Vision_Budget.h"
+
+const QualityLevel budgetLevels[BUDGET_NUM_LEVELS] =
+{
+    // downsample, roiHalfSize, robotsTracked
+    { 1,   0, NUM_ROBOTS },                 // 0: everything, as findSquares()
+    { 2,   0, NUM_ROBOTS },                 // 1: half resolution
+    { 2, 160, NUM_ROBOTS },                 // 2: half resolution, windows around robots
+    { 2,  96, NUM_ROBOTS },                 // 3: smaller windows
+    { 2,  96, NUM_ROBOTS - 1 },             // 4: drop the last robot
+    { 2,  96, 1 }                           // 5: robot 1 only
+};
+
+//-------------------------------------------------------------------------------------
+/** This constructor starts at full quality.
+ *  @param period_ms The frame period to stay within, normally 1000/fps of the camera
+ */
+FrameBudget::FrameBudget(double period_ms)
+    : period(period_ms), average_ms(0.0), current(0), hold(0)
+{
+    for (int i = 0; i < BUDGET_NUM_LEVELS; i++)
+    {
+        cost[i] = 0.0;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+/** This method is called once per frame with the time the frame took to process, and
+ *  may change the level used for the next frame.
+ *  @param frame_ms Processing time of the frame just finished, ms
+ */
+void FrameBudget::update(double frame_ms)
+{
+    average_ms = (average_ms == 0.0) ? frame_ms
+                                     : BUDGET_ALPHA * frame_ms + (1.0 - BUDGET_ALPHA) * average_ms;
+    if (current > 0)
+    {
+        cost[current - 1] *= BUDGET_FORGET;
+    }
+    if (hold > 0)
+    {
+        hold--;
+        return;
+    }
+
+    if (average_ms > BUDGET_HIGH * period && current < BUDGET_NUM_LEVELS - 1)
+    {
+        cost[current] = average_ms;
+        current++;
+        hold = BUDGET_HOLD_FRAMES;
+    }
+    else if (average_ms < BUDGET_LOW * period && current > 0
+             && cost[current - 1] < BUDGET_HIGH * period)
+    {
+        current--;
+        hold = BUDGET_HOLD_FRAMES;
+    }
+}
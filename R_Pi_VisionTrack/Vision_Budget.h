@@ -0,0 +1,64 @@
+//**************************************************************************************
+/** \file Vision_Budget.h
+ *    This file contains the frame budget controller, which trades image quality for
+ *    speed so that a loaded Pi keeps up with its cameras rather than falling behind.
+ *
+ *  Revisions:
+ *    \li 10-18-26 - original file
+ *
+ *  License:
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *    GNU General Public License for more details.
+*/
+//**************************************************************************************
+
+#ifndef VISION_BUDGET_H
+#define VISION_BUDGET_H
+
+#include "Vision_Pipeline.h"
+
+#define BUDGET_NUM_LEVELS 6                 ///< Quality levels, 0 is full quality
+#define BUDGET_ALPHA 0.1                    ///< Weight of the newest frame in the average
+#define BUDGET_HIGH 0.85                    ///< Step down above this fraction of the period
+#define BUDGET_LOW 0.5                      ///< Step up below this fraction of the period
+#define BUDGET_HOLD_FRAMES 15               ///< Frames to wait after a step before another
+#define BUDGET_FORGET 0.995                 ///< Per frame decay of a remembered level cost
+
+/// What each level does, from full quality down. See QualityLevel.
+extern const QualityLevel budgetLevels[BUDGET_NUM_LEVELS];
+
+//-------------------------------------------------------------------------------------
+/** This class keeps an exponentially weighted average of the time taken to process
+ *  each frame and picks a quality level from it. When the average gets close to the
+ *  frame period it steps one level down: first shrinking the frame, then searching
+ *  smaller windows around each robot, then dropping the lowest priority robots (the
+ *  highest numbered ones). When there is plenty of headroom it steps back up. After
+ *  each step it waits a while for the average to settle.
+ *
+ *  One step down can easily quarter the cost, so plenty of headroom alone would send
+ *  it straight back up. Instead the cost of a level is remembered when stepping down
+ *  from it, and it only steps back up once that remembered cost would fit. The memory
+ *  fades with every frame, so once the load goes away it does try again.
+ */
+class FrameBudget
+{
+public:
+    FrameBudget(double period_ms);
+
+    void setPeriod(double period_ms) { period = period_ms; }
+    void update(double frame_ms);
+    int level() const { return current; }
+    const QualityLevel& quality() const { return budgetLevels[current]; }
+    double average() const { return average_ms; }
+
+private:
+    double period;                          ///< Target frame period, ms
+    double average_ms;                      ///< Weighted average processing time, ms
+    int current;                            ///< Current level, 0 is full quality
+    int hold;                               ///< Frames left before the next step is allowed
+    double cost[BUDGET_NUM_LEVELS];         ///< Remembered cost of each level, ms, 0 if none
+};
+
+#endif // VISION_BUDGET_H
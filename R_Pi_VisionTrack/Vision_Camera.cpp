@@ -0,0 +1,218 @@
+//**************************************************************************************
+/** \file Vision_Camera.cpp
+ *    This file contains the worker which owns one camera (or one replay file), runs the
+ *    square finding pipeline on its frames in its own thread, and hands the resulting
+ *    robot poses to the shared PoseFusion.
+ *
+ *  Revisions:
+ *    \li 10-18-26 - original file, for multi-camera tracking
+ *    \li 10-18-26 - added the frame budget
+ *
+ *  License:
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *    GNU General Public License for more details.
+*/
+//**************************************************************************************
+
+#include <chrono>
+#include <iostream>
+#include <stdlib.h>
+#include "Vision_Camera.h"
+
+using namespace cv;
+using namespace std;
+
+/// Zero point for live camera timestamps, shared by all workers so they compare
+static const chrono::steady_clock::time_point clockStart = chrono::steady_clock::now();
+
+//-------------------------------------------------------------------------------------
+/** This constructor splits the source specification but doesn't open anything yet.
+ *  @param index Camera number, used to tag poses and name windows
+ *  @param spec Source specification, \c source[\@homography.yml]
+ *  @param fusion The fusion object every worker reports to
+ */
+CameraWorker::CameraWorker(int index, const string& spec, PoseFusion& fusion)
+    : index(index), fusion(fusion), running(false), done(false), level(0), budgetPeriod(-1.0),
+      fresh(false)
+{
+    size_t at = spec.find('@');
+    source = spec.substr(0, at);
+    if (at != string::npos)
+    {
+        homographyFile = spec.substr(at + 1);
+    }
+    replay = source.empty() || source.find_first_not_of("0123456789") != string::npos;
+
+    for (int i = 0; i < NUM_SQUARES; i++)
+    {
+        lastSquares[i].found = false;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+/** The destructor makes sure the thread is gone before the capture is released.
+ */
+CameraWorker::~CameraWorker()
+{
+    stop();
+}
+
+//-------------------------------------------------------------------------------------
+/** This method opens the camera or replay file and loads the homography, if any.
+ *  @return True if the source opened and the homography (if given) is a 3x3 matrix
+ */
+bool CameraWorker::open()
+{
+    if (replay)
+    {
+        cap.open(source);
+    }
+    else
+    {
+        cap.open(atoi(source.c_str()));
+    }
+    if (!cap.isOpened())
+    {
+        cout << "Cannot open camera " << index << " (" << source << ")" << endl;
+        return false;
+    }
+
+    if (!homographyFile.empty())
+    {
+        if (!loadHomography(homographyFile, homography))
+        {
+            cout << "Camera " << index << ": no 3x3 homography in " << homographyFile << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+//-------------------------------------------------------------------------------------
+/** This method starts the worker thread. open() must have succeeded first.
+ */
+void CameraWorker::start()
+{
+    running = true;
+    worker = thread(&CameraWorker::run, this);
+}
+
+//-------------------------------------------------------------------------------------
+/** This method asks the worker thread to finish its current frame and waits for it.
+ */
+void CameraWorker::stop()
+{
+    running = false;
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+}
+
+//-------------------------------------------------------------------------------------
+/** This method copies out the newest frame and its square detections (in pixels) for
+ *  display. Each frame is only handed out once.
+ *  @param frame Output, the raw camera frame
+ *  @param squares Output, the squares found in that frame, in image pixels
+ *  @return True if a frame was copied, false if there has been no new frame since the
+ *          last call
+ */
+bool CameraWorker::latest(Mat& frame, SquareDetection squares[NUM_SQUARES])
+{
+    lock_guard<mutex> guard(frameLock);
+    if (!fresh)
+    {
+        return false;
+    }
+    lastFrame.copyTo(frame);
+    for (int i = 0; i < NUM_SQUARES; i++)
+    {
+        squares[i] = lastSquares[i];
+    }
+    fresh = false;
+    return true;
+}
+
+//-------------------------------------------------------------------------------------
+/** This method is the body of the worker thread. It reads frames until stopped or the
+ *  source runs dry, and for each one finds the squares, moves them into the arena
+ *  frame, resolves the robots and submits them to the fusion. Only that processing is
+ *  timed for the frame budget; waiting for the camera is free.
+ */
+void CameraWorker::run()
+{
+    chrono::steady_clock::time_point replayStart = chrono::steady_clock::now();
+
+    double period = budgetPeriod;
+    if (period < 0.0)
+    {
+        double fps = cap.get(CAP_PROP_FPS);
+        period = 1000.0 / ((fps > 0.0) ? fps : 30.0);
+    }
+    FrameBudget budget(period);
+
+    SquareDetection pixels[NUM_SQUARES];    // Last frame's squares, where to look next
+    for (int i = 0; i < NUM_SQUARES; i++)
+    {
+        pixels[i].found = false;
+    }
+
+    while (running)
+    {
+        Mat imgOriginal;
+        if (!cap.read(imgOriginal))
+        {
+            cout << "Cannot read a frame from camera " << index << endl;
+            break;
+        }
+
+        int64_t stamp_us;
+        if (replay)
+        {
+            stamp_us = (int64_t)(cap.get(CAP_PROP_POS_MSEC) * 1000.0);
+            // Hold the replay back to real time so that it lines up with the others
+            this_thread::sleep_until(replayStart + chrono::microseconds(stamp_us));
+        }
+        else
+        {
+            stamp_us = chrono::duration_cast<chrono::microseconds>(
+                chrono::steady_clock::now() - clockStart).count();
+        }
+
+        chrono::steady_clock::time_point started = chrono::steady_clock::now();
+
+        // The masks may be nudged by the trackbars in the main thread meanwhile; a torn
+        // read only costs one frame of a slightly odd threshold
+        SquareDetection squares[NUM_SQUARES];
+        int quality = (period > 0.0) ? budget.level() : 0;
+        findSquaresAt(imgOriginal, squareMasks, budgetLevels[quality], pixels, squares);
+        for (int i = 0; i < NUM_SQUARES; i++)
+        {
+            pixels[i] = squares[i];
+        }
+
+        {
+            lock_guard<mutex> guard(frameLock);
+            lastFrame = imgOriginal;
+            for (int i = 0; i < NUM_SQUARES; i++)
+            {
+                lastSquares[i] = squares[i];
+            }
+            fresh = true;
+        }
+
+        RobotPose poses[NUM_ROBOTS];
+        toArena(homography, squares);
+        resolveRobots(squares, stamp_us, index, poses);
+        fusion.submit(index, poses);
+
+        level = quality;
+        if (period > 0.0)
+        {
+            budget.update(chrono::duration<double, milli>(chrono::steady_clock::now() - started).count());
+        }
+    }
+    done = true;
+}
@@ -0,0 +1,89 @@
+//**************************************************************************************
+/** \file Vision_Camera.h
+ *    This file contains the worker which owns one camera (or one replay file), runs the
+ *    square finding pipeline on its frames in its own thread, and hands the resulting
+ *    robot poses to the shared PoseFusion.
+ *
+ *  Revisions:
+ *    \li 10-18-26 - original file, for multi-camera tracking
+ *    \li 10-18-26 - added the frame budget
+ *
+ *  License:
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *    GNU General Public License for more details.
+*/
+//**************************************************************************************
+
+#ifndef VISION_CAMERA_H
+#define VISION_CAMERA_H
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "opencv2/videoio.hpp"
+#include "Vision_Pipeline.h"
+#include "Vision_Fusion.h"
+#include "Vision_Budget.h"
+
+//-------------------------------------------------------------------------------------
+/** This class runs one camera source in a thread of its own. A source is given as
+ *  \c source[\@homography.yml], where \c source is either a camera index such as \c 0
+ *  or the path of a recorded video. The optional YAML file holds a 3x3 matrix under the
+ *  key \c homography which maps that camera's pixels into the shared arena frame;
+ *  without one, poses are reported in raw pixels, which is only sensible with a single
+ *  camera.
+ *
+ *  Live cameras are stamped with a monotonic clock. Replay files are stamped with their
+ *  own media time and paced to real time, so several recordings of the same match
+ *  started together line up in the fusion.
+ *
+ *  Each worker times its own processing and lets a FrameBudget lower the quality of
+ *  the square search when it can't keep up with the camera.
+ *
+ *  The worker never touches HighGUI; the main thread pulls the latest frame with
+ *  latest() and displays it.
+ */
+class CameraWorker
+{
+public:
+    CameraWorker(int index, const std::string& spec, PoseFusion& fusion);
+    ~CameraWorker();
+
+    bool open();
+    void start();
+    void stop();
+    bool finished() const { return done; }
+    int getIndex() const { return index; }
+    void setBudget(double period_ms) { budgetPeriod = period_ms; }
+    int qualityLevel() const { return level; }
+
+    bool latest(cv::Mat& frame, SquareDetection squares[NUM_SQUARES]);
+
+private:
+    void run();
+
+    int index;                          ///< Camera number, also used in RobotPose::camera
+    std::string source;                 ///< Camera index or replay file path
+    std::string homographyFile;         ///< Empty if no homography was given
+    bool replay;                        ///< True if source is a file rather than a camera
+
+    cv::VideoCapture cap;
+    cv::Mat homography;
+    PoseFusion& fusion;
+
+    std::thread worker;
+    std::atomic<bool> running;
+    std::atomic<bool> done;             ///< Set when the source runs out of frames
+    std::atomic<int> level;             ///< Quality level of the last frame, 0 is full
+    double budgetPeriod;                ///< Frame budget in ms, 0 for none, <0 for camera fps
+
+    std::mutex frameLock;               ///< Guards the three members below
+    cv::Mat lastFrame;
+    SquareDetection lastSquares[NUM_SQUARES];
+    bool fresh;                         ///< True until latest() has returned lastFrame
+};
+
+#endif // VISION_CAMERA_H
@@ -0,0 +1,146 @@
+//**************************************************************************************
+/** \file Vision_Fusion.cpp
+ *    This file contains the class which merges robot poses seen by several cameras into
+ *    one pose per robot.
+ *
+ *  Revisions:
+ *    \li 10-18-26 - original file, for multi-camera tracking
+ *
+ *  License:
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *    GNU General Public License for more details.
+*/
+//**************************************************************************************
+
+#include <math.h>
+#include "Vision_Fusion.h"
+
+using namespace std;
+
+//-------------------------------------------------------------------------------------
+/** This constructor sets up storage for the given number of cameras. Nothing has been
+ *  seen yet, so every pose starts out invalid at the origin and no camera has a frame
+ *  time, which is -1 so that a frame stamped 0 still counts as new.
+ *  @param numCameras How many camera workers will call submit()
+ */
+PoseFusion::PoseFusion(int numCameras)
+    : latest(numCameras * NUM_ROBOTS), lastFrame_us(numCameras, -1)
+{
+    for (size_t i = 0; i < latest.size(); i++)
+    {
+        latest[i] = RobotPose();
+        latest[i].valid = false;
+    }
+    for (int r = 0; r < NUM_ROBOTS; r++)
+    {
+        lastFused[r] = RobotPose();
+        lastFused[r].valid = false;
+        lastFused[r].camera = -1;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+/** This method records the poses one camera resolved from one frame. Robots the
+ *  camera didn't see keep that camera's previous detection, which ages out of the
+ *  fusion window on its own.
+ *  @param camera Index of the reporting camera
+ *  @param poses The camera's poses, already in the arena frame
+ */
+void PoseFusion::submit(int camera, const RobotPose poses[NUM_ROBOTS])
+{
+    lock_guard<mutex> guard(lock);
+    for (int r = 0; r < NUM_ROBOTS; r++)
+    {
+        if (poses[r].valid)
+        {
+            latest[camera*NUM_ROBOTS + r] = poses[r];
+        }
+        if (poses[r].timestamp_us > lastFrame_us[camera])
+        {
+            lastFrame_us[camera] = poses[r].timestamp_us;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------
+/** This method fuses the latest detections of every robot. Headings are averaged as
+ *  unit vectors so that 179 and -179 degrees average to 180 rather than 0.
+ *  @param fused Output, one pose per robot with camera set to -1
+ *  @return Time of the newest frame any camera has submitted, -1 if there is none yet
+ */
+int64_t PoseFusion::fuse(RobotPose fused[NUM_ROBOTS])
+{
+    lock_guard<mutex> guard(lock);
+
+    int64_t newestFrame = -1;
+    for (size_t c = 0; c < lastFrame_us.size(); c++)
+    {
+        if (lastFrame_us[c] > newestFrame)
+        {
+            newestFrame = lastFrame_us[c];
+        }
+    }
+
+    int numCameras = (int)lastFrame_us.size();
+    for (int r = 0; r < NUM_ROBOTS; r++)
+    {
+        // Find the newest detection of this robot by any camera
+        int64_t newest = 0;
+        bool seen = false;
+        for (int c = 0; c < numCameras; c++)
+        {
+            const RobotPose& p = latest[c*NUM_ROBOTS + r];
+            if (p.valid && (!seen || p.timestamp_us > newest))
+            {
+                newest = p.timestamp_us;
+                seen = true;
+            }
+        }
+
+        // Lost by every camera for longer than the window: hold the last fused pose
+        if (!seen || newestFrame - newest > FUSION_WINDOW_US)
+        {
+            lastFused[r].valid = false;
+            fused[r] = lastFused[r];
+            continue;
+        }
+
+        double wSum = 0.0, x = 0.0, y = 0.0, s = 0.0, co = 0.0, conf = 0.0;
+        int count = 0;
+        int onlyCamera = -1;
+        for (int c = 0; c < numCameras; c++)
+        {
+            const RobotPose& p = latest[c*NUM_ROBOTS + r];
+            if (!p.valid || newest - p.timestamp_us > FUSION_WINDOW_US)
+            {
+                continue;
+            }
+            // A tiny floor keeps two barely-seen detections from dividing by zero
+            double w = p.confidence + 1e-6;
+            x += w * p.x;
+            y += w * p.y;
+            s += w * sin(p.angle * M_PI / 180.0);
+            co += w * cos(p.angle * M_PI / 180.0);
+            if (p.confidence > conf)
+            {
+                conf = p.confidence;
+            }
+            wSum += w;
+            count++;
+            onlyCamera = c;
+        }
+
+        RobotPose& out = lastFused[r];
+        out.valid = true;
+        out.x = x / wSum;
+        out.y = y / wSum;
+        out.angle = atan2(s, co) * 180.0 / M_PI;
+        out.confidence = conf;
+        out.timestamp_us = newest;
+        out.camera = (count == 1) ? onlyCamera : -1;
+        fused[r] = out;
+    }
+    return newestFrame;
+}
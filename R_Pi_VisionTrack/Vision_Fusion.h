@@ -0,0 +1,51 @@
+//**************************************************************************************
+/** \file Vision_Fusion.h
+ *    This file contains the class which merges robot poses seen by several cameras into
+ *    one pose per robot.
+ *
+ *  Revisions:
+ *    \li 10-18-26 - original file, for multi-camera tracking
+ *
+ *  License:
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *    GNU General Public License for more details.
+*/
+//**************************************************************************************
+
+#ifndef VISION_FUSION_H
+#define VISION_FUSION_H
+
+#include <mutex>
+#include <vector>
+#include "Vision_Pipeline.h"
+
+/** Detections closer together in time than this are considered the same instant and
+ *  are averaged. Roughly one frame at 30 fps.
+ */
+#define FUSION_WINDOW_US 40000
+
+//-------------------------------------------------------------------------------------
+/** This class keeps the latest poses reported by each camera worker and fuses them per
+ *  robot. Of the detections of a robot, only those within FUSION_WINDOW_US of the
+ *  newest one are used, and those are averaged weighted by their confidence. If no
+ *  camera currently sees a robot, its last fused pose is kept but marked invalid.
+ *  All methods are safe to call from any thread.
+ */
+class PoseFusion
+{
+public:
+    PoseFusion(int numCameras);
+
+    void submit(int camera, const RobotPose poses[NUM_ROBOTS]);
+    int64_t fuse(RobotPose fused[NUM_ROBOTS]);
+
+private:
+    std::mutex lock;                                    ///< Guards everything below
+    std::vector<RobotPose> latest;                      ///< [camera*NUM_ROBOTS + robot]
+    std::vector<int64_t> lastFrame_us;                  ///< Newest frame time per camera, -1 if none
+    RobotPose lastFused[NUM_ROBOTS];                    ///< Held when a robot is lost
+};
+
+#endif // VISION_FUSION_H
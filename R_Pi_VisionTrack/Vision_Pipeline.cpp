@@ -0,0 +1,318 @@
+//**************************************************************************************
+/** \file Vision_Pipeline.cpp
+ *    This file contains the per-frame image processing used to find the colored squares
+ *    on top of each robot and resolve them into robot positions and headings.
+ *
+ *  Revisions:
+ *    \li 10-18-26 - split out of Vision.cpp so that several cameras can share it
+ *    \li 10-18-26 - added findSquaresAt() for reduced quality levels
+ *    \li 10-19-26 - squares not found are at 0, 0 and aren't transformed
+ *
+ *  License:
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *    GNU General Public License for more details.
+*/
+//**************************************************************************************
+
+#include <math.h>
+#include <vector>
+#include "opencv2/core.hpp"
+#include "opencv2/highgui.hpp"
+#include "Vision_Pipeline.h"
+
+using namespace cv;
+using namespace std;
+
+ColorMask squareMasks[NUM_SQUARES] =
+{
+    //Robot 1-R Color Mask
+    //This is the red rectangle that is present in the ME507.docx on Ryan's drive. Printed on 192-118 printer.
+    { 154, 179, 109, 255,  60, 255 },
+    //Robot 1-G Color Mask
+    //This is the green rectangle in the ME507.docx file on drive. Printed on the 192-118 printer.
+    {  30,  84,  49, 116, 159, 255 },
+    //Robot 2-O Color Mask (also used for testing)
+    //This is the orange rectangle that is present in the ME507.docx on Ryan's drive. Printed on 192-118 printer.
+    {   0,   9,  79, 178, 201, 255 },
+    //Robot 2-B Color Mask (also used for testing)
+    //This is the blue rectangle that is present in the ME507.docx on Ryan's drive. Printed on 192-118 printer.
+    { 101, 117, 102, 225, 168, 255 },
+    //Robot 3A Color Mask
+    //This is the YELLOW rectangle that is present in the ME507.docx on Ryan's drive. Printed on 192-118 printer.
+    {  14,  28,  79, 255, 168, 255 },
+    //Robot 3B Color Mask
+    //This is the Purple rectangle in the ME507.docx file on drive. Printed on the 192-118 printer.
+    { 128, 154, 102, 225, 127, 255 }
+};
+
+static const char* squareNames[NUM_SQUARES] = { "1A", "1B", "2A", "2B", "3A", "3B" };
+
+//-------------------------------------------------------------------------------------
+/** This function thresholds one square's color in an HSV image and finds its centroid
+ *  from the moments of the mask.
+ *  @param imgHSV The (possibly shrunk, possibly cropped) HSV image
+ *  @param m The square's color mask
+ *  @param scale How much imgHSV was shrunk by; area and position are scaled back up
+ *  @param offset Where imgHSV's top left corner is, in full frame pixels
+ *  @param square Output, the detection in full frame pixels
+ *  @param imgThresholded Output, the mask, kept for debug display
+ */
+static void measureSquare(const Mat& imgHSV, const ColorMask& m, int scale, Point offset,
+                          SquareDetection& square, Mat& imgThresholded)
+{
+    inRange(imgHSV, Scalar(m.iLowH, m.iLowS, m.iLowV), Scalar(m.iHighH, m.iHighS, m.iHighV), imgThresholded); //Threshold the image
+
+    //Calculate the moments of the thresholded image
+    Moments oMoments = moments(imgThresholded);
+    double dArea = oMoments.m00 * scale * scale;
+
+    // if the area <= 10000, I consider that the there are no object in the image and it's because of the noise, the area is not zero
+    square.found = (dArea > SQUARE_MIN_AREA);
+    square.area = dArea;
+    if (square.found)
+    {
+        square.x = oMoments.m10 / oMoments.m00 * scale + offset.x;
+        square.y = oMoments.m01 / oMoments.m00 * scale + offset.y;
+    }
+    else
+    {
+        square.x = 0;
+        square.y = 0;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+/** This function finds the centroid of each colored square in a camera frame.
+ *  1. imgOriginal is converted to HSV color format
+ *  2. imgHSV is thresholded to create a black/white mask
+ *  3. Moments are taken about the white color on the mask (centroids and second moments of area)
+ *  4. the center of the masked shape can be determined using the moments
+ *  5. This is repeated for all 6 squares
+ *  @param imgOriginal BGR frame straight from the camera
+ *  @param masks The color mask of each square
+ *  @param squares Output, one detection per square in image pixels
+ *  @param showThreshed Set to true to display the thresholded images. Only call with
+ *                      true from the thread that owns the HighGUI windows.
+ */
+void findSquares(const Mat& imgOriginal, const ColorMask masks[NUM_SQUARES],
+                 SquareDetection squares[NUM_SQUARES], bool showThreshed)
+{
+    Mat imgHSV;
+    Mat imgThresholded;
+
+    cvtColor(imgOriginal, imgHSV, COLOR_BGR2HSV); //Convert the captured frame from BGR to HSV
+
+    for (int i = 0; i < NUM_SQUARES; i++)
+    {
+        measureSquare(imgHSV, masks[i], 1, Point(0, 0), squares[i], imgThresholded);
+
+        if (showThreshed)
+        {
+            imshow(string("Thresholded Image - Square") + squareNames[i], imgThresholded); //show the thresholded image
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------
+/** This function is findSquares() with the work cut down to a quality level. The frame
+ *  is shrunk first if asked; each tracked robot is then searched for only in a window
+ *  around where it was in the last frame, or in the whole frame if it wasn't seen
+ *  there. Robots beyond quality.robotsTracked aren't searched for and come back not
+ *  found. Results are always in full frame pixels and areas, whatever the level.
+ *  @param imgOriginal BGR frame straight from the camera
+ *  @param masks The color mask of each square
+ *  @param quality How much work to do
+ *  @param last This camera's detections from its previous frame, in pixels
+ *  @param squares Output, one detection per square in image pixels
+ */
+void findSquaresAt(const Mat& imgOriginal, const ColorMask masks[NUM_SQUARES],
+                   const QualityLevel& quality, const SquareDetection last[NUM_SQUARES],
+                   SquareDetection squares[NUM_SQUARES])
+{
+    int ds = (quality.downsample > 1) ? quality.downsample : 1;
+    Mat imgSmall;
+    if (ds > 1)
+    {
+        resize(imgOriginal, imgSmall, Size(imgOriginal.cols / ds, imgOriginal.rows / ds), 0, 0, INTER_NEAREST);
+    }
+    else
+    {
+        imgSmall = imgOriginal;
+    }
+    Rect whole(0, 0, imgSmall.cols, imgSmall.rows);
+
+    Mat imgHSV;                         // Whole frame HSV, only made if some robot needs it
+    Mat imgThresholded;
+    for (int r = 0; r < NUM_ROBOTS; r++)
+    {
+        const SquareDetection& a = last[2*r];
+        const SquareDetection& b = last[2*r + 1];
+        if (r >= quality.robotsTracked)
+        {
+            squares[2*r] = SquareDetection();
+            squares[2*r + 1] = SquareDetection();
+            continue;
+        }
+
+        if (quality.roiHalfSize > 0 && a.found && b.found)
+        {
+            // Window around the last robot center, in shrunk frame pixels
+            int cx = (int)((a.x + b.x) / 2.0) / ds;
+            int cy = (int)((a.y + b.y) / 2.0) / ds;
+            int half = quality.roiHalfSize / ds;
+            Rect roi = Rect(cx - half, cy - half, 2*half, 2*half) & whole;
+            if (roi.area() > 0)
+            {
+                Mat roiHSV;
+                cvtColor(imgSmall(roi), roiHSV, COLOR_BGR2HSV);
+                Point offset(roi.x * ds, roi.y * ds);
+                measureSquare(roiHSV, masks[2*r], ds, offset, squares[2*r], imgThresholded);
+                measureSquare(roiHSV, masks[2*r + 1], ds, offset, squares[2*r + 1], imgThresholded);
+                continue;
+            }
+        }
+
+        if (imgHSV.empty())
+        {
+            cvtColor(imgSmall, imgHSV, COLOR_BGR2HSV);
+        }
+        measureSquare(imgHSV, masks[2*r], ds, Point(0, 0), squares[2*r], imgThresholded);
+        measureSquare(imgHSV, masks[2*r + 1], ds, Point(0, 0), squares[2*r + 1], imgThresholded);
+    }
+}
+
+//-------------------------------------------------------------------------------------
+/** This function loads a camera's image to arena homography from an OpenCV YAML or XML
+ *  file, where it is stored as a 3x3 matrix under the key \c homography.
+ *  @param file Path of the file
+ *  @param homography Output, the matrix
+ *  @return True if the file held a 3x3 matrix
+ */
+bool loadHomography(const string& file, Mat& homography)
+{
+    FileStorage fs(file, FileStorage::READ);
+    if (fs.isOpened())
+    {
+        fs["homography"] >> homography;
+    }
+    return homography.rows == 3 && homography.cols == 3;
+}
+
+//-------------------------------------------------------------------------------------
+/** This function maps square centroids from image pixels into the shared arena frame
+ *  using a camera's 3x3 homography. Squares which weren't found are left alone.
+ *  @param homography The camera's image to arena homography. If empty, the squares
+ *                    are left in image pixels.
+ *  @param squares The detections to transform in place
+ */
+void toArena(const Mat& homography, SquareDetection squares[NUM_SQUARES])
+{
+    if (homography.empty())
+    {
+        return;
+    }
+
+    vector<Point2f> pixels;
+    vector<Point2f> arena;
+    for (int i = 0; i < NUM_SQUARES; i++)
+    {
+        if (squares[i].found)
+        {
+            pixels.push_back(Point2f((float)squares[i].x, (float)squares[i].y));
+        }
+    }
+    if (pixels.empty())
+    {
+        return;
+    }
+    perspectiveTransform(pixels, arena, homography);
+    int next = 0;
+    for (int i = 0; i < NUM_SQUARES; i++)
+    {
+        if (squares[i].found)
+        {
+            squares[i].x = arena[next].x;
+            squares[i].y = arena[next].y;
+            next++;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------------------
+/** This function calculates actual robot center position and heading from the two
+ *  squares on each robot. Some basic trignometry is applied to compute the angle of
+ *  each robot. A robot is only valid if both of its squares were found.
+ *  @param squares The square detections, A (front) and B (rear) for each robot
+ *  @param timestamp_us Capture time of the frame, stamped into each pose
+ *  @param camera The camera the frame came from
+ *  @param robots Output, one pose per robot
+ */
+void resolveRobots(const SquareDetection squares[NUM_SQUARES], int64_t timestamp_us,
+                   int camera, RobotPose robots[NUM_ROBOTS])
+{
+    for (int r = 0; r < NUM_ROBOTS; r++)
+    {
+        const SquareDetection& a = squares[2*r];
+        const SquareDetection& b = squares[2*r + 1];
+        RobotPose& pose = robots[r];
+
+        pose.timestamp_us = timestamp_us;
+        pose.camera = camera;
+        pose.valid = a.found && b.found;
+        if (!pose.valid)
+        {
+            pose.confidence = 0.0;
+            continue;
+        }
+
+        pose.x = (b.x - a.x)/2.0 + a.x;
+        pose.y = (b.y - a.y)/2.0 + a.y;
+
+        //calculate some angles yo!
+        if ((b.x - a.x) < 0.1 && (b.x - a.x) > -0.1)
+        {
+            pose.angle = 90; // TODO: deal with 270deg edge case.
+        }
+        else if ((b.y - a.y) < 0.1 && (b.y - a.y) > -0.1)
+        {
+            pose.angle = 0; //TODO: deal with 180deg edge case.
+        }
+        else
+        {
+            pose.angle = atan2((b.y - a.y), (b.x - a.x)) * 180.0 / 3.14159;
+        }
+
+        // The weaker square limits how much we trust the pose; a square right at the
+        // noise threshold counts for nothing
+        double weakest = (a.area < b.area) ? a.area : b.area;
+        pose.confidence = 1.0 - SQUARE_MIN_AREA / weakest;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+/** This function draws a circle on each square that was found. Must be given pixel
+ *  coordinates, i.e. detections that have not been through toArena().
+ *  @param img The frame to draw on
+ *  @param squares The square detections in image pixels
+ */
+void drawDetections(Mat& img, const SquareDetection squares[NUM_SQUARES])
+{
+    for (int i = 0; i < NUM_SQUARES; i++)
+    {
+        if (squares[i].found)
+        {
+            circle(img, Point((int)squares[i].x, (int)squares[i].y), 3, Scalar(255, 0, 255), 2);
+        }
+    }
+    for (int r = 0; r < NUM_ROBOTS; r++)
+    {
+        const SquareDetection& a = squares[2*r];
+        const SquareDetection& b = squares[2*r + 1];
+        if (a.found && b.found)
+        {
+            circle(img, Point((int)((a.x + b.x)/2.0), (int)((a.y + b.y)/2.0)), 3, Scalar(255, 255, 255), 4);
+        }
+    }
+}
@@ -0,0 +1,91 @@
+//**************************************************************************************
+/** \file Vision_Pipeline.h
+ *    This file contains the per-frame image processing used to find the colored squares
+ *    on top of each robot and resolve them into robot positions and headings.
+ *
+ *  Revisions:
+ *    \li 10-18-26 - split out of Vision.cpp so that several cameras can share it
+ *    \li 10-18-26 - added findSquaresAt() for reduced quality levels
+ *
+ *  License:
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *    GNU General Public License for more details.
+*/
+//**************************************************************************************
+
+#ifndef VISION_PIPELINE_H
+#define VISION_PIPELINE_H
+
+#include <stdint.h>
+#include <string>
+#include "opencv2/imgproc.hpp"
+
+#define NUM_ROBOTS 3                    ///< Number of robots tracked in the arena
+#define NUM_SQUARES (2*NUM_ROBOTS)      ///< Two squares per robot, A is the front, B is the rear
+#define SQUARE_MIN_AREA 10000           ///< Mask area (moment m00) below which a square is considered noise
+
+/** An HSV threshold window for one colored square. Members are plain ints so that they
+ *  can be handed straight to createTrackbar() for tuning.
+ */
+struct ColorMask
+{
+    int iLowH;
+    int iHighH;
+    int iLowS;
+    int iHighS;
+    int iLowV;
+    int iHighV;
+};
+
+/** The centroid of one colored square, in whatever frame the caller last put it in
+ *  (image pixels straight out of findSquares(), arena units after toArena()).
+ */
+struct SquareDetection
+{
+    bool found;                         ///< True if the mask area was above SQUARE_MIN_AREA
+    double x;
+    double y;
+    double area;                        ///< Mask area in pixels, used to weight detections
+};
+
+/** The pose of one robot as seen by one camera, or as fused from several cameras.
+ */
+struct RobotPose
+{
+    bool valid;                         ///< True if both squares of the robot were seen
+    double x;                           ///< Robot center, arena frame
+    double y;
+    double angle;                       ///< Heading in degrees, front square relative to rear
+    double confidence;                  ///< 0..1, grows with the area of the weaker square
+    int64_t timestamp_us;               ///< Capture time of the frame this came from
+    int camera;                         ///< Camera that produced this pose, -1 if fused
+};
+
+/** How much work findSquaresAt() puts into a frame. Set by FrameBudget, see
+ *  Vision_Budget.h.
+ */
+struct QualityLevel
+{
+    int downsample;                     ///< Frame is shrunk by this factor first, 1 for none
+    int roiHalfSize;                    ///< Search only this far (full frame pixels) around
+                                        ///< where a robot was last seen, 0 for everywhere
+    int robotsTracked;                  ///< Robots 1..n are looked for, the rest are skipped
+};
+
+/// Color masks for squares 1A, 1B, 2A, 2B, 3A, 3B. See the ME507Squares doc on git.
+extern ColorMask squareMasks[NUM_SQUARES];
+
+void findSquares(const cv::Mat& imgOriginal, const ColorMask masks[NUM_SQUARES],
+                 SquareDetection squares[NUM_SQUARES], bool showThreshed = false);
+void findSquaresAt(const cv::Mat& imgOriginal, const ColorMask masks[NUM_SQUARES],
+                   const QualityLevel& quality, const SquareDetection last[NUM_SQUARES],
+                   SquareDetection squares[NUM_SQUARES]);
+bool loadHomography(const std::string& file, cv::Mat& homography);
+void toArena(const cv::Mat& homography, SquareDetection squares[NUM_SQUARES]);
+void resolveRobots(const SquareDetection squares[NUM_SQUARES], int64_t timestamp_us,
+                   int camera, RobotPose robots[NUM_ROBOTS]);
+void drawDetections(cv::Mat& img, const SquareDetection squares[NUM_SQUARES]);
+
+#endif // VISION_PIPELINE_H
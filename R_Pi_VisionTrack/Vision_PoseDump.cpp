@@ -0,0 +1,66 @@
+//**************************************************************************************
+/** \file Vision_PoseDump.cpp
+ *    This file contains a small tool which prints part of a binary pose log as CSV, and
+ *    doubles as an example of using PoseLogReader.
+ *
+ *    Usage: posedump log.pl [from_s [to_s]]
+ *
+ *  Revisions:
+ *    \li 10-18-26 - original file
+ *
+ *  License:
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *    GNU General Public License for more details.
+*/
+//**************************************************************************************
+
+#include <iostream>
+#include <stdlib.h>
+#include "Vision_PoseLog.h"
+
+using namespace std;
+
+int main( int argc, char** argv )
+{
+    if (argc < 2)
+    {
+        cout << "Usage: posedump log.pl [from_s [to_s]]" << endl;
+        return -1;
+    }
+
+    PoseLogReader log;
+    if (!log.open(argv[1]))
+    {
+        cout << "Cannot open pose log " << argv[1] << endl;
+        return -1;
+    }
+    if (log.size() == 0)
+    {
+        return 0;
+    }
+
+    // Times on the command line are seconds from the start of the log
+    int64_t start = log[0].timestamp_us;
+    int64_t from = start + (int64_t)((argc >= 3) ? atof(argv[2]) * 1e6 : 0.0);
+    int64_t to = (argc >= 4) ? start + (int64_t)(atof(argv[3]) * 1e6) : log[log.size() - 1].timestamp_us + 1;
+
+    uint32_t begin, end;
+    log.range(from, to, begin, end);
+    cerr << log.size() << " records, " << (log.indexed() ? "indexed" : "no index")
+         << ", printing " << (end - begin) << endl;
+
+    cout << "frame,time_us,quality,robot,seen,x,y,angle,confidence" << endl;
+    for (uint32_t i = begin; i < end; i++)
+    {
+        const PoseRecord& rec = log[i];
+        for (int r = 0; r < NUM_ROBOTS; r++)
+        {
+            const PoseLogRobot& p = rec.robots[r];
+            cout << rec.frame << "," << rec.timestamp_us << "," << rec.quality << "," << (r + 1) << "," << ((rec.seen >> r) & 1) << ","
+                 << p.x << "," << p.y << "," << p.angle << "," << p.confidence << "\n";
+        }
+    }
+    return 0;
+}
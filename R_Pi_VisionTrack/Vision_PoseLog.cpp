@@ -0,0 +1,334 @@
+//**************************************************************************************
+/** \file Vision_PoseLog.cpp
+ *    This file contains the binary pose log written by the tracker and the reader used
+ *    by analysis tools to get at it. See Vision_PoseLog.h for the file layout.
+ *
+ *  Revisions:
+ *    \li 10-18-26 - original file
+ *    \li 10-18-26 - version 2, records carry the quality level
+ *    \li 10-19-26 - reader rejects a header size outside the file
+ *
+ *  License:
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *    GNU General Public License for more details.
+*/
+//**************************************************************************************
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "Vision_PoseLog.h"
+
+using namespace std;
+
+// The layout is the file format; make sure the compiler didn't pad anything
+static_assert(sizeof(PoseLogHeader) == 208, "PoseLogHeader layout changed");
+static_assert(sizeof(PoseRecord) == 16 + 16*NUM_ROBOTS, "PoseRecord layout changed");
+static_assert(sizeof(PoseLogTrailer) == 32, "PoseLogTrailer layout changed");
+
+//-------------------------------------------------------------------------------------
+/** This constructor makes a writer with no file open.
+ */
+PoseLogWriter::PoseLogWriter() : file(NULL), numRecords(0), firstTimestamp_us(0), lastTimestamp_us(0)
+{
+}
+
+//-------------------------------------------------------------------------------------
+/** The destructor closes the log so that the index gets written.
+ */
+PoseLogWriter::~PoseLogWriter()
+{
+    close();
+}
+
+//-------------------------------------------------------------------------------------
+/** This method creates (or truncates) a log and writes its header.
+ *  @param path Where to write the log
+ *  @param masks The color masks the tracker is using
+ *  @param numCameras Number of cameras feeding the tracker, kept for reference
+ *  @return True if the file was created
+ */
+bool PoseLogWriter::open(const string& path, const ColorMask masks[NUM_SQUARES], int numCameras)
+{
+    close();
+    file = fopen(path.c_str(), "wb");
+    if (file == NULL)
+    {
+        return false;
+    }
+
+    PoseLogHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, POSELOG_MAGIC, sizeof(hdr.magic));
+    hdr.version = POSELOG_VERSION;
+    hdr.headerSize = sizeof(PoseLogHeader);
+    hdr.recordSize = sizeof(PoseRecord);
+    hdr.numRobots = NUM_ROBOTS;
+    hdr.indexInterval_us = POSELOG_INDEX_INTERVAL_US;
+    hdr.numCameras = numCameras;
+    hdr.created = (int64_t)time(NULL);
+    for (int i = 0; i < NUM_SQUARES; i++)
+    {
+        hdr.masks[i][0] = masks[i].iLowH;
+        hdr.masks[i][1] = masks[i].iHighH;
+        hdr.masks[i][2] = masks[i].iLowS;
+        hdr.masks[i][3] = masks[i].iHighS;
+        hdr.masks[i][4] = masks[i].iLowV;
+        hdr.masks[i][5] = masks[i].iHighV;
+    }
+    fwrite(&hdr, sizeof(hdr), 1, file);
+
+    numRecords = 0;
+    index.clear();
+    memset(held, 0, sizeof(held));
+    return true;
+}
+
+//-------------------------------------------------------------------------------------
+/** This method appends one frame's poses. Robots that weren't seen are stored with
+ *  their last seen pose and their bit in PoseRecord::seen clear.
+ *  @param timestamp_us Frame time; must not go backwards
+ *  @param robots The frame's poses
+ *  @param quality The frame budget level the poses were found at
+ *  @return False if no log is open or the timestamp went backwards, in which case
+ *          nothing was written
+ */
+bool PoseLogWriter::append(int64_t timestamp_us, const RobotPose robots[NUM_ROBOTS], int quality)
+{
+    if (file == NULL || (numRecords > 0 && timestamp_us < lastTimestamp_us))
+    {
+        return false;
+    }
+    if (numRecords == 0)
+    {
+        firstTimestamp_us = timestamp_us;
+    }
+
+    // Every index boundary up to this record's time now points at it
+    while (firstTimestamp_us + (int64_t)index.size() * POSELOG_INDEX_INTERVAL_US <= timestamp_us)
+    {
+        index.push_back(numRecords);
+    }
+
+    PoseRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.timestamp_us = timestamp_us;
+    rec.frame = numRecords;
+    rec.quality = (uint16_t)quality;
+    for (int r = 0; r < NUM_ROBOTS; r++)
+    {
+        if (robots[r].valid)
+        {
+            rec.seen |= (uint16_t)(1 << r);
+            held[r].x = (float)robots[r].x;
+            held[r].y = (float)robots[r].y;
+            held[r].angle = (float)robots[r].angle;
+            held[r].confidence = (float)robots[r].confidence;
+        }
+        rec.robots[r] = held[r];
+    }
+    fwrite(&rec, sizeof(rec), 1, file);
+
+    numRecords++;
+    lastTimestamp_us = timestamp_us;
+    return true;
+}
+
+//-------------------------------------------------------------------------------------
+/** This method writes the index and trailer and closes the file. Safe to call when no
+ *  log is open.
+ */
+void PoseLogWriter::close()
+{
+    if (file == NULL)
+    {
+        return;
+    }
+
+    PoseLogTrailer trailer;
+    memset(&trailer, 0, sizeof(trailer));
+    memcpy(trailer.magic, POSELOG_INDEX_MAGIC, sizeof(trailer.magic));
+    // Pad the index to an even count so the trailer's 64 bit fields stay aligned. The
+    // extra entry points past the last record, which is what it means anyway.
+    if (index.size() % 2 != 0)
+    {
+        index.push_back(numRecords);
+    }
+    trailer.indexOffset = sizeof(PoseLogHeader) + (uint64_t)numRecords * sizeof(PoseRecord);
+    trailer.numEntries = (uint32_t)index.size();
+    trailer.numRecords = numRecords;
+    trailer.firstTimestamp_us = firstTimestamp_us;
+    if (!index.empty())
+    {
+        fwrite(&index[0], sizeof(uint32_t), index.size(), file);
+    }
+    fwrite(&trailer, sizeof(trailer), 1, file);
+
+    fclose(file);
+    file = NULL;
+}
+
+//-------------------------------------------------------------------------------------
+/** This constructor makes a reader with nothing mapped.
+ */
+PoseLogReader::PoseLogReader()
+    : fd(-1), base(NULL), length(0), hdr(NULL), records(NULL), numRecords(0),
+      index(NULL), numEntries(0), firstTimestamp_us(0)
+{
+}
+
+//-------------------------------------------------------------------------------------
+/** The destructor unmaps the log.
+ */
+PoseLogReader::~PoseLogReader()
+{
+    close();
+}
+
+//-------------------------------------------------------------------------------------
+/** This method maps a log and checks its header. If the trailer is missing or doesn't
+ *  add up (the writer didn't get to close the log), the records are counted from the
+ *  file size instead and seeks use a binary search.
+ *  @param path The log to open
+ *  @return True if the file is a pose log this reader understands
+ */
+bool PoseLogReader::open(const string& path)
+{
+    close();
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(PoseLogHeader))
+    {
+        close();
+        return false;
+    }
+    length = (size_t)st.st_size;
+    base = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED)
+    {
+        base = NULL;
+        close();
+        return false;
+    }
+
+    const uint8_t* bytes = (const uint8_t*)base;
+    hdr = (const PoseLogHeader*)bytes;
+    if (memcmp(hdr->magic, POSELOG_MAGIC, sizeof(hdr->magic)) != 0 || (hdr->version < 1 || hdr->version > POSELOG_VERSION)
+        || hdr->recordSize != sizeof(PoseRecord) || hdr->numRobots != NUM_ROBOTS
+        || hdr->headerSize < sizeof(PoseLogHeader) || hdr->headerSize > length)
+    {
+        close();
+        return false;
+    }
+    records = (const PoseRecord*)(bytes + hdr->headerSize);
+
+    // Use the trailer if it is there and consistent with the file size
+    if (length >= hdr->headerSize + sizeof(PoseLogTrailer))
+    {
+        const PoseLogTrailer* trailer = (const PoseLogTrailer*)(bytes + length - sizeof(PoseLogTrailer));
+        if (memcmp(trailer->magic, POSELOG_INDEX_MAGIC, sizeof(trailer->magic)) == 0
+            && trailer->indexOffset == hdr->headerSize + (uint64_t)trailer->numRecords * sizeof(PoseRecord)
+            && trailer->indexOffset + (uint64_t)trailer->numEntries * sizeof(uint32_t) + sizeof(PoseLogTrailer) == length)
+        {
+            numRecords = trailer->numRecords;
+            index = (const uint32_t*)(bytes + trailer->indexOffset);
+            numEntries = trailer->numEntries;
+            firstTimestamp_us = trailer->firstTimestamp_us;
+            return true;
+        }
+    }
+    numRecords = (uint32_t)((length - hdr->headerSize) / sizeof(PoseRecord));
+    return true;
+}
+
+//-------------------------------------------------------------------------------------
+/** This method unmaps the log. Safe to call when nothing is open.
+ */
+void PoseLogReader::close()
+{
+    if (base != NULL)
+    {
+        munmap(base, length);
+    }
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+    fd = -1;
+    base = NULL;
+    length = 0;
+    hdr = NULL;
+    records = NULL;
+    numRecords = 0;
+    index = NULL;
+    numEntries = 0;
+}
+
+//-------------------------------------------------------------------------------------
+/** This method finds the first record in [lo, hi) at or after a time.
+ *  @return The record number, hi if there is none
+ */
+uint32_t PoseLogReader::search(int64_t timestamp_us, uint32_t lo, uint32_t hi) const
+{
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo)/2;
+        if (records[mid].timestamp_us < timestamp_us)
+        {
+            lo = mid + 1;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+//-------------------------------------------------------------------------------------
+/** This method finds the first record at or after a time. With an index this only has
+ *  to search the records within one index interval, so it takes the same time however
+ *  long the log is.
+ *  @param timestamp_us The time to look for
+ *  @return The record number, size() if every record is earlier
+ */
+uint32_t PoseLogReader::seek(int64_t timestamp_us) const
+{
+    if (index == NULL || numEntries == 0)
+    {
+        return search(timestamp_us, 0, numRecords);
+    }
+    if (timestamp_us <= firstTimestamp_us)
+    {
+        return 0;
+    }
+    uint64_t k = (uint64_t)(timestamp_us - firstTimestamp_us) / hdr->indexInterval_us;
+    if (k >= numEntries)
+    {
+        return search(timestamp_us, index[numEntries - 1], numRecords);
+    }
+    uint32_t hi = (k + 1 < numEntries) ? index[k + 1] : numRecords;
+    return search(timestamp_us, index[k], hi);
+}
+
+//-------------------------------------------------------------------------------------
+/** This method finds the records in a time range, for scanning with operator[].
+ *  @param from_us Start of the range, inclusive
+ *  @param to_us End of the range, exclusive
+ *  @param begin Output, first record in the range
+ *  @param end Output, one past the last record in the range
+ */
+void PoseLogReader::range(int64_t from_us, int64_t to_us, uint32_t& begin, uint32_t& end) const
+{
+    begin = seek(from_us);
+    end = (to_us > from_us) ? seek(to_us) : begin;
+}
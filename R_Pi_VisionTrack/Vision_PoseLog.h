@@ -0,0 +1,144 @@
+//**************************************************************************************
+/** \file Vision_PoseLog.h
+ *    This file contains the binary pose log written by the tracker and the reader used
+ *    by analysis tools to get at it.
+ *
+ *    A log is a header, then one fixed-size PoseRecord per frame in time order, and, if
+ *    the writer was closed cleanly, a time index and trailer at the end. The file is
+ *    only ever appended to, so a run that dies part way still leaves every record up
+ *    to the crash readable; without the trailer the reader simply falls back to a
+ *    binary search over the records. Everything is stored in the host's (little
+ *    endian) byte order.
+ *
+ *  Revisions:
+ *    \li 10-18-26 - original file
+ *    \li 10-18-26 - version 2, records carry the quality level
+ *
+ *  License:
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *    GNU General Public License for more details.
+*/
+//**************************************************************************************
+
+#ifndef VISION_POSELOG_H
+#define VISION_POSELOG_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "Vision_Pipeline.h"
+
+#define POSELOG_MAGIC "ME507POS"            ///< First 8 bytes of every log
+#define POSELOG_INDEX_MAGIC "ME507IDX"      ///< First 8 bytes of the trailer
+#define POSELOG_VERSION 2                   ///< 2 added PoseRecord::quality, 1 is still read
+#define POSELOG_INDEX_INTERVAL_US 100000    ///< One index entry per 100 ms of log
+
+/// File header, written once when the log is created
+struct PoseLogHeader
+{
+    char magic[8];                          ///< POSELOG_MAGIC
+    uint16_t version;                       ///< POSELOG_VERSION
+    uint16_t headerSize;                    ///< sizeof(PoseLogHeader), records start here
+    uint16_t recordSize;                    ///< sizeof(PoseRecord)
+    uint16_t numRobots;                     ///< NUM_ROBOTS of the tracker that wrote it
+    uint32_t indexInterval_us;              ///< Time covered by each index entry
+    uint32_t numCameras;
+    int64_t created;                        ///< Wall clock seconds when the log was opened
+    int32_t masks[NUM_SQUARES][6];          ///< Color masks in use, in ColorMask order
+    uint8_t reserved[32];
+};
+
+/// The pose of one robot as stored in the log
+struct PoseLogRobot
+{
+    float x;
+    float y;
+    float angle;                            ///< Degrees
+    float confidence;
+};
+
+/// One frame's worth of poses
+struct PoseRecord
+{
+    int64_t timestamp_us;                   ///< Frame time, never decreases through the log
+    uint32_t frame;                         ///< Frame number from the start of the log
+    uint16_t seen;                          ///< Bit r set if robot r was seen in this frame
+    uint16_t quality;                       ///< Frame budget level, 0 is full quality
+    PoseLogRobot robots[NUM_ROBOTS];        ///< Robots not seen hold their last pose
+};
+
+/// Last bytes of a cleanly closed log, after the index entries
+struct PoseLogTrailer
+{
+    char magic[8];                          ///< POSELOG_INDEX_MAGIC
+    uint64_t indexOffset;                   ///< File offset of the first index entry
+    uint32_t numEntries;                    ///< Number of uint32_t index entries
+    uint32_t numRecords;
+    int64_t firstTimestamp_us;              ///< Time of index entry 0
+};
+
+//-------------------------------------------------------------------------------------
+/** This class writes a pose log. Entry k of the index is the number of the first
+ *  record at or after firstTimestamp + k*POSELOG_INDEX_INTERVAL_US, built up as records
+ *  go by and written out by close().
+ */
+class PoseLogWriter
+{
+public:
+    PoseLogWriter();
+    ~PoseLogWriter();
+
+    bool open(const std::string& path, const ColorMask masks[NUM_SQUARES], int numCameras);
+    bool append(int64_t timestamp_us, const RobotPose robots[NUM_ROBOTS], int quality = 0);
+    void close();
+    bool isOpen() const { return file != NULL; }
+
+private:
+    FILE* file;
+    uint32_t numRecords;
+    int64_t firstTimestamp_us;
+    int64_t lastTimestamp_us;
+    PoseLogRobot held[NUM_ROBOTS];          ///< Last seen pose of each robot
+    std::vector<uint32_t> index;
+};
+
+//-------------------------------------------------------------------------------------
+/** This class maps a pose log into memory for reading. Records are returned by pointer
+ *  straight out of the mapping, so nothing is read until it is touched and opening an
+ *  hours long log costs the same as opening a short one.
+ */
+class PoseLogReader
+{
+public:
+    PoseLogReader();
+    ~PoseLogReader();
+
+    bool open(const std::string& path);
+    void close();
+
+    const PoseLogHeader& header() const { return *hdr; }
+    uint32_t size() const { return numRecords; }
+    const PoseRecord& operator[](uint32_t i) const { return records[i]; }
+    bool indexed() const { return index != NULL; }
+
+    uint32_t seek(int64_t timestamp_us) const;
+    void range(int64_t from_us, int64_t to_us, uint32_t& begin, uint32_t& end) const;
+
+private:
+    uint32_t search(int64_t timestamp_us, uint32_t lo, uint32_t hi) const;
+
+    int fd;
+    void* base;
+    size_t length;
+    const PoseLogHeader* hdr;
+    const PoseRecord* records;
+    uint32_t numRecords;
+    const uint32_t* index;                  ///< NULL if the log has no trailer
+    uint32_t numEntries;
+    int64_t firstTimestamp_us;
+};
+
+#endif // VISION_POSELOG_H
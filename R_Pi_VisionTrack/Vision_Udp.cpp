@@ -0,0 +1,265 @@
+//**************************************************************************************
+/** \file Vision_Udp.cpp
+ *    This file contains the UDP publisher which sends the fused robot poses out of the
+ *    tracker, and the matching receiver. See Vision_Udp.h for the packet format.
+ *
+ *  Revisions:
+ *    \li 10-18-26 - original file
+ *    \li 10-18-26 - version 2, packets carry the quality level
+ *
+ *  License:
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *    GNU General Public License for more details.
+*/
+//**************************************************************************************
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "Vision_Udp.h"
+
+using namespace std;
+
+static_assert(sizeof(PosePacket) == 24 + 16*NUM_ROBOTS, "PosePacket layout changed");
+
+/// A sequence number this far behind the last one means the sender was restarted
+#define POSE_SEQ_RESTART 1000
+
+//-------------------------------------------------------------------------------------
+/** This constructor makes a sender with no socket.
+ */
+PoseSender::PoseSender() : sock(-1), seq(0)
+{
+    memset(&addr, 0, sizeof(addr));
+}
+
+//-------------------------------------------------------------------------------------
+/** The destructor closes the socket.
+ */
+PoseSender::~PoseSender()
+{
+    close();
+}
+
+//-------------------------------------------------------------------------------------
+/** This method opens a socket for sending to one address. Multicast addresses
+ *  (224.0.0.0 to 239.255.255.255) get the given TTL and local loopback turned on so
+ *  a receiver on the Pi itself also sees the packets.
+ *  @param dest Destination as \c host:port, or just \c host for POSE_UDP_PORT
+ *  @param ttl Multicast time to live; 1 keeps packets on the local network
+ *  @return True if the address parsed and the socket opened
+ */
+bool PoseSender::open(const string& dest, int ttl)
+{
+    close();
+
+    size_t colon = dest.find(':');
+    string host = dest.substr(0, colon);
+    int port = (colon == string::npos) ? POSE_UDP_PORT : atoi(dest.c_str() + colon + 1);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1)
+    {
+        return false;
+    }
+
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0)
+    {
+        return false;
+    }
+    if (IN_MULTICAST(ntohl(addr.sin_addr.s_addr)))
+    {
+        unsigned char t = (unsigned char)ttl;
+        unsigned char loop = 1;
+        setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &t, sizeof(t));
+        setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    }
+    else if (addr.sin_addr.s_addr == htonl(INADDR_BROADCAST))
+    {
+        int on = 1;
+        setsockopt(sock, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+    }
+    seq = 0;
+    return true;
+}
+
+//-------------------------------------------------------------------------------------
+/** This method sends one frame's poses. It never blocks; if the socket buffer is full
+ *  the packet is simply lost, since the next frame will supersede it anyway.
+ *  @param timestamp_us Frame time of the poses
+ *  @param robots The poses
+ *  @param quality The frame budget level the poses were found at
+ *  @return True if the packet was handed to the network
+ */
+bool PoseSender::send(int64_t timestamp_us, const RobotPose robots[NUM_ROBOTS], int quality)
+{
+    if (sock < 0)
+    {
+        return false;
+    }
+
+    PosePacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.magic = POSE_PACKET_MAGIC;
+    packet.version = POSE_PACKET_VERSION;
+    packet.seq = seq++;
+    packet.quality = (uint16_t)quality;
+    packet.timestamp_us = timestamp_us;
+    for (int r = 0; r < NUM_ROBOTS; r++)
+    {
+        if (robots[r].valid)
+        {
+            packet.seen |= (uint16_t)(1 << r);
+        }
+        packet.robots[r].x = (float)robots[r].x;
+        packet.robots[r].y = (float)robots[r].y;
+        packet.robots[r].angle = (float)robots[r].angle;
+        packet.robots[r].confidence = (float)robots[r].confidence;
+    }
+
+    return sendto(sock, &packet, sizeof(packet), MSG_DONTWAIT, (sockaddr*)&addr, sizeof(addr))
+           == (ssize_t)sizeof(packet);
+}
+
+//-------------------------------------------------------------------------------------
+/** This method closes the socket. Safe to call when nothing is open.
+ */
+void PoseSender::close()
+{
+    if (sock >= 0)
+    {
+        ::close(sock);
+    }
+    sock = -1;
+}
+
+//-------------------------------------------------------------------------------------
+/** This constructor makes a receiver with no socket.
+ */
+PoseReceiver::PoseReceiver() : sock(-1), haveLast(false), lastSeq(0), numDropped(0)
+{
+}
+
+//-------------------------------------------------------------------------------------
+/** The destructor closes the socket.
+ */
+PoseReceiver::~PoseReceiver()
+{
+    close();
+}
+
+//-------------------------------------------------------------------------------------
+/** This method binds a socket to a port, and joins a multicast group if one is given.
+ *  @param port The port to listen on
+ *  @param group Multicast group to join, empty for unicast or broadcast
+ *  @return True if the socket is ready
+ */
+bool PoseReceiver::open(int port, const string& group)
+{
+    close();
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0)
+    {
+        return false;
+    }
+    int on = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_port = htons((uint16_t)port);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(sock, (sockaddr*)&local, sizeof(local)) != 0)
+    {
+        close();
+        return false;
+    }
+
+    if (!group.empty())
+    {
+        ip_mreq mreq;
+        memset(&mreq, 0, sizeof(mreq));
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (inet_pton(AF_INET, group.c_str(), &mreq.imr_multiaddr) != 1
+            || setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0)
+        {
+            close();
+            return false;
+        }
+    }
+    haveLast = false;
+    numDropped = 0;
+    return true;
+}
+
+//-------------------------------------------------------------------------------------
+/** This method waits for the next packet. Packets whose sequence number isn't newer
+ *  than the last one accepted are dropped, comparing with wraparound so the 32 bit
+ *  counter rolling over is harmless. A sequence number far behind the last one is
+ *  taken to mean the tracker was restarted, and is accepted.
+ *  @param packet Output, the packet if POSE_RX_OK is returned
+ *  @param timeout_ms How long to wait; -1 waits forever
+ *  @return What became of the datagram
+ */
+PoseRxStatus PoseReceiver::receive(PosePacket& packet, int timeout_ms)
+{
+    if (sock < 0)
+    {
+        return POSE_RX_ERROR;
+    }
+    pollfd pfd;
+    pfd.fd = sock;
+    pfd.events = POLLIN;
+    int ready = poll(&pfd, 1, timeout_ms);
+    if (ready == 0)
+    {
+        return POSE_RX_TIMEOUT;
+    }
+    if (ready < 0)
+    {
+        return POSE_RX_ERROR;
+    }
+
+    ssize_t n = recv(sock, &packet, sizeof(packet), 0);
+    if (n < 0)
+    {
+        return POSE_RX_ERROR;
+    }
+    if (n != (ssize_t)sizeof(packet) || packet.magic != POSE_PACKET_MAGIC
+        || packet.version != POSE_PACKET_VERSION)
+    {
+        numDropped++;
+        return POSE_RX_BAD;
+    }
+
+    int32_t ahead = (int32_t)(packet.seq - lastSeq);
+    if (haveLast && ahead <= 0 && ahead > -POSE_SEQ_RESTART)
+    {
+        numDropped++;
+        return POSE_RX_STALE;
+    }
+    haveLast = true;
+    lastSeq = packet.seq;
+    return POSE_RX_OK;
+}
+
+//-------------------------------------------------------------------------------------
+/** This method closes the socket. Safe to call when nothing is open.
+ */
+void PoseReceiver::close()
+{
+    if (sock >= 0)
+    {
+        ::close(sock);
+    }
+    sock = -1;
+}
@@ -0,0 +1,103 @@
+//**************************************************************************************
+/** \file Vision_Udp.h
+ *    This file contains the UDP publisher which sends the fused robot poses out of the
+ *    tracker, and the matching receiver.
+ *
+ *    Each datagram is one PosePacket carrying every robot, so a receiver never has to
+ *    piece a frame together. The tracker sends only the newest pose set once per frame;
+ *    updates that arrive in between are coalesced rather than queued. Packets carry a
+ *    sequence number and the frame time, and the receiver throws away anything that
+ *    isn't newer than what it already has.
+ *
+ *  Revisions:
+ *    \li 10-18-26 - original file
+ *    \li 10-18-26 - version 2, packets carry the quality level
+ *
+ *  License:
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *    GNU General Public License for more details.
+*/
+//**************************************************************************************
+
+#ifndef VISION_UDP_H
+#define VISION_UDP_H
+
+#include <stdint.h>
+#include <string>
+#include <netinet/in.h>
+#include "Vision_Pipeline.h"
+#include "Vision_PoseLog.h"
+
+#define POSE_PACKET_MAGIC 0x37303545        ///< "E507" as little endian bytes
+#define POSE_PACKET_VERSION 2               ///< 2 added PosePacket::quality
+#define POSE_UDP_PORT 5507                  ///< Default port
+
+/// One datagram, little endian
+struct PosePacket
+{
+    uint32_t magic;                         ///< POSE_PACKET_MAGIC
+    uint16_t version;                       ///< POSE_PACKET_VERSION
+    uint16_t seen;                          ///< Bit r set if robot r was seen in this frame
+    uint32_t seq;                           ///< Counts up by one per packet, wraps
+    uint16_t quality;                       ///< Frame budget level, 0 is full quality
+    uint16_t reserved;
+    int64_t timestamp_us;                   ///< Frame time of the poses
+    PoseLogRobot robots[NUM_ROBOTS];        ///< Same layout as in the pose log
+};
+
+/// What PoseReceiver::receive() made of a datagram
+enum PoseRxStatus
+{
+    POSE_RX_OK,                             ///< New packet, returned to the caller
+    POSE_RX_TIMEOUT,                        ///< Nothing arrived in time
+    POSE_RX_STALE,                          ///< Older than or same as the last packet
+    POSE_RX_BAD,                            ///< Not a pose packet
+    POSE_RX_ERROR                           ///< Socket error
+};
+
+//-------------------------------------------------------------------------------------
+/** This class sends pose packets to one unicast or multicast address.
+ */
+class PoseSender
+{
+public:
+    PoseSender();
+    ~PoseSender();
+
+    bool open(const std::string& dest, int ttl = 1);
+    bool send(int64_t timestamp_us, const RobotPose robots[NUM_ROBOTS], int quality = 0);
+    void close();
+    bool isOpen() const { return sock >= 0; }
+
+private:
+    int sock;
+    sockaddr_in addr;
+    uint32_t seq;
+};
+
+//-------------------------------------------------------------------------------------
+/** This class receives pose packets, optionally joining a multicast group, and drops
+ *  duplicates and packets which arrive out of order.
+ */
+class PoseReceiver
+{
+public:
+    PoseReceiver();
+    ~PoseReceiver();
+
+    bool open(int port, const std::string& group = "");
+    PoseRxStatus receive(PosePacket& packet, int timeout_ms);
+    void close();
+
+    uint32_t dropped() const { return numDropped; }
+
+private:
+    int sock;
+    bool haveLast;
+    uint32_t lastSeq;
+    uint32_t numDropped;                    ///< Stale or bad packets thrown away
+};
+
+#endif // VISION_UDP_H
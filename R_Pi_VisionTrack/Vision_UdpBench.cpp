@@ -0,0 +1,151 @@
+//**************************************************************************************
+/** \file Vision_UdpBench.cpp
+ *    This file contains a test tool for the UDP pose packets. It can listen and print
+ *    what the tracker is sending, or run a loopback benchmark of PoseSender and
+ *    PoseReceiver on one machine.
+ *
+ *    Usage: udpbench listen [port [group]]
+ *           udpbench bench [packets [rate_hz]]
+ *
+ *  Revisions:
+ *    \li 10-18-26 - original file
+ *
+ *  License:
+ *    This program is distributed in the hope that it will be useful,
+ *    but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *    GNU General Public License for more details.
+*/
+//**************************************************************************************
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Vision_Udp.h"
+
+using namespace std;
+
+#define BENCH_PORT (POSE_UDP_PORT + 1)      ///< Keeps the benchmark off a live tracker
+
+/// Microseconds on the monotonic clock, shared by both ends of the benchmark
+static int64_t now_us()
+{
+    return chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//-------------------------------------------------------------------------------------
+/** This function prints every packet accepted, with a running count of drops.
+ */
+static int listen(int port, const string& group)
+{
+    PoseReceiver rx;
+    if (!rx.open(port, group))
+    {
+        cout << "Cannot listen on port " << port << endl;
+        return -1;
+    }
+    PosePacket packet;
+    while (true)
+    {
+        if (rx.receive(packet, -1) != POSE_RX_OK)
+        {
+            continue;
+        }
+        cout << "seq " << packet.seq << " t " << packet.timestamp_us << " q " << packet.quality
+             << " dropped " << rx.dropped();
+        for (int r = 0; r < NUM_ROBOTS; r++)
+        {
+            const PoseLogRobot& p = packet.robots[r];
+            cout << " | " << (r + 1) << ((packet.seen >> r) & 1 ? " " : "* ") << p.x << "," << p.y << "," << p.angle;
+        }
+        cout << endl;
+    }
+    return 0;
+}
+
+//-------------------------------------------------------------------------------------
+/** This function sends packets to a receiver thread over loopback and reports the
+ *  throughput, losses and one-way latency. The timestamp field carries the send time
+ *  so the receiver can work out the latency on the same clock.
+ */
+static int bench(int count, int rate_hz)
+{
+    PoseReceiver rx;
+    PoseSender tx;
+    if (!rx.open(BENCH_PORT) || !tx.open("127.0.0.1:" + to_string(BENCH_PORT)))
+    {
+        cout << "Cannot open loopback sockets" << endl;
+        return -1;
+    }
+
+    vector<int64_t> latency;
+    latency.reserve(count);
+    thread receiver([&]()
+    {
+        PosePacket packet;
+        PoseRxStatus status;
+        while ((status = rx.receive(packet, 500)) != POSE_RX_TIMEOUT && status != POSE_RX_ERROR)
+        {
+            if (status == POSE_RX_OK)
+            {
+                latency.push_back(now_us() - packet.timestamp_us);
+            }
+        }
+    });
+
+    RobotPose robots[NUM_ROBOTS];
+    for (int r = 0; r < NUM_ROBOTS; r++)
+    {
+        robots[r] = RobotPose();
+        robots[r].valid = true;
+    }
+
+    int64_t start = now_us();
+    int sent = 0;
+    for (int i = 0; i < count; i++)
+    {
+        if (rate_hz > 0)
+        {
+            this_thread::sleep_until(chrono::steady_clock::time_point(
+                chrono::microseconds(start + (int64_t)i * 1000000 / rate_hz)));
+        }
+        robots[0].x = i;
+        sent += tx.send(now_us(), robots) ? 1 : 0;
+    }
+    int64_t elapsed = now_us() - start;
+    receiver.join();
+
+    cout << "sent " << sent << " of " << count << " in " << elapsed / 1000.0 << " ms ("
+         << (elapsed > 0 ? sent * 1e6 / elapsed : 0.0) << " packets/s, "
+         << sizeof(PosePacket) << " bytes each)" << endl;
+    cout << "received " << latency.size() << ", dropped stale/bad " << rx.dropped()
+         << ", lost " << (sent - (int)latency.size() - (int)rx.dropped()) << endl;
+    if (!latency.empty())
+    {
+        sort(latency.begin(), latency.end());
+        cout << "latency us: min " << latency.front() << " median " << latency[latency.size()/2]
+             << " p99 " << latency[latency.size()*99/100] << " max " << latency.back() << endl;
+    }
+    return 0;
+}
+
+int main( int argc, char** argv )
+{
+    string mode = (argc >= 2) ? argv[1] : "";
+    if (mode == "listen")
+    {
+        return listen((argc >= 3) ? atoi(argv[2]) : POSE_UDP_PORT, (argc >= 4) ? argv[3] : "");
+    }
+    if (mode == "bench")
+    {
+        return bench((argc >= 3) ? atoi(argv[2]) : 100000, (argc >= 4) ? atoi(argv[3]) : 0);
+    }
+    cout << "Usage: udpbench listen [port [group]]" << endl
+         << "       udpbench bench [packets [rate_hz]]" << endl;
+    return -1;
+}